@@ -21,8 +21,13 @@ std::mutex mtx;
 std::unordered_map<int, bool> updated;
 int update_list[NUM_THREAD][MAX_TRX + 1][MAX_TRXSEQ + 1];
 
-int main() {
+int main(int argc, char* argv[]) {
+    // usage: testapp [lock|occ]
+    bool optimistic = argc > 1 && std::strcmp(argv[1], "occ") == 0;
+
     Database dbms(100000);
+    dbms.set_concurrency(
+        optimistic ? Concurrency::OPTIMISTIC : Concurrency::LOCKING);
     tableid_t tid = dbms.open_table("db");
 
     std::vector<Record> keys = dbms.find_range(
@@ -84,7 +89,10 @@ int main() {
                 }
 
                 update_list[i][j][MAX_TRXSEQ] = idx;
-                dbms.end_trx(xid);
+                // optimistic transaction could be aborted on validation
+                if (dbms.end_trx(xid) == Status::FAILURE) {
+                    state = TrxState::INVALID;
+                }
 
                 if (state == TrxState::INVALID) {
                     if (++aborts > MAX_ABORTS) {
@@ -127,6 +135,7 @@ int main() {
 
     size_t tick = duration_cast<milliseconds>(end - now).count();
     std::cout << '\r'
+        << (optimistic ? "[occ] " : "[lock] ")
         << nquery.load() << " queris (" << updates.load() << " updates), "
         << ntrxs.load() << " trxs, "
         << tick << "ms (" << (static_cast<double>(nquery.load()) / tick) << "/ms, "
@@ -0,0 +1,221 @@
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "join.hpp"
+#include "table_manager.hpp"
+
+/// Aggregated value extracted from the record.
+using aggval_t = int64_t;
+
+/// Partial or final aggregates of the values.
+struct Aggregate {
+    size_t count;       /// the number of the values.
+    aggval_t sum;       /// sum of the values, invalid if overflow.
+    aggval_t min;       /// minimum value, maximum of aggval_t if empty.
+    aggval_t max;       /// maximum value, minimum of aggval_t if empty.
+    bool overflow;      /// whether the sum is out of the range of aggval_t.
+
+    /// Construct empty aggregate.
+    Aggregate();
+
+    /// Add value, overflow of the sum is marked instead of wrapped.
+    /// \param value aggval_t, value.
+    void add(aggval_t value);
+
+    /// Merge partial aggregate.
+    /// \param other Aggregate const&, other partial aggregate.
+    void merge(Aggregate const& other);
+
+    /// Get the average of the values.
+    /// \return double, average, zero if empty.
+    double avg() const;
+};
+
+namespace AggregateOper {
+
+/// Extract the value of the record as decimal integer, leading digits
+/// of the null terminated value are parsed and the others are ignored.
+/// \param record Record const&, record.
+/// \return aggval_t, parsed value, zero if not a number, saturated to
+/// the range of aggval_t if too many digits.
+aggval_t value_as_int(Record const& record);
+
+/// Scan the records of the key range in parallel, key range is split on
+/// the separators of the tree and each range is scanned by its worker
+/// leaf by leaf.
+/// \tparam F typename, callback Status(size_t, Record const&), worker
+/// index and record.
+/// \param table Table const*, target table.
+/// \param num_workers size_t, the number of the workers, at least one.
+/// \param start prikey_t, inclusive lower bound.
+/// \param end prikey_t, inclusive upper bound.
+/// \param callback F&&, callback for the records, called concurrently
+/// with the different worker index.
+/// \return Status, whether success to scan or not.
+template <typename F>
+Status parallel_scan(
+    Table const* table, size_t num_workers,
+    prikey_t start, prikey_t end, F&& callback
+) {
+    CHECK_TRUE(num_workers > 0);
+    std::vector<prikey_t> bounds =
+        JoinOper::split_ranges(table, table, num_workers);
+    std::vector<Status> results(bounds.size(), Status::SUCCESS);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        prikey_t lower = std::max(bounds[i], start);
+        prikey_t upper = i + 1 < bounds.size()
+            ? std::min<prikey_t>(bounds[i + 1] - 1, end)
+            : end;
+        if (lower > upper) {
+            continue;
+        }
+        workers.emplace_back([&, i, lower, upper] {
+            for (auto iter = table->batches(lower, upper);
+                 iter.valid();
+                 iter.next()
+            ) {
+                for (Record const& rec : iter.batch()) {
+                    if (callback(i, rec) == Status::FAILURE) {
+                        results[i] = Status::FAILURE;
+                        return;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (Status res : results) {
+        CHECK_SUCCESS(res);
+    }
+    return Status::SUCCESS;
+}
+
+/// Count, sum, min, max and average of the extracted values.
+/// \tparam V typename, value extractor aggval_t(Record const&).
+/// \param table Table const*, target table.
+/// \param extract V&&, value extractor, called concurrently.
+/// \param result Aggregate&, aggregates of the values.
+/// \param num_workers size_t, the number of the workers.
+/// \param start prikey_t, inclusive lower bound.
+/// \param end prikey_t, inclusive upper bound.
+/// \return Status, whether success to aggregate or not, failure if the
+/// sum is overflowed.
+template <typename V>
+Status aggregate(
+    Table const* table, V&& extract, Aggregate& result,
+    size_t num_workers = 1,
+    prikey_t start = std::numeric_limits<prikey_t>::min(),
+    prikey_t end = std::numeric_limits<prikey_t>::max()
+) {
+    // partial aggregates per worker, merged after the scan
+    std::vector<Aggregate> partials(num_workers);
+    CHECK_SUCCESS(parallel_scan(
+        table, num_workers, start, end,
+        [&](size_t worker, Record const& rec) {
+            partials[worker].add(extract(rec));
+            return Status::SUCCESS;
+        }));
+
+    result = Aggregate();
+    for (Aggregate const& partial : partials) {
+        result.merge(partial);
+    }
+    CHECK_TRUE(!result.overflow);
+    return Status::SUCCESS;
+}
+
+/// Distinct values extracted from the records.
+/// \tparam V typename, hashable value extractor T(Record const&).
+/// \tparam T typename, value type.
+/// \param table Table const*, target table.
+/// \param extract V&&, value extractor, called concurrently.
+/// \param values std::vector<T>&, distinct values in ascending order.
+/// \param num_workers size_t, the number of the workers.
+/// \param start prikey_t, inclusive lower bound.
+/// \param end prikey_t, inclusive upper bound.
+/// \return Status, whether success to aggregate or not.
+template <
+    typename V,
+    typename T = std::decay_t<std::result_of_t<V(Record const&)>>>
+Status distinct(
+    Table const* table, V&& extract, std::vector<T>& values,
+    size_t num_workers = 1,
+    prikey_t start = std::numeric_limits<prikey_t>::min(),
+    prikey_t end = std::numeric_limits<prikey_t>::max()
+) {
+    std::vector<std::unordered_set<T>> partials(num_workers);
+    CHECK_SUCCESS(parallel_scan(
+        table, num_workers, start, end,
+        [&](size_t worker, Record const& rec) {
+            partials[worker].insert(extract(rec));
+            return Status::SUCCESS;
+        }));
+
+    std::unordered_set<T>& merged = partials.front();
+    for (size_t i = 1; i < partials.size(); ++i) {
+        merged.insert(partials[i].begin(), partials[i].end());
+        partials[i].clear();
+    }
+    values.assign(merged.begin(), merged.end());
+    std::sort(values.begin(), values.end());
+    return Status::SUCCESS;
+}
+
+/// Aggregates of the extracted values per group, groups are kept in
+/// the hash table of each worker and merged after the scan.
+/// \tparam G typename, hashable group key extractor K(Record const&).
+/// \tparam V typename, value extractor aggval_t(Record const&).
+/// \tparam K typename, group key type.
+/// \param table Table const*, target table.
+/// \param group G&&, group key extractor, called concurrently.
+/// \param extract V&&, value extractor, called concurrently.
+/// \param groups std::unordered_map<K, Aggregate>&, aggregates per group.
+/// \param num_workers size_t, the number of the workers.
+/// \param start prikey_t, inclusive lower bound.
+/// \param end prikey_t, inclusive upper bound.
+/// \return Status, whether success to aggregate or not, failure if the
+/// sum of any group is overflowed.
+template <
+    typename G, typename V,
+    typename K = std::decay_t<std::result_of_t<G(Record const&)>>>
+Status group_by(
+    Table const* table, G&& group, V&& extract,
+    std::unordered_map<K, Aggregate>& groups,
+    size_t num_workers = 1,
+    prikey_t start = std::numeric_limits<prikey_t>::min(),
+    prikey_t end = std::numeric_limits<prikey_t>::max()
+) {
+    std::vector<std::unordered_map<K, Aggregate>> partials(num_workers);
+    CHECK_SUCCESS(parallel_scan(
+        table, num_workers, start, end,
+        [&](size_t worker, Record const& rec) {
+            partials[worker][group(rec)].add(extract(rec));
+            return Status::SUCCESS;
+        }));
+
+    groups = std::move(partials.front());
+    for (size_t i = 1; i < partials.size(); ++i) {
+        for (auto const& pair : partials[i]) {
+            groups[pair.first].merge(pair.second);
+        }
+    }
+    for (auto const& pair : groups) {
+        CHECK_TRUE(!pair.second.overflow);
+    }
+    return Status::SUCCESS;
+}
+}
+
+#endif
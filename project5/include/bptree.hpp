@@ -1,11 +1,17 @@
 #ifndef BPTREE_HPP
 #define BPTREE_HPP
 
+#include <functional>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
 #include <vector>
 
 #include "buffer_manager.hpp"
 #include "disk_manager.hpp"
 #include "headers.hpp"
+#include "lock_manager.hpp"
+#include "predicate.hpp"
 
 #ifdef TEST_MODULE
 #include "test.hpp"
@@ -13,6 +19,7 @@
    
 /// B+Tree record iterator.
 class BPTreeIterator;
+class BPTreeBatchIterator;
 
 /// B+Tree Structure.
 class BPTree {
@@ -26,6 +33,18 @@ public:
     /// default value for whether use delayed merge or not, true
     static constexpr bool DEFAULT_DELAYED_MERGE = true;
 
+    /// log2 of the number of the keys in a lock group, record locks are
+    /// identified by key since records move on insert and delete,
+    /// and grouped as virtual pages for intention locks and escalation.
+    static constexpr int LOCK_GROUP_BITS = 5;
+
+    /// key for locking the gap after the last record.
+    static constexpr prikey_t SUPREMUM = std::numeric_limits<prikey_t>::max();
+
+    /// Type alias for logger, which writes log about the record
+    /// at given position before the leaf is modified and returns its lsn.
+    using logger_t = std::function<lsn_t(HID, int, Record const&)>;
+
     /// Construct on-disk b+tree with given file and buffers.
     /// \param file FileManager*, file base.
     /// \param buffers BufferManager*, buffer manager.
@@ -63,6 +82,8 @@ public:
     void print_tree() const;
 
     /// Find given key and write the result to argument record.
+    /// In transaction, the version visible to its snapshot is read
+    /// without any lock.
     /// \param key prikey_t, primary key.
     /// \param record Record*, nullable, pointer to write the result.
     /// \param xid trxid_t, transaction id, default INVALID_TRXID.
@@ -70,23 +91,41 @@ public:
     Status find(
         prikey_t key, Record* record, trxid_t xid = INVALID_TRXID) const;
 
+    /// Find the sorted keys, keys in the same leaf are searched under
+    /// single page read without descending from the root again.
+    /// \param keys std::vector<prikey_t> const&, keys in ascending order.
+    /// \param records std::vector<Record>&, buffer for the found records
+    /// in ascending order, absent keys are skipped.
+    /// \return Status, whether success to search or not.
+    Status find_batch(
+        std::vector<prikey_t> const& keys, std::vector<Record>& records) const;
+
     /// Range based search.
     /// \param start prikey_t, start point.
     /// \param end prikey_t, end point.
+    /// \param filter Predicate const*, nullable, evaluated in the leaf.
     /// \return std::vector<Record>, result sequence.
-    std::vector<Record> find_range(prikey_t start, prikey_t end) const;
+    std::vector<Record> find_range(
+        prikey_t start, prikey_t end,
+        Predicate const* filter = nullptr) const;
 
     /// Insert given key and value to tree.
+    /// In transaction, the key and the next key are exclusive-locked.
     /// \param key prikey_t, primary key.
     /// \param value const uint8_t*, byte sequence.
     /// \param value_size int, the size of the value.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to insert items or not.
-    Status insert(prikey_t key, const uint8_t* value, int value_size) const;
+    Status insert(
+        prikey_t key, const uint8_t* value, int value_size,
+        trxid_t xid = INVALID_TRXID) const;
 
     /// Remove records based on given key.
+    /// In transaction, the key and the next key are exclusive-locked.
     /// \param key prikey_t, primary key.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to remove proper items or not.
-    Status remove(prikey_t key) const;
+    Status remove(prikey_t key, trxid_t xid = INVALID_TRXID) const;
 
     /// Update record to given.
     /// \param key prikey_t, primary key.
@@ -106,6 +145,42 @@ public:
     /// Get the end of b+tree record iterator. 
     BPTreeIterator end() const;
 
+    /// Get leaf based iterator over the key range.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    /// \param filter Predicate const*, nullable, evaluated in the leaf.
+    /// \return BPTreeBatchIterator, iterator on the first non-empty leaf.
+    BPTreeBatchIterator batches(
+        prikey_t start = std::numeric_limits<prikey_t>::min(),
+        prikey_t end = std::numeric_limits<prikey_t>::max(),
+        Predicate const* filter = nullptr) const;
+
+    /// Get the number of the pages in the file, including free pages.
+    /// \return pagenum_t, the number of the pages.
+    pagenum_t num_pages() const;
+
+    /// Collect separator keys of the highest internal level which has
+    /// at least given number of keys, or the lowest internal level.
+    /// \param num size_t, the number of the keys wanted.
+    /// \return std::vector<prikey_t>, separators in ascending order,
+    /// empty if the root is leaf.
+    std::vector<prikey_t> separators(size_t num) const;
+
+    /// Copy the records in the key range from the leaf, page is latched once.
+    /// \param pagenum pagenum_t&, leaf page ID, INVALID_PAGENUM for
+    /// the leaf containing start key, set to the next leaf to read or
+    /// INVALID_PAGENUM if the range is done.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    /// \param records std::vector<Record>&, buffer, cleared before copy.
+    /// \param filter Predicate const*, nullable, only the matched records
+    /// are copied.
+    /// \return Status, whether success to read or not.
+    Status read_leaf(
+        pagenum_t& pagenum, prikey_t start, prikey_t end,
+        std::vector<Record>& records,
+        Predicate const* filter = nullptr) const;
+
     /// Set database.
     Status set_database(Database& dbms);
 
@@ -122,22 +197,124 @@ private:
     FileManager* file;              /// target file pointer.
     BufferManager* buffers;         /// buffer manager.
     Database* dbms;                 /// database pointer.
+    std::unique_ptr<std::shared_timed_mutex> latch;
+                                    /// tree latch, exclusive on insert and remove.
 
     friend class BPTreeIterator;
+    friend class LogManager;
+    friend class OccManager;
 
     /// Return buffer specified by pageid.
     /// \param pagenum pagenum_t, page id.
     /// \return Ubuffer, buffer.
     Ubuffer buffering(pagenum_t pagenum) const;
 
-    /// Return buffer speicified by pid with lock acquirance.
-    /// \param pagenum pagenum_t, page id.
-    /// \param idx size_t, record index.
+    /// Get lock ID of the record with given key.
+    /// \param key prikey_t, primary key.
+    /// \return HID, record level ID in the lock group of the key.
+    HID lock_id(prikey_t key) const;
+
+    /// Acquire record lock on given key, tree latch should not be held.
+    /// \param key prikey_t, primary key.
     /// \param xid trxid_t, transaction id.
     /// \param mode LockMode, lock mode.
-    /// \return Ubuffer, buffer.
-    Ubuffer require_buffering(
-        pagenum_t pagenum, size_t rid, trxid_t xid, LockMode mode) const;
+    /// \return Status, whether success to acquire lock or not.
+    Status require_lock(prikey_t key, trxid_t xid, LockMode mode) const;
+
+    /// Acquire exclusive lock for writing given key, abort transaction
+    /// if the key is overwritten after its snapshot.
+    /// \param key prikey_t, primary key.
+    /// \param xid trxid_t, transaction id.
+    /// \return Status, whether writable or not.
+    Status require_write(prikey_t key, trxid_t xid) const;
+
+    /// Find the smallest key greater than given key, latch should be held.
+    /// \param key prikey_t, primary key.
+    /// \return prikey_t, next key, SUPREMUM if not exists.
+    prikey_t next_key(prikey_t key) const;
+
+    /// Exclusive-lock the next key of given key and run callback under
+    /// exclusive tree latch, while the next key is not changed.
+    /// \param key prikey_t, primary key.
+    /// \param xid trxid_t, transaction id.
+    /// \param callback std::function<Status()> const&, modification.
+    /// \return Status, whether success to lock and modify or not.
+    Status with_next_key(
+        prikey_t key, trxid_t xid,
+        std::function<Status()> const& callback) const;
+
+    /// Insert record with tree latch.
+    /// \param record Record const&, record for insertion.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to insert or not.
+    Status insert_record(
+        Record const& record, logger_t const& logger = logger_t()) const;
+
+    /// Insert record, exclusive tree latch should be held.
+    /// \param record Record const&, record for insertion.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to insert or not.
+    Status insert_latched(Record const& record, logger_t const& logger) const;
+
+    /// Remove record with tree latch.
+    /// \param key prikey_t, primary key.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to remove or not.
+    Status remove_record(
+        prikey_t key, logger_t const& logger = logger_t()) const;
+
+    /// Remove record, exclusive tree latch should be held.
+    /// \param key prikey_t, primary key.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to remove or not.
+    Status remove_latched(prikey_t key, logger_t const& logger) const;
+
+    /// Insert record without logging the structure modification.
+    /// \param record Record const&, record for insertion.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to insert or not.
+    Status insert_to_tree(Record const& record, logger_t const& logger) const;
+
+    /// Remove record without logging the structure modification.
+    /// \param key prikey_t, primary key.
+    /// \param logger logger_t const&, logger, empty for no logging.
+    /// \return Status, whether success to remove or not.
+    Status remove_from_tree(prikey_t key, logger_t const& logger) const;
+
+    /// Run the modification and log the images of the written pages
+    /// if more than the leaf is written, exclusive tree latch should be
+    /// held. Pages are not written back until they are logged.
+    /// \param logger logger_t const&, record logger, empty for no logging.
+    /// \param modify std::function<Status()> const&, modification.
+    /// \return Status, whether success to modify and log or not.
+    Status log_structure(
+        logger_t const& logger,
+        std::function<Status()> const& modify) const;
+
+    /// Get LSN of the leaf which would contain given key.
+    /// \param key prikey_t, primary key.
+    /// \return lsn_t, page LSN of the leaf, INVALID_LSN if tree is empty.
+    lsn_t leaf_lsn(prikey_t key) const;
+
+    /// Write the record with given key under the leaf latch,
+    /// tree latch is shared for keeping the record in place.
+    /// \param key prikey_t, primary key.
+    /// \param writer std::function<void(Page&, HID, int)> const&,
+    /// callback with latched leaf, record ID and record index.
+    /// \return Status, whether the key is found or not.
+    Status write_leaf(
+        prikey_t key,
+        std::function<void(Page&, HID, int)> const& writer) const;
+
+    /// Write the leaf which would contain given key under the leaf latch,
+    /// records in the leaf could be written at once.
+    /// \param key prikey_t, primary key.
+    /// \param writer std::function<void(Page&, pagenum_t)> const&,
+    /// callback with latched leaf and its page ID.
+    /// \return Status, whether the leaf is found or not.
+    Status write_leaf_page(
+        prikey_t key,
+        std::function<void(Page&, pagenum_t)> const& writer) const;
 
     /// Create page on buffer.
     /// \param leaf bool, whether generated page is leaf page or internal.
@@ -1,6 +1,9 @@
 #ifndef BPTREE_ITER_HPP
 #define BPTREE_ITER_HPP
 
+#include <limits>
+#include <vector>
+
 #include "bptree.hpp"
 
 #ifdef TEST_MODULE
@@ -90,6 +93,12 @@ public:
     /// \return BPTreeIterator&, updated iterator.
     BPTreeIterator& operator++();
 
+    /// Move forward to the first record not less than the key. Current
+    /// and next leaves are searched before descending from the root.
+    /// \param key prikey_t, target key, ignored if not greater.
+    /// \return BPTreeIterator&, updated iterator, end if no such record.
+    BPTreeIterator& seek(prikey_t key);
+
     /// Check whether this and given are not same.
     /// \param other BPTreeIterator const&, other iterator.
     /// \return bool, whether this and given are inequal. 
@@ -115,6 +124,14 @@ private:
         pagenum_t pagenum, int record_index, int num_key,
         Ubuffer buffer, BPTree const* tree);
 
+    /// Move to the first record not less than the key in the current leaf.
+    /// \param key prikey_t, target key.
+    /// \return bool, whether the leaf has such record or not.
+    bool seek_leaf(prikey_t key);
+
+    /// Move to the first record of the next leaf.
+    void next_leaf();
+
     pagenum_t pagenum;      /// current page ID.
     int record_index;       /// current record index.
     int num_key;            /// number of keys in page.
@@ -126,4 +143,55 @@ private:
 #endif
 };
 
+/// Leaf based iterator, records of a leaf are copied under single latch.
+class BPTreeBatchIterator {
+public:
+    /// Construct iterator on the first non-empty leaf of the key range.
+    /// \param tree BPTree const&, target b+tree.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    /// \param filter Predicate const*, nullable, only the matched records
+    /// are in the batches, should outlive the iterator.
+    BPTreeBatchIterator(
+        BPTree const& tree,
+        prikey_t start = std::numeric_limits<prikey_t>::min(),
+        prikey_t end = std::numeric_limits<prikey_t>::max(),
+        Predicate const* filter = nullptr);
+
+    /// Whether the iterator points a batch or not.
+    /// \return bool, false if all records in the range are read.
+    bool valid() const;
+
+    /// Get records of the current leaf in the key range.
+    /// \return std::vector<Record> const&, non-empty, ascending records.
+    std::vector<Record> const& batch() const;
+
+    /// Move to the next non-empty leaf.
+    /// \return Status, whether success to read the next leaf or not.
+    Status next();
+
+    /// Move forward to the leaf containing the key, next leaf is read
+    /// first and the tree is descended from the root if key is beyond it.
+    /// \param key prikey_t, new lower bound, ignored if not greater.
+    /// \return Status, whether success to read the leaf or not.
+    Status seek(prikey_t key);
+
+private:
+    BPTree const* tree;             /// tree pointer.
+    prikey_t start;                 /// inclusive lower bound.
+    prikey_t end;                   /// inclusive upper bound.
+    Predicate const* filter;        /// nullable, predicate on the records.
+    pagenum_t pagenum;              /// next leaf to read.
+    bool done;                      /// whether all leaves are read.
+    std::vector<Record> records;    /// copied records of the leaf.
+
+    /// Read leaves until a record is found or the range is done.
+    /// \return Status, whether success to read or not.
+    Status fetch();
+
+#ifdef TEST_MODULE
+    friend struct BPTreeIteratorTest;
+#endif
+};
+
 #endif
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <shared_mutex>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "disk_manager.hpp"
 #include "hashable.hpp"
@@ -72,8 +74,7 @@ public:
     inline auto read(F&& callback) {
         ++pin;
         std::shared_lock<std::shared_timed_mutex> lock(mtx);
-        auto res = callback(static_cast<Page const&>(page()));
-        append_mru(true);
+        auto res = read_latched(std::forward<F>(callback));
         --pin;
         return res;
     }
@@ -86,9 +87,7 @@ public:
     inline auto write(F&& callback) {
         ++pin;
         std::unique_lock<std::shared_timed_mutex> lock(mtx);
-        auto res = callback(page());
-        append_mru(true);
-        is_dirty = true;
+        auto res = write_latched(std::forward<F>(callback));
         --pin;
         return res;
     }
@@ -99,6 +98,9 @@ private:
     int index;                      /// block index from manager.
     bool is_allocated;              /// whether buffer is allocated or not.
     bool is_dirty;                  /// whether any values are written in this page frame.
+    bool is_virtual;                /// whether page is created without reading the file.
+    std::atomic<bool> held;         /// written by the structure modification in progress.
+    std::atomic<lsn_t> rec_lsn;     /// LSN of the first log dirtying this page frame.
     std::atomic<int> pin;           /// the number of the blocks attaching this buffer.
     std::shared_timed_mutex mtx;    /// whether block is used now.
     Buffer* prev_use;               /// previous used block, for page replacement policy.
@@ -106,10 +108,51 @@ private:
     FileManager* file;              /// file pointer which current page exist.
     BufferManager* manager;         /// buffer manager which current buffer exist.
 
+    /// pages written by the current thread, for structure modification.
+    static thread_local std::vector<pagenum_t>* captured;
+
     friend class Ubuffer;
 
     friend class BufferManager;
 
+    /// Read page frame, shared latch should be acquired.
+    /// \param F typename, callback type, R(Page const&).
+    /// \param callback F&&, callback.
+    /// \return R, return value of callback.
+    template <typename F>
+    inline auto read_latched(F&& callback) {
+        auto res = callback(static_cast<Page const&>(page()));
+        append_mru(true);
+        return res;
+    }
+
+    /// Write page frame, exclusive latch should be acquired.
+    /// \param F typename, callback type, R(Page&).
+    /// \param callback F&&, callback.
+    /// \return R, return value of callback.
+    template <typename F>
+    inline auto write_latched(F&& callback) {
+        lsn_t page_lsn = frame.page_header().page_lsn;
+        auto res = callback(page());
+        // first logged modification since the page was written
+        if (rec_lsn == INVALID_LSN
+            && frame.page_header().page_lsn != page_lsn
+        ) {
+            rec_lsn = frame.page_header().page_lsn;
+        }
+        // pages of the structure modification in progress are not written
+        // back until they are logged, new pages are out of the file yet
+        if (captured != nullptr) {
+            captured->push_back(pagenum);
+            if (!is_virtual) {
+                held = true;
+            }
+        }
+        append_mru(true);
+        is_dirty = true;
+        return res;
+    }
+
     /// Clear buffer with given block index and manager (nonblock).
     /// \param index int, index of the block in buffer.
     /// \param parent BufferManager*, buffer manager.
@@ -209,8 +252,20 @@ public:
     /// \return R, return value of callback.
     template <typename F>
     inline auto read(F&& callback) {
-        check_and_reload();
-        return buf->read(std::forward<F>(callback));
+        while (true) {
+            check_and_reload();
+            Buffer& target = *buf;
+            ++target.pin;
+            std::shared_lock<std::shared_timed_mutex> lock(target.mtx);
+            // frame may be replaced while waiting for the latch
+            if (holds(target)) {
+                auto res = target.read_latched(std::forward<F>(callback));
+                --target.pin;
+                return res;
+            }
+            lock.unlock();
+            --target.pin;
+        }
     }
 
     /// Read buffer without check return value.
@@ -229,8 +284,20 @@ public:
     /// \return Status, return value of callback.
     template <typename F>
     inline auto write(F&& callback) {
-        check_and_reload();
-        return buf->write(std::forward<F>(callback));
+        while (true) {
+            check_and_reload();
+            Buffer& target = *buf;
+            ++target.pin;
+            std::unique_lock<std::shared_timed_mutex> lock(target.mtx);
+            // frame may be replaced while waiting for the latch
+            if (holds(target)) {
+                auto res = target.write_latched(std::forward<F>(callback));
+                --target.pin;
+                return res;
+            }
+            lock.unlock();
+            --target.pin;
+        }
     }
 
     /// Write buffer without checking return type.
@@ -249,6 +316,11 @@ private:
     pagenum_t pagenum;          /// page ID for buffer validation.
     FileManager* file;          /// file pointer for buffer validation.
 
+    /// Whether latched buffer still holds the page (nonblock).
+    /// \param target Buffer const&, latched buffer.
+    /// \return bool, whether the page is valid or not.
+    bool holds(Buffer const& target) const;
+
     /// Construct ubuffer with specified buffer infos.
     /// \param buf Buffer*, target buffer.
     /// \param pagenum pagenum_t, page ID.
@@ -349,6 +421,13 @@ private:
     Ubuffer buf;            /// buffer for user provision.
 };
 
+/// Entry of the dirty page table.
+struct DirtyPage {
+    fileid_t fileid;        /// file ID.
+    pagenum_t pagenum;      /// page ID.
+    lsn_t rec_lsn;          /// LSN of the first log dirtying the page.
+};
+
 /// Page replacement policy.
 struct ReleasePolicy {
     /// Initial searching state.
@@ -386,6 +465,10 @@ public:
     /// Set database.
     Status set_database(Database& dbms);
 
+    /// Get the number of the buffer frames.
+    /// \return int, buffer pool size.
+    int get_capacity() const;
+
     /// Get mru buffer (nonblock).
     /// \return Buffer*, mru buffer.
     Buffer* most_recently_used() const;
@@ -416,6 +499,12 @@ public:
         FileManager& file, pagenum_t pagenum, size_t rid,
         trxid_t xid, LockMode mode);
 
+    /// Load page to the buffer pool in advance (thread-safe).
+    /// \param file FileManager&, file manager.
+    /// \param pagenum pagenum_t, page ID.
+    /// \return Status, whether success to load the page or not.
+    Status prefetch(FileManager& file, pagenum_t pagenum);
+
     /// Create page with given file manager (thread-safe).
     /// \param file FileManager&, file manager.
     /// \return Ubuffer, buffer for user provision.
@@ -432,6 +521,38 @@ public:
     /// \return Status, whether success or not.
     Status release_file(fileid_t fileid);
 
+    /// Dirty page table, pages modified by logged updates (thread-safe).
+    /// \return std::vector<DirtyPage>, dirty pages and their recLSN.
+    std::vector<DirtyPage> dirty_pages();
+
+    /// Write back dirty pages in the order of recLSN without blocking
+    /// other buffer requests, written pages are durable after sync_files
+    /// (thread-safe).
+    /// \param num size_t, the maximum number of the pages to write.
+    /// \return Status, whether success or not.
+    Status flush_dirty(size_t num);
+
+    /// Synchronize the files written back since the last synchronization,
+    /// pages written back before the call are durable after it (thread-safe).
+    /// \return Status, whether success or not.
+    Status sync_files();
+
+    /// Collect the pages written by the current thread, the pages which
+    /// exist in the file are held, neither evicted nor written back,
+    /// until they are released.
+    /// \param pages std::vector<pagenum_t>*, collected page IDs,
+    /// nullptr for stopping.
+    static void capture(std::vector<pagenum_t>* pages);
+
+    /// Release the collected pages, stamp them with the LSN of the log
+    /// about their images before they could be written back (thread-safe).
+    /// \param file FileManager&, file manager.
+    /// \param pages std::vector<pagenum_t> const&, collected page IDs.
+    /// \param lsn lsn_t, page LSN, INVALID_LSN for keeping.
+    /// \return Status, whether success or not.
+    Status release_held(
+        FileManager& file, std::vector<pagenum_t> const& pages, lsn_t lsn);
+
 private:
     Database* dbms;                             /// database pointer.
     std::recursive_mutex mtx;                   /// lock for buffer manager.
@@ -439,12 +560,29 @@ private:
     int num_buffer;                             /// number of the element.
     Buffer* lru;                                /// least recently used block index.
     Buffer* mru;                                /// most recently used block index.
+    // written files outlive the frames, which are released on destruction
+    std::mutex sync_mtx;                        /// lock for synchronization.
+    std::mutex written_mtx;                     /// lock for written files.
+    std::unordered_set<FileManager*> written;   /// files not synchronized.
     std::unique_ptr<Buffer[]> dummy;            /// buffer array.
     std::unique_ptr<Buffer*[]> buffers;         /// usage array.
     std::unordered_map<fpid_t, int> table;      /// hashmap for faster search.
 
     friend class Buffer;
 
+    /// Flush logs about the page before writing it, write-ahead logging.
+    /// \param page Page const&, page frame.
+    /// \return Status, whether success or not.
+    Status write_ahead(Page const& page);
+
+    /// Pin the frames dirtied by logged updates (thread-safe).
+    /// \return std::vector<Buffer*>, pinned frames.
+    std::vector<Buffer*> pin_dirty();
+
+    /// Mark the file as written back but not synchronized (thread-safe).
+    /// \param file FileManager*, file manager.
+    void mark_written(FileManager* file);
+
     /// Allocate buffer frame (nonblock).
     /// \return int, index value.
     int allocate_block();
@@ -0,0 +1,165 @@
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "headers.hpp"
+#include "status.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Typed value of the column or the expression.
+struct Value {
+    /// Type of the value.
+    enum class Type { NUL = 0, INT = 1, REAL = 2, STR = 3 };
+
+    Type type;          /// type of the value.
+    int64_t integer;    /// integer value.
+    double real;        /// real value.
+    std::string str;    /// string value.
+
+    /// Construct null.
+    Value();
+
+    /// Construct integer.
+    /// \param integer int64_t, integer.
+    /// \return Value, integer value.
+    static Value of(int64_t integer);
+
+    /// Construct real.
+    /// \param real double, real number.
+    /// \return Value, real value.
+    static Value of(double real);
+
+    /// Construct string.
+    /// \param str std::string, string.
+    /// \return Value, string value.
+    static Value of(std::string str);
+
+    /// Whether the value is null or not.
+    bool is_null() const;
+
+    /// Whether the value is integer or real.
+    bool is_number() const;
+
+    /// Get the number as real.
+    /// \return double, real number, zero if not a number.
+    double as_real() const;
+
+    /// Compare with the other value, null is the smallest, numbers are
+    /// compared by their values and smaller than the strings.
+    /// \param other Value const&, other value.
+    /// \return int, negative, zero or positive.
+    int compare(Value const& other) const;
+
+    /// Whether two values are same or not.
+    bool operator==(Value const& other) const;
+
+    /// Whether two values are different or not.
+    bool operator!=(Value const& other) const;
+
+    /// Hash consistent with the equality.
+    size_t hash() const;
+
+    /// Convert to string, quoted if string literal is wanted.
+    /// \param quote bool, whether quote the string or not.
+    /// \return std::string, converted.
+    std::string to_string(bool quote = false) const;
+};
+
+/// Hasher of the values.
+struct ValueHash {
+    size_t operator()(Value const& value) const;
+};
+
+/// Row of the values.
+using Row = std::vector<Value>;
+
+/// Hasher of the rows.
+struct RowHash {
+    size_t operator()(Row const& row) const;
+};
+
+/// Type of the column.
+enum class ColumnType { INT = 0, CHAR = 1 };
+
+/// Column layout in the record.
+struct Column {
+    std::string name;   /// lowercase column name.
+    ColumnType type;    /// column type.
+    size_t size;        /// width in bytes, 8 for integer.
+    bool key;           /// whether mapped on the primary key or not.
+    size_t offset;      /// offset in the value, assigned by the catalog.
+
+    /// Integer column, 64-bit signed in native byte order.
+    /// \param name std::string const&, column name.
+    /// \param key bool, whether primary key or not.
+    /// \return Column, integer column.
+    static Column integer(std::string const& name, bool key = false);
+
+    /// Fixed width string column, padded with null.
+    /// \param name std::string const&, column name.
+    /// \param size size_t, width in bytes.
+    /// \return Column, string column.
+    static Column chars(std::string const& name, size_t size);
+};
+
+/// Schema of the table.
+struct Schema {
+    std::string name;               /// lowercase table name.
+    tableid_t id;                   /// table ID.
+    std::vector<Column> columns;    /// columns in the declared order.
+
+    /// Find the column by name.
+    /// \param name std::string const&, lowercase column name.
+    /// \return int, column index, -1 if not found.
+    int find(std::string const& name) const;
+
+    /// Read the column from the record.
+    /// \param idx size_t, column index.
+    /// \param record Record const&, record.
+    /// \return Value, column value.
+    Value decode(size_t idx, Record const& record) const;
+
+    /// Write the values to the record.
+    /// \param values std::vector<Value> const&, values in column order.
+    /// \param record Record&, output record.
+    /// \return Status, whether the values fit in the columns or not.
+    Status encode(std::vector<Value> const& values, Record& record) const;
+};
+
+/// Catalog of the table names and their column layouts on the records.
+/// Names are case-insensitive and stored in lowercase.
+class Catalog {
+public:
+    /// Default constructor.
+    Catalog();
+
+    /// Define the table, offsets of the columns are assigned in order
+    /// and single integer key column is mapped on the primary key.
+    /// \param name std::string const&, table name.
+    /// \param id tableid_t, opened table ID.
+    /// \param columns std::vector<Column>, columns.
+    /// \return Status, whether the layout is valid or not.
+    Status define(
+        std::string const& name, tableid_t id, std::vector<Column> columns);
+
+    /// Find the schema by name.
+    /// \param name std::string const&, table name.
+    /// \return Schema const*, schema, nullptr if not found.
+    Schema const* find(std::string const& name) const;
+
+    /// Convert identifier to lowercase.
+    /// \param name std::string const&, identifier.
+    /// \return std::string, lowercase identifier.
+    static std::string lower(std::string const& name);
+
+private:
+    std::unordered_map<std::string, Schema> tables;     /// schemas by name.
+};
+
+#endif
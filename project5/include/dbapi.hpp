@@ -8,8 +8,9 @@ extern std::unique_ptr<Database> GLOBAL_DB;
 
 /// Initialize database.
 /// \param buf_num int, the number of the buffer.
+/// \param log_path char const*, write-ahead log file, nullptr for no log file.
 /// \return int, 0 for success, 1 for failure.
-int init_db(int buf_num);
+int init_db(int buf_num, char const* log_path = nullptr);
 
 /// Load table to table manager.
 /// \param pathname char const*, the name of the file.
@@ -20,8 +21,11 @@ int open_table(char const* pathname);
 /// \param table_id int, table ID.
 /// \param key int64_t, primary key.
 /// \param value char const*, null-terminated byte sequence.
+/// \param trx_id, int, transaction id.
 /// \return int, 0 for success, 1 for failure.
-int db_insert(int table_id, int64_t key, char const* value);
+int db_insert(
+    int table_id, int64_t key, char const* value,
+    int trx_id = INVALID_TRXID);
 
 /// Find items by key and write the result to ret_val.
 /// \param table_id, int, table ID.
@@ -35,8 +39,9 @@ int db_find(
 /// Delete the records by key.
 /// \param table_id int, table ID.
 /// \param key int64_t, primary key.
+/// \param trx_id, int, transaction id.
 /// \return int, whether success to delete the record (=0) or not (=1).
-int db_delete(int table_id, int64_t key);
+int db_delete(int table_id, int64_t key, int trx_id = INVALID_TRXID);
 
 /// Update the records.
 /// \param table_id int, table ID.
@@ -59,12 +64,34 @@ int shutdown_db();
 /// \param table_id_1 int, left table ID.
 /// \param table_id_2 int, right table ID.
 /// \param pathname char const*, output path name.
+/// \param binary bool, write raw records instead of csv or not.
 /// \return int, whether success to join tables or not.
-int join_table(int table_id_1, int table_id_2, char const* pathname);
+int join_table(
+    int table_id_1, int table_id_2, char const* pathname, bool binary = false);
+
+/// Join multiple tables naturally based on primary key.
+/// \param table_ids int const*, table IDs.
+/// \param num_tables int, the number of the tables.
+/// \param pathname char const*, output path name.
+/// \param binary bool, write raw records instead of csv or not.
+/// \return int, whether success to join tables or not.
+int db_join_tables(
+    int const* table_ids, int num_tables, char const* pathname,
+    bool binary = false);
+
+/// Aggregate the values of the records in the key range in the engine,
+/// values are parsed as decimal integers.
+/// \param table_id int, table ID.
+/// \param start int64_t, inclusive lower bound of the keys.
+/// \param end int64_t, inclusive upper bound of the keys.
+/// \param result Aggregate*, count, sum, min and max of the values.
+/// \return int, whether success to aggregate (=0) or not (=1).
+int db_aggregate(int table_id, int64_t start, int64_t end, Aggregate* result);
 
 /// Start transaction.
+/// \param read_only bool, read from the snapshot without locks and logs.
 /// \return int, transaction ID if success else 0.
-int begin_trx();
+int begin_trx(bool read_only = false);
 
 /// Finish transaction.
 /// \param tid int, transaction ID.
@@ -4,8 +4,11 @@
 #include "buffer_manager.hpp"
 #include "lock_manager.hpp"
 #include "log_manager.hpp"
+#include "occ_manager.hpp"
 #include "table_manager.hpp"
+#include "version_manager.hpp"
 #include "xaction_manager.hpp"
+#include "aggregate.hpp"
 #include "join.hpp"
 
 /// Database management system.
@@ -14,10 +17,16 @@ public:
     /// Construct database with the number of buffers.
     /// \param num_buffer int, number of buffers.
     /// \param seq int, sequential access or not.
-    Database(int num_buffer, bool seq = false);
+    /// \param logfile std::string const&, write-ahead log file,
+    /// empty for keeping logs only in memory, default empty.
+    /// \param checkpoint int, checkpoint period in milliseconds,
+    /// zero for disabling background checkpointer, default 1000.
+    Database(
+        int num_buffer, bool seq = false,
+        std::string const& logfile = "", int checkpoint = 1000);
 
-    /// Default destructor.
-    ~Database() = default;
+    /// Destructor, flush logs and buffers.
+    ~Database();
 
     /// Deleted copy constructor.
     Database(Database const&) = delete;
@@ -31,6 +40,16 @@ public:
     /// Deleted move assignment.
     Database& operator=(Database&&) = delete;
 
+    /// Allocate with the alignment of the log shards, which is not
+    /// respected by the global new until C++17.
+    /// \param size std::size_t, the size of the database.
+    /// \return void*, aligned memory.
+    static void* operator new(std::size_t size);
+
+    /// Free the memory allocated by the aligned new.
+    /// \param ptr void*, memory to free.
+    static void operator delete(void* ptr);
+
     /// Open table with given filename.
     /// \param filename std::string const&, the name of the file.
     /// \return tableid_t, created table ID.
@@ -60,23 +79,30 @@ public:
     /// \param id tableid_t, table ID.
     /// \param start prikey_t, start point.
     /// \param end prikey_t, end point.
+    /// \param filter Predicate const*, nullable, evaluated in the leaf,
+    /// only the matched records are copied out.
     /// \return std::vector<Record>, result records.
-    std::vector<Record> find_range(tableid_t id, prikey_t start, prikey_t end);
+    std::vector<Record> find_range(
+        tableid_t id, prikey_t start, prikey_t end,
+        Predicate const* filter = nullptr);
 
     /// Insert the record to the tree.
     /// \param id tableid_t, table ID.
     /// \param key prikey_t, primary key.
     /// \param value uint8_t const*, byte sequence.
     /// \param value_size int, the length of the sequence.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to insert the record or not.
     Status insert(
-        tableid_t id, prikey_t key, uint8_t const* value, int value_size);
+        tableid_t id, prikey_t key, uint8_t const* value, int value_size,
+        trxid_t xid = INVALID_TRXID);
 
     /// Remove the record from the tree.
     /// \param id tableid_t, table ID.
     /// \param key prikey_t, primary key.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to remove the record or not.
-    Status remove(tableid_t id, prikey_t key);
+    Status remove(tableid_t id, prikey_t key, trxid_t xid = INVALID_TRXID);
 
     /// Update the record in the tree.
     /// \param id tableid_t, table ID.
@@ -93,8 +119,9 @@ public:
     /// \return Status, whether success to clean up the tree.
     Status destroy_tree(tableid_t id);
 
-    /// Natural join on primary key.
-    /// \tparam F typename, Status(Record&).
+    /// Natural join on primary key, index nested-loop join probing the
+    /// larger table is chosen if its estimated cost is lower than merge.
+    /// \tparam F typename, Status(Record const&, Record const&).
     /// \param id1 tableid_t, left table id.
     /// \param id2 tableid_t, right table id.
     /// \param callback F&&, callback for found keys.
@@ -105,17 +132,166 @@ public:
         Table const* table2 = (*this)[id2];
         CHECK_NULL(table1);
         CHECK_NULL(table2);
+
+        JoinOper::PrikeyJoin method = JoinOper::choose_join(
+            table1->num_pages(), table2->num_pages());
+        switch (method) {
+        case JoinOper::PrikeyJoin::PROBE_RIGHT:
+            return JoinOper::nested_loop(
+                table1, table2, std::forward<F>(callback));
+        case JoinOper::PrikeyJoin::PROBE_LEFT:
+            return JoinOper::nested_loop(
+                table2, table1, [&](Record const& rec2, Record const& rec1) {
+                    return callback(rec1, rec2);
+                });
+        case JoinOper::PrikeyJoin::MERGE:
+            break;
+        }
         return JoinOper::set_merge(table1, table2, std::forward<F>(callback));
     }
 
+    /// Multi-way natural join on primary key.
+    /// \tparam F typename, Status(std::vector<Record const*> const&).
+    /// \param ids std::vector<tableid_t> const&, table ids.
+    /// \param callback F&&, callback for the matched rows, records are in
+    /// the order of the ids.
+    /// \return Status, whether success to join or not.
+    template <typename F>
+    Status multi_join(std::vector<tableid_t> const& ids, F&& callback) {
+        std::vector<Table const*> tables;
+        for (tableid_t id : ids) {
+            Table const* table = (*this)[id];
+            CHECK_NULL(table);
+            tables.push_back(table);
+        }
+        return JoinOper::leapfrog(tables, std::forward<F>(callback));
+    }
+
+    /// Parallel join on primary key, key space is split into ranges and
+    /// each range is merged by its own worker. If the index nested-loop
+    /// join is cheaper, it runs as the single range of the first worker.
+    /// \tparam F typename, Status(size_t, Record const&, Record const&).
+    /// \tparam D typename, Status(size_t, Status).
+    /// \param id1 tableid_t, left table id.
+    /// \param id2 tableid_t, right table id.
+    /// \param num_workers size_t, the number of the workers.
+    /// \param callback F&&, callback with the worker index, outputs are
+    /// in key order if concatenated in the worker order.
+    /// \param done D&&, callback after the range of the worker is merged,
+    /// with the worker index and the result of the range.
+    /// \return Status, whether success to join or not.
+    template <typename F, typename D>
+    Status parallel_join(
+        tableid_t id1, tableid_t id2, size_t num_workers,
+        F&& callback, D&& done
+    ) {
+        Table const* table1 = (*this)[id1];
+        Table const* table2 = (*this)[id2];
+        CHECK_NULL(table1);
+        CHECK_NULL(table2);
+        JoinOper::PrikeyJoin method = JoinOper::choose_join(
+            table1->num_pages(), table2->num_pages());
+        if (method != JoinOper::PrikeyJoin::MERGE) {
+            return done(0, prikey_join(
+                id1, id2, [&](Record const& rec1, Record const& rec2) {
+                    return callback(0, rec1, rec2);
+                }));
+        }
+        return JoinOper::parallel_merge(
+            table1, table2, num_workers,
+            std::forward<F>(callback), std::forward<D>(done));
+    }
+
+    /// Parallel merge join on primary key without the range callback.
+    /// \tparam F typename, Status(size_t, Record const&, Record const&).
+    /// \param id1 tableid_t, left table id.
+    /// \param id2 tableid_t, right table id.
+    /// \param num_workers size_t, the number of the workers.
+    /// \param callback F&&, callback with the worker index.
+    /// \return Status, whether success to join or not.
+    template <typename F>
+    Status parallel_join(
+        tableid_t id1, tableid_t id2, size_t num_workers, F&& callback
+    ) {
+        return parallel_join(
+            id1, id2, num_workers, std::forward<F>(callback),
+            [](size_t, Status res) { return res; });
+    }
+
+    /// Aggregates of the values extracted from the records in the range.
+    /// \tparam V typename, value extractor aggval_t(Record const&).
+    /// \param id tableid_t, table id.
+    /// \param extract V&&, value extractor, called concurrently.
+    /// \param result Aggregate&, aggregates of the values.
+    /// \param num_workers size_t, the number of the workers.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    /// \return Status, whether success to aggregate or not.
+    template <typename V>
+    Status aggregate(
+        tableid_t id, V&& extract, Aggregate& result,
+        size_t num_workers = 1,
+        prikey_t start = std::numeric_limits<prikey_t>::min(),
+        prikey_t end = std::numeric_limits<prikey_t>::max()
+    ) {
+        Table const* table = (*this)[id];
+        CHECK_NULL(table);
+        return AggregateOper::aggregate(
+            table, std::forward<V>(extract), result, num_workers, start, end);
+    }
+
+    /// Distinct values extracted from the records in the range.
+    /// \tparam V typename, hashable value extractor T(Record const&).
+    /// \tparam T typename, value type.
+    /// \param id tableid_t, table id.
+    /// \param extract V&&, value extractor, called concurrently.
+    /// \param values std::vector<T>&, distinct values in ascending order.
+    /// \param num_workers size_t, the number of the workers.
+    /// \return Status, whether success to aggregate or not.
+    template <typename V, typename T>
+    Status distinct(
+        tableid_t id, V&& extract, std::vector<T>& values,
+        size_t num_workers = 1
+    ) {
+        Table const* table = (*this)[id];
+        CHECK_NULL(table);
+        return AggregateOper::distinct(
+            table, std::forward<V>(extract), values, num_workers);
+    }
+
+    /// Aggregates of the extracted values per group.
+    /// \tparam G typename, hashable group key extractor K(Record const&).
+    /// \tparam V typename, value extractor aggval_t(Record const&).
+    /// \tparam K typename, group key type.
+    /// \param id tableid_t, table id.
+    /// \param group G&&, group key extractor, called concurrently.
+    /// \param extract V&&, value extractor, called concurrently.
+    /// \param groups std::unordered_map<K, Aggregate>&, aggregates per group.
+    /// \param num_workers size_t, the number of the workers.
+    /// \return Status, whether success to aggregate or not.
+    template <typename G, typename V, typename K>
+    Status group_by(
+        tableid_t id, G&& group, V&& extract,
+        std::unordered_map<K, Aggregate>& groups,
+        size_t num_workers = 1
+    ) {
+        Table const* table = (*this)[id];
+        CHECK_NULL(table);
+        return AggregateOper::group_by(
+            table, std::forward<G>(group), std::forward<V>(extract),
+            groups, num_workers);
+    }
+
     /// Get table from table manager.
     /// \param id tableid_t, table ID.
     /// \return Table const*, table structure.
     Table const* operator[](tableid_t id) const;
 
-    /// Start transaction.
+    /// Start transaction, read-only transaction reads from its snapshot
+    /// without locks and logs, or validates its reads in optimistic mode.
+    /// \param read_only bool, whether the transaction never writes.
     /// \return trxid_t, created transaction id.
-    trxid_t begin_trx();
+    trxid_t begin_trx(bool read_only = false);
 
     /// End transaction.
     /// \param id trxid_t, target transaction id.
@@ -124,12 +300,53 @@ public:
 
     /// Abort transaction.
     /// \param id trxid_t, target transaction id.
+    /// \param locked bool, whether the caller holds the lock manager mutex,
+    /// only the deadlock detector aborts in the lock manager.
     /// \return Status, whether success or not.
-    Status abort_trx(trxid_t id);
+    Status abort_trx(trxid_t id, bool locked = false);
 
     /// Return tranaction state.
     TrxState trx_state(trxid_t id);
 
+    /// Get statistics of the restart recovery.
+    /// \return RecoveryStats const&, recovery statistics.
+    RecoveryStats const& recovery_stats() const;
+
+    /// Set group commit parameters.
+    /// \param size size_t, maximum number of the commits in a group.
+    /// \param wait int, maximum time for the leader to wait followers
+    /// in microseconds.
+    /// \return Status, whether success or not.
+    Status set_group_commit(size_t size, int wait);
+
+    /// Get statistics of group commit.
+    /// \return GroupCommitStats, group commit statistics.
+    GroupCommitStats group_commit_stats();
+
+    /// Set concurrency control scheme of the transactions,
+    /// should be set while no transaction is running.
+    /// \param mode Concurrency, locking or optimistic.
+    /// \return Status, whether success or not.
+    Status set_concurrency(Concurrency mode);
+
+    /// Get statistics of the optimistic transactions.
+    /// \return OccStats, optimistic transaction statistics.
+    OccStats occ_stats() const;
+
+    /// Get statistics of the version store.
+    /// \return VersionStats, version store statistics.
+    VersionStats version_stats();
+
+    /// Take fuzzy checkpoint, log file should be opened.
+    /// \return Status, whether success to take checkpoint or not.
+    Status checkpoint();
+
+    /// Set lock escalation thresholds, zero for disabling.
+    /// \param records size_t, record locks on a page before page lock.
+    /// \param pages size_t, page locks on a table before table lock.
+    /// \return Status, whether success or not.
+    Status set_escalation(size_t records, size_t pages);
+
     /// Set verbosity.
     void verbose(bool on = false);
 
@@ -142,13 +359,20 @@ private:
     LockManager locks;              /// lock manager.
     LogManager logs;                /// log manager.
     TransactionManager trxs;        /// transaction manager.
+    VersionManager versions;        /// version store for snapshot reads.
+    Concurrency concurrency;        /// concurrency control scheme.
+    OccManager occ;                 /// optimistic transaction manager.
 
     friend class BPTree;
     friend class BufferManager;
+    friend class LogManager;
+    friend class OccManager;
     friend class Transaction;
 
 #ifdef TEST_MODULE
     friend struct LockManagerTest;
+    friend struct LogManagerTest;
+    friend struct TransactionManagerTest;
 #endif
 
     /// \tparam typename R, return type.
@@ -76,6 +76,10 @@ public:
     /// \return Status, whether success or not.
     Status page_write(pagenum_t pagenum, Page const& src) const;
 
+    /// Synchronize the written pages with the disk.
+    /// \return Status, whether success or not.
+    Status sync() const;
+
 private:
     /// File pointer.
     FILE* fp;
@@ -19,7 +19,7 @@ long fsize(FILE* fp);
 /// \return int, whether success (= 1) or not (= 0).
 int fresize(FILE* fp, size_t size);
 
-/// Write the data to stream in given position.
+/// Write the data to stream in given position, thread-safe.
 /// \param ptr void*, data.
 /// \param size size_t, size of the data.
 /// \param pos long, offset from SEEK_SET (start of the file).
@@ -27,8 +27,13 @@ int fresize(FILE* fp, size_t size);
 /// \return int, whether success (= 1) or not (= 0).
 int fpwrite(const void* ptr, size_t size, long pos, FILE* stream);
 
+/// Flush user space buffer and synchronize the file with the disk.
+/// \param stream FILE*, file pointer.
+/// \return int, whether success (= 1) or not (= 0).
+int fpsync(FILE* stream);
+
 
-/// Read the data from stream in given position, given size.
+/// Read the data from stream in given position, given size, thread-safe.
 /// \param ptr void*, memory to return data.
 /// \param size size_t, size of the data.
 /// \param pos long, offset from SEEK_SET (start of the file).
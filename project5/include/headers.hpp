@@ -62,7 +62,8 @@ struct PageHeader {
     pagenum_t parent_page_number;   /// 0~8, ID of parent page.
     uint32_t is_leaf;               /// 8~12, bool, whether leaf page or not.
     uint32_t number_of_keys;        /// 12~16, the number of keys.
-    uint8_t reserved[104];          /// 16~120, reserved space.
+    uint8_t reserved[96];           /// 16~112, reserved space.
+    lsn_t page_lsn;                 /// 112~120, LSN of the last log applied to this page.
     pagenum_t special_page_number;  /// 120~128, sibling pointer for leaf page, leftmost page ID for internal page.
 };
 
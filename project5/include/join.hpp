@@ -1,10 +1,366 @@
 #ifndef JOIN_HPP
 #define JOIN_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "table_manager.hpp"
 
 namespace JoinOper {
 
+/// Join key extracted from the record.
+using joinkey_t = int64_t;
+
+/// Default memory budget of the build side in bytes.
+constexpr size_t HASH_JOIN_BUDGET = 64 << 20;
+
+/// Hash table of single partition, entries are allocated from the arena
+/// and chained in the buckets after all entries are appended.
+class HashTable {
+public:
+    /// Build side entry.
+    struct Entry {
+        joinkey_t key;      /// join key.
+        Entry* next;        /// next entry in the bucket.
+        Record record;      /// build record.
+    };
+
+    /// Number of the entries in an arena chunk.
+    static constexpr size_t CHUNK_SIZE = 256;
+
+    /// Default constructor.
+    HashTable();
+
+    /// Default destructor.
+    ~HashTable() = default;
+
+    /// Deleted copy constructor.
+    HashTable(HashTable const&) = delete;
+
+    /// Move constructor.
+    HashTable(HashTable&&) noexcept = default;
+
+    /// Deleted copy assignment.
+    HashTable& operator=(HashTable const&) = delete;
+
+    /// Move assignment.
+    HashTable& operator=(HashTable&&) noexcept = default;
+
+    /// Hash of the join key.
+    /// \param key joinkey_t, join key.
+    /// \return size_t, mixed hash.
+    static size_t hash(joinkey_t key);
+
+    /// Append entry to the arena, visible after build.
+    /// \param key joinkey_t, join key.
+    /// \param record Record const&, build record.
+    void append(joinkey_t key, Record const& record);
+
+    /// Link the appended entries into the buckets.
+    void build();
+
+    /// Find the entries with given key.
+    /// \tparam F typename, callback Status(Record const&).
+    /// \param key joinkey_t, join key.
+    /// \param callback F&&, callback for the matched records.
+    /// \return Status, whether all callbacks succeed or not.
+    template <typename F>
+    Status probe(joinkey_t key, F&& callback) const {
+        if (buckets.empty()) {
+            return Status::SUCCESS;
+        }
+        for (Entry const* entry = buckets[hash(key) & mask];
+             entry != nullptr;
+             entry = entry->next
+        ) {
+            if (entry->key == key) {
+                CHECK_SUCCESS(callback(entry->record));
+            }
+        }
+        return Status::SUCCESS;
+    }
+
+    /// Write all entries to the file and release the arena.
+    /// \param fp FILE*, spill file.
+    /// \return Status, whether success to write or not.
+    Status spill(FILE* fp);
+
+    /// Release all entries.
+    void clear();
+
+    /// Get the number of the entries.
+    size_t size() const;
+
+    /// Get the memory used by the arena in bytes.
+    size_t memory() const;
+
+private:
+    std::vector<std::unique_ptr<Entry[]>> chunks;   /// arena.
+    size_t num_entries;                             /// the number of entries.
+    std::vector<Entry*> buckets;                    /// bucket heads.
+    size_t mask;                                    /// bucket mask.
+};
+
+/// Partitions of the grace hash join. Build records are kept in memory
+/// until the budget is exceeded, then all partitions are spilled to the
+/// temporary files and joined one by one with the spilled probe records.
+class HashPartitions {
+public:
+    /// Number of the partitions.
+    static constexpr size_t NUM_PARTITIONS = 64;
+
+    /// Spilled record with its join key.
+    struct Spilled {
+        joinkey_t key;      /// join key.
+        Record record;      /// record.
+    };
+
+    /// Construct partitions with memory budget.
+    /// \param budget size_t, memory budget of the build side in bytes.
+    HashPartitions(size_t budget);
+
+    /// Destructor, close the temporary files.
+    ~HashPartitions();
+
+    /// Deleted copy constructor.
+    HashPartitions(HashPartitions const&) = delete;
+
+    /// Deleted move constructor.
+    HashPartitions(HashPartitions&&) = delete;
+
+    /// Deleted copy assignment.
+    HashPartitions& operator=(HashPartitions const&) = delete;
+
+    /// Deleted move assignment.
+    HashPartitions& operator=(HashPartitions&&) = delete;
+
+    /// Add build record, spill all partitions if the budget is exceeded.
+    /// \param key joinkey_t, join key.
+    /// \param record Record const&, build record.
+    /// \return Status, whether success to add or not.
+    Status add_build(joinkey_t key, Record const& record);
+
+    /// Finish build side, hash tables are built if nothing is spilled.
+    /// \return Status, whether success or not.
+    Status finish_build();
+
+    /// Whether the build side is spilled.
+    bool spilled() const;
+
+    /// Add probe record to the spilled partition.
+    /// \param key joinkey_t, join key.
+    /// \param record Record const&, probe record.
+    /// \return Status, whether success to write or not.
+    Status add_probe(joinkey_t key, Record const& record);
+
+    /// Find the build records with given key in memory.
+    /// \tparam F typename, callback Status(Record const&).
+    /// \param key joinkey_t, join key.
+    /// \param callback F&&, callback for the matched build records.
+    /// \return Status, whether all callbacks succeed or not.
+    template <typename F>
+    Status probe(joinkey_t key, F&& callback) const {
+        return tables[partition_of(key)].probe(key, std::forward<F>(callback));
+    }
+
+    /// Join spilled partitions one by one, the build side of the partition
+    /// is loaded into memory and probed by the spilled probe records.
+    /// \tparam F typename, callback Status(Record const&, Record const&),
+    /// build record and probe record.
+    /// \param callback F&&, callback for the matched pairs.
+    /// \return Status, whether success to join or not.
+    template <typename F>
+    Status join_spilled(F&& callback) {
+        Spilled spilled;
+        for (size_t i = 0; i < NUM_PARTITIONS; ++i) {
+            CHECK_SUCCESS(load(i));
+            HashTable const& table = tables[i];
+            FILE* fp = probe_files[i];
+            if (table.size() > 0 && fp != nullptr) {
+                std::rewind(fp);
+                while (std::fread(&spilled, sizeof(Spilled), 1, fp) == 1) {
+                    CHECK_SUCCESS(table.probe(
+                        spilled.key, [&](Record const& build) {
+                            return callback(build, spilled.record);
+                        }));
+                }
+            }
+            tables[i].clear();
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    size_t budget;                                      /// memory budget.
+    size_t used;                                        /// memory in use.
+    bool spill;                                         /// spilled or not.
+    std::array<HashTable, NUM_PARTITIONS> tables;       /// partitions.
+    std::array<FILE*, NUM_PARTITIONS> build_files;      /// spilled build.
+    std::array<FILE*, NUM_PARTITIONS> probe_files;      /// spilled probe.
+
+    /// Get partition of the key, from the high bits of the hash.
+    /// \param key joinkey_t, join key.
+    /// \return size_t, partition index.
+    static size_t partition_of(joinkey_t key);
+
+    /// Write the record to the temporary file, created on first write.
+    /// \param file FILE*&, temporary file.
+    /// \param key joinkey_t, join key.
+    /// \param record Record const&, record.
+    /// \return Status, whether success to write or not.
+    static Status write(FILE*& file, joinkey_t key, Record const& record);
+
+    /// Load spilled build records of the partition and build hash table.
+    /// \param idx size_t, partition index.
+    /// \return Status, whether success to load or not.
+    Status load(size_t idx);
+};
+
+/// Build and probe, the build side is kept in the hash table.
+/// \tparam KB typename, build key extractor joinkey_t(Record const&).
+/// \tparam KP typename, probe key extractor joinkey_t(Record const&).
+/// \tparam F typename, callback Status(Record const&, Record const&),
+/// build record and probe record.
+/// \param build Table const*, build side table.
+/// \param probe Table const*, probe side table.
+/// \param build_key KB&&, build key extractor.
+/// \param probe_key KP&&, probe key extractor.
+/// \param callback F&&, callback for the matched pairs.
+/// \param budget size_t, memory budget of the build side in bytes.
+/// \return Status, whether success to join or not.
+template <typename KB, typename KP, typename F>
+Status build_probe(
+    Table const* build, Table const* probe,
+    KB&& build_key, KP&& probe_key, F&& callback, size_t budget
+) {
+    HashPartitions partitions(budget);
+    for (auto iter = build->batches(); iter.valid(); iter.next()) {
+        for (Record const& rec : iter.batch()) {
+            CHECK_SUCCESS(partitions.add_build(build_key(rec), rec));
+        }
+    }
+    CHECK_SUCCESS(partitions.finish_build());
+
+    if (!partitions.spilled()) {
+        for (auto iter = probe->batches(); iter.valid(); iter.next()) {
+            for (Record const& rec : iter.batch()) {
+                CHECK_SUCCESS(partitions.probe(
+                    probe_key(rec), [&](Record const& matched) {
+                        return callback(matched, rec);
+                    }));
+            }
+        }
+        return Status::SUCCESS;
+    }
+
+    // grace hash join, partition the probe side in the same way
+    for (auto iter = probe->batches(); iter.valid(); iter.next()) {
+        for (Record const& rec : iter.batch()) {
+            CHECK_SUCCESS(partitions.add_probe(probe_key(rec), rec));
+        }
+    }
+    return partitions.join_spilled(std::forward<F>(callback));
+}
+
+/// Hash join on the keys extracted from the records, hash table is built
+/// on the smaller table and probed by the larger one. If the build side
+/// exceeds the memory budget, both sides are partitioned to temporary
+/// files and joined partition by partition (grace hash join).
+/// \tparam K1 typename, left key extractor joinkey_t(Record const&).
+/// \tparam K2 typename, right key extractor joinkey_t(Record const&).
+/// \tparam F typename, callback Status(Record const&, Record const&).
+/// \param table1 Table const*, left table pointer.
+/// \param table2 Table const*, right table pointer.
+/// \param key1 K1&&, left key extractor.
+/// \param key2 K2&&, right key extractor.
+/// \param callback F&&, callback for the matched pairs, left record first.
+/// \param budget size_t, memory budget of the build side in bytes.
+/// \return Status, whether success to join or not.
+template <typename K1, typename K2, typename F>
+Status hash_join(
+    Table const* table1, Table const* table2,
+    K1&& key1, K2&& key2, F&& callback,
+    size_t budget = HASH_JOIN_BUDGET
+) {
+    if (table2->num_pages() < table1->num_pages()) {
+        return build_probe(
+            table2, table1, key2, key1,
+            [&](Record const& rec2, Record const& rec1) {
+                return callback(rec1, rec2);
+            },
+            budget);
+    }
+    return build_probe(table1, table2, key1, key2, callback, budget);
+}
+
+/// Cursor over the records in the key range of the table,
+/// records of a leaf are copied under single page latch.
+class LeafCursor {
+public:
+    /// Construct cursor on the first record in the range.
+    /// \param table Table const*, target table.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    LeafCursor(Table const* table, prikey_t start, prikey_t end);
+
+    /// Whether the cursor points a record or not.
+    bool valid() const;
+
+    /// Get current record.
+    Record const& record() const;
+
+    /// Move to the next record.
+    /// \return Status, whether success to read the next leaf or not.
+    Status next();
+
+    /// Move forward to the first record not less than the key, searched
+    /// in the current leaf, the next leaf, then from the root.
+    /// \param key prikey_t, target key.
+    /// \return Status, whether success to read the leaf or not.
+    Status seek(prikey_t key);
+
+private:
+    BPTreeBatchIterator iter;       /// leaf iterator.
+    size_t idx;                     /// current record index in the batch.
+};
+
+/// Merge join on primary key in the key range.
+/// \tparam F typename, callback Status(Record const&, Record const&).
+/// \param table1 Table const*, left table pointer.
+/// \param table2 Table const*, right table pointer.
+/// \param start prikey_t, inclusive lower bound.
+/// \param end prikey_t, inclusive upper bound.
+/// \param callback F&&, callback for the matched pairs.
+/// \return Status, whether success to merge or not.
+template <typename F>
+Status merge_range(
+    Table const* table1, Table const* table2,
+    prikey_t start, prikey_t end, F&& callback
+) {
+    LeafCursor cursor1(table1, start, end);
+    LeafCursor cursor2(table2, start, end);
+    while (cursor1.valid() && cursor2.valid()) {
+        prikey_t key1 = cursor1.record().key;
+        prikey_t key2 = cursor2.record().key;
+        // skip ahead to the other key instead of stepping
+        if (key1 < key2) {
+            CHECK_SUCCESS(cursor1.seek(key2));
+        } else if (key2 < key1) {
+            CHECK_SUCCESS(cursor2.seek(key1));
+        } else {
+            CHECK_SUCCESS(callback(cursor1.record(), cursor2.record()));
+            CHECK_SUCCESS(cursor1.next());
+            CHECK_SUCCESS(cursor2.next());
+        }
+    }
+    return Status::SUCCESS;
+}
+
 /// Set based merge.
 /// \param F typename, callback Status(Record const&, Record const&).
 /// \param table1 Table const*, left table pointer.
@@ -15,37 +371,212 @@ template <typename F>
 Status set_merge(
     Table const* table1, Table const* table2, F&& callback
 ) {
-    auto iter1 = table1->begin();
-    auto iter2 = table2->begin();
+    return merge_range(
+        table1, table2,
+        std::numeric_limits<prikey_t>::min(),
+        std::numeric_limits<prikey_t>::max(),
+        std::forward<F>(callback));
+}
+
+/// Multi-way merge join on primary key in leapfrog style, cursors behind
+/// the largest current key seek forward to it, so sparse regions of the
+/// other tables are skipped without reading their leaves.
+/// \tparam F typename, callback Status(std::vector<Record const*> const&),
+/// matched records in the order of the tables.
+/// \param tables std::vector<Table const*> const&, tables to join.
+/// \param callback F&&, callback for the matched rows.
+/// \return Status, whether success to join or not.
+template <typename F>
+Status leapfrog(std::vector<Table const*> const& tables, F&& callback) {
+    CHECK_TRUE(!tables.empty());
+    std::vector<LeafCursor> cursors;
+    for (Table const* table : tables) {
+        CHECK_NULL(table);
+        cursors.emplace_back(
+            table,
+            std::numeric_limits<prikey_t>::min(),
+            std::numeric_limits<prikey_t>::max());
+    }
 
-    auto end1 = table1->end();
-    auto end2 = table2->end();
+    std::vector<Record const*> row(cursors.size());
+    while (true) {
+        prikey_t target = std::numeric_limits<prikey_t>::min();
+        for (LeafCursor const& cursor : cursors) {
+            if (!cursor.valid()) {
+                return Status::SUCCESS;
+            }
+            target = std::max(target, cursor.record().key);
+        }
 
-    while (iter1 != end1 && iter2 != end2) {
-        prikey_t key1;
-        prikey_t key2 = (*iter2).key();
-        while (iter1 != end1 && (key1 = (*iter1).key()) < key2) {
-            ++iter1;
+        bool aligned = true;
+        for (LeafCursor& cursor : cursors) {
+            CHECK_SUCCESS(cursor.seek(target));
+            if (!cursor.valid() || cursor.record().key != target) {
+                aligned = false;
+                break;
+            }
         }
-        while (iter2 != end2 && (key2 = (*iter2).key()) < key1) {
-            ++iter2;
+        if (!aligned) {
+            continue;
         }
 
-        if (iter1 == end1 || iter2 == end2) {
-            break;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            row[i] = &cursors[i].record();
         }
+        CHECK_SUCCESS(callback(row));
+        for (LeafCursor& cursor : cursors) {
+            CHECK_SUCCESS(cursor.next());
+        }
+    }
+}
 
-        if (key1 == key2) {
-            CHECK_SUCCESS((*iter1).read([&](Record const& rec1) {
-                return (*iter2).read([&](Record const& rec2) {
-                    return callback(rec1, rec2);
-                });
-            }))
+/// Number of the outer keys probed at once in the index nested-loop join.
+constexpr size_t NESTED_LOOP_BATCH = 256;
+
+/// Index nested-loop join on primary key. Outer records are read in key
+/// order and their keys are probed on the inner tree in batches, so the
+/// consecutive probes in the same leaf share single descent.
+/// \tparam F typename, callback Status(Record const&, Record const&),
+/// outer record and inner record.
+/// \param outer Table const*, scanned table, expected to be small.
+/// \param inner Table const*, probed table.
+/// \param callback F&&, callback for the matched pairs.
+/// \param batch_size size_t, the number of the keys probed at once.
+/// \return Status, whether success to join or not.
+template <typename F>
+Status nested_loop(
+    Table const* outer, Table const* inner, F&& callback,
+    size_t batch_size = NESTED_LOOP_BATCH
+) {
+    std::vector<Record> records;
+    std::vector<prikey_t> keys;
+    std::vector<Record> matched;
+    auto probe = [&] {
+        CHECK_SUCCESS(inner->find_batch(keys, matched));
+        // matched records are in the order of the keys
+        size_t idx = 0;
+        for (Record const& rec : matched) {
+            while (records[idx].key != rec.key) {
+                ++idx;
+            }
+            CHECK_SUCCESS(callback(records[idx], rec));
+        }
+        records.clear();
+        keys.clear();
+        return Status::SUCCESS;
+    };
+
+    for (auto iter = outer->batches(); iter.valid(); iter.next()) {
+        for (Record const& rec : iter.batch()) {
+            records.push_back(rec);
+            keys.push_back(rec.key);
+        }
+        if (keys.size() >= batch_size) {
+            CHECK_SUCCESS(probe());
         }
-        ++iter1;
+    }
+    return probe();
+}
+
+/// Estimated page reads of the merge join, both tables are scanned.
+/// \param pages1 pagenum_t, the number of the pages of the left table.
+/// \param pages2 pagenum_t, the number of the pages of the right table.
+/// \return size_t, estimated cost.
+size_t merge_cost(pagenum_t pages1, pagenum_t pages2);
+
+/// Estimated page reads of the index nested-loop join, outer table is
+/// scanned and each outer record descends the inner tree.
+/// \param outer_pages pagenum_t, the number of the pages of the outer.
+/// \param inner_pages pagenum_t, the number of the pages of the inner.
+/// \return size_t, estimated cost.
+size_t nested_loop_cost(pagenum_t outer_pages, pagenum_t inner_pages);
+
+/// Join algorithm on primary key.
+enum class PrikeyJoin {
+    MERGE = 0,          /// merge join scanning both tables.
+    PROBE_RIGHT = 1,    /// nested-loop join, left outer probes the right.
+    PROBE_LEFT = 2,     /// nested-loop join, right outer probes the left.
+};
+
+/// Choose the join algorithm by the estimated page reads, the smaller
+/// table is the outer of the nested-loop join.
+/// \param pages1 pagenum_t, the number of the pages of the left table.
+/// \param pages2 pagenum_t, the number of the pages of the right table.
+/// \return PrikeyJoin, the cheapest algorithm.
+PrikeyJoin choose_join(pagenum_t pages1, pagenum_t pages2);
+
+/// Split the key space into ranges on the separators of both tables.
+/// \param table1 Table const*, left table pointer.
+/// \param table2 Table const*, right table pointer.
+/// \param num size_t, the maximum number of the ranges.
+/// \return std::vector<prikey_t>, ascending lower bounds of the ranges,
+/// the first one is the minimum key.
+std::vector<prikey_t> split_ranges(
+    Table const* table1, Table const* table2, size_t num);
+
+/// Parallel merge join on primary key. Key space is split into ranges
+/// and each range is merged by its own worker, worker of the lower range
+/// has the lower index, so the outputs are ordered if concatenated.
+/// \tparam F typename, callback Status(size_t, Record const&, Record const&),
+/// worker index and matched pair.
+/// \tparam D typename, callback Status(size_t, Status), worker index and
+/// result of its range, called by the worker after its range.
+/// \param table1 Table const*, left table pointer.
+/// \param table2 Table const*, right table pointer.
+/// \param num_workers size_t, the number of the workers, at least one.
+/// \param callback F&&, callback for the matched pairs, called
+/// concurrently with the different worker index.
+/// \param done D&&, callback for the finished ranges, its result is
+/// the result of the range.
+/// \return Status, whether success to merge or not.
+template <typename F, typename D>
+Status parallel_merge(
+    Table const* table1, Table const* table2,
+    size_t num_workers, F&& callback, D&& done
+) {
+    CHECK_TRUE(num_workers > 0);
+    std::vector<prikey_t> bounds = split_ranges(table1, table2, num_workers);
+    std::vector<Status> results(bounds.size(), Status::SUCCESS);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        prikey_t end = i + 1 < bounds.size()
+            ? bounds[i + 1] - 1
+            : std::numeric_limits<prikey_t>::max();
+        workers.emplace_back([&, i, end] {
+            Status res = merge_range(
+                table1, table2, bounds[i], end,
+                [&](Record const& rec1, Record const& rec2) {
+                    return callback(i, rec1, rec2);
+                });
+            results[i] = done(i, res);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (Status res : results) {
+        CHECK_SUCCESS(res);
     }
     return Status::SUCCESS;
 }
+
+/// Parallel merge join on primary key without the range callback.
+/// \tparam F typename, callback Status(size_t, Record const&, Record const&),
+/// worker index and matched pair.
+/// \param table1 Table const*, left table pointer.
+/// \param table2 Table const*, right table pointer.
+/// \param num_workers size_t, the number of the workers, at least one.
+/// \param callback F&&, callback for the matched pairs.
+/// \return Status, whether success to merge or not.
+template <typename F>
+Status parallel_merge(
+    Table const* table1, Table const* table2,
+    size_t num_workers, F&& callback
+) {
+    return parallel_merge(
+        table1, table2, num_workers, std::forward<F>(callback),
+        [](size_t, Status res) { return res; });
+}
 }
 
-#endif
\ No newline at end of file
+#endif
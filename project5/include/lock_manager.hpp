@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -10,6 +11,7 @@
 #include <unordered_map>
 
 #include "hashable.hpp"
+#include "pool.hpp"
 
 #ifdef TEST_MODULE
 #include "test.hpp"
@@ -29,13 +31,57 @@ enum class LockMode {
     IDLE = 0,
     SHARED = 1,
     EXCLUSIVE = 2,
+    INTENTION_SHARED = 3,
+    INTENTION_EXCLUSIVE = 4,
 };
 
+/// Lock granularity.
+enum class LockLevel {
+    INVALID = 0,
+    TABLE = 1,
+    PAGE = 2,
+    RECORD = 3,
+};
+
+/// Lock mode utilities for multiple granularity locking.
+namespace LockModes {
+    /// Whether two lock modes can be held by different transactions.
+    /// \param held LockMode, mode already held.
+    /// \param req LockMode, requested mode.
+    /// \return bool, whether compatible or not.
+    bool compatible(LockMode held, LockMode req);
+
+    /// Whether held lock mode already grants requested one.
+    /// \param held LockMode, mode already held.
+    /// \param req LockMode, requested mode.
+    /// \return bool, whether covered or not.
+    bool covers(LockMode held, LockMode req);
+
+    /// Least mode which covers both given modes.
+    /// \param left LockMode, lock mode.
+    /// \param right LockMode, lock mode.
+    /// \return LockMode, supremum of two modes.
+    LockMode supremum(LockMode left, LockMode right);
+
+    /// Non-intention mode which covers all locks under the intention.
+    /// \param mode LockMode, lock mode.
+    /// \return LockMode, escalated mode.
+    LockMode escalated(LockMode mode);
+
+    /// Intention mode which should be held on the ancestors.
+    /// \param mode LockMode, requested mode.
+    /// \return LockMode, intention mode.
+    LockMode intention(LockMode mode);
+}
+
 /// Pack of tableid, pageid, record index.
 using HashableID = HashablePack<tableid_t, pagenum_t, size_t>;
 
 /// Hierarchical ID for pointing specific page ID. 
 struct HierarchicalID {
+    /// Record index for page or table level ID.
+    static constexpr size_t WHOLE = static_cast<size_t>(-1);
+
     tableid_t tid;              /// Table ID.
     pagenum_t pid;              /// Page ID.
     size_t rid;                 /// Record index.
@@ -49,10 +95,33 @@ struct HierarchicalID {
     /// \param rid size_t, record index.
     HierarchicalID(tableid_t tid, pagenum_t pid, size_t rid);
 
+    /// Make table level ID.
+    /// \param tid tableid_t, table ID.
+    /// \return HierarchicalID, table level ID.
+    static HierarchicalID table(tableid_t tid);
+
+    /// Make page level ID.
+    /// \param tid tableid_t, table ID.
+    /// \param pid pagenum_t, page ID.
+    /// \return HierarchicalID, page level ID.
+    static HierarchicalID page(tableid_t tid, pagenum_t pid);
+
+    /// Get lock granularity of the ID.
+    /// \return LockLevel, granularity.
+    LockLevel level() const;
+
+    /// Get ID of the upper granularity, table for page, page for record.
+    /// \return HierarchicalID, parent ID.
+    HierarchicalID parent() const;
+
     /// Make ID in hashable format.
     /// \return HashableID, hashable hid.
     HashableID make_hashable() const;
 
+    /// Hash ID without packing, for the lock table.
+    /// \return std::size_t, hash.
+    std::size_t hash() const;
+
     /// Define order about hid for ordered data structure.
     bool operator<(HierarchicalID const& other) const;
 
@@ -63,6 +132,18 @@ struct HierarchicalID {
 /// Type alias for hierarchical ID as HID.
 using HID = HierarchicalID;
 
+namespace std {
+    template <>
+    struct hash<HierarchicalID> {
+        std::size_t operator()(HierarchicalID const& hid) const {
+            return hid.hash();
+        }
+    };
+}
+
+/// Intrusive lock queue, forward declaration.
+class LockQueue;
+
 
 /// Lock Structure.
 class Lock {
@@ -100,9 +181,16 @@ public:
 private:
     HID hid;                        /// hierarchical ID.
     LockMode mode;                  /// lock mode.
+    LockMode upgrade;               /// pending upgrade mode, IDLE if none.
     trxid_t xid;                    /// owner transaction id.
     Transaction* backref;           /// owner transaction.
     std::atomic<bool> wait_flag;    /// whether waiting for others or not.
+    Lock* prev;                     /// previous lock in the queue.
+    Lock* next;                     /// next lock in the queue.
+    LockQueue* queue;               /// queue which contains this lock.
+
+    friend class LockQueue;
+    friend class LockManager;
 
 #ifdef TEST_MODULE
     friend struct LockTest;
@@ -111,13 +199,93 @@ private:
 };
 
 
+/// Intrusive doubly linked queue of the locks, linking does not allocate.
+class LockQueue {
+public:
+    /// Forward iterator over the locks.
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Lock*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Lock* const*;
+        using reference = Lock* const&;
+
+        /// Construct iterator pointing given lock.
+        /// \param lock Lock*, current lock, nullptr for end.
+        iterator(Lock* lock);
+        /// Current lock.
+        reference operator*() const;
+        /// Move to the next lock.
+        iterator& operator++();
+        /// Move to the next lock.
+        iterator operator++(int);
+        /// Equality comparison.
+        bool operator==(iterator const& other) const;
+        /// Inequality comparison.
+        bool operator!=(iterator const& other) const;
+
+    private:
+        Lock* lock;     /// current lock.
+    };
+
+    /// Default constructor.
+    LockQueue();
+    /// Default destructor.
+    ~LockQueue() = default;
+    /// Deleted copy constructor.
+    LockQueue(LockQueue const&) = delete;
+    /// Deleted copy assignment.
+    LockQueue& operator=(LockQueue const&) = delete;
+
+    /// The number of the locks.
+    size_t size() const;
+    /// Whether queue is empty or not.
+    bool empty() const;
+    /// First lock.
+    Lock* front() const;
+    /// Last lock.
+    Lock* back() const;
+
+    /// Link lock at the front of the queue.
+    /// \param lock Lock*, unlinked lock.
+    void push_front(Lock* lock);
+    /// Link lock at the end of the queue.
+    /// \param lock Lock*, unlinked lock.
+    void push_back(Lock* lock);
+    /// Unlink lock from the queue.
+    /// \param lock Lock*, lock in this queue.
+    /// \return iterator, iterator pointing next lock.
+    iterator erase(Lock* lock);
+
+    /// Iterator pointing first lock.
+    iterator begin() const;
+    /// Iterator pointing past the last lock.
+    iterator end() const;
+
+private:
+    Lock* head;         /// first lock.
+    Lock* tail;         /// last lock.
+    size_t num;         /// the number of the locks.
+};
+
+
 /// Lock manager.
 class LockManager {
 public:
+    /// Default number of record locks on a page before escalation, 16.
+    static constexpr size_t DEFAULT_RECORD_ESCALATION = 16;
+
+    /// Default number of page locks on a table before escalation, 1024.
+    static constexpr size_t DEFAULT_PAGE_ESCALATION = 1024;
+
+    /// Pooled lock allocator.
+    using allocator_t = PoolAllocator<Lock>;
+
     /// Default constructor.
     LockManager();
-    /// Default destructor.
-    ~LockManager() = default;
+    /// Destructor, return all remaining locks to the pool.
+    ~LockManager();
     /// Deleted move constructor.
     LockManager(LockManager&&) = delete;
     /// Deleted copy constructor.
@@ -131,20 +299,40 @@ public:
     /// \param backref Transaction*, lock owner.
     /// \param hid HID, hierarchical ID.
     /// \param mode LockMode, lock mode.
-    /// \return std::shared_ptr<Lock>, created lock pointer.
-    std::shared_ptr<Lock> require_lock(
-        Transaction* backref, HID hid, LockMode mode);
+    /// \return Lock*, pooled lock owned by the manager,
+    /// nullptr if the lock is released while waiting (abort).
+    Lock* require_lock(Transaction* backref, HID hid, LockMode mode);
     
-    /// Relase lock.
-    /// \param lock std::shared_ptr<Lock>, target lock.
+    /// Upgrade granted lock in place, waiting only for the holders of
+    /// the other transactions, prior to the waiting requests.
+    /// \param lock Lock*, granted lock.
+    /// \param mode LockMode, stronger lock mode.
+    /// \return Status, FAILURE if the lock is released while waiting (abort).
+    Status upgrade_lock(Lock* lock, LockMode mode);
+
+    /// Relase lock, granted lock returns to the pool immediately,
+    /// waiting lock is returned by the waiter.
+    /// \param lock Lock*, target lock.
     /// \param acquire acquire lock or not, default true.
     /// \return Status, whether success to release lock or not.
-    Status release_lock(std::shared_ptr<Lock> lock, bool acquire = true);
+    Status release_lock(Lock* lock, bool acquire = true);
 
     /// Set base database structure.
     /// \param db Database&, database.
     Status set_database(Database& db);
 
+    /// Set escalation thresholds, zero for disabling each escalation.
+    /// \param records size_t, record locks on a page before page lock.
+    /// \param pages size_t, page locks on a table before table lock.
+    /// \return Status, whether success or not.
+    Status set_escalation(size_t records, size_t pages);
+
+    /// Number of record locks on a page which triggers escalation.
+    size_t record_escalation() const;
+
+    /// Number of page locks on a table which triggers escalation.
+    size_t page_escalation() const;
+
 private:
 #ifdef TEST_MODULE
     friend class LockManagerTest;
@@ -152,9 +340,10 @@ private:
 
     /// Lock struct for one specified page.
     struct LockStruct {
-        LockMode mode;                              /// current lock mode.
-        std::list<std::shared_ptr<Lock>> run;       /// running locks.
-        std::list<std::shared_ptr<Lock>> wait;      /// waiting locks.
+        LockMode mode;      /// current lock mode.
+        LockQueue run;      /// running locks.
+        LockQueue wait;     /// waiting locks.
+        size_t upgrading;   /// running locks waiting for upgrade.
 
         /// Default constructor.
         LockStruct();
@@ -171,7 +360,9 @@ private:
     };
 
     /// Type alias for lock table.
-    using locktable_t = std::unordered_map<HashableID, LockStruct>;
+    using locktable_t = std::unordered_map<
+        HID, LockStruct, std::hash<HID>, std::equal_to<HID>,
+        PoolAllocator<std::pair<HID const, LockStruct>>>;
 
     /// Deadloock detector.
     struct DeadlockDetector {
@@ -227,13 +418,31 @@ private:
     locktable_t locks;              /// lock table.
     DeadlockDetector detector;      /// deadlock detector.
     Database* db;                   /// database system.
+    std::atomic<size_t> records_per_page;   /// record escalation threshold.
+    std::atomic<size_t> pages_per_table;    /// page escalation threshold.
 
-    /// Whether current lock is lockable on given page.
+    /// Whether current lock is lockable on given page,
+    /// locks of the same transaction are not considered as conflict.
     /// \param module LockStruct const&, lock structs for target page.
-    /// \param target std::shared_ptr<Lock> const&, target locks.
+    /// \param target Lock const*, target locks.
     /// \return bool, whether lockable or not.
-    bool lockable(
-        LockStruct const& module, std::shared_ptr<Lock> const& target) const;
+    bool lockable(LockStruct const& module, Lock const* target) const;
+
+    /// Whether pending upgrade is grantable, only the running locks
+    /// of the other transactions are considered.
+    /// \param module LockStruct const&, lock structs for target page.
+    /// \param target Lock const*, running lock with pending upgrade.
+    /// \return bool, whether upgradable or not.
+    bool upgradable(LockStruct const& module, Lock const* target) const;
+
+    /// Grant pending upgrades which became compatible.
+    /// \param module LockStruct&, lock structs for target page.
+    void grant_upgrades(LockStruct& module);
+
+    /// Compute the mode of the running locks.
+    /// \param module LockStruct const&, lock structs for target page.
+    /// \return LockMode, supremum of the running lock modes.
+    static LockMode running_mode(LockStruct const& module);
 
     /// Detect deadlock and release if it is found.
     /// \return Status, whether deadlock found or not.
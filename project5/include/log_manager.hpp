@@ -1,8 +1,17 @@
 #ifndef LOG_MANAGER_HPP
 #define LOG_MANAGER_HPP
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
 #include <list>
 #include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "headers.hpp"
 #include "lock_manager.hpp"
@@ -19,10 +28,22 @@ enum class LogType {
     ABORT = 3,
     CLR = 4,
     END = 5,
+    BEGIN_CKPT = 6,
+    CKPT_DPT = 7,
+    CKPT_ATT = 8,
+    END_CKPT = 9,
+    INSERT = 10,
+    DELETE = 11,
+    CLR_INSERT = 12,
+    CLR_DELETE = 13,
+    PAGE = 14,
 };
 
 /// Log structure.
 struct Log {
+    /// Size of the page entry in the page log, page ID and its image.
+    static constexpr size_t IMAGE_SIZE = sizeof(pagenum_t) + sizeof(Page);
+
     /// Default constructor.
     Log();
     /// Constructor for recordless log.
@@ -32,7 +53,8 @@ struct Log {
     /// \param type LogType, log type.
     Log(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type);
 
-    /// Constructor for record relative log.
+    /// Constructor for record relative log, changed range of the value
+    /// is computed from the before and after records.
     /// \param lsn lsn_t, log sequence number.
     /// \param prev_lsn lsn_t, previous lsn.
     /// \param xid trxid_t, transaction ID.
@@ -44,23 +66,135 @@ struct Log {
     Log(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
         HID hid, int offset, Record const& before, Record const& after);
 
+    /// Constructor for compensation log.
+    /// \param lsn lsn_t, log sequence number.
+    /// \param prev_lsn lsn_t, previous lsn.
+    /// \param xid trxid_t, transaction ID.
+    /// \param type LogType, log type.
+    /// \param hid HID, hierarchical ID.
+    /// \param offset int, record offset in target page.
+    /// \param before Record const&, before record.
+    /// \param after Record const&, after record.
+    /// \param undo_next lsn_t, next lsn to undo.
+    Log(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+        HID hid, int offset, Record const& before, Record const& after,
+        lsn_t undo_next);
+
+    /// Constructor for checkpoint entry.
+    /// \param lsn lsn_t, log sequence number.
+    /// \param prev_lsn lsn_t, previous lsn.
+    /// \param xid trxid_t, transaction ID, for active transaction entry.
+    /// \param type LogType, log type.
+    /// \param hid HID, hierarchical ID, for dirty page entry.
+    /// \param undo_next lsn_t, recLSN of the dirty page
+    /// or last lsn of the active transaction.
+    Log(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+        HID hid, lsn_t undo_next);
+
+    /// Constructor for page log, after images of the pages changed by
+    /// a structure modification.
+    /// \param lsn lsn_t, log sequence number.
+    /// \param prev_lsn lsn_t, previous lsn.
+    /// \param xid trxid_t, transaction ID.
+    /// \param type LogType, log type.
+    /// \param hid HID, hierarchical ID, table of the pages.
+    /// \param images std::shared_ptr<std::vector<uint8_t> const>,
+    /// entries of the page ID followed by its image, the number of
+    /// the entries is kept as offset.
+    Log(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+        HID hid, std::shared_ptr<std::vector<uint8_t> const> images);
+
+    /// Whether log is undone on rollback, update, insert or delete.
+    bool undoable() const;
+
+    /// Whether log is compensation of the undone log.
+    bool compensation() const;
+
+    /// Whether log is replayed by key instead of the page,
+    /// insert, delete and their compensations.
+    bool logical() const;
+
     lsn_t lsn;          /// log sequence number.
     lsn_t prev_lsn;     /// previous lsn.
     trxid_t xid;        /// transaction ID.
     LogType type;       /// log type.
     HID hid;            /// hierarchical ID.
     int offset;         /// record offset in target page.
-    Record before;      /// before record.
-    Record after;       /// after record.
+    Record before;      /// before record, valid in the changed range.
+    Record after;       /// after record, valid in the changed range.
+    lsn_t undo_next;    /// next lsn to undo, for compensation log.
+    int delta_offset;   /// offset of the first changed byte of the value.
+    int delta_length;   /// the number of the changed bytes of the value.
+    std::shared_ptr<std::vector<uint8_t> const> images;
+                        /// page IDs and images, for page log.
+};
+
+/// Statistics of restart recovery.
+struct RecoveryStats {
+    size_t num_logs;        /// the number of the analyzed logs.
+    size_t num_redo;        /// the number of the redone logs.
+    size_t num_undo;        /// the number of the undone logs.
+    size_t num_workers;     /// the number of the redo workers.
+    double redo_time;       /// elapsed time of redo pass in seconds.
+    double total_time;      /// elapsed time of recovery in seconds.
+
+    /// Redo throughput.
+    /// \return double, redone logs per second.
+    double redo_throughput() const;
+};
+
+/// Statistics of group commit.
+struct GroupCommitStats {
+    size_t num_groups;      /// the number of the flushed groups.
+    size_t num_commits;     /// the number of the committed transactions.
+    size_t max_group;       /// the largest group size.
+
+    /// Average group size.
+    /// \return double, commits per log flush.
+    double avg_group() const;
 };
 
+/// Dirty page table entry, forward declaration (ref: buffer_manager.hpp).
+struct DirtyPage;
+
+/// Database system, forward declaration (ref: dbms.hpp).
+class Database;
+
 
-/// Log manager.
+/// Log manager, writers reserve LSN with atomic increment and copy
+/// their logs into the ring buffer without global lock.
 class LogManager {
 public:
-    /// Default constructor.
+    /// The number of the logs in the ring buffer.
+    static constexpr size_t BUFFER_SIZE = 1 << 12;
+    /// The number of the shards of the transaction log chains.
+    static constexpr size_t NUM_SHARDS = 64;
+    /// The number of the dirty pages written back per checkpoint period.
+    static constexpr size_t FLUSH_BATCH = 16;
+    /// Default maximum number of the commits in a group.
+    static constexpr size_t GROUP_SIZE = 64;
+
+    /// Default constructor, logs are kept only in memory.
     LogManager();
 
+    /// Destructor, stop checkpointer, flush and close the log file.
+    ~LogManager();
+
+    /// Deleted copy constructor.
+    LogManager(LogManager const&) = delete;
+
+    /// Deleted copy assignment.
+    LogManager& operator=(LogManager const&) = delete;
+
+    /// Open or create write-ahead log file, it should be called before
+    /// writing any log.
+    /// \param filename std::string const&, the name of the log file.
+    /// \return Status, whether success to open the log file or not.
+    Status open(std::string const& filename);
+
+    /// Whether log file is opened or not.
+    bool durable() const;
+
     /// Write log about record update.
     /// \param xid trxid_t, transaction ID.
     /// \param hid HID, hierarchical ID.
@@ -72,6 +206,36 @@ public:
         trxid_t xid, HID hid, int offset,
         Record const& before, Record const& after);
     
+    /// Write log about record insertion.
+    /// \param xid trxid_t, transaction ID.
+    /// \param hid HID, hierarchical ID.
+    /// \param offset int, record index.
+    /// \param record Record const&, inserted record.
+    /// \return lsn_t, allocated log sequence number.
+    lsn_t log_insert(
+        trxid_t xid, HID hid, int offset, Record const& record);
+
+    /// Write log about record deletion.
+    /// \param xid trxid_t, transaction ID.
+    /// \param hid HID, hierarchical ID.
+    /// \param offset int, record index.
+    /// \param record Record const&, deleted record.
+    /// \return lsn_t, allocated log sequence number.
+    lsn_t log_delete(
+        trxid_t xid, HID hid, int offset, Record const& record);
+
+    /// Write compensation log for undoing update.
+    /// \param xid trxid_t, transaction ID.
+    /// \param hid HID, hierarchical ID.
+    /// \param offset int, record index.
+    /// \param before Record const&, record before undo.
+    /// \param after Record const&, restored record.
+    /// \param undo_next lsn_t, previous lsn of the undone log.
+    /// \return lsn_t, allocated log sequence number.
+    lsn_t log_clr(
+        trxid_t xid, HID hid, int offset,
+        Record const& before, Record const& after, lsn_t undo_next);
+
     /// Write log about transaction abort.
     /// \param xid trxid_t, transaction ID.
     /// \return lsn_t, allocated log sequence number.
@@ -87,7 +251,19 @@ public:
     /// \return lsn_t, allocated log sequence number.
     lsn_t log_end(trxid_t xid);
 
-    /// Get all logs about given transaction ID.
+    /// Write after images of the pages changed by a structure modification
+    /// in a single log, which is redone before the logical logs and never
+    /// undone. Pages should be held by the buffer manager, they are
+    /// released with the lsn of the log.
+    /// \param dbms Database&, database system.
+    /// \param tid tableid_t, table ID.
+    /// \param pages std::vector<pagenum_t> const&, held page IDs.
+    /// \return Status, whether success to log all pages or not.
+    Status log_pages(
+        Database& dbms, tableid_t tid, std::vector<pagenum_t> const& pages);
+
+    /// Get all logs about given transaction ID by following prev_lsn chain.
+    /// \param xid trxid_t, transaction ID.
     /// \return std::list<Log>, log list in reverse chronological order.
     std::list<Log> get_logs(trxid_t xid);
 
@@ -96,32 +272,352 @@ public:
     /// \return Status, whether success to remove all logs about xid or not.
     Status remove_trxlog(trxid_t xid);
 
+    /// Write buffered logs to the log file until given LSN at least.
+    /// \param lsn lsn_t, log sequence number which should be durable.
+    /// \return Status, whether success to flush or not.
+    Status flush(lsn_t lsn);
+
+    /// Write all buffered logs to the log file.
+    /// \return Status, whether success to flush or not.
+    Status flush_all();
+
+    /// Wait until the commit log is durable. Committing transactions
+    /// join the current group, and the first one becomes the leader
+    /// which flushes the log once for the whole group.
+    /// \param lsn lsn_t, lsn of the commit log.
+    /// \return Status, whether the commit log is durable or not.
+    Status commit(lsn_t lsn);
+
+    /// Set group commit parameters.
+    /// \param size size_t, maximum number of the commits in a group,
+    /// at least one.
+    /// \param wait int, maximum time for the leader to wait followers
+    /// in microseconds, zero for gathering only during the previous flush.
+    /// \return Status, whether success to set or not.
+    Status set_group_commit(size_t size, int wait);
+
+    /// Get statistics of group commit.
+    /// \return GroupCommitStats, group commit statistics.
+    GroupCommitStats group_commit_stats();
+
+    /// Record table file for restart recovery.
+    /// \param tid tableid_t, table ID.
+    /// \param filename std::string const&, the name of the table file.
+    /// \return Status, whether success to write catalog or not.
+    Status register_table(tableid_t tid, std::string const& filename);
+
+    /// Undo update, insert or delete log with writing compensation log.
+    /// \param dbms Database&, database system.
+    /// \param log Log const&, undoable log.
+    /// \return Status, whether success to undo or not.
+    Status rollback(Database& dbms, Log const& log);
+
+    /// Undo all logs of the aborting transaction. Consecutive updates
+    /// are grouped by page, each page is latched once and its compensation
+    /// logs are reserved at once, inserts and deletes are undone one by one.
+    /// \param dbms Database&, database system.
+    /// \param logs std::list<Log> const&, logs in reverse chronological order.
+    /// \return Status, whether success to undo or not.
+    Status rollback(Database& dbms, std::list<Log> const& logs);
+
+    /// Restart recovery, analysis, redo and undo pass of ARIES.
+    /// Analysis starts from the last complete checkpoint and redo starts
+    /// from the oldest recLSN of the dirty page table.
+    /// \param dbms Database&, database system.
+    /// \return Status, whether success to recover or not.
+    Status recovery(Database& dbms);
+
+    /// Set the number of the redo workers.
+    /// \param num size_t, the number of the workers, at least one.
+    /// \return Status, whether success to set or not.
+    Status set_redo_workers(size_t num);
+
+    /// Get statistics of the last restart recovery.
+    /// \return RecoveryStats const&, recovery statistics.
+    RecoveryStats const& recovery_stats() const;
+
+    /// Write fuzzy checkpoint, dirty page table and active transaction
+    /// table are logged between begin and end checkpoint logs.
+    /// \param dbms Database&, database system.
+    /// \return Status, whether success to write checkpoint or not.
+    Status checkpoint(Database& dbms);
+
+    /// Start background checkpointer, which writes back dirty pages
+    /// incrementally and takes checkpoint periodically.
+    /// \param dbms Database&, database system.
+    /// \param interval int, checkpoint period in milliseconds.
+    /// \return Status, whether success to start checkpointer or not.
+    Status start_checkpointer(Database& dbms, int interval);
+
+    /// Stop background checkpointer.
+    /// \return Status, whether success to stop checkpointer or not.
+    Status stop_checkpointer();
+
 private:
-    std::mutex mtx;                                 /// System level mutex.
-    lsn_t last_lsn;                                 /// last log sequence number.
-    std::unordered_map<trxid_t, std::list<Log>> log_map;      /// logs.
+    /// Compact log format in the log file, followed by the changed bytes
+    /// of the before record and the after record.
+    struct PackedLog {
+        lsn_t lsn;              /// 0~8, log sequence number.
+        lsn_t prev_lsn;         /// 8~16, previous lsn.
+        lsn_t undo_next;        /// 16~24, next lsn to undo.
+        pagenum_t pid;          /// 24~32, page ID of the hierarchical ID.
+        uint64_t rid;           /// 32~40, record ID of the hierarchical ID.
+        prikey_t key;           /// 40~48, key of the updated record.
+        trxid_t xid;            /// 48~52, transaction ID.
+        tableid_t tid;          /// 52~56, table ID of the hierarchical ID.
+        int32_t offset;         /// 56~60, record offset in target page.
+        uint8_t type;           /// 60~61, log type.
+        uint8_t delta_offset;   /// 61~62, offset of the first changed byte.
+        uint8_t delta_length;   /// 62~63, the number of the changed bytes.
+        uint8_t reserved;       /// 63~64, reserved.
+    };
+
+    /// Maximum size of the packed log about record.
+    static constexpr size_t MAX_PACKED =
+        sizeof(PackedLog) + 2 * sizeof(Record::value);
 
-    /// Get possible log sequence number.
+    /// Buffer slot, log is published when `lsn` is stored.
+    struct Slot {
+        std::atomic<lsn_t> lsn;     /// lsn of the published log.
+        Log log;                    /// log.
+    };
+
+    /// Log chain of single transaction.
+    struct Chain {
+        lsn_t first;                /// first lsn of the transaction.
+        lsn_t last;                 /// last lsn of the transaction.
+    };
+
+    /// Group of the committing transactions.
+    struct Group {
+        lsn_t lsn;                  /// the largest commit lsn.
+        size_t size;                /// the number of the commits.
+        bool done;                  /// whether group is flushed or not.
+        Status status;              /// result of the flush.
+    };
+
+    /// Shard of the transaction log chains.
+    struct alignas(64) Shard {
+        std::mutex mtx;                                 /// shard mutex.
+        std::unordered_map<trxid_t, Chain> chains;      /// log chains.
+    };
+
+    std::mutex mtx;                                 /// mutex for draining logs.
+    std::atomic<lsn_t> last_lsn;                    /// last reserved lsn.
+    std::atomic<lsn_t> drained_lsn;                 /// last lsn moved out of ring.
+    std::atomic<lsn_t> flushed_lsn;                 /// last durable lsn.
+    std::unique_ptr<Slot[]> ring;                   /// ring buffer.
+    std::array<Shard, NUM_SHARDS> shards;           /// transaction log chains.
+
+    FILE* fp;                                       /// log file.
+    std::string filename;                           /// name of the log file.
+    std::vector<uint8_t> staging;                   /// packed logs being drained.
+    std::vector<uint64_t> offsets;                  /// file offsets of the logs.
+    uint64_t file_end;                              /// end of the log file.
+    std::deque<Log> archive;                        /// drained logs, memory only.
+    lsn_t archive_base;                             /// lsn of the first archived log.
+    std::map<tableid_t, std::string> catalog;       /// table files.
+    lsn_t master_lsn;                               /// last complete checkpoint.
+    lsn_t ckpt_lsn;                                 /// last lsn covered by checkpoint.
+
+    std::thread checkpointer;                       /// checkpointer thread.
+    std::mutex ckpt_mtx;                            /// mutex for checkpoint.
+    std::condition_variable ckpt_cv;                /// checkpointer wakeup.
+    bool ckpt_running;                              /// checkpointer is running.
+
+    std::mutex group_mtx;                           /// mutex for group commit.
+    std::condition_variable group_cv;               /// group state changed.
+    std::shared_ptr<Group> forming;                 /// group accepting commits.
+    bool group_flushing;                            /// leader is flushing.
+    size_t group_size;                              /// maximum group size.
+    int group_wait;                                 /// leader wait in microseconds.
+    GroupCommitStats group_stats;                   /// group commit statistics.
+
+    size_t redo_workers;                            /// the number of redo workers.
+    RecoveryStats stats;                            /// last recovery statistics.
+
+    /// Reserve log sequence number.
     /// \return lsn_t, monotonically increasing lsn.
     lsn_t get_lsn();
 
-    /// Log writer.
+    /// Get shard of given transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Shard&, shard.
+    Shard& shard_of(trxid_t xid);
+
+    /// Wait for free space in the ring buffer.
+    /// \param lsn lsn_t, reserved lsn.
+    /// \return Slot&, slot for given lsn.
+    Slot& reserve(lsn_t lsn);
+
+    /// Move published logs out of the ring buffer in lsn order,
+    /// mutex should be acquired.
+    /// \return Status, whether success to write logs or not.
+    Status drain_buffer();
+
+    /// Drain logs until given LSN, mutex should be acquired.
+    /// \param own std::unique_lock<std::mutex>&, acquired mutex.
+    /// \param lsn lsn_t, target log sequence number.
+    /// \return Status, whether success to drain or not.
+    Status drain_until(std::unique_lock<std::mutex>& own, lsn_t lsn);
+
+    /// Read drained log, mutex should be acquired.
+    /// \param lsn lsn_t, log sequence number.
+    /// \param log Log*, pointer to write log.
+    /// \return Status, whether success to read or not.
+    Status read_log(lsn_t lsn, Log* log);
+
+    /// Discard archived logs which are not required by any transaction.
+    void trim_archive();
+
+    /// Read logs from the log file, index `i` has lsn `from + i`.
+    /// \param from lsn_t, first lsn to read, default 1.
+    /// \return std::vector<Log>, logs in chronological order.
+    std::vector<Log> read_logs(lsn_t from = 1);
+
+    /// Scan the log file and build file offsets of the complete logs.
+    /// \return lsn_t, the number of the complete logs.
+    lsn_t scan_logs();
+
+    /// Size of the log in compact format.
+    /// \param log Log const&, log.
+    /// \return size_t, the number of the bytes.
+    static size_t packed_size(Log const& log);
+
+    /// Write log in compact format.
+    /// \param log Log const&, log.
+    /// \param out uint8_t*, buffer with packed_size bytes at least.
+    /// \return size_t, the number of the written bytes.
+    static size_t pack(Log const& log, uint8_t* out);
+
+    /// Read log in compact format.
+    /// \param data uint8_t const*, packed log.
+    /// \param size size_t, the number of the readable bytes.
+    /// \param log Log*, pointer to write log.
+    /// \return size_t, the number of the read bytes, 0 if broken.
+    static size_t unpack(uint8_t const* data, size_t size, Log* log);
+
+    /// Redo pass, structure modifications are redone first, then logical
+    /// logs are applied by key in lsn order as the barriers, and the
+    /// updates between them are replayed by page.
+    /// \param dbms Database&, database system.
+    /// \param logs std::vector<Log> const&, logs in chronological order.
+    /// \param dirty std::map<HID, lsn_t> const&, dirty page table.
+    /// \return Status, whether success to redo or not.
+    Status redo(
+        Database& dbms, std::vector<Log> const& logs,
+        std::map<HID, lsn_t> const& dirty);
+
+    /// Write the latest image of each page if page LSN is older than
+    /// the page log, the tree takes the structure logged at last.
+    /// \param dbms Database&, database system.
+    /// \param logs std::vector<Log> const&, logs in chronological order.
+    /// \return Status, whether success to redo or not.
+    Status redo_images(Database& dbms, std::vector<Log> const& logs);
+
+    /// Replay the updates partitioned by page in parallel, logs of the
+    /// same page are replayed by single worker in lsn order.
+    /// \param dbms Database&, database system.
+    /// \param logs std::vector<Log const*> const&, redoable update and
+    /// compensation logs in lsn order.
+    /// \return Status, whether success to redo or not.
+    Status redo_pages(Database& dbms, std::vector<Log const*> const& logs);
+
+    /// Find the record of the log in the page, records could be moved
+    /// by insert and delete after the log is written.
+    /// \param page Page const&, page frame.
+    /// \param log Log const&, record relative log.
+    /// \return int, record index, -1 if not found.
+    static int locate(Page const& page, Log const& log);
+
+    /// Write changed bytes of the log to the latched page
+    /// if page LSN is older than given LSN.
+    /// \param page Page&, page frame.
+    /// \param offset int, record index, -1 for skipping.
+    /// \param log Log const&, update or compensation log.
+    /// \param undo bool, write before image or not.
+    /// \param lsn lsn_t, LSN of the change.
+    static void replay(
+        Page& page, int offset, Log const& log, bool undo, lsn_t lsn);
+
+    /// Redo or undo the log by key. Updates are written to the page if
+    /// page LSN is older than the LSN of the log, and inserts and deletes
+    /// are applied if the key is absent or present, on redo, only if
+    /// the leaf is older than the log.
+    /// On undo, compensation log is written while the page is latched.
+    /// \param dbms Database&, database system.
+    /// \param log Log const&, undoable or compensation log.
+    /// \param undo bool, restore before image or not.
+    /// \return Status, whether success or not.
+    Status apply(Database& dbms, Log const& log, bool undo);
+
+    /// Undo the run of the update logs grouped by page, compensation log
+    /// points the most recent log which is not undone yet.
+    /// \param dbms Database&, database system.
+    /// \param run std::vector<Log const*>&, update logs of a transaction
+    /// in reverse chronological order, sorted by key on return.
+    /// \return Status, whether success to undo or not.
+    Status undo_updates(Database& dbms, std::vector<Log const*>& run);
+
+    /// Reserve consecutive LSNs on the chain of the transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \param num size_t, the number of the logs, at least one.
+    /// \param prev_lsn lsn_t&, previous lsn of the first log.
+    /// \return lsn_t, the first reserved lsn.
+    lsn_t reserve_chain(trxid_t xid, size_t num, lsn_t& prev_lsn);
+
+    /// Write fuzzy checkpoint, checkpoint mutex should be acquired.
+    /// \param dbms Database&, database system.
+    /// \return Status, whether success to write checkpoint or not.
+    Status write_checkpoint(Database& dbms);
+
+    /// Write master record, lsn of the last complete checkpoint.
+    /// \param lsn lsn_t, lsn of the begin checkpoint log.
+    /// \return Status, whether success to write master record or not.
+    Status write_master(lsn_t lsn);
+
+    /// Offset of the drained log in the log file, mutex should be acquired.
+    /// \param lsn lsn_t, log sequence number, next lsn for the end of file.
+    /// \return long, file offset.
+    long offset_of(lsn_t lsn) const;
+
+    /// Log writer, only the transaction chain is guarded by shard mutex.
     /// \tparam typename... Args, arguments type.
     /// \param xid trxid_t, transaction ID.
     /// \param args Args&&..., arguments for log constructor.
     /// \return lsn_t, allocated log sequence number.
     template <typename... Args>
     lsn_t wrapper(trxid_t xid, Args&&... args) {
-        std::unique_lock<std::mutex> own(mtx);
-        std::list<Log>& log_list = log_map[xid];
-
-        lsn_t lsn = get_lsn();
+        Shard& shard = shard_of(xid);
+        lsn_t lsn;
         lsn_t prev_lsn = INVALID_LSN;
-        if (log_list.size() > 0) {
-            prev_lsn = log_list.front().lsn;
+        {
+            std::unique_lock<std::mutex> own(shard.mtx);
+            lsn = get_lsn();
+            auto iter = shard.chains.find(xid);
+            if (iter == shard.chains.end()) {
+                shard.chains.emplace(xid, Chain{ lsn, lsn });
+            } else {
+                prev_lsn = iter->second.last;
+                iter->second.last = lsn;
+            }
         }
 
-        log_list.emplace_front(lsn, prev_lsn, xid, std::forward<Args>(args)...);
+        return publish(lsn, prev_lsn, xid, std::forward<Args>(args)...);
+    }
+
+    /// Copy log into the ring buffer and publish it.
+    /// \tparam typename... Args, arguments type.
+    /// \param lsn lsn_t, reserved log sequence number.
+    /// \param prev_lsn lsn_t, previous lsn.
+    /// \param xid trxid_t, transaction ID.
+    /// \param args Args&&..., arguments for log constructor.
+    /// \return lsn_t, given log sequence number.
+    template <typename... Args>
+    lsn_t publish(lsn_t lsn, lsn_t prev_lsn, trxid_t xid, Args&&... args) {
+        Slot& slot = reserve(lsn);
+        slot.log = Log(lsn, prev_lsn, xid, std::forward<Args>(args)...);
+        slot.lsn.store(lsn, std::memory_order_release);
         return lsn;
     }
 
@@ -0,0 +1,193 @@
+#ifndef OCC_MANAGER_HPP
+#define OCC_MANAGER_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "headers.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Database, forward declaration.
+class Database;
+
+/// Concurrency control scheme of the transactions.
+enum class Concurrency {
+    LOCKING = 0,        /// two-phase locking with snapshot reads.
+    OPTIMISTIC = 1,     /// optimistic, validate at commit.
+};
+
+/// Statistics of the optimistic transactions.
+struct OccStats {
+    size_t num_commits;         /// the number of the committed transactions.
+    size_t num_conflicts;       /// the number of the validation failures.
+};
+
+/// Optimistic concurrency control in Silo style, transactions run
+/// without locks, buffer their writes and validate the read set at commit.
+/// Records share the version words by hash, so the memory is fixed and
+/// a collision is at worst a spurious validation failure.
+class OccManager {
+public:
+    /// Number of the version words, power of two.
+    static constexpr size_t NUM_WORDS = 1 << 16;
+
+    /// Lock bit of the record word.
+    static constexpr uint64_t LOCKED = 1;
+
+    /// Default constructor.
+    OccManager();
+
+    /// Default destructor.
+    ~OccManager() = default;
+
+    /// Deleted copy constructor.
+    OccManager(OccManager const&) = delete;
+
+    /// Deleted move constructor.
+    OccManager(OccManager&&) = delete;
+
+    /// Deleted copy assignment.
+    OccManager& operator=(OccManager const&) = delete;
+
+    /// Deleted move assignment.
+    OccManager& operator=(OccManager&&) = delete;
+
+    /// Set base database structure.
+    /// \param db Database&, database.
+    /// \return Status, whether success or not.
+    Status set_database(Database& db);
+
+    /// Start optimistic transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \param read_only bool, whether writes are refused.
+    /// \return Status, whether success or not.
+    Status begin(trxid_t xid, bool read_only = false);
+
+    /// Find record, own writes are visible.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \param record Record*, nullable, pointer to write the result.
+    /// \return Status, whether the record exists or not.
+    Status find(trxid_t xid, tableid_t tid, prikey_t key, Record* record);
+
+    /// Buffer record insertion.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \param value uint8_t const*, value sequence.
+    /// \param value_size int, the size of the value.
+    /// \return Status, whether the key is insertable or not.
+    Status insert(
+        trxid_t xid, tableid_t tid, prikey_t key,
+        uint8_t const* value, int value_size);
+
+    /// Buffer record deletion.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \return Status, whether the key exists or not.
+    Status remove(trxid_t xid, tableid_t tid, prikey_t key);
+
+    /// Buffer record update.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \param record Record const&, new record.
+    /// \return Status, whether the key exists or not.
+    Status update(
+        trxid_t xid, tableid_t tid, prikey_t key, Record const& record);
+
+    /// Lock the write set in global order, validate the read set
+    /// and install the writes with logs.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Status, FAILURE if validation failed, caller should abort.
+    Status commit(trxid_t xid);
+
+    /// Discard the buffered writes.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Status, whether success or not.
+    Status abort(trxid_t xid);
+
+    /// Get statistics.
+    /// \return OccStats, optimistic transaction statistics.
+    OccStats stats() const;
+
+private:
+    /// Record ID, ordered for global locking order.
+    using recid_t = std::pair<tableid_t, prikey_t>;
+
+    /// Hash of the record ID.
+    struct RecordHash {
+        /// Hash table ID and key.
+        std::size_t operator()(recid_t const& id) const {
+            return std::hash<prikey_t>{}(id.second)
+                ^ (static_cast<std::size_t>(id.first) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    /// Buffered write operation.
+    enum class Op {
+        UPDATE = 0,
+        INSERT = 1,
+        DELETE = 2,
+    };
+
+    /// Buffered write.
+    struct Write {
+        Op op;              /// operation.
+        Record record;      /// record after the write.
+    };
+
+    /// Read and write set of the transaction.
+    struct Context {
+        std::map<recid_t, uint64_t> reads;              /// observed versions.
+        std::map<recid_t, Write> writes;                /// buffered writes.
+        bool read_only;                                 /// refuse writes.
+    };
+
+    Database* dbms;                                     /// database.
+    std::mutex mtx;                                     /// context mutex.
+    std::unordered_map<trxid_t, Context> active;        /// running transactions.
+    std::unique_ptr<std::atomic<uint64_t>[]> words;     /// version words.
+    std::atomic<size_t> num_commits;                    /// committed.
+    std::atomic<size_t> num_conflicts;                  /// validation failures.
+
+    /// Find context of the transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Context*, nullable, context.
+    Context* context_of(trxid_t xid);
+
+    /// Get version word of the record, shared with the colliding records.
+    /// \param id recid_t const&, record ID.
+    /// \return std::atomic<uint64_t>&, version word.
+    std::atomic<uint64_t>& word_of(recid_t const& id);
+
+    /// Read committed record with its version, version is recorded to
+    /// the read set on first read.
+    /// \param context Context&, transaction context.
+    /// \param id recid_t const&, record ID.
+    /// \param record Record*, nullable, pointer to write the result.
+    /// \return Status, whether the record exists or not.
+    Status stable_read(Context& context, recid_t const& id, Record* record);
+
+    /// Install the write to the tree with logs.
+    /// \param xid trxid_t, transaction ID.
+    /// \param id recid_t const&, record ID.
+    /// \param write Write const&, buffered write.
+    /// \return Status, whether success to install or not.
+    Status install(trxid_t xid, recid_t const& id, Write const& write);
+
+#ifdef TEST_MODULE
+    friend struct OccManagerTest;
+#endif
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Process-wide free list of fixed size blocks with per-thread caches.
+/// Blocks are never returned to the system, so steady state allocation
+/// and deallocation are done without touching the heap.
+/// \tparam std::size_t Size, size of the block.
+/// \tparam std::size_t Align, alignment of the block.
+template <std::size_t Size, std::size_t Align>
+class BlockPool {
+public:
+    /// Number of the blocks moved between thread cache and global list.
+    static constexpr std::size_t BATCH = 64;
+
+    /// Allocate single block.
+    /// \return void*, allocated block.
+    static void* allocate() {
+        Cache& local = cache();
+        if (local.head == nullptr) {
+            local.refill();
+        }
+        Block* block = local.head;
+        local.head = block->next;
+        --local.num;
+        return block;
+    }
+
+    /// Return block to the pool.
+    /// \param ptr void*, block allocated by this pool.
+    static void deallocate(void* ptr) {
+        Cache& local = cache();
+        Block* block = static_cast<Block*>(ptr);
+        block->next = local.head;
+        local.head = block;
+        if (++local.num >= 2 * BATCH) {
+            local.flush(BATCH);
+        }
+    }
+
+private:
+    /// Memory block, link for the free list if it is not used.
+    union Block {
+        Block* next;                                    /// next free block.
+        alignas(Align) unsigned char data[Size];        /// user data.
+    };
+
+    /// Free list shared by all threads.
+    struct Global {
+        std::mutex mtx;                                 /// list mutex.
+        Block* head = nullptr;                          /// free blocks.
+        std::vector<std::unique_ptr<Block[]>> chunks;   /// owned memory.
+    };
+
+    /// Free list of the current thread.
+    struct Cache {
+        Block* head = nullptr;      /// free blocks.
+        std::size_t num = 0;        /// the number of the free blocks.
+
+        /// Return all cached blocks on thread exit.
+        ~Cache() {
+            flush(num);
+        }
+
+        /// Take the blocks from global list, allocate chunk if empty.
+        void refill() {
+            Global& shared = global();
+            std::unique_lock<std::mutex> own(shared.mtx);
+            if (shared.head == nullptr) {
+                auto chunk = std::make_unique<Block[]>(BATCH);
+                for (std::size_t i = 0; i < BATCH; ++i) {
+                    chunk[i].next = i + 1 < BATCH ? &chunk[i + 1] : nullptr;
+                }
+                shared.head = &chunk[0];
+                shared.chunks.push_back(std::move(chunk));
+            }
+            for (std::size_t i = 0; i < BATCH && shared.head != nullptr; ++i) {
+                Block* block = shared.head;
+                shared.head = block->next;
+                block->next = head;
+                head = block;
+                ++num;
+            }
+        }
+
+        /// Return the least recently freed blocks to global list.
+        /// \param count std::size_t, the number of the blocks.
+        void flush(std::size_t count) {
+            if (count == 0) {
+                return;
+            }
+            // keep recently freed blocks, which are likely in the cache
+            Block* first = head;
+            if (count < num) {
+                Block* kept = head;
+                for (std::size_t i = 1; i < num - count; ++i) {
+                    kept = kept->next;
+                }
+                first = kept->next;
+                kept->next = nullptr;
+            } else {
+                head = nullptr;
+            }
+            Block* last = first;
+            while (last->next != nullptr) {
+                last = last->next;
+            }
+            num -= count;
+
+            Global& shared = global();
+            std::unique_lock<std::mutex> own(shared.mtx);
+            last->next = shared.head;
+            shared.head = first;
+        }
+    };
+
+    /// Global free list, intentionally leaked for thread exit after main.
+    static Global& global() {
+        static Global* shared = new Global();
+        return *shared;
+    }
+
+    /// Free list of the current thread.
+    static Cache& cache() {
+        static thread_local Cache local;
+        return local;
+    }
+};
+
+/// Standard allocator based on block pool, single object allocations
+/// (list, tree and hash nodes) are served from the pool.
+/// \tparam typename T, value type.
+template <typename T>
+struct PoolAllocator {
+    /// Value type.
+    using value_type = T;
+    /// Pool for single object.
+    using pool_t = BlockPool<sizeof(T), alignof(T)>;
+
+    /// Default constructor.
+    PoolAllocator() = default;
+
+    /// Rebinding constructor.
+    template <typename U>
+    PoolAllocator(PoolAllocator<U> const&) {
+        // Do Nothing
+    }
+
+    /// Allocate memory for `n` objects.
+    /// \param n std::size_t, the number of the objects.
+    /// \return T*, allocated memory.
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(pool_t::allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    /// Deallocate memory.
+    /// \param ptr T*, allocated memory.
+    /// \param n std::size_t, the number of the objects.
+    void deallocate(T* ptr, std::size_t n) {
+        if (n == 1) {
+            pool_t::deallocate(ptr);
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    /// Construct object on the pool.
+    /// \tparam typename... Args, constructor argument types.
+    /// \param args Args&&..., constructor arguments.
+    /// \return T*, created object.
+    template <typename... Args>
+    static T* create(Args&&... args) {
+        void* ptr = pool_t::allocate();
+        return new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    /// Destroy object created by `create`.
+    /// \param ptr T*, target object.
+    static void destroy(T* ptr) {
+        ptr->~T();
+        pool_t::deallocate(ptr);
+    }
+
+    /// All pool allocators are interchangeable.
+    template <typename U>
+    bool operator==(PoolAllocator<U> const&) const {
+        return true;
+    }
+
+    /// All pool allocators are interchangeable.
+    template <typename U>
+    bool operator!=(PoolAllocator<U> const&) const {
+        return false;
+    }
+};
+
+#endif
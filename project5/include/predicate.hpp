@@ -0,0 +1,107 @@
+#ifndef PREDICATE_HPP
+#define PREDICATE_HPP
+
+#include <string>
+#include <vector>
+
+#include "headers.hpp"
+#include "status.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Comparison operator of the predicate.
+enum class CompareOp { EQ = 0, NE = 1, LT = 2, LE = 3, GT = 4, GE = 5 };
+
+/// Compiled predicate on the record value, conjunction of the terms.
+/// Terms are evaluated against the records in place, so the records
+/// in the latched page are filtered before they are copied out.
+class Predicate {
+public:
+    /// Maximum number of the records evaluated at once.
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    /// Construct predicate without terms, which matches all records.
+    Predicate();
+
+    /// Add byte range comparison, value bytes from the offset are compared
+    /// with the operand in lexicographical order.
+    /// \param offset size_t, offset in the value.
+    /// \param operand std::string const&, bytes to compare.
+    /// \param op CompareOp, comparison operator, value op operand.
+    /// \return Status, whether the range is in the value or not.
+    Status bytes(
+        size_t offset, std::string const& operand, CompareOp op = CompareOp::EQ);
+
+    /// Add prefix match of the value.
+    /// \param prefix std::string const&, prefix bytes.
+    /// \return Status, whether the prefix fits in the value or not.
+    Status prefix(std::string const& prefix);
+
+    /// Add comparison of the signed integer field in native byte order.
+    /// \param offset size_t, offset in the value.
+    /// \param op CompareOp, comparison operator, field op operand.
+    /// \param operand int64_t, integer to compare.
+    /// \param width size_t, field width in bytes, one of 1, 2, 4 and 8.
+    /// \return Status, whether the field is valid or not.
+    Status integer(
+        size_t offset, CompareOp op, int64_t operand, size_t width = 8);
+
+    /// Whether the record matches all terms or not.
+    /// \param record Record const&, record.
+    /// \return bool, whether matches or not.
+    bool match(Record const& record) const;
+
+    /// Append the matched records in order, each term is evaluated over
+    /// the block of the records and narrows the selected indices.
+    /// \param records Record const*, records.
+    /// \param num size_t, the number of the records.
+    /// \param out std::vector<Record>&, output for the matched records.
+    /// \return size_t, the number of the matched records.
+    size_t filter(
+        Record const* records, size_t num, std::vector<Record>& out) const;
+
+private:
+    /// Kind of the term.
+    enum class Kind { BYTES = 0, INTEGER = 1 };
+
+    /// Compiled term.
+    struct Term {
+        Kind kind;                                  /// kind of the term.
+        CompareOp op;                               /// comparison operator.
+        size_t offset;                              /// offset in the value.
+        size_t length;                              /// length of the field.
+        int64_t integer;                            /// integer operand.
+        uint8_t bytes[sizeof(Record::value)];       /// bytes operand.
+    };
+
+    std::vector<Term> terms;    /// conjunction of the terms.
+
+    /// Select the records matching the term from the selected indices.
+    /// \param term Term const&, term.
+    /// \param records Record const*, records.
+    /// \param sel uint8_t*, selected indices, narrowed in place.
+    /// \param num size_t, the number of the selected indices.
+    /// \return size_t, the number of the narrowed indices.
+    static size_t select(
+        Term const& term, Record const* records, uint8_t* sel, size_t num);
+
+    /// Read the integer field of the term.
+    /// \param term Term const&, integer term.
+    /// \param value uint8_t const*, record value.
+    /// \return int64_t, sign extended field.
+    static int64_t read_integer(Term const& term, uint8_t const* value);
+
+    /// Evaluate comparison result with the operator.
+    /// \param cmp int, negative, zero or positive as memcmp.
+    /// \param op CompareOp, comparison operator.
+    /// \return bool, whether satisfied or not.
+    static bool compare(int cmp, CompareOp op);
+
+#ifdef TEST_MODULE
+    friend struct PredicateTest;
+#endif
+};
+
+#endif
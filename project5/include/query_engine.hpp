@@ -0,0 +1,143 @@
+#ifndef QUERY_ENGINE_HPP
+#define QUERY_ENGINE_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "catalog.hpp"
+#include "dbms.hpp"
+#include "sql_parser.hpp"
+#include "status.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Output column of the operator.
+struct Field {
+    std::string table;      /// qualifier, table name or alias.
+    std::string name;       /// column name, alias or expression text.
+};
+
+struct SubPlan;
+
+/// Pull based operator of the query plan, rows are pulled from the root
+/// and each call is timed for the explain output.
+class Operator {
+public:
+    /// Construct operator with the output columns.
+    /// \param fields std::vector<Field>, output columns.
+    explicit Operator(std::vector<Field> fields);
+
+    /// Virtual destructor.
+    virtual ~Operator();
+
+    /// Evaluate the subqueries and prepare the inputs.
+    /// \return Status, whether success to open or not.
+    Status open();
+
+    /// Get the next row.
+    /// \param row Row&, output row.
+    /// \param valid bool&, false if all rows are read.
+    /// \return Status, whether success to read or not.
+    Status next(Row& row, bool& valid);
+
+    /// Describe the operator for the explain output.
+    /// \return std::string, operator name and its arguments.
+    virtual std::string describe() const = 0;
+
+    /// Get the output columns.
+    std::vector<Field> const& fields() const;
+
+    /// Get the input operators.
+    std::vector<std::unique_ptr<Operator>> const& inputs() const;
+
+    /// Get the subqueries evaluated on open.
+    std::vector<std::unique_ptr<SubPlan>> const& subplans() const;
+
+    /// Get the number of the returned rows.
+    size_t rows() const;
+
+    /// Get the time spent in the operator including its inputs.
+    /// \return double, elapsed time in milliseconds.
+    double elapsed() const;
+
+protected:
+    std::vector<Field> output;                          /// output columns.
+    std::vector<std::unique_ptr<Operator>> children;    /// inputs.
+    std::vector<std::unique_ptr<SubPlan>> subqueries;   /// subqueries.
+
+    /// Prepare the operator after the subqueries are evaluated.
+    /// \return Status, whether success to open or not.
+    virtual Status open_rows() = 0;
+
+    /// Produce the next row.
+    /// \param row Row&, output row.
+    /// \param valid bool&, false if all rows are produced.
+    /// \return Status, whether success to produce or not.
+    virtual Status next_row(Row& row, bool& valid) = 0;
+
+private:
+    size_t num_rows;                            /// returned rows.
+    std::chrono::steady_clock::duration time;   /// time spent.
+};
+
+/// Uncorrelated subquery evaluated once before its owner reads rows.
+struct SubPlan {
+    std::unique_ptr<Operator> root;                 /// plan of the subquery.
+    bool scalar;                                    /// scalar or in-set.
+    bool done;                                      /// whether evaluated.
+    Value value;                                    /// scalar result.
+    std::unordered_set<Value, ValueHash> values;    /// in-set result.
+    std::string* message;                           /// error output.
+
+    /// Evaluate the subquery if not evaluated yet.
+    /// \return Status, whether success to evaluate or not, scalar subquery
+    /// returning more than one row is failure.
+    Status run();
+};
+
+/// Result of the query.
+struct QueryResult {
+    std::vector<std::string> columns;   /// output column names.
+    std::vector<Row> rows;              /// output rows.
+    std::string plan;                   /// explain output, empty if not.
+};
+
+/// Query layer on the tables described by the catalog. Conjuncts on the
+/// single table are pushed down to the key range and the leaf predicate,
+/// equi-joins use primary key join, index lookup or hash join, and the
+/// uncorrelated subqueries are evaluated once as init plans.
+class QueryEngine {
+public:
+    /// Construct engine.
+    /// \param dbms Database&, database of the tables.
+    /// \param catalog Catalog const&, schemas of the tables.
+    QueryEngine(Database& dbms, Catalog const& catalog);
+
+    /// Execute the statement, explain without analyze only plans.
+    /// \param sql std::string const&, SQL text.
+    /// \param result QueryResult&, output result.
+    /// \return Status, whether success to execute or not.
+    Status execute(std::string const& sql, QueryResult& result);
+
+    /// Get the message of the last error.
+    /// \return std::string const&, error message.
+    std::string const& error() const;
+
+    /// Format the plan tree.
+    /// \param root Operator const&, root of the plan.
+    /// \param analyze bool, whether print the rows and time or not.
+    /// \return std::string, one operator per line, indented by depth.
+    static std::string explain(Operator const& root, bool analyze);
+
+private:
+    Database* dbms;             /// database.
+    Catalog const* catalog;     /// catalog.
+    std::string message;        /// last error message.
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef RESULT_SINK_HPP
+#define RESULT_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "headers.hpp"
+#include "status.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Output format of the result rows.
+enum class SinkFormat {
+    CSV = 0,        /// key and value of the records, comma separated line.
+    BINARY = 1,     /// raw records of the row.
+};
+
+/// Default capacity of the result buffer in bytes.
+constexpr size_t SINK_BUFFER_SIZE = 1 << 20;
+
+/// Growable buffer of the formatted rows, keys are formatted without
+/// iostream and the memory is reused after clear.
+class ResultBuffer {
+public:
+    /// Maximum size of the single record in a row.
+    static constexpr size_t MAX_RECORD_SIZE = 24 + sizeof(Record);
+
+    /// Construct empty buffer.
+    /// \param format SinkFormat, output format.
+    /// \param capacity size_t, initial capacity in bytes.
+    ResultBuffer(
+        SinkFormat format = SinkFormat::CSV,
+        size_t capacity = SINK_BUFFER_SIZE);
+
+    /// Default destructor.
+    ~ResultBuffer() = default;
+
+    /// Deleted copy constructor.
+    ResultBuffer(ResultBuffer const&) = delete;
+
+    /// Move constructor.
+    ResultBuffer(ResultBuffer&&) noexcept = default;
+
+    /// Deleted copy assignment.
+    ResultBuffer& operator=(ResultBuffer const&) = delete;
+
+    /// Move assignment.
+    ResultBuffer& operator=(ResultBuffer&&) noexcept = default;
+
+    /// Append row of the single record.
+    /// \param record Record const&, record.
+    void append(Record const& record);
+
+    /// Append row of the joined pair.
+    /// \param rec1 Record const&, left record.
+    /// \param rec2 Record const&, right record.
+    void append(Record const& rec1, Record const& rec2);
+
+    /// Append row of the multiple records.
+    /// \param row std::vector<Record const*> const&, records of the row.
+    void append(std::vector<Record const*> const& row);
+
+    /// Whether the next row of two records may exceed the capacity.
+    bool full() const;
+
+    /// Get formatted rows.
+    char const* data() const;
+
+    /// Get the size of the formatted rows in bytes.
+    size_t size() const;
+
+    /// Remove all rows, the memory is kept.
+    void clear();
+
+    /// Get output format.
+    SinkFormat format() const;
+
+    /// Format signed integer in decimal.
+    /// \param out char*, output, at least 20 bytes.
+    /// \param value int64_t, integer.
+    /// \return size_t, the number of the written characters.
+    static size_t format_int(char* out, int64_t value);
+
+private:
+    SinkFormat fmt;                     /// output format.
+    std::unique_ptr<char[]> buffer;     /// formatted rows.
+    size_t capacity;                    /// size of the buffer.
+    size_t used;                        /// size of the rows.
+
+    /// Grow the buffer if the space is not enough.
+    /// \param size size_t, size to write.
+    /// \return char*, end of the rows.
+    char* reserve(size_t size);
+
+    /// Format the record without the delimiter.
+    /// \param out char*, output, at least MAX_RECORD_SIZE bytes.
+    /// \param record Record const&, record.
+    /// \return char*, end of the output.
+    char* put(char* out, Record const& record) const;
+};
+
+/// Writer of the result rows to the file. Rows are buffered and written
+/// when the buffer is full, buffers of the other writers are gathered
+/// into single writev call.
+class ResultSink {
+public:
+    /// Construct sink without file.
+    /// \param format SinkFormat, output format.
+    /// \param capacity size_t, capacity of the buffer in bytes.
+    ResultSink(
+        SinkFormat format = SinkFormat::CSV,
+        size_t capacity = SINK_BUFFER_SIZE);
+
+    /// Destructor, flush and close the file.
+    ~ResultSink();
+
+    /// Deleted copy constructor.
+    ResultSink(ResultSink const&) = delete;
+
+    /// Deleted move constructor.
+    ResultSink(ResultSink&&) = delete;
+
+    /// Deleted copy assignment.
+    ResultSink& operator=(ResultSink const&) = delete;
+
+    /// Deleted move assignment.
+    ResultSink& operator=(ResultSink&&) = delete;
+
+    /// Open the output file, truncated if exists.
+    /// \param filename std::string const&, output path.
+    /// \return Status, whether success to open or not.
+    Status open(std::string const& filename);
+
+    /// Write row of the single record, pluggable into the scans.
+    /// \param record Record const&, record.
+    /// \return Status, whether success to write or not.
+    Status write(Record const& record);
+
+    /// Write row of the joined pair, pluggable into the joins.
+    /// \param rec1 Record const&, left record.
+    /// \param rec2 Record const&, right record.
+    /// \return Status, whether success to write or not.
+    Status write(Record const& rec1, Record const& rec2);
+
+    /// Write row of the multiple records, pluggable into the multi-way joins.
+    /// \param row std::vector<Record const*> const&, records of the row.
+    /// \return Status, whether success to write or not.
+    Status write(std::vector<Record const*> const& row);
+
+    /// Write the buffered rows and given buffers in order.
+    /// \param buffers std::vector<ResultBuffer> const&, buffers of the
+    /// same format, for example the outputs of the parallel workers.
+    /// \return Status, whether success to write or not.
+    Status write(std::vector<ResultBuffer> const& buffers);
+
+    /// Write the buffered rows and given buffer in order.
+    /// \param other ResultBuffer const&, buffer of the same format.
+    /// \return Status, whether success to write or not.
+    Status write(ResultBuffer const& other);
+
+    /// Write the buffered rows.
+    /// \return Status, whether success to write or not.
+    Status flush();
+
+    /// Flush and close the file.
+    /// \return Status, whether success to close or not.
+    Status close();
+
+    /// Get output format.
+    SinkFormat format() const;
+
+private:
+    int fd;                 /// output file descriptor.
+    ResultBuffer buffer;    /// buffered rows.
+
+    /// Write the buffered rows and given buffers with writev.
+    /// \param buffers std::vector<ResultBuffer const*> const&, additional
+    /// buffers.
+    /// \return Status, whether success to write all or not.
+    Status write_all(std::vector<ResultBuffer const*> const& buffers);
+
+#ifdef TEST_MODULE
+    friend struct ResultSinkTest;
+#endif
+};
+
+/// Writer of the ordered ranges produced concurrently, for example the
+/// key ranges of the parallel join. Rows of the range in its turn stream
+/// into the sink, rows of the later ranges are buffered and their workers
+/// wait for the turn when the buffer is full, so the memory is bounded by
+/// the number of the ranges times the capacity.
+class RangeWriter {
+public:
+    /// Construct writer on the opened sink.
+    /// \param sink ResultSink&, output sink.
+    /// \param num_ranges size_t, the number of the ranges.
+    /// \param capacity size_t, capacity of the buffer per range in bytes.
+    RangeWriter(
+        ResultSink& sink, size_t num_ranges,
+        size_t capacity = SINK_BUFFER_SIZE);
+
+    /// Default destructor.
+    ~RangeWriter() = default;
+
+    /// Deleted copy constructor.
+    RangeWriter(RangeWriter const&) = delete;
+
+    /// Deleted move constructor.
+    RangeWriter(RangeWriter&&) = delete;
+
+    /// Deleted copy assignment.
+    RangeWriter& operator=(RangeWriter const&) = delete;
+
+    /// Deleted move assignment.
+    RangeWriter& operator=(RangeWriter&&) = delete;
+
+    /// Write row of the joined pair, called by the worker of the range.
+    /// \param range size_t, range index.
+    /// \param rec1 Record const&, left record.
+    /// \param rec2 Record const&, right record.
+    /// \return Status, whether success to write or not, failure if the
+    /// other range has failed.
+    Status write(size_t range, Record const& rec1, Record const& rec2);
+
+    /// Finish the range, the rest rows are written in its turn and the
+    /// turn is passed to the next range.
+    /// \param range size_t, range index.
+    /// \param res Status, result of the range, failure stops the others.
+    /// \return Status, whether all rows of the range are written or not.
+    Status finish(size_t range, Status res);
+
+private:
+    ResultSink* sink;                   /// output sink.
+    std::vector<ResultBuffer> buffers;  /// rows waiting for the turn.
+    std::mutex mtx;                     /// mutex for the turn.
+    std::condition_variable cond;       /// wakes the waiting ranges.
+    std::atomic<size_t> turn;           /// range writing to the sink.
+    std::atomic<bool> failed;           /// whether any range has failed.
+
+    /// Wait for the turn of the range and write its buffer.
+    /// \param range size_t, range index.
+    /// \return Status, whether success to write or not.
+    Status drain(size_t range);
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef SQL_PARSER_HPP
+#define SQL_PARSER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catalog.hpp"
+#include "predicate.hpp"
+#include "status.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+struct Select;
+
+/// Expression of the query.
+struct Expr {
+    /// Kind of the expression.
+    enum class Kind {
+        COLUMN = 0,     /// [table.]name.
+        LITERAL = 1,    /// integer, real or string.
+        STAR = 2,       /// `*` in the select list or count(*).
+        NOT = 3,        /// not args[0].
+        AND = 4,        /// args[0] and args[1].
+        OR = 5,         /// args[0] or args[1].
+        COMPARE = 6,    /// args[0] op args[1].
+        LIKE = 7,       /// args[0] [not] like args[1].
+        IN = 8,         /// args[0] [not] in (query) or (args[1..]).
+        SUBQUERY = 9,   /// scalar subquery.
+        AGGREGATE = 10, /// name(args[0]), count, sum, avg, min or max.
+    };
+
+    Kind kind;                                  /// kind of the expression.
+    CompareOp op;                               /// comparison operator.
+    std::string table;                          /// column qualifier.
+    std::string name;                           /// column or function name.
+    Value value;                                /// literal value.
+    std::vector<std::unique_ptr<Expr>> args;    /// operands.
+    std::unique_ptr<Select> query;              /// subquery.
+    bool negated;                               /// not like, not in.
+
+    /// Construct expression of the kind.
+    /// \param kind Kind, kind of the expression.
+    explicit Expr(Kind kind);
+
+    /// Convert to SQL text, also used as the identity of the expression.
+    /// \return std::string, canonical SQL text.
+    std::string to_string() const;
+};
+
+/// Owning pointer of the expression.
+using ExprPtr = std::unique_ptr<Expr>;
+
+/// Item of the select list.
+struct SelectItem {
+    ExprPtr expr;           /// expression.
+    std::string alias;      /// output name, empty if not given.
+};
+
+/// Table in the from clause.
+struct TableRef {
+    std::string name;                   /// table name, empty if derived.
+    std::string alias;                  /// alias, empty if not given.
+    std::unique_ptr<Select> query;      /// derived table.
+};
+
+/// Item of the order by clause.
+struct OrderItem {
+    ExprPtr expr;       /// sort key.
+    bool desc;          /// descending or not.
+};
+
+/// Select statement.
+struct Select {
+    bool distinct;                      /// select distinct or not.
+    std::vector<SelectItem> items;      /// select list.
+    std::vector<TableRef> from;         /// from clause.
+    ExprPtr where;                      /// nullable, where clause.
+    std::vector<ExprPtr> group_by;      /// group by clause.
+    std::vector<OrderItem> order_by;    /// order by clause.
+    int64_t limit;                      /// limit, -1 if not given.
+
+    /// Construct empty select.
+    Select();
+
+    /// Convert to SQL text.
+    /// \return std::string, canonical SQL text.
+    std::string to_string() const;
+};
+
+/// Parsed statement.
+struct Statement {
+    bool explain;                       /// explain the plan only.
+    bool analyze;                       /// execute and explain with stats.
+    std::unique_ptr<Select> select;     /// select statement.
+};
+
+/// Recursive descent parser of the SQL subset, keywords and identifiers
+/// are case-insensitive and converted to lowercase.
+///
+/// statement := [EXPLAIN [ANALYZE]] select [;]
+/// select    := SELECT [DISTINCT] item {, item} FROM tref {, tref}
+///              [WHERE expr] [GROUP BY expr {, expr}]
+///              [ORDER BY expr [ASC|DESC] {, ...}] [LIMIT integer]
+/// item      := * | expr [[AS] alias]
+/// tref      := name [[AS] alias] | ( select ) [AS] alias
+/// expr      := and {OR and}
+/// and       := not {AND not}
+/// not       := NOT not | pred
+/// pred      := primary [cmp primary | [NOT] LIKE string
+///              | [NOT] IN ( select | expr {, expr} )]
+/// primary   := literal | column | aggregate | ( select ) | ( expr )
+class SqlParser {
+public:
+    /// Construct parser on the text.
+    /// \param sql std::string const&, SQL text.
+    explicit SqlParser(std::string const& sql);
+
+    /// Parse the statement.
+    /// \param stmt Statement&, output statement.
+    /// \return Status, whether success to parse or not.
+    Status parse(Statement& stmt);
+
+    /// Get the message of the last error.
+    /// \return std::string const&, error message with the position.
+    std::string const& error() const;
+
+private:
+    /// Token of the text.
+    struct Token {
+        /// Kind of the token.
+        enum class Kind {
+            END = 0, IDENT = 1, NUMBER = 2, STRING = 3, SYMBOL = 4
+        };
+
+        Kind kind;          /// kind of the token.
+        std::string text;   /// lowercase identifier, literal or symbol.
+        size_t pos;         /// offset in the text.
+    };
+
+    std::string sql;                /// SQL text.
+    std::vector<Token> tokens;      /// tokens ending with END.
+    size_t cursor;                  /// current token index.
+    std::string message;            /// last error message.
+
+    /// Split the text into the tokens.
+    /// \return Status, whether all characters are valid or not.
+    Status tokenize();
+
+    /// Parse select statement.
+    /// \param select Select&, output select.
+    /// \return Status, whether success to parse or not.
+    Status parse_select(Select& select);
+
+    /// Parse table reference.
+    /// \param ref TableRef&, output table.
+    /// \return Status, whether success to parse or not.
+    Status parse_table(TableRef& ref);
+
+    /// Parse disjunction.
+    /// \param expr ExprPtr&, output expression.
+    /// \return Status, whether success to parse or not.
+    Status parse_or(ExprPtr& expr);
+
+    /// Parse conjunction.
+    /// \param expr ExprPtr&, output expression.
+    /// \return Status, whether success to parse or not.
+    Status parse_and(ExprPtr& expr);
+
+    /// Parse negation.
+    /// \param expr ExprPtr&, output expression.
+    /// \return Status, whether success to parse or not.
+    Status parse_not(ExprPtr& expr);
+
+    /// Parse comparison, like and in.
+    /// \param expr ExprPtr&, output expression.
+    /// \return Status, whether success to parse or not.
+    Status parse_predicate(ExprPtr& expr);
+
+    /// Parse literal, column, aggregate or parenthesized expression.
+    /// \param expr ExprPtr&, output expression.
+    /// \return Status, whether success to parse or not.
+    Status parse_primary(ExprPtr& expr);
+
+    /// Parse optional alias.
+    /// \param alias std::string&, output alias, empty if not given.
+    /// \return Status, whether identifier follows AS or not.
+    Status parse_alias(std::string& alias);
+
+    /// Get the current token.
+    Token const& peek() const;
+
+    /// Whether the current token is the keyword or the symbol.
+    /// \param text char const*, lowercase keyword or symbol.
+    /// \return bool, whether matched or not.
+    bool is(char const* text) const;
+
+    /// Consume the token if it is the keyword or the symbol.
+    /// \param text char const*, lowercase keyword or symbol.
+    /// \return bool, whether consumed or not.
+    bool accept(char const* text);
+
+    /// Consume the keyword or the symbol, error if not matched.
+    /// \param text char const*, lowercase keyword or symbol.
+    /// \return Status, whether consumed or not.
+    Status expect(char const* text);
+
+    /// Record the error at the current token.
+    /// \param what std::string const&, error description.
+    /// \return Status, always FAILURE.
+    Status fail(std::string const& what);
+
+    /// Whether the identifier is reserved or not.
+    /// \param ident std::string const&, lowercase identifier.
+    /// \return bool, whether keyword or not.
+    static bool is_keyword(std::string const& ident);
+
+#ifdef TEST_MODULE
+    friend struct SqlParserTest;
+#endif
+};
+
+#endif
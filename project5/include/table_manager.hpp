@@ -55,23 +55,37 @@ public:
     Status find(
         prikey_t key, Record* record, trxid_t xid = INVALID_TRXID) const;
 
+    /// Find the sorted keys, absent keys are skipped.
+    /// \param keys std::vector<prikey_t> const&, keys in ascending order.
+    /// \param records std::vector<Record>&, buffer for the found records.
+    /// \return Status, whether success to search or not.
+    Status find_batch(
+        std::vector<prikey_t> const& keys, std::vector<Record>& records) const;
+
     /// Range based search.
     /// \param start prikey_t, key, start point.
     /// \param end prikey_t, key, end point.
+    /// \param filter Predicate const*, nullable, evaluated in the leaf.
     /// \return std::vector<Record>, found records.
-    std::vector<Record> find_range(prikey_t start, prikey_t end) const;
+    std::vector<Record> find_range(
+        prikey_t start, prikey_t end,
+        Predicate const* filter = nullptr) const;
 
     /// Insert the record to the tree.
     /// \param key prikey_t, primary key.
     /// \param value uint8_t const*, byte sequence.
     /// \param value_size, the length of the value.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to insert the record or not.
-    Status insert(prikey_t key, uint8_t const* value, int value_size) const;
+    Status insert(
+        prikey_t key, uint8_t const* value, int value_size,
+        trxid_t xid = INVALID_TRXID) const;
 
     /// Remove the record from the tree.
     /// \param key prikey_t, primary key.
+    /// \param xid trxid_t, transaction id, default INVALID_TRXID.
     /// \return Status, whether success to remove the record or not.
-    Status remove(prikey_t key) const;
+    Status remove(prikey_t key, trxid_t xid = INVALID_TRXID) const;
 
     /// Update record from the tree.
     /// \param key prikey_t, primary key.
@@ -91,6 +105,25 @@ public:
     /// Get the end of the record iterator.
     RecordIterator end() const;
 
+    /// Get the number of the pages, estimation of the table size.
+    /// \return pagenum_t, the number of the pages.
+    pagenum_t num_pages() const;
+
+    /// Collect separator keys from the internal nodes.
+    /// \param num size_t, the number of the keys wanted.
+    /// \return std::vector<prikey_t>, separators in ascending order.
+    std::vector<prikey_t> separators(size_t num) const;
+
+    /// Get leaf based iterator over the key range.
+    /// \param start prikey_t, inclusive lower bound.
+    /// \param end prikey_t, inclusive upper bound.
+    /// \param filter Predicate const*, nullable, evaluated in the leaf.
+    /// \return BPTreeBatchIterator, iterator on the first non-empty leaf.
+    BPTreeBatchIterator batches(
+        prikey_t start = std::numeric_limits<prikey_t>::min(),
+        prikey_t end = std::numeric_limits<prikey_t>::max(),
+        Predicate const* filter = nullptr) const;
+
     /// Get file ID.
     /// \return fileid_t, file ID.
     fileid_t fileid() const;
@@ -119,6 +152,8 @@ private:
     BPTree bpt;                     /// B+ Tree structure.
 
     friend class TableManager;
+    friend class LogManager;
+    friend class OccManager;
 
     /// Get file manager.
     FileManager& filemng();
@@ -182,6 +217,7 @@ private:
     Database* dbms;         /// Database pointer.
 
     friend class Transaction;
+    friend class LogManager;
 
     /// Find file manager from table ID.
     FileManager* find_file(tableid_t id);
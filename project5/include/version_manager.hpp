@@ -0,0 +1,189 @@
+#ifndef VERSION_MANAGER_HPP
+#define VERSION_MANAGER_HPP
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "headers.hpp"
+
+#ifdef TEST_MODULE
+#include "test.hpp"
+#endif
+
+/// Timestamp for snapshot and commit ordering.
+using timestamp_t = uint64_t;
+
+/// Timestamp of the uncommitted versions.
+constexpr timestamp_t UNCOMMITTED = 0;
+
+/// Record version overwritten by the transaction.
+struct Version {
+    trxid_t writer;                                 /// transaction which overwrote the version.
+    std::shared_ptr<std::atomic<timestamp_t>> stamp;    /// commit timestamp of the writer.
+    bool exists;                                    /// whether the record existed or not.
+    Record image;                                   /// record image before the write.
+    std::unique_ptr<Version> older;                 /// older version.
+};
+
+/// Statistics of the version store.
+struct VersionStats {
+    size_t num_versions;        /// the number of the live versions.
+    size_t num_collected;       /// the number of the collected versions.
+    timestamp_t oldest;         /// oldest active snapshot.
+};
+
+/// Multi-version store, keeps prior versions of the records
+/// so that the readers resolve their snapshots without locks.
+class VersionManager {
+public:
+    /// Number of the chain shards.
+    static constexpr size_t NUM_SHARDS = 64;
+
+    /// Default constructor.
+    VersionManager();
+
+    /// Default destructor.
+    ~VersionManager() = default;
+
+    /// Deleted copy constructor.
+    VersionManager(VersionManager const&) = delete;
+
+    /// Deleted move constructor.
+    VersionManager(VersionManager&&) = delete;
+
+    /// Deleted copy assignment.
+    VersionManager& operator=(VersionManager const&) = delete;
+
+    /// Deleted move assignment.
+    VersionManager& operator=(VersionManager&&) = delete;
+
+    /// Take snapshot for the transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \return timestamp_t, snapshot timestamp.
+    timestamp_t begin(trxid_t xid);
+
+    /// Stamp the versions of the transaction with commit timestamp.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Status, whether success or not.
+    Status commit(trxid_t xid);
+
+    /// Drop the versions of the transaction, records should be
+    /// restored before the call.
+    /// \param xid trxid_t, transaction ID.
+    /// \return Status, whether success or not.
+    Status abort(trxid_t xid);
+
+    /// Whether the record is overwritten after the snapshot of the
+    /// transaction, caller should own exclusive lock of the record.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \return bool, whether conflicted or not.
+    bool conflict(trxid_t xid, tableid_t tid, prikey_t key);
+
+    /// Keep the record image before the transaction writes it,
+    /// should be called before the page is modified.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \param exists bool, whether the record exists or not.
+    /// \param image Record const&, record image.
+    /// \return Status, whether success or not.
+    Status record(
+        trxid_t xid, tableid_t tid, prikey_t key,
+        bool exists, Record const& image);
+
+    /// Resolve the visible version of the record, record should be read
+    /// from the page and the page latch should be kept during the call.
+    /// \param xid trxid_t, transaction ID.
+    /// \param tid tableid_t, table ID.
+    /// \param key prikey_t, primary key.
+    /// \param exists bool, whether the record exists on the page.
+    /// \param record Record*, nullable, record read from the page,
+    /// replaced with the visible one.
+    /// \return Status, whether visible record exists or not.
+    Status read(
+        trxid_t xid, tableid_t tid, prikey_t key,
+        bool exists, Record* record);
+
+    /// Collect versions which are not visible to any snapshot.
+    /// \return size_t, the number of the collected versions.
+    size_t collect();
+
+    /// Get statistics.
+    /// \return VersionStats, version store statistics.
+    VersionStats stats();
+
+private:
+    /// Version chain ID.
+    using chainid_t = std::pair<tableid_t, prikey_t>;
+
+    /// Hash of the chain ID.
+    struct ChainHash {
+        /// Hash table ID and key.
+        std::size_t operator()(chainid_t const& id) const {
+            return std::hash<prikey_t>{}(id.second)
+                ^ (static_cast<std::size_t>(id.first) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    /// Shard of the version chains.
+    struct Shard {
+        std::mutex mtx;                                 /// shard mutex.
+        std::unordered_map<
+            chainid_t, std::unique_ptr<Version>, ChainHash> chains;   /// newest versions.
+    };
+
+    /// Snapshot and written records of the transaction.
+    struct Context {
+        timestamp_t snapshot;                           /// snapshot timestamp.
+        std::shared_ptr<std::atomic<timestamp_t>> stamp;    /// commit timestamp.
+        std::vector<chainid_t> writes;                  /// written records.
+    };
+
+    /// Committed transaction waiting for collection.
+    struct Committed {
+        timestamp_t stamp;                              /// commit timestamp.
+        std::vector<chainid_t> writes;                  /// written records.
+    };
+
+    std::mutex mtx;                                     /// snapshot mutex.
+    timestamp_t clock;                                  /// last commit timestamp.
+    std::unordered_map<trxid_t, Context> active;        /// running transactions.
+    std::deque<Committed> garbage;                      /// collection queue.
+    std::array<Shard, NUM_SHARDS> shards;               /// version chains.
+    std::atomic<size_t> num_versions;                   /// live versions.
+    std::atomic<size_t> num_collected;                  /// collected versions.
+
+    /// Get shard of the chain.
+    /// \param id chainid_t, chain ID.
+    /// \return Shard&, shard.
+    Shard& shard_of(chainid_t const& id);
+
+    /// Find snapshot of the transaction, latest for unknown transaction.
+    /// \param xid trxid_t, transaction ID.
+    /// \return timestamp_t, snapshot timestamp.
+    timestamp_t snapshot_of(trxid_t xid);
+
+    /// Oldest active snapshot, caller should own the snapshot mutex.
+    /// \return timestamp_t, oldest snapshot.
+    timestamp_t oldest() const;
+
+    /// Drop the versions which every snapshot can skip.
+    /// \param id chainid_t, chain ID.
+    /// \param oldest timestamp_t, oldest active snapshot.
+    /// \return size_t, the number of the dropped versions.
+    size_t prune(chainid_t const& id, timestamp_t oldest);
+
+#ifdef TEST_MODULE
+    friend struct VersionManagerTest;
+#endif
+};
+
+#endif
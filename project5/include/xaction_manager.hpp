@@ -3,7 +3,10 @@
 
 #include "lock_manager.hpp"
 
+#include <array>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -19,11 +22,17 @@ enum class TrxState {
 /// Transaction structure.
 class Transaction {
 public:
+    /// Type alias for owned locks, nodes are allocated from the pool.
+    using lockmap_t = std::map<
+        HID, Lock*, std::less<HID>, PoolAllocator<std::pair<HID const, Lock*>>>;
+
     /// Default constructor.
     Transaction();
 
     /// Construct transaction with XID.
-    Transaction(trxid_t id);
+    /// \param id trxid_t, transaction ID.
+    /// \param read_only bool, whether the transaction never writes.
+    Transaction(trxid_t id, bool read_only = false);
 
     /// Default destructor.
     ~Transaction() = default;
@@ -47,10 +56,12 @@ public:
 
     /// Abort transaction.
     /// \param dbms Database&, database system.
+    /// \param locked bool, whether the caller holds the lock manager mutex.
     /// \return Status, whether success to abort trx or not.
-    Status abort_trx(Database& dbms);
+    Status abort_trx(Database& dbms, bool locked = false);
 
-    /// Acquire lock from lock manager.
+    /// Acquire lock from lock manager with intention locks on the ancestors,
+    /// escalate locks if the number of the locks exceeds the threshold.
     /// \param manager LockManager&, lock manager.
     /// \param hid HID, hierarchical ID (tableid + pageid).
     /// \param mode LockMode, lock mode.
@@ -60,8 +71,9 @@ public:
 
     /// Release all locks.
     /// \param manager LockManager&, lock manager.
+    /// \param locked bool, whether the caller holds the lock manager mutex.
     /// \return Status, whether success or not.
-    Status release_locks(LockManager& manager);
+    Status release_locks(LockManager& manager, bool locked = false);
 
     /// Get transaction ID.
     trxid_t get_id() const;
@@ -69,25 +81,59 @@ public:
     /// Get transaction state.
     TrxState get_state() const;
 
+    /// Whether the transaction is read-only.
+    bool is_read_only() const;
+
     /// Get waiting lock.
-    std::shared_ptr<Lock> get_wait() const;
+    Lock* get_wait() const;
 
     /// Get all locks.
-    std::map<HID, std::shared_ptr<Lock>> const& get_locks() const;
+    lockmap_t const& get_locks() const;
 
 private:
+    /// Summary of the locks in lower granularity.
+    struct Children {
+        size_t num;         /// the number of the child locks.
+        LockMode mode;      /// escalated mode covering all child locks.
+    };
+
+    /// Type alias for child lock summaries.
+    using childmap_t = std::map<
+        HID, Children, std::less<HID>,
+        PoolAllocator<std::pair<HID const, Children>>>;
+
     std::unique_ptr<std::mutex> mtx;                /// mutex;
     trxid_t id;                                     /// transaction ID.
+    bool read_only;                                 /// read-only transaction.
     std::atomic<TrxState> state;                    /// transaction state.
-    std::shared_ptr<Lock> wait;                     /// waiting lock.
-    std::map<HID, std::shared_ptr<Lock>> locks;     /// all locks which trx owned.
+    Lock* wait;                                     /// waiting lock.
+    lockmap_t locks;                                /// all locks which trx owned.
+    childmap_t children;                            /// child locks per granule.
 
     friend class Lock;
     friend class LockManager;
 
-    /// Elevate lock to stronger mode.
-    Status elevate_lock(
-        LockManager& manager, std::shared_ptr<Lock> lock, LockMode mode);
+    /// Whether given lock request is already granted by owned locks.
+    /// \param hid HID, hierarchical ID.
+    /// \param mode LockMode, lock mode.
+    /// \return bool, whether covered or not.
+    bool covered(HID hid, LockMode mode) const;
+
+    /// Acquire single lock without considering granularity.
+    /// \param manager LockManager&, lock manager.
+    /// \param hid HID, hierarchical ID.
+    /// \param mode LockMode, lock mode.
+    /// \return Status, whether success to own lock or not.
+    Status acquire_lock(LockManager& manager, HID hid, LockMode mode);
+
+    /// Elevate lock to stronger mode in place.
+    Status elevate_lock(LockManager& manager, Lock* lock, LockMode mode);
+
+    /// Escalate child locks if the number of them reaches threshold.
+    /// \param manager LockManager&, lock manager.
+    /// \param parent HID, page or table level ID.
+    /// \return Status, whether success or not.
+    Status escalate_lock(LockManager& manager, HID parent);
 
 #ifdef TEST_MODULE
     friend class LockTest;
@@ -115,8 +161,9 @@ public:
     TransactionManager& operator=(TransactionManager&&) = delete;
 
     /// Create new transaction.
+    /// \param read_only bool, whether the transaction never writes.
     /// \return trxid_t, transaction ID.
-    trxid_t new_trx();
+    trxid_t new_trx(bool read_only = false);
 
     /// Finish transaction.
     /// \param id trxid_t, transaction ID.
@@ -126,8 +173,9 @@ public:
     /// Abort transaction.
     /// \param id trxid_t, transaction ID.
     /// \param dbms Database&, database system.
+    /// \param locked bool, whether the caller holds the lock manager mutex.
     /// \return Status, whether success to abort transaction or not.
-    Status abort_trx(trxid_t id, Database& dbms);
+    Status abort_trx(trxid_t id, Database& dbms, bool locked = false);
 
     /// Acquire lock.
     /// \param id trxid_t, transaction ID.
@@ -144,27 +192,52 @@ public:
     /// Get transaction state.
     TrxState trx_state(trxid_t id);
 
+    /// Whether the transaction is read-only.
+    /// \param id trxid_t, transaction ID.
+    /// \return bool, false if the transaction is not found.
+    bool read_only(trxid_t id);
+
 private:
-    std::mutex mtx;         /// System level mutex.
-    LockManager* lock_manager;      /// Lock manager pointer.
+    /// Number of the transaction table shards.
+    static constexpr size_t NUM_SHARDS = 64;
+
+    /// Transactions, shared with the callers outside of the shard mutex.
+    using trx_map_t = std::unordered_map<trxid_t, std::shared_ptr<Transaction>>;
+
+    /// Shard of the transaction table.
+    struct Shard {
+        std::mutex mtx;                                 /// shard mutex.
+        trx_map_t trxs;                                 /// transactions in shard.
+    };
 
-    trxid_t last_id;                                    /// last transaction ID.
-    std::unordered_map<trxid_t, Transaction> trxs;      /// all managed transactions.
+    LockManager* lock_manager;                          /// Lock manager pointer.
+    std::atomic<trxid_t> last_id;                       /// last transaction ID.
+    std::array<Shard, NUM_SHARDS> shards;               /// transaction table.
+
+    /// Get shard of the transaction.
+    /// \param id trxid_t, transaction ID.
+    /// \return Shard&, shard.
+    inline Shard& shard_of(trxid_t id) {
+        return shards[static_cast<size_t>(id) % NUM_SHARDS];
+    }
+
+    /// Find transaction, reference keeps it alive after it is erased.
+    /// \param id trxid_t, transaction ID.
+    /// \return std::shared_ptr<Transaction>, nullable, transaction.
+    std::shared_ptr<Transaction> find_trx(trxid_t id);
 
     template <typename R, typename F, typename... Args>
     inline auto use_trx(trxid_t id, R&& retn, F&& method, Args&&... args) {
-        std::unique_lock<std::mutex> own(mtx);
-        auto iter = trxs.find(id);
-        if (iter == trxs.end()) {
+        std::shared_ptr<Transaction> trx = find_trx(id);
+        if (trx == nullptr) {
             return std::forward<R>(retn);
         }
-
-        own.unlock();
-        return (iter->second.*method)(std::forward<Args>(args)...);
+        return ((*trx).*method)(std::forward<Args>(args)...);
     }
 
 #ifdef TEST_MODULE
     friend struct LockManagerTest;
+    friend struct TransactionManagerTest;
 #endif
 };
 
@@ -0,0 +1,57 @@
+#include "aggregate.hpp"
+
+Aggregate::Aggregate()
+    : count(0), sum(0)
+    , min(std::numeric_limits<aggval_t>::max())
+    , max(std::numeric_limits<aggval_t>::min())
+    , overflow(false)
+{
+    // Do Nothing
+}
+
+void Aggregate::add(aggval_t value) {
+    ++count;
+    overflow |= __builtin_add_overflow(sum, value, &sum);
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void Aggregate::merge(Aggregate const& other) {
+    count += other.count;
+    overflow |= other.overflow;
+    overflow |= __builtin_add_overflow(sum, other.sum, &sum);
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double Aggregate::avg() const {
+    if (count == 0) {
+        return 0;
+    }
+    return static_cast<double>(sum) / count;
+}
+
+namespace AggregateOper {
+
+aggval_t value_as_int(Record const& record) {
+    uint8_t const* value = record.value;
+    size_t size = sizeof(record.value);
+    size_t i = 0;
+    bool negative = i < size && value[i] == '-';
+    if (negative) {
+        ++i;
+    }
+
+    aggval_t parsed = 0;
+    for (; i < size && value[i] >= '0' && value[i] <= '9'; ++i) {
+        if (__builtin_mul_overflow(parsed, 10, &parsed)
+            || __builtin_add_overflow(parsed, value[i] - '0', &parsed)
+        ) {
+            return negative
+                ? std::numeric_limits<aggval_t>::min()
+                : std::numeric_limits<aggval_t>::max();
+        }
+    }
+    return negative ? -parsed : parsed;
+}
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <queue>
@@ -16,6 +17,7 @@ BPTree::BPTree(FileManager* file, BufferManager* buffers)
     , file(file)
     , buffers(buffers)
     , dbms(nullptr)
+    , latch(std::make_unique<std::shared_timed_mutex>())
 {
     // Do nothing
 }
@@ -28,6 +30,7 @@ BPTree::BPTree(BPTree&& other) noexcept
     , file(other.file)
     , buffers(other.buffers)
     , dbms(other.dbms)
+    , latch(std::move(other.latch))
 {
     other.leaf_order = other.internal_order = 0;
     other.delayed_merge = other.verbose_output = false;
@@ -44,6 +47,7 @@ BPTree& BPTree::operator=(BPTree&& other) noexcept {
     file = other.file;
     buffers = other.buffers;
     dbms = other.dbms;
+    latch = std::move(other.latch);
 
     other.leaf_order = other.internal_order = 0;
     other.delayed_merge = other.verbose_output = false;
@@ -203,126 +207,128 @@ void BPTree::print_tree() const {
 }
 
 Status BPTree::find(prikey_t key, Record* record, trxid_t xid) const {
+    CHECK_TRUE(xid == INVALID_TRXID || dbms != nullptr);
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
     Ubuffer buffer(nullptr);
-    pagenum_t c = find_leaf(key, buffer);
-    if (c == INVALID_PAGENUM) {
-        return Status::FAILURE;
-    }
-    Urecord rec = find_key_from_leaf(key, buffer);
-    CHECK_NULL(rec.buffer());
-
-    if (xid != INVALID_TRXID) {
-        CHECK_NULL(dbms);
-        buffer = require_buffering(c, rec.index(), xid, LockMode::SHARED);
-        CHECK_NULL(buffer.buffer());
+    pagenum_t leaf = find_leaf(key, buffer);
+    if (xid == INVALID_TRXID) {
+        if (leaf == INVALID_PAGENUM) {
+            return Status::FAILURE;
+        }
+        return find_key_from_leaf(key, buffer, record);
     }
 
-    if (record != nullptr) {
-        rec.read_void([&](Record const& rec) {
-            std::memcpy(record, &rec, sizeof(Record));
-        });
-    }
-    return Status::SUCCESS;
-}
-
-std::vector<Record> BPTree::find_range(prikey_t start, prikey_t end) const {
-    std::vector<Record> retn;
-
-    Ubuffer buffer(nullptr);
-    pagenum_t leaf = find_leaf(start, buffer);
+    // snapshot read, versions are resolved under the page latch since
+    // rollback restores the page before it drops the aborted versions
+    tableid_t tid = TableManager::convert(file->get_id());
     if (leaf == INVALID_PAGENUM) {
-        return retn;
+        return dbms->versions.read(xid, tid, key, false, record);
     }
-
-    int i;
-    Status res = buffer.read([&](Page const& page) {
-        Record const* rec = page.records();
-        int num_key = page.page_header().number_of_keys;
-        for (i = 0; i < num_key && rec[i].key < start; ++i)
-            {}
-
-        if (i == num_key) {
-            return Status::FAILURE;
+    return buffer.read([&](Page const& page) {
+        uint32_t num_key = page.page_header().number_of_keys;
+        uint32_t i = 0;
+        while (i < num_key && page.records()[i].key != key) {
+            ++i;
         }
-        return Status::SUCCESS;
+        bool exists = page.page_header().is_leaf && i < num_key;
+        if (exists && record != nullptr) {
+            std::memcpy(record, &page.records()[i], sizeof(Record));
+        }
+        return dbms->versions.read(xid, tid, key, exists, record);
     });
+}
 
-    if (res == Status::FAILURE) {
-        return retn;
-    }
-
-    while (true) {
-        pagenum_t next;
-        buffer.read_void([&](Page const& page) {
-            Record const* rec = page.records();
-            int num_key = page.page_header().number_of_keys;
-            for (; i < num_key && rec[i].key <= end; ++i) {
-                retn.push_back(rec[i]);
-            }
+Status BPTree::find_batch(
+    std::vector<prikey_t> const& keys, std::vector<Record>& records
+) const {
+    records.clear();
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
 
-            if (i < num_key && rec[i].key > end) {
-                next = INVALID_PAGENUM;
-            } else {
-                next = page.page_header().special_page_number;
-            }
-        });
-        if (next == INVALID_PAGENUM) {
-            break;
+    size_t i = 0;
+    Ubuffer buffer(nullptr);
+    while (i < keys.size()) {
+        if (find_leaf(keys[i], buffer) == INVALID_PAGENUM) {
+            // empty tree
+            return Status::SUCCESS;
         }
+        CHECK_SUCCESS(buffer.read_void([&](Page const& page) {
+            Record const* begin = page.records();
+            Record const* end = begin + page.page_header().number_of_keys;
+            Record const* rec = begin;
+            // at least one key is consumed, following keys while in the leaf
+            do {
+                prikey_t key = keys[i++];
+                rec = std::lower_bound(
+                    rec, end, key, [](Record const& rec, prikey_t key) {
+                        return rec.key < key;
+                    });
+                if (rec != end && rec->key == key) {
+                    records.push_back(*rec);
+                }
+            } while (i < keys.size() && begin != end
+                && keys[i] <= end[-1].key);
+        }));
+    }
+    return Status::SUCCESS;
+}
 
-        i = 0;
-        buffer = buffering(next);
-        if (buffer.buffer() == nullptr) {
-            return std::vector<Record>();
-        }
+std::vector<Record> BPTree::find_range(
+    prikey_t start, prikey_t end, Predicate const* filter
+) const {
+    std::vector<Record> retn;
+    for (BPTreeBatchIterator iter = batches(start, end, filter);
+         iter.valid();
+         iter.next()
+    ) {
+        std::vector<Record> const& batch = iter.batch();
+        retn.insert(retn.end(), batch.begin(), batch.end());
     }
     return retn;
 }
 
 Status BPTree::insert(
-    prikey_t key, const uint8_t* value, int value_size
+    prikey_t key, const uint8_t* value, int value_size, trxid_t xid
 ) const {
-    Ubuffer leaf_page(nullptr);
-    pagenum_t leaf = find_leaf(key, leaf_page);
-    if (leaf != INVALID_PAGENUM
-        && find_key_from_leaf(key, leaf_page, nullptr) == Status::SUCCESS) {
-        return Status::FAILURE;
-    }
-
     Record record;
     CHECK_SUCCESS(write_record(record, key, value, value_size));
-
-    pagenum_t root = buffering(FILE_HEADER_PAGENUM).read(
-        [&](Page const& page) {
-            return page.file_header().root_page_number;
-        });
-
-    if (root == INVALID_PAGENUM) {
-        return new_tree(record);
+    if (xid == INVALID_TRXID) {
+        return insert_record(record);
     }
 
-    int num_key = leaf_page.read([&](Page const& page) {
-        return page.page_header().number_of_keys;
+    CHECK_NULL(dbms);
+    CHECK_SUCCESS(require_write(key, xid));
+    return with_next_key(key, xid, [&] {
+        return insert_latched(
+            record, [&](HID hid, int offset, Record const& rec) {
+                dbms->versions.record(xid, hid.tid, rec.key, false, rec);
+                return dbms->logs.log_insert(xid, hid, offset, rec);
+            });
     });
-    if (num_key < leaf_order - 1) {
-        return insert_to_leaf(std::move(leaf_page), record);
-    }
-
-    return insert_and_split_leaf(std::move(leaf_page), record);
 }
 
-Status BPTree::remove(prikey_t key) const {
-    Ubuffer leaf_page(nullptr);
-    pagenum_t leaf = find_leaf(key, leaf_page);
-    if (leaf != INVALID_PAGENUM
-        && find_key_from_leaf(key, leaf_page, nullptr) == Status::SUCCESS
-    ) {
-        return delete_entry(key, std::move(leaf_page));
+Status BPTree::remove(prikey_t key, trxid_t xid) const {
+    if (xid == INVALID_TRXID) {
+        return remove_record(key);
     }
-    return Status::FAILURE;
+
+    CHECK_NULL(dbms);
+    CHECK_SUCCESS(require_write(key, xid));
+    return with_next_key(key, xid, [&] {
+        return remove_latched(
+            key, [&](HID hid, int offset, Record const& rec) {
+                dbms->versions.record(xid, hid.tid, rec.key, true, rec);
+                return dbms->logs.log_delete(xid, hid, offset, rec);
+            });
+    });
 }
 
 Status BPTree::update(prikey_t key, Record record, trxid_t xid) const {
+    if (xid != INVALID_TRXID) {
+        CHECK_NULL(dbms);
+        CHECK_SUCCESS(require_write(key, xid));
+    }
+    // update in place, structure is not changed
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
     Ubuffer buffer(nullptr);
     pagenum_t c = find_leaf(key, buffer);
     if (c == INVALID_PAGENUM) {
@@ -331,30 +337,34 @@ Status BPTree::update(prikey_t key, Record record, trxid_t xid) const {
     Urecord rec = find_key_from_leaf(key, buffer);
     CHECK_NULL(rec.buffer());
 
-    if (xid != INVALID_TRXID) {
-        CHECK_NULL(dbms);
-        buffer = require_buffering(c, rec.index(), xid, LockMode::EXCLUSIVE);
-        CHECK_NULL(buffer.buffer());
-    }
-
     Record before;
-    Status status = rec.write_void([&](Record& rec) {
+    CHECK_SUCCESS(rec.read_void([&](Record const& rec) {
         std::memcpy(&before, &rec, sizeof(Record));
+    }));
+
+    size_t idx = rec.index();
+    HID hid(TableManager::convert(file->get_id()), c, idx);
+    record.key = before.key;
+    if (xid != INVALID_TRXID) {
+        // prior version should be kept before the page is modified
+        CHECK_SUCCESS(
+            dbms->versions.record(xid, hid.tid, key, true, before));
+    }
+    return buffer.write_void([&](Page& page) {
+        // write ahead, log should be written before the page is modified,
+        // under the page latch for consistent dirty page table
+        if (xid != INVALID_TRXID) {
+            page.page_header().page_lsn =
+                dbms->logs.log_update(xid, hid, idx, before, record);
+        }
         std::memcpy(
-            rec.value, record.value,
+            page.records()[idx].value, record.value,
             sizeof(Record) - sizeof(prikey_t));
-        return Status::SUCCESS;
     });
-
-    if (status == Status::SUCCESS && xid != INVALID_TRXID) {
-        record.key = before.key;
-        HID hid(TableManager::convert(file->get_id()), c, rec.index());
-        dbms->logs.log_update(xid, hid, rec.index(), before, record);
-    }
-    return status;
 }
 
 Status BPTree::destroy_tree() const {
+    std::unique_lock<std::shared_timed_mutex> own(*latch);
     pagenum_t root;
     CHECK_SUCCESS(
         buffering(FILE_HEADER_PAGENUM).write_void([&](Page& page) {
@@ -400,6 +410,94 @@ BPTreeIterator BPTree::end() const {
     return BPTreeIterator::end();
 }
 
+BPTreeBatchIterator BPTree::batches(
+    prikey_t start, prikey_t end, Predicate const* filter
+) const {
+    return BPTreeBatchIterator(*this, start, end, filter);
+}
+
+pagenum_t BPTree::num_pages() const {
+    return buffering(FILE_HEADER_PAGENUM).read([&](Page const& page) {
+        return page.file_header().number_of_pages;
+    });
+}
+
+std::vector<prikey_t> BPTree::separators(size_t num) const {
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
+    std::vector<prikey_t> keys;
+    std::vector<pagenum_t> level(1, buffering(FILE_HEADER_PAGENUM).read(
+        [&](Page const& page) {
+            return page.file_header().root_page_number;
+        }));
+    if (level[0] == INVALID_PAGENUM) {
+        return keys;
+    }
+
+    // descend level by level, nodes of a level are in key order
+    while (!level.empty()) {
+        std::vector<pagenum_t> children;
+        std::vector<prikey_t> found;
+        bool leaf = false;
+        for (pagenum_t pagenum : level) {
+            buffering(pagenum).read_void([&](Page const& page) {
+                PageHeader const& header = page.page_header();
+                if (header.is_leaf) {
+                    leaf = true;
+                    return;
+                }
+                children.push_back(header.special_page_number);
+                for (uint32_t i = 0; i < header.number_of_keys; ++i) {
+                    found.push_back(page.entries()[i].key);
+                    children.push_back(page.entries()[i].pagenum);
+                }
+            });
+        }
+        if (leaf) {
+            break;
+        }
+        keys = std::move(found);
+        if (keys.size() >= num) {
+            break;
+        }
+        level = std::move(children);
+    }
+    return keys;
+}
+
+Status BPTree::read_leaf(
+    pagenum_t& pagenum, prikey_t start, prikey_t end,
+    std::vector<Record>& records, Predicate const* filter
+) const {
+    records.clear();
+    Ubuffer buffer(nullptr);
+    if (pagenum == INVALID_PAGENUM) {
+        std::shared_lock<std::shared_timed_mutex> own(*latch);
+        if (find_leaf(start, buffer) == INVALID_PAGENUM) {
+            return Status::SUCCESS;
+        }
+    } else {
+        buffer = buffering(pagenum);
+    }
+
+    return buffer.read_void([&](Page const& page) {
+        PageHeader const& header = page.page_header();
+        Record const* rec = page.records();
+        int num_key = header.number_of_keys;
+        int i = 0;
+        for (; i < num_key && rec[i].key < start; ++i) {}
+        int first = i;
+        for (; i < num_key && rec[i].key <= end; ++i) {}
+        if (filter == nullptr) {
+            records.insert(records.end(), rec + first, rec + i);
+        } else {
+            // evaluated on the latched page, only matches are copied
+            filter->filter(rec + first, i - first, records);
+        }
+        // range ends in this leaf
+        pagenum = i < num_key ? INVALID_PAGENUM : header.special_page_number;
+    });
+}
+
 Status BPTree::set_database(Database& dbms) {
     this->dbms = &dbms;
     return Status::SUCCESS;
@@ -416,10 +514,244 @@ Ubuffer BPTree::buffering(pagenum_t pagenum) const {
     return buffers->buffering(*file, pagenum);
 }
 
-Ubuffer BPTree::require_buffering(
-    pagenum_t pagenum, size_t rid, trxid_t xid, LockMode mode
+HID BPTree::lock_id(prikey_t key) const {
+    uint64_t bits = static_cast<uint64_t>(key);
+    // group ID starts from one, zero is reserved for invalid page
+    return HID(
+        TableManager::convert(file->get_id()),
+        (bits >> LOCK_GROUP_BITS) + 1,
+        bits & ((1 << LOCK_GROUP_BITS) - 1));
+}
+
+Status BPTree::require_lock(
+    prikey_t key, trxid_t xid, LockMode mode
 ) const {
-    return buffers->require_buffering(*file, pagenum, rid, xid, mode);
+    return dbms->trxs.require_lock(xid, lock_id(key), mode);
+}
+
+Status BPTree::require_write(prikey_t key, trxid_t xid) const {
+    CHECK_SUCCESS(require_lock(key, xid, LockMode::EXCLUSIVE));
+    // first updater wins, snapshot should not overwrite newer commit
+    if (dbms->versions.conflict(
+            xid, TableManager::convert(file->get_id()), key)) {
+        dbms->abort_trx(xid);
+        return Status::FAILURE;
+    }
+    return Status::SUCCESS;
+}
+
+prikey_t BPTree::next_key(prikey_t key) const {
+    Ubuffer buffer(nullptr);
+    pagenum_t pagenum = find_leaf(key, buffer);
+    while (pagenum != INVALID_PAGENUM) {
+        prikey_t next = SUPREMUM;
+        buffer.read_void([&](Page const& page) {
+            Record const* rec = page.records();
+            int num_key = page.page_header().number_of_keys;
+            for (int i = 0; i < num_key; ++i) {
+                if (rec[i].key > key) {
+                    next = rec[i].key;
+                    return;
+                }
+            }
+            pagenum = page.page_header().special_page_number;
+        });
+        if (next != SUPREMUM || pagenum == INVALID_PAGENUM) {
+            return next;
+        }
+        buffer = buffering(pagenum);
+    }
+    return SUPREMUM;
+}
+
+Status BPTree::with_next_key(
+    prikey_t key, trxid_t xid, std::function<Status()> const& callback
+) const {
+    prikey_t next;
+    {
+        std::shared_lock<std::shared_timed_mutex> own(*latch);
+        next = next_key(key);
+    }
+    while (true) {
+        // lock is acquired without latch, waiting could be long
+        CHECK_SUCCESS(require_lock(next, xid, LockMode::EXCLUSIVE));
+        std::unique_lock<std::shared_timed_mutex> own(*latch);
+        prikey_t found = next_key(key);
+        if (found == next) {
+            return callback();
+        }
+        next = found;
+    }
+}
+
+Status BPTree::insert_record(
+    Record const& record, logger_t const& logger
+) const {
+    std::unique_lock<std::shared_timed_mutex> own(*latch);
+    return insert_latched(record, logger);
+}
+
+Status BPTree::insert_latched(
+    Record const& record, logger_t const& logger
+) const {
+    return log_structure(logger, [&] {
+        return insert_to_tree(record, logger);
+    });
+}
+
+Status BPTree::insert_to_tree(
+    Record const& record, logger_t const& logger
+) const {
+    prikey_t key = record.key;
+    tableid_t tid = TableManager::convert(file->get_id());
+    Ubuffer leaf_page(nullptr);
+    pagenum_t leaf = find_leaf(key, leaf_page);
+    if (leaf == INVALID_PAGENUM) {
+        CHECK_SUCCESS(new_tree(record));
+        if (!logger) {
+            return Status::SUCCESS;
+        }
+        leaf = find_leaf(key, leaf_page);
+        return leaf_page.write_void([&](Page& page) {
+            page.page_header().page_lsn = logger(HID(tid, leaf, 0), 0, record);
+        });
+    }
+    if (find_key_from_leaf(key, leaf_page, nullptr) == Status::SUCCESS) {
+        return Status::FAILURE;
+    }
+
+    lsn_t lsn = INVALID_LSN;
+    int num_key;
+    CHECK_SUCCESS(leaf_page.write_void([&](Page& page) {
+        num_key = page.page_header().number_of_keys;
+        if (!logger) {
+            return;
+        }
+        // write ahead, log should be written before the leaf is modified
+        int idx = 0;
+        while (idx < num_key && page.records()[idx].key < key) {
+            ++idx;
+        }
+        lsn = logger(HID(tid, leaf, idx), idx, record);
+        page.page_header().page_lsn = lsn;
+    }));
+
+    if (num_key < leaf_order - 1) {
+        return insert_to_leaf(std::move(leaf_page), record);
+    }
+    CHECK_SUCCESS(insert_and_split_leaf(std::move(leaf_page), record));
+    if (lsn == INVALID_LSN) {
+        return Status::SUCCESS;
+    }
+
+    // record could be moved to the new leaf
+    find_leaf(key, leaf_page);
+    return leaf_page.write_void([&](Page& page) {
+        PageHeader& header = page.page_header();
+        header.page_lsn = std::max(header.page_lsn, lsn);
+    });
+}
+
+Status BPTree::remove_record(prikey_t key, logger_t const& logger) const {
+    std::unique_lock<std::shared_timed_mutex> own(*latch);
+    return remove_latched(key, logger);
+}
+
+Status BPTree::remove_latched(prikey_t key, logger_t const& logger) const {
+    return log_structure(logger, [&] {
+        return remove_from_tree(key, logger);
+    });
+}
+
+Status BPTree::remove_from_tree(
+    prikey_t key, logger_t const& logger
+) const {
+    Ubuffer leaf_page(nullptr);
+    pagenum_t leaf = find_leaf(key, leaf_page);
+    if (leaf == INVALID_PAGENUM) {
+        return Status::FAILURE;
+    }
+    Urecord rec = find_key_from_leaf(key, leaf_page);
+    CHECK_NULL(rec.buffer());
+
+    if (logger) {
+        tableid_t tid = TableManager::convert(file->get_id());
+        int idx = rec.index();
+        CHECK_SUCCESS(leaf_page.write_void([&](Page& page) {
+            page.page_header().page_lsn =
+                logger(HID(tid, leaf, idx), idx, page.records()[idx]);
+        }));
+    }
+    return delete_entry(key, std::move(leaf_page));
+}
+
+Status BPTree::log_structure(
+    logger_t const& logger, std::function<Status()> const& modify
+) const {
+    // structure is logged with the records
+    if (!logger || dbms == nullptr || !dbms->logs.durable()) {
+        return modify();
+    }
+    std::vector<pagenum_t> pages;
+    BufferManager::capture(&pages);
+    Status res = modify();
+    BufferManager::capture(nullptr);
+
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    if (pages.size() > 1) {
+        // structure is changed, written pages are logged at once
+        CHECK_SUCCESS(dbms->logs.log_pages(
+            *dbms, TableManager::convert(file->get_id()), pages));
+    } else {
+        // single leaf is covered by the record log
+        CHECK_SUCCESS(buffers->release_held(*file, pages, INVALID_LSN));
+    }
+    return res;
+}
+
+lsn_t BPTree::leaf_lsn(prikey_t key) const {
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
+    Ubuffer buffer(nullptr);
+    if (find_leaf(key, buffer) == INVALID_PAGENUM) {
+        return INVALID_LSN;
+    }
+    return buffer.read([](Page const& page) {
+        return page.page_header().page_lsn;
+    });
+}
+
+Status BPTree::write_leaf(
+    prikey_t key, std::function<void(Page&, HID, int)> const& writer
+) const {
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
+    Ubuffer buffer(nullptr);
+    pagenum_t leaf = find_leaf(key, buffer);
+    if (leaf == INVALID_PAGENUM) {
+        return Status::FAILURE;
+    }
+    Urecord rec = find_key_from_leaf(key, buffer);
+    CHECK_NULL(rec.buffer());
+
+    int idx = rec.index();
+    HID hid(TableManager::convert(file->get_id()), leaf, idx);
+    return buffer.write_void([&](Page& page) {
+        writer(page, hid, idx);
+    });
+}
+
+Status BPTree::write_leaf_page(
+    prikey_t key, std::function<void(Page&, pagenum_t)> const& writer
+) const {
+    std::shared_lock<std::shared_timed_mutex> own(*latch);
+    Ubuffer buffer(nullptr);
+    pagenum_t leaf = find_leaf(key, buffer);
+    if (leaf == INVALID_PAGENUM) {
+        return Status::FAILURE;
+    }
+    return buffer.write_void([&](Page& page) {
+        writer(page, leaf);
+    });
 }
 
 Ubuffer BPTree::create_page(bool leaf) const {
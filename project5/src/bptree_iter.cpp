@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <limits>
+#include <mutex>
+#include <shared_mutex>
 
 #include "bptree_iter.hpp"
 
@@ -121,6 +124,62 @@ BPTreeIterator& BPTreeIterator::operator++() {
     return *this;
 }
 
+BPTreeIterator& BPTreeIterator::seek(prikey_t key) {
+    // near key is found by following the leaves
+    for (int i = 0; i < 2 && pagenum != INVALID_PAGENUM; ++i) {
+        if (seek_leaf(key)) {
+            return *this;
+        }
+        next_leaf();
+    }
+    if (pagenum == INVALID_PAGENUM) {
+        return *this;
+    }
+
+    // far key, descend from the root
+    {
+        std::shared_lock<std::shared_timed_mutex> own(*tree->latch);
+        pagenum = tree->find_leaf(key, buffer);
+    }
+    record_index = 0;
+    num_key = 0;
+    if (pagenum == INVALID_PAGENUM) {
+        buffer = Ubuffer(nullptr);
+        return *this;
+    }
+
+    num_key = buffer.read([&](Page const& page) {
+        return page.page_header().number_of_keys;
+    });
+    if (!seek_leaf(key)) {
+        // all keys of the leaf are less, next leaf starts after the key
+        next_leaf();
+    }
+    return *this;
+}
+
+bool BPTreeIterator::seek_leaf(prikey_t key) {
+    return buffer.read([&](Page const& page) {
+        Record const* begin = page.records();
+        Record const* end = begin + num_key;
+        Record const* found = std::lower_bound(
+            begin + std::min(record_index, num_key), end, key,
+            [](Record const& rec, prikey_t key) {
+                return rec.key < key;
+            });
+        if (found == end) {
+            return false;
+        }
+        record_index = static_cast<int>(found - begin);
+        return true;
+    });
+}
+
+void BPTreeIterator::next_leaf() {
+    record_index = num_key - 1;
+    ++*this;
+}
+
 bool BPTreeIterator::operator!=(BPTreeIterator const& other) {
     return pagenum != other.pagenum || record_index != other.record_index;
 }
@@ -132,3 +191,71 @@ bool BPTreeIterator::operator==(BPTreeIterator const& other) {
 UbufferRecordRef BPTreeIterator::operator*() {
     return UbufferRecordRef(record_index, &buffer);
 }
+
+BPTreeBatchIterator::BPTreeBatchIterator(
+    BPTree const& tree, prikey_t start, prikey_t end, Predicate const* filter
+) : tree(&tree), start(start), end(end), filter(filter),
+    pagenum(INVALID_PAGENUM),
+    done(start > end), records()
+{
+    if (fetch() == Status::FAILURE) {
+        done = true;
+        records.clear();
+    }
+}
+
+bool BPTreeBatchIterator::valid() const {
+    return !records.empty();
+}
+
+std::vector<Record> const& BPTreeBatchIterator::batch() const {
+    return records;
+}
+
+Status BPTreeBatchIterator::next() {
+    return fetch();
+}
+
+Status BPTreeBatchIterator::seek(prikey_t key) {
+    if (key <= start) {
+        return Status::SUCCESS;
+    }
+    start = key;
+    if (!records.empty() && key <= records.back().key) {
+        records.erase(
+            records.begin(),
+            std::lower_bound(
+                records.begin(), records.end(), key,
+                [](Record const& rec, prikey_t key) {
+                    return rec.key < key;
+                }));
+        return Status::SUCCESS;
+    }
+
+    if (done) {
+        records.clear();
+        return Status::SUCCESS;
+    }
+
+    // near key is in the next leaf
+    CHECK_SUCCESS(tree->read_leaf(pagenum, start, end, records, filter));
+    done = pagenum == INVALID_PAGENUM;
+    if (!records.empty() || done) {
+        return Status::SUCCESS;
+    }
+
+    // far key, descend from the root
+    pagenum = INVALID_PAGENUM;
+    done = start > end;
+    return fetch();
+}
+
+Status BPTreeBatchIterator::fetch() {
+    records.clear();
+    // empty leaves are skipped
+    while (records.empty() && !done) {
+        CHECK_SUCCESS(tree->read_leaf(pagenum, start, end, records, filter));
+        done = pagenum == INVALID_PAGENUM;
+    }
+    return Status::SUCCESS;
+}
@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <cstring>
+
 #include "buffer_manager.hpp"
 #include "dbms.hpp"
 
+thread_local std::vector<pagenum_t>* Buffer::captured = nullptr;
+
 Buffer::Buffer() {
     clear(-1, nullptr);
 }
@@ -26,6 +31,9 @@ Status Buffer::clear(int idx, BufferManager* parent) {
     index = idx;
     is_allocated = false;
     is_dirty = false;
+    is_virtual = false;
+    held = false;
+    rec_lsn = INVALID_LSN;
     pin = 0;
     prev_use = nullptr;
     next_use = nullptr;
@@ -38,9 +46,13 @@ Status Buffer::load(FileManager& file, pagenum_t pagenum, bool virtual_page) {
     // buffer must be initialized by buffer init before loading
     if (!virtual_page) {
         CHECK_SUCCESS(file.page_read(pagenum, frame));
+    } else {
+        // new page has no lsn, redo compares it with the page images
+        std::memset(&frame, 0, sizeof(Page));
     }
     this->pagenum = pagenum;
     this->is_allocated = true;
+    this->is_virtual = virtual_page;
     this->file = &file;
     return Status::SUCCESS;
 }
@@ -91,7 +103,13 @@ Status Buffer::release() {
     CHECK_SUCCESS(link_neighbor());
     // if is dirty
     if (is_dirty) {
+        if (manager != nullptr) {
+            CHECK_SUCCESS(manager->write_ahead(frame));
+        }
         CHECK_SUCCESS(file->page_write(pagenum, frame));
+        if (manager != nullptr) {
+            manager->mark_written(file);
+        }
     }
     return clear(index, manager);
 }
@@ -170,6 +188,14 @@ Status Ubuffer::check_and_reload() {
     return reload();
 }
 
+bool Ubuffer::holds(Buffer const& target) const {
+    // unmanaged buffer could not be reloaded
+    return target.manager == nullptr
+        || (target.file != nullptr && file != nullptr
+            && target.file->get_id() == file->get_id()
+            && target.pagenum == pagenum);
+}
+
 pagenum_t Ubuffer::to_pagenum() const {
     return pagenum;
 }
@@ -221,6 +247,9 @@ BufferManager::BufferManager(int num_buffer)
     , num_buffer(0)
     , lru(nullptr)
     , mru(nullptr)
+    , sync_mtx()
+    , written_mtx()
+    , written()
     , dummy(std::make_unique<Buffer[]>(capacity))
     , buffers(std::make_unique<Buffer*[]>(capacity))
     , table()
@@ -237,6 +266,10 @@ Status BufferManager::set_database(Database& dbms) {
     return Status::SUCCESS;
 }
 
+int BufferManager::get_capacity() const {
+    return capacity;
+}
+
 Buffer* BufferManager::most_recently_used() const {
     return mru;
 }
@@ -286,6 +319,14 @@ Ubuffer BufferManager::require_buffering(
     return buffering(file, pagenum);
 }
 
+Status BufferManager::prefetch(FileManager& file, pagenum_t pagenum) {
+    std::unique_lock<std::recursive_mutex> lock(mtx);
+    if (find(file.get_id(), pagenum) != -1) {
+        return Status::SUCCESS;
+    }
+    return load(file, pagenum) == -1 ? Status::FAILURE : Status::SUCCESS;
+}
+
 Ubuffer BufferManager::new_page(FileManager& file) {
     std::unique_lock<std::recursive_mutex> lock(mtx);
     pagenum_t pid = Page::create(
@@ -304,6 +345,11 @@ Status BufferManager::free_page(FileManager& file, pagenum_t pagenum) {
     std::unique_lock<std::recursive_mutex> lock(mtx);
     int idx = find(file.get_id(), pagenum);
     if (idx != -1) {
+        // tree on the disk could refer the page until the structure
+        // modification is logged, content of the freed page is dropped
+        if (buffers[idx]->held) {
+            buffers[idx]->is_dirty = false;
+        }
         CHECK_SUCCESS(release_block(idx));
     }
     return Page::release([&](pagenum_t target, auto&& func) {
@@ -312,6 +358,131 @@ Status BufferManager::free_page(FileManager& file, pagenum_t pagenum) {
     }, pagenum);
 }
 
+Status BufferManager::write_ahead(Page const& page) {
+    if (dbms == nullptr) {
+        return Status::SUCCESS;
+    }
+    return dbms->logs.flush(page.page_header().page_lsn);
+}
+
+std::vector<DirtyPage> BufferManager::dirty_pages() {
+    std::vector<DirtyPage> pages;
+    for (Buffer* buffer : pin_dirty()) {
+        {
+            // wait for the modification in progress
+            std::shared_lock<std::shared_timed_mutex> own(buffer->mtx);
+            if (buffer->is_allocated && buffer->rec_lsn != INVALID_LSN) {
+                pages.push_back(DirtyPage{
+                    buffer->file->get_id(), buffer->pagenum, buffer->rec_lsn });
+            }
+        }
+        --buffer->pin;
+    }
+    return pages;
+}
+
+Status BufferManager::flush_dirty(size_t num) {
+    std::vector<Buffer*> dirty = pin_dirty();
+    // the oldest pages hold the redo point
+    std::sort(dirty.begin(), dirty.end(), [](Buffer* a, Buffer* b) {
+        return a->rec_lsn < b->rec_lsn;
+    });
+
+    Status res = Status::SUCCESS;
+    for (size_t i = 0; i < dirty.size(); ++i) {
+        Buffer* buffer = dirty[i];
+        if (i < num && res == Status::SUCCESS) {
+            std::shared_lock<std::shared_timed_mutex> own(buffer->mtx);
+            if (buffer->is_allocated && buffer->is_dirty && !buffer->held) {
+                if (write_ahead(buffer->frame) == Status::FAILURE
+                    || buffer->file->page_write(
+                        buffer->pagenum, buffer->frame) == Status::FAILURE
+                ) {
+                    res = Status::FAILURE;
+                } else {
+                    // recLSN is dropped, file is synchronized by checkpoint
+                    mark_written(buffer->file);
+                    buffer->is_dirty = false;
+                    buffer->rec_lsn = INVALID_LSN;
+                }
+            }
+        }
+        --buffer->pin;
+    }
+    return res;
+}
+
+Status BufferManager::sync_files() {
+    // file is not closed until the synchronization is done
+    std::unique_lock<std::mutex> own(sync_mtx);
+    std::unordered_set<FileManager*> files;
+    {
+        std::unique_lock<std::mutex> lock(written_mtx);
+        files.swap(written);
+    }
+
+    Status res = Status::SUCCESS;
+    for (FileManager* file : files) {
+        if (file->sync() == Status::FAILURE) {
+            mark_written(file);
+            res = Status::FAILURE;
+        }
+    }
+    return res;
+}
+
+void BufferManager::capture(std::vector<pagenum_t>* pages) {
+    Buffer::captured = pages;
+}
+
+Status BufferManager::release_held(
+    FileManager& file, std::vector<pagenum_t> const& pages, lsn_t lsn
+) {
+    Status res = Status::SUCCESS;
+    for (pagenum_t pagenum : pages) {
+        Ubuffer ubuf = buffering(file, pagenum);
+        if (ubuf.buffer() == nullptr) {
+            res = Status::FAILURE;
+            continue;
+        }
+        // write ahead, log is written before the stamped page
+        if (lsn != INVALID_LSN && ubuf.write_void([&](Page& page) {
+                page.page_header().page_lsn = lsn;
+            }) == Status::FAILURE
+        ) {
+            res = Status::FAILURE;
+        }
+
+        // frame could be replaced if it is not held
+        Buffer& buffer = *ubuf.buffer();
+        std::unique_lock<std::shared_timed_mutex> own(buffer.mtx);
+        if (buffer.file == &file && buffer.pagenum == pagenum) {
+            buffer.is_virtual = false;
+            buffer.held = false;
+        }
+    }
+    return res;
+}
+
+void BufferManager::mark_written(FileManager* file) {
+    std::unique_lock<std::mutex> lock(written_mtx);
+    written.insert(file);
+}
+
+std::vector<Buffer*> BufferManager::pin_dirty() {
+    std::unique_lock<std::recursive_mutex> lock(mtx);
+    // pinned frames are not selected as victim
+    std::vector<Buffer*> dirty;
+    for (int i = 0; i < num_buffer; ++i) {
+        Buffer* buffer = buffers[i];
+        if (buffer->is_allocated && buffer->rec_lsn != INVALID_LSN) {
+            ++buffer->pin;
+            dirty.push_back(buffer);
+        }
+    }
+    return dirty;
+}
+
 int BufferManager::allocate_block() {
     if (num_buffer < capacity) {
         return num_buffer++;
@@ -367,13 +538,25 @@ Status BufferManager::release_file(fileid_t fileid) {
             CHECK_SUCCESS(release_block(i));
         }
     }
+
+    // written pages should be durable before the file is closed
+    std::unique_lock<std::mutex> own(sync_mtx);
+    std::unique_lock<std::mutex> written_lock(written_mtx);
+    for (auto iter = written.begin(); iter != written.end();) {
+        if ((*iter)->get_id() == fileid) {
+            CHECK_SUCCESS((*iter)->sync());
+            iter = written.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
     return Status::SUCCESS;
 }
 
 int BufferManager::release(ReleasePolicy const& policy) {
     // searching proper buffer
     Buffer* buf = policy.init(*this);
-    while (buf != nullptr && buf->pin > 0) {
+    while (buf != nullptr && (buf->pin > 0 || buf->held)) {
         buf = policy.next(*buf);
     }
     // if failed
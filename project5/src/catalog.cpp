@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+#include "catalog.hpp"
+
+Value::Value() : type(Type::NUL), integer(0), real(0), str() {
+    // Do Nothing
+}
+
+Value Value::of(int64_t integer) {
+    Value value;
+    value.type = Type::INT;
+    value.integer = integer;
+    return value;
+}
+
+Value Value::of(double real) {
+    Value value;
+    value.type = Type::REAL;
+    value.real = real;
+    return value;
+}
+
+Value Value::of(std::string str) {
+    Value value;
+    value.type = Type::STR;
+    value.str = std::move(str);
+    return value;
+}
+
+bool Value::is_null() const {
+    return type == Type::NUL;
+}
+
+bool Value::is_number() const {
+    return type == Type::INT || type == Type::REAL;
+}
+
+double Value::as_real() const {
+    if (type == Type::INT) {
+        return static_cast<double>(integer);
+    }
+    return type == Type::REAL ? real : 0;
+}
+
+int Value::compare(Value const& other) const {
+    auto rank = [](Value const& value) {
+        return value.is_null() ? 0 : value.is_number() ? 1 : 2;
+    };
+    int lhs = rank(*this);
+    int rhs = rank(other);
+    if (lhs != rhs) {
+        return lhs < rhs ? -1 : 1;
+    }
+
+    if (type == Type::INT && other.type == Type::INT) {
+        return (integer > other.integer) - (integer < other.integer);
+    }
+    if (lhs == 1) {
+        double x = as_real();
+        double y = other.as_real();
+        return (x > y) - (x < y);
+    }
+    if (lhs == 2) {
+        int cmp = str.compare(other.str);
+        return (cmp > 0) - (cmp < 0);
+    }
+    return 0;
+}
+
+bool Value::operator==(Value const& other) const {
+    return compare(other) == 0;
+}
+
+bool Value::operator!=(Value const& other) const {
+    return compare(other) != 0;
+}
+
+size_t Value::hash() const {
+    switch (type) {
+    case Type::NUL:
+        return 0;
+    case Type::INT:
+        return std::hash<int64_t>()(integer);
+    case Type::REAL: {
+        // integral reals are equal to the integers
+        int64_t truncated = static_cast<int64_t>(real);
+        if (static_cast<double>(truncated) == real) {
+            return std::hash<int64_t>()(truncated);
+        }
+        return std::hash<double>()(real);
+    }
+    case Type::STR:
+        return std::hash<std::string>()(str);
+    }
+    return 0;
+}
+
+std::string Value::to_string(bool quote) const {
+    switch (type) {
+    case Type::NUL:
+        return "null";
+    case Type::INT:
+        return std::to_string(integer);
+    case Type::REAL: {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.4f", real);
+        return buf;
+    }
+    case Type::STR:
+        return quote ? "'" + str + "'" : str;
+    }
+    return "";
+}
+
+size_t ValueHash::operator()(Value const& value) const {
+    return value.hash();
+}
+
+size_t RowHash::operator()(Row const& row) const {
+    size_t seed = row.size();
+    for (Value const& value : row) {
+        seed ^= value.hash() + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+Column Column::integer(std::string const& name, bool key) {
+    return Column { Catalog::lower(name), ColumnType::INT, 8, key, 0 };
+}
+
+Column Column::chars(std::string const& name, size_t size) {
+    return Column { Catalog::lower(name), ColumnType::CHAR, size, false, 0 };
+}
+
+int Schema::find(std::string const& name) const {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+Value Schema::decode(size_t idx, Record const& record) const {
+    Column const& column = columns[idx];
+    if (column.key) {
+        return Value::of(static_cast<int64_t>(record.key));
+    }
+
+    uint8_t const* field = record.value + column.offset;
+    if (column.type == ColumnType::INT) {
+        int64_t integer;
+        std::memcpy(&integer, field, sizeof(integer));
+        return Value::of(integer);
+    }
+    char const* str = reinterpret_cast<char const*>(field);
+    return Value::of(std::string(str, strnlen(str, column.size)));
+}
+
+Status Schema::encode(std::vector<Value> const& values, Record& record) const {
+    CHECK_TRUE(values.size() == columns.size());
+    std::memset(&record, 0, sizeof(Record));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        Column const& column = columns[i];
+        Value const& value = values[i];
+        uint8_t* field = record.value + column.offset;
+        if (column.type == ColumnType::INT) {
+            CHECK_TRUE(value.type == Value::Type::INT);
+            if (column.key) {
+                record.key = value.integer;
+            } else {
+                std::memcpy(field, &value.integer, sizeof(value.integer));
+            }
+        } else {
+            CHECK_TRUE(value.type == Value::Type::STR);
+            CHECK_TRUE(value.str.size() <= column.size);
+            std::memcpy(field, value.str.data(), value.str.size());
+        }
+    }
+    return Status::SUCCESS;
+}
+
+Catalog::Catalog() : tables() {
+    // Do Nothing
+}
+
+Status Catalog::define(
+    std::string const& name, tableid_t id, std::vector<Column> columns
+) {
+    std::string lowered = lower(name);
+    CHECK_TRUE(tables.find(lowered) == tables.end());
+
+    size_t num_keys = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        Column& column = columns[i];
+        column.name = lower(column.name);
+        for (size_t j = 0; j < i; ++j) {
+            CHECK_TRUE(columns[j].name != column.name);
+        }
+
+        if (column.key) {
+            CHECK_TRUE(column.type == ColumnType::INT);
+            ++num_keys;
+            column.offset = 0;
+            continue;
+        }
+        CHECK_TRUE(column.size > 0);
+        column.offset = offset;
+        offset += column.size;
+    }
+    CHECK_TRUE(num_keys == 1);
+    CHECK_TRUE(offset <= sizeof(Record::value));
+
+    tables[lowered] = Schema { lowered, id, std::move(columns) };
+    return Status::SUCCESS;
+}
+
+Schema const* Catalog::find(std::string const& name) const {
+    auto iter = tables.find(lower(name));
+    if (iter == tables.end()) {
+        return nullptr;
+    }
+    return &iter->second;
+}
+
+std::string Catalog::lower(std::string const& name) {
+    std::string lowered = name;
+    std::transform(
+        lowered.begin(), lowered.end(), lowered.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lowered;
+}
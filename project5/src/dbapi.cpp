@@ -1,12 +1,17 @@
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <thread>
+#include <vector>
 
 #include "dbapi.hpp"
+#include "result_sink.hpp"
 
 std::unique_ptr<Database> GLOBAL_DB = nullptr;
 
-int init_db(int buf_num) {
-    GLOBAL_DB = std::make_unique<Database>(buf_num);
+int init_db(int buf_num, char const* log_path) {
+    GLOBAL_DB = std::make_unique<Database>(
+        buf_num, false, log_path == nullptr ? "" : log_path);
     return 0;
 }
 
@@ -14,12 +19,13 @@ int open_table(char const* pathname) {
     return GLOBAL_DB->open_table(pathname);
 }
 
-int db_insert(int table_id, int64_t key, char const* value) {
+int db_insert(int table_id, int64_t key, char const* value, int xid) {
     return static_cast<int>(GLOBAL_DB->insert(
         table_id,
         key,
         reinterpret_cast<uint8_t const*>(value),
-        strlen(value) + 1));
+        strlen(value) + 1,
+        xid));
 }
 
 int db_find(int table_id, int64_t key, char* ret_val, int xid) {
@@ -38,8 +44,8 @@ int db_find(int table_id, int64_t key, char* ret_val, int xid) {
     return 0;
 }
 
-int db_delete(int table_id, int64_t key) {
-    return static_cast<int>(GLOBAL_DB->remove(table_id, key));
+int db_delete(int table_id, int64_t key, int xid) {
+    return static_cast<int>(GLOBAL_DB->remove(table_id, key, xid));
 }
 
 int db_update(int table_id, int64_t key, char const* values, int xid) {
@@ -57,21 +63,56 @@ int shutdown_db() {
     return 0;
 }
 
-int join_table(int table_id_1, int table_id_2, char const* pathname) {
-    std::ofstream file(pathname);
-    if (!file.is_open()) {
+int join_table(
+    int table_id_1, int table_id_2, char const* pathname, bool binary
+) {
+    ResultSink sink(binary ? SinkFormat::BINARY : SinkFormat::CSV);
+    if (sink.open(pathname) == Status::FAILURE) {
         return 1;
     }
 
-    int res = static_cast<int>(GLOBAL_DB->prikey_join(table_id_1, table_id_2,
-        [&](Record const& rec1, Record const& rec2) {
-            file
-                << rec1.key << ',' << rec1.value << ','
-                << rec2.key << ',' << rec2.value << '\n';
-            return Status::SUCCESS;
+    // ranges are written in key order, the lowest unfinished one streams
+    size_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+    RangeWriter writer(sink, num_workers);
+    int res = static_cast<int>(GLOBAL_DB->parallel_join(
+        table_id_1, table_id_2, num_workers,
+        [&](size_t worker, Record const& rec1, Record const& rec2) {
+            return writer.write(worker, rec1, rec2);
+        },
+        [&](size_t worker, Status res) {
+            return writer.finish(worker, res);
         }));
+    if (sink.close() == Status::FAILURE) {
+        res = 1;
+    }
+
+    if (res != 0) {
+        remove(pathname);
+    }
+
+    return res;
+}
+
+int db_join_tables(
+    int const* table_ids, int num_tables, char const* pathname, bool binary
+) {
+    if (table_ids == nullptr || num_tables <= 0) {
+        return 1;
+    }
+    ResultSink sink(binary ? SinkFormat::BINARY : SinkFormat::CSV);
+    if (sink.open(pathname) == Status::FAILURE) {
+        return 1;
+    }
+
+    std::vector<tableid_t> ids(table_ids, table_ids + num_tables);
+    int res = static_cast<int>(GLOBAL_DB->multi_join(
+        ids, [&](std::vector<Record const*> const& row) {
+            return sink.write(row);
+        }));
+    if (sink.close() == Status::FAILURE) {
+        res = 1;
+    }
 
-    file.close();
     if (res != 0) {
         remove(pathname);
     }
@@ -79,8 +120,18 @@ int join_table(int table_id_1, int table_id_2, char const* pathname) {
     return res;
 }
 
-int begin_trx() {
-    return GLOBAL_DB->begin_trx();
+int db_aggregate(int table_id, int64_t start, int64_t end, Aggregate* result) {
+    if (result == nullptr) {
+        return 1;
+    }
+    size_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<int>(GLOBAL_DB->aggregate(
+        table_id, AggregateOper::value_as_int, *result,
+        num_workers, start, end));
+}
+
+int begin_trx(bool read_only) {
+    return GLOBAL_DB->begin_trx(read_only);
 }
 
 int end_trx(int tid) {
@@ -1,16 +1,52 @@
+#include <cstdlib>
+#include <new>
+
 #include "dbms.hpp"
 
-Database::Database(int num_buffer, bool seq) :
+Database::Database(
+    int num_buffer, bool seq, std::string const& logfile, int checkpoint
+) :
     sequential(seq), mtx(), tables(), buffers(num_buffer),
-    locks(), logs(), trxs(locks)
+    locks(), logs(), trxs(locks), versions()
+    , concurrency(Concurrency::LOCKING), occ()
 {
     tables.set_database(*this);
     buffers.set_database(*this);
     locks.set_database(*this);
+    occ.set_database(*this);
+
+    if (!logfile.empty()) {
+        EXIT_ON_FAILURE(logs.open(logfile));
+        EXIT_ON_FAILURE(logs.recovery(*this));
+        if (checkpoint > 0) {
+            EXIT_ON_FAILURE(logs.start_checkpointer(*this, checkpoint));
+        }
+    }
+}
+
+Database::~Database() {
+    logs.stop_checkpointer();
+    // pages should be written before the log manager is destructed
+    logs.flush_all();
+    buffers.shutdown();
+}
+
+void* Database::operator new(std::size_t size) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignof(Database), size) != 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void Database::operator delete(void* ptr) {
+    std::free(ptr);
 }
 
 tableid_t Database::open_table(std::string const& filename) {
-    return tables.load(filename, buffers);
+    tableid_t tid = tables.load(filename, buffers);
+    logs.register_table(tid, filename);
+    return tid;
 }
 
 Status Database::close_table(tableid_t id) {
@@ -26,26 +62,41 @@ Status Database::print_tree(tableid_t id) {
 }
 
 Status Database::find(tableid_t id, prikey_t key, Record* record, trxid_t xid) {
+    if (xid != INVALID_TRXID && concurrency == Concurrency::OPTIMISTIC) {
+        return occ.find(xid, id, key, record);
+    }
     return wrapper(id, Status::FAILURE, &Table::find, key, record, xid);
 }
 
 std::vector<Record> Database::find_range(
-    tableid_t id, prikey_t start, prikey_t end
+    tableid_t id, prikey_t start, prikey_t end, Predicate const* filter
 ) {
-    return wrapper(id, std::vector<Record>(), &Table::find_range, start, end);
+    return wrapper(
+        id, std::vector<Record>(), &Table::find_range, start, end, filter);
 }
 
 Status Database::insert(
-    tableid_t id, prikey_t key, uint8_t const* value, int value_size
+    tableid_t id, prikey_t key, uint8_t const* value, int value_size,
+    trxid_t xid
 ) {
-    return wrapper(id, Status::FAILURE, &Table::insert, key, value, value_size);
+    if (xid != INVALID_TRXID && concurrency == Concurrency::OPTIMISTIC) {
+        return occ.insert(xid, id, key, value, value_size);
+    }
+    return wrapper(
+        id, Status::FAILURE, &Table::insert, key, value, value_size, xid);
 }
 
-Status Database::remove(tableid_t id, prikey_t key) {
-    return wrapper(id, Status::FAILURE, &Table::remove, key);
+Status Database::remove(tableid_t id, prikey_t key, trxid_t xid) {
+    if (xid != INVALID_TRXID && concurrency == Concurrency::OPTIMISTIC) {
+        return occ.remove(xid, id, key);
+    }
+    return wrapper(id, Status::FAILURE, &Table::remove, key, xid);
 }
 
 Status Database::update(tableid_t id, prikey_t key, Record const& record, trxid_t xid) {
+    if (xid != INVALID_TRXID && concurrency == Concurrency::OPTIMISTIC) {
+        return occ.update(xid, id, key, record);
+    }
     return wrapper(id, Status::FAILURE, &Table::update, key, record, xid);
 }
 
@@ -57,25 +108,60 @@ Table const* Database::operator[](tableid_t id) const {
     return tables.find(id);
 }
 
-trxid_t Database::begin_trx() {
+trxid_t Database::begin_trx(bool read_only) {
     if (sequential) {
         mtx.lock();
     }
 
-    return trxs.new_trx();
+    trxid_t id = trxs.new_trx(read_only);
+    if (concurrency == Concurrency::OPTIMISTIC) {
+        occ.begin(id, read_only);
+    } else {
+        versions.begin(id);
+    }
+    return id;
 }
 
 Status Database::end_trx(trxid_t id) {
     if (sequential) {
         mtx.unlock();
     }
+    CHECK_TRUE(trxs.trx_state(id) != TrxState::INVALID);
+    if (concurrency == Concurrency::OPTIMISTIC
+        && occ.commit(id) == Status::FAILURE
+    ) {
+        abort_trx(id);
+        return Status::FAILURE;
+    }
+
+    if (trxs.read_only(id)) {
+        // nothing to make durable
+        versions.commit(id);
+        return trxs.end_trx(id);
+    }
+
+    // commit is durable after the log is flushed with its group
+    if (logs.commit(logs.log_commit(id)) == Status::FAILURE) {
+        // not durable, roll back so that the waiters get the locks
+        abort_trx(id);
+        return Status::FAILURE;
+    }
+    // stamp versions before the locks are released
+    versions.commit(id);
+    Status res = trxs.end_trx(id);
+    logs.log_end(id);
     logs.remove_trxlog(id);
-    return trxs.end_trx(id);
+    return res;
 }
 
-Status Database::abort_trx(trxid_t id) {
-    Status res = trxs.abort_trx(id, *this);
-    logs.remove_trxlog(id);
+Status Database::abort_trx(trxid_t id, bool locked) {
+    occ.abort(id);
+    bool read_only = trxs.read_only(id);
+    Status res = trxs.abort_trx(id, *this, locked);
+    versions.abort(id);
+    if (!read_only) {
+        logs.remove_trxlog(id);
+    }
     return res;
 }
 
@@ -83,6 +169,39 @@ TrxState Database::trx_state(trxid_t id) {
     return trxs.trx_state(id);
 }
 
+RecoveryStats const& Database::recovery_stats() const {
+    return logs.recovery_stats();
+}
+
+Status Database::set_group_commit(size_t size, int wait) {
+    return logs.set_group_commit(size, wait);
+}
+
+GroupCommitStats Database::group_commit_stats() {
+    return logs.group_commit_stats();
+}
+
+Status Database::set_concurrency(Concurrency mode) {
+    concurrency = mode;
+    return Status::SUCCESS;
+}
+
+OccStats Database::occ_stats() const {
+    return occ.stats();
+}
+
+VersionStats Database::version_stats() {
+    return versions.stats();
+}
+
+Status Database::checkpoint() {
+    return logs.checkpoint(*this);
+}
+
+Status Database::set_escalation(size_t records, size_t pages) {
+    return locks.set_escalation(records, pages);
+}
+
 void Database::verbose(bool on) {
     tables.verbose(on);
 }
\ No newline at end of file
@@ -122,3 +122,8 @@ Status FileManager::page_write(pagenum_t pagenum, Page const& src) const {
     CHECK_TRUE(fpwrite(&src, sizeof(Page), pagenum * PAGE_SIZE, fp));
     return Status::SUCCESS;
 }
+
+Status FileManager::sync() const {
+    CHECK_TRUE(fpsync(fp));
+    return Status::SUCCESS;
+}
@@ -1,3 +1,4 @@
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "fileio.hpp"
@@ -7,8 +8,12 @@ int fexist(const char* filename) {
 }
 
 long fsize(FILE* fp) {
-    fseek(fp, 0, SEEK_END);
-    return ftell(fp);
+    // without moving file offset, thread-safe
+    struct stat info;
+    if (fflush(fp) != 0 || fstat(fileno(fp), &info) != 0) {
+        return -1;
+    }
+    return info.st_size;
 }
 
 int fresize(FILE* fp, size_t size) {
@@ -17,15 +22,19 @@ int fresize(FILE* fp, size_t size) {
 }
 
 int fpwrite(const void* ptr, size_t size, long pos, FILE* stream) {
-    fseek(stream, pos, SEEK_SET);
-    int retval = fwrite(ptr, size, 1, stream);
-    fflush(stream);
+    // positional write without user space buffer, thread-safe.
+    // pages are synchronized by the checkpoint, not by each page write
+    return pwrite(fileno(stream), ptr, size, pos)
+        == static_cast<ssize_t>(size);
+}
+
+int fpsync(FILE* stream) {
     // for synchronizing kernel level caching
-    fsync(fileno(stream));
-    return retval == 1;
+    return fflush(stream) == 0 && fsync(fileno(stream)) == 0;
 }
 
 int fpread(void* ptr, size_t size, long pos, FILE* stream) {
-    fseek(stream, pos, SEEK_SET);
-    return fread(ptr, size, 1, stream) == 1;
+    // positional read, concurrent reads do not share file offset
+    return pread(fileno(stream), ptr, size, pos)
+        == static_cast<ssize_t>(size);
 }
@@ -6,6 +6,8 @@ Status Page::init(uint32_t leaf) {
     header.number_of_keys = 0;
     header.parent_page_number = INVALID_PAGENUM;
     header.special_page_number = INVALID_PAGENUM;
+    // page frame may have garbage from the free page
+    header.page_lsn = INVALID_LSN;
     return Status::SUCCESS;
 }
 
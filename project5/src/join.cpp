@@ -1 +1,269 @@
-#include "join.hpp"
\ No newline at end of file
+#include <algorithm>
+#include <cstring>
+
+#include "join.hpp"
+
+namespace JoinOper {
+
+HashTable::HashTable() : chunks(), num_entries(0), buckets(), mask(0) {
+    // Do Nothing
+}
+
+size_t HashTable::hash(joinkey_t key) {
+    // finalizer of splitmix64, sequential keys are spread over the buckets
+    uint64_t x = static_cast<uint64_t>(key);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+void HashTable::append(joinkey_t key, Record const& record) {
+    size_t offset = num_entries % CHUNK_SIZE;
+    if (offset == 0) {
+        chunks.emplace_back(new Entry[CHUNK_SIZE]);
+    }
+    Entry& entry = chunks.back()[offset];
+    entry.key = key;
+    entry.next = nullptr;
+    std::memcpy(&entry.record, &record, sizeof(Record));
+    ++num_entries;
+}
+
+void HashTable::build() {
+    size_t num_buckets = 1;
+    while (num_buckets < num_entries) {
+        num_buckets <<= 1;
+    }
+    mask = num_buckets - 1;
+    buckets.assign(num_buckets, nullptr);
+
+    for (size_t i = 0; i < num_entries; ++i) {
+        Entry& entry = chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+        Entry*& head = buckets[hash(entry.key) & mask];
+        entry.next = head;
+        head = &entry;
+    }
+}
+
+Status HashTable::spill(FILE* fp) {
+    HashPartitions::Spilled spilled;
+    for (size_t i = 0; i < num_entries; ++i) {
+        Entry const& entry = chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+        spilled.key = entry.key;
+        std::memcpy(&spilled.record, &entry.record, sizeof(Record));
+        CHECK_TRUE(std::fwrite(&spilled, sizeof(spilled), 1, fp) == 1);
+    }
+    clear();
+    return Status::SUCCESS;
+}
+
+void HashTable::clear() {
+    chunks.clear();
+    buckets.clear();
+    num_entries = 0;
+    mask = 0;
+}
+
+size_t HashTable::size() const {
+    return num_entries;
+}
+
+size_t HashTable::memory() const {
+    return chunks.size() * CHUNK_SIZE * sizeof(Entry);
+}
+
+HashPartitions::HashPartitions(size_t budget)
+    : budget(budget), used(0), spill(false), tables()
+{
+    build_files.fill(nullptr);
+    probe_files.fill(nullptr);
+}
+
+HashPartitions::~HashPartitions() {
+    // temporary files are removed on close
+    for (size_t i = 0; i < NUM_PARTITIONS; ++i) {
+        if (build_files[i] != nullptr) {
+            std::fclose(build_files[i]);
+        }
+        if (probe_files[i] != nullptr) {
+            std::fclose(probe_files[i]);
+        }
+    }
+}
+
+Status HashPartitions::add_build(joinkey_t key, Record const& record) {
+    size_t idx = partition_of(key);
+    if (spill) {
+        return write(build_files[idx], key, record);
+    }
+
+    HashTable& table = tables[idx];
+    if (table.size() % HashTable::CHUNK_SIZE == 0) {
+        used += HashTable::CHUNK_SIZE * sizeof(HashTable::Entry);
+    }
+    table.append(key, record);
+    if (used <= budget) {
+        return Status::SUCCESS;
+    }
+
+    // over budget, move every partition to its file
+    spill = true;
+    for (size_t i = 0; i < NUM_PARTITIONS; ++i) {
+        if (tables[i].size() == 0) {
+            continue;
+        }
+        if (build_files[i] == nullptr) {
+            CHECK_NULL(build_files[i] = std::tmpfile());
+        }
+        CHECK_SUCCESS(tables[i].spill(build_files[i]));
+    }
+    used = 0;
+    return Status::SUCCESS;
+}
+
+Status HashPartitions::finish_build() {
+    if (!spill) {
+        for (HashTable& table : tables) {
+            table.build();
+        }
+    }
+    return Status::SUCCESS;
+}
+
+bool HashPartitions::spilled() const {
+    return spill;
+}
+
+Status HashPartitions::add_probe(joinkey_t key, Record const& record) {
+    size_t idx = partition_of(key);
+    if (build_files[idx] == nullptr) {
+        // nothing to match
+        return Status::SUCCESS;
+    }
+    return write(probe_files[idx], key, record);
+}
+
+size_t HashPartitions::partition_of(joinkey_t key) {
+    // buckets take the low bits, partitions take the high bits
+    return (HashTable::hash(key) >> 58) % NUM_PARTITIONS;
+}
+
+Status HashPartitions::write(
+    FILE*& file, joinkey_t key, Record const& record
+) {
+    if (file == nullptr) {
+        CHECK_NULL(file = std::tmpfile());
+    }
+    Spilled spilled;
+    spilled.key = key;
+    std::memcpy(&spilled.record, &record, sizeof(Record));
+    CHECK_TRUE(std::fwrite(&spilled, sizeof(Spilled), 1, file) == 1);
+    return Status::SUCCESS;
+}
+
+Status HashPartitions::load(size_t idx) {
+    HashTable& table = tables[idx];
+    table.clear();
+    FILE* fp = build_files[idx];
+    if (fp == nullptr) {
+        return Status::SUCCESS;
+    }
+
+    std::rewind(fp);
+    Spilled spilled;
+    while (std::fread(&spilled, sizeof(Spilled), 1, fp) == 1) {
+        table.append(spilled.key, spilled.record);
+    }
+    table.build();
+    return Status::SUCCESS;
+}
+
+LeafCursor::LeafCursor(Table const* table, prikey_t start, prikey_t end)
+    : iter(table->batches(start, end)), idx(0)
+{
+    // Do Nothing
+}
+
+bool LeafCursor::valid() const {
+    return iter.valid();
+}
+
+Record const& LeafCursor::record() const {
+    return iter.batch()[idx];
+}
+
+Status LeafCursor::next() {
+    if (++idx < iter.batch().size()) {
+        return Status::SUCCESS;
+    }
+    idx = 0;
+    return iter.next();
+}
+
+Status LeafCursor::seek(prikey_t key) {
+    if (!iter.valid() || key <= record().key) {
+        return Status::SUCCESS;
+    }
+    // binary search in the leaf, or the next leaf is sought
+    std::vector<Record> const& batch = iter.batch();
+    if (key <= batch.back().key) {
+        auto found = std::lower_bound(
+            batch.begin() + idx, batch.end(), key,
+            [](Record const& rec, prikey_t key) {
+                return rec.key < key;
+            });
+        idx = found - batch.begin();
+        return Status::SUCCESS;
+    }
+    idx = 0;
+    return iter.seek(key);
+}
+
+size_t merge_cost(pagenum_t pages1, pagenum_t pages2) {
+    return pages1 + pages2;
+}
+
+size_t nested_loop_cost(pagenum_t outer_pages, pagenum_t inner_pages) {
+    // full leaves, every page of the outer is assumed to be a leaf
+    size_t num_records = outer_pages * (BPTree::DEFAULT_LEAF_ORDER - 1);
+    size_t height = 1;
+    for (size_t reach = 1; reach < inner_pages;
+         reach *= BPTree::DEFAULT_INTERNAL_ORDER
+    ) {
+        ++height;
+    }
+    return outer_pages + num_records * height;
+}
+
+PrikeyJoin choose_join(pagenum_t pages1, pagenum_t pages2) {
+    size_t merge = merge_cost(pages1, pages2);
+    if (pages1 <= pages2 && nested_loop_cost(pages1, pages2) < merge) {
+        return PrikeyJoin::PROBE_RIGHT;
+    }
+    if (pages2 < pages1 && nested_loop_cost(pages2, pages1) < merge) {
+        return PrikeyJoin::PROBE_LEFT;
+    }
+    return PrikeyJoin::MERGE;
+}
+
+std::vector<prikey_t> split_ranges(
+    Table const* table1, Table const* table2, size_t num
+) {
+    std::vector<prikey_t> keys = table1->separators(num);
+    std::vector<prikey_t> keys2 = table2->separators(num);
+    keys.insert(keys.end(), keys2.begin(), keys2.end());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // evenly spaced separators, lower bound of the first range is minimum
+    std::vector<prikey_t> bounds(1, std::numeric_limits<prikey_t>::min());
+    size_t num_ranges = std::min(num, keys.size() + 1);
+    for (size_t i = 1; i < num_ranges; ++i) {
+        prikey_t key = keys[i * keys.size() / num_ranges];
+        if (key > bounds.back()) {
+            bounds.push_back(key);
+        }
+    }
+    return bounds;
+}
+}
@@ -6,6 +6,69 @@
 #include "utils.hpp"
 #include "xaction_manager.hpp"
 
+bool LockModes::compatible(LockMode held, LockMode req) {
+    switch (held) {
+    case LockMode::IDLE:
+        return true;
+    case LockMode::INTENTION_SHARED:
+        return req != LockMode::EXCLUSIVE;
+    case LockMode::INTENTION_EXCLUSIVE:
+        return req == LockMode::IDLE
+            || req == LockMode::INTENTION_SHARED
+            || req == LockMode::INTENTION_EXCLUSIVE;
+    case LockMode::SHARED:
+        return req == LockMode::IDLE
+            || req == LockMode::INTENTION_SHARED
+            || req == LockMode::SHARED;
+    default:
+        return req == LockMode::IDLE;
+    }
+}
+
+bool LockModes::covers(LockMode held, LockMode req) {
+    return held == req
+        || req == LockMode::IDLE
+        || held == LockMode::EXCLUSIVE
+        || (req == LockMode::INTENTION_SHARED && held != LockMode::IDLE)
+        || (req == LockMode::INTENTION_EXCLUSIVE
+            && held == LockMode::EXCLUSIVE);
+}
+
+LockMode LockModes::supremum(LockMode left, LockMode right) {
+    if (covers(left, right)) {
+        return left;
+    }
+    if (covers(right, left)) {
+        return right;
+    }
+    // shared + intention exclusive, no six mode
+    return LockMode::EXCLUSIVE;
+}
+
+LockMode LockModes::escalated(LockMode mode) {
+    switch (mode) {
+    case LockMode::INTENTION_SHARED:
+        return LockMode::SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+        return LockMode::EXCLUSIVE;
+    default:
+        return mode;
+    }
+}
+
+LockMode LockModes::intention(LockMode mode) {
+    switch (mode) {
+    case LockMode::SHARED:
+    case LockMode::INTENTION_SHARED:
+        return LockMode::INTENTION_SHARED;
+    case LockMode::EXCLUSIVE:
+    case LockMode::INTENTION_EXCLUSIVE:
+        return LockMode::INTENTION_EXCLUSIVE;
+    default:
+        return LockMode::IDLE;
+    }
+}
+
 HierarchicalID::HierarchicalID()
     : HierarchicalID(INVALID_TABLEID, INVALID_PAGENUM, 0)
 {
@@ -18,10 +81,50 @@ HierarchicalID::HierarchicalID(tableid_t tid, pagenum_t pid, size_t rid) :
     // Do Nothing
 }
 
+HierarchicalID HierarchicalID::table(tableid_t tid) {
+    return HierarchicalID(tid, INVALID_PAGENUM, WHOLE);
+}
+
+HierarchicalID HierarchicalID::page(tableid_t tid, pagenum_t pid) {
+    return HierarchicalID(tid, pid, WHOLE);
+}
+
+LockLevel HierarchicalID::level() const {
+    if (tid == INVALID_TABLEID) {
+        return LockLevel::INVALID;
+    }
+    if (rid != WHOLE) {
+        return LockLevel::RECORD;
+    }
+    if (pid != INVALID_PAGENUM) {
+        return LockLevel::PAGE;
+    }
+    return LockLevel::TABLE;
+}
+
+HierarchicalID HierarchicalID::parent() const {
+    switch (level()) {
+    case LockLevel::RECORD:
+        return page(tid, pid);
+    case LockLevel::PAGE:
+        return table(tid);
+    default:
+        return HierarchicalID();
+    }
+}
+
 HashableID HierarchicalID::make_hashable() const {
     return HashableID(utils::token, tid, pid, rid);
 }
 
+std::size_t HierarchicalID::hash() const {
+    // boost style hash combine
+    std::size_t seed = std::hash<tableid_t>{}(tid);
+    seed ^= std::hash<pagenum_t>{}(pid) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<size_t>{}(rid) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
 bool HierarchicalID::operator<(HierarchicalID const& other) const {
     return tid < other.tid
         || (tid == other.tid && pid < other.pid)
@@ -33,25 +136,29 @@ bool HierarchicalID::operator==(HierarchicalID const& other) const {
 }
 
 Lock::Lock()
-    : hid(), mode(LockMode::IDLE)
+    : hid(), mode(LockMode::IDLE), upgrade(LockMode::IDLE)
     , xid(INVALID_TRXID), backref(nullptr), wait_flag(false)
+    , prev(nullptr), next(nullptr), queue(nullptr)
 {
     // Do Nothing
 }
 
 Lock::Lock(HID hid, LockMode mode, Transaction* backref)
-    : hid(hid), mode(mode)
+    : hid(hid), mode(mode), upgrade(LockMode::IDLE)
     , xid(backref->get_id()), backref(backref), wait_flag(false)
+    , prev(nullptr), next(nullptr), queue(nullptr)
 {
     // Do Nothing
 }
 
 Lock::Lock(Lock&& lock) noexcept
-    : hid(lock.hid), mode(lock.mode)
+    : hid(lock.hid), mode(lock.mode), upgrade(lock.upgrade)
     , xid(lock.xid), backref(lock.backref), wait_flag(lock.wait_flag.load())
+    , prev(nullptr), next(nullptr), queue(nullptr)
 {
     lock.hid = HID();
     lock.mode = LockMode::IDLE;
+    lock.upgrade = LockMode::IDLE;
     lock.xid = INVALID_TRXID;
     lock.backref = nullptr;
     lock.wait_flag = false;
@@ -60,12 +167,14 @@ Lock::Lock(Lock&& lock) noexcept
 Lock& Lock::operator=(Lock&& lock) noexcept {
     hid = lock.hid;
     mode = lock.mode;
+    upgrade = lock.upgrade;
     xid = lock.xid;
     backref = lock.backref;
     wait_flag = lock.wait_flag.load();
 
     lock.hid = HID();
     lock.mode = LockMode::IDLE;
+    lock.upgrade = LockMode::IDLE;
     lock.xid = INVALID_TRXID;
     lock.backref = nullptr;
     lock.wait_flag = false;
@@ -108,30 +217,149 @@ Status Lock::run() {
     return Status::SUCCESS;
 }
 
+LockQueue::iterator::iterator(Lock* lock) : lock(lock) {
+    // Do Nothing
+}
+
+auto LockQueue::iterator::operator*() const -> reference {
+    return lock;
+}
+
+auto LockQueue::iterator::operator++() -> iterator& {
+    lock = lock->next;
+    return *this;
+}
+
+auto LockQueue::iterator::operator++(int) -> iterator {
+    iterator iter = *this;
+    lock = lock->next;
+    return iter;
+}
+
+bool LockQueue::iterator::operator==(iterator const& other) const {
+    return lock == other.lock;
+}
+
+bool LockQueue::iterator::operator!=(iterator const& other) const {
+    return lock != other.lock;
+}
+
+LockQueue::LockQueue() : head(nullptr), tail(nullptr), num(0) {
+    // Do Nothing
+}
+
+size_t LockQueue::size() const {
+    return num;
+}
+
+bool LockQueue::empty() const {
+    return num == 0;
+}
+
+Lock* LockQueue::front() const {
+    return head;
+}
+
+Lock* LockQueue::back() const {
+    return tail;
+}
+
+void LockQueue::push_front(Lock* lock) {
+    lock->prev = nullptr;
+    lock->next = head;
+    lock->queue = this;
+    if (head == nullptr) {
+        tail = lock;
+    } else {
+        head->prev = lock;
+    }
+    head = lock;
+    ++num;
+}
+
+void LockQueue::push_back(Lock* lock) {
+    lock->prev = tail;
+    lock->next = nullptr;
+    lock->queue = this;
+    if (tail == nullptr) {
+        head = lock;
+    } else {
+        tail->next = lock;
+    }
+    tail = lock;
+    ++num;
+}
+
+auto LockQueue::erase(Lock* lock) -> iterator {
+    Lock* next = lock->next;
+    if (lock->prev == nullptr) {
+        head = next;
+    } else {
+        lock->prev->next = next;
+    }
+    if (next == nullptr) {
+        tail = lock->prev;
+    } else {
+        next->prev = lock->prev;
+    }
+    lock->prev = nullptr;
+    lock->next = nullptr;
+    lock->queue = nullptr;
+    --num;
+    return iterator(next);
+}
+
+auto LockQueue::begin() const -> iterator {
+    return iterator(head);
+}
+
+auto LockQueue::end() const -> iterator {
+    return iterator(nullptr);
+}
+
 LockManager::LockStruct::LockStruct() :
-    mode(LockMode::IDLE), run(), wait()
+    mode(LockMode::IDLE), run(), wait(), upgrading(0)
 {
     // Do Nothing
 }
 
 LockManager::LockManager() :
-    mtx(), locks(), detector(), db(nullptr)
+    mtx(), locks(), detector(), db(nullptr),
+    records_per_page(DEFAULT_RECORD_ESCALATION),
+    pages_per_table(DEFAULT_PAGE_ESCALATION)
 {
     // Do Nothing
 }
 
-std::shared_ptr<Lock> LockManager::require_lock(
+LockManager::~LockManager() {
+    for (auto& pair : locks) {
+        LockStruct& module = pair.second;
+        while (!module.run.empty()) {
+            Lock* lock = module.run.front();
+            module.run.erase(lock);
+            allocator_t::destroy(lock);
+        }
+        // waiting locks are owned by the waiters
+        while (!module.wait.empty()) {
+            module.wait.erase(module.wait.front());
+        }
+    }
+}
+
+Lock* LockManager::require_lock(
     Transaction* backref, HID hid, LockMode mode
 ) {
-    HashableID id = hid.make_hashable();
-    auto new_lock = std::make_shared<Lock>(hid, mode, backref);
+    Lock* new_lock = allocator_t::create(hid, mode, backref);
 
     std::unique_lock<std::mutex> own(mtx);
 
-    auto iter = locks.find(id);
-    if (iter == locks.end() || lockable(iter->second, new_lock)) {
-        LockStruct& module = locks[id];
-        module.mode = mode;
+    // pending upgrades have priority over the new requests
+    auto iter = locks.find(hid);
+    if (iter == locks.end()
+        || (iter->second.upgrading == 0 && lockable(iter->second, new_lock))
+    ) {
+        LockStruct& module = iter == locks.end() ? locks[hid] : iter->second;
+        module.mode = LockModes::supremum(module.mode, mode);
         module.run.push_front(new_lock);
         return new_lock;
     }
@@ -140,7 +368,7 @@ std::shared_ptr<Lock> LockManager::require_lock(
     backref->state = TrxState::WAITING;
 
     new_lock->wait();
-    locks[id].wait.push_back(new_lock);
+    iter->second.wait.push_back(new_lock);
 
     own.unlock();
 
@@ -150,66 +378,123 @@ std::shared_ptr<Lock> LockManager::require_lock(
         if (--selfcheck == 0) {
             selfcheck = 10;
             std::unique_lock<std::mutex> inner(mtx);
-            auto& target = locks[id].run.front();
-            if (db->trx_state(target->get_xid()) == TrxState::INVALID) {
-                release_lock(target, false);
+            auto& run = locks[hid].run;
+            if (run.size() > 0 && new_lock->stop()) {
+                Lock* target = run.front();
+                if (db->trx_state(target->get_xid()) == TrxState::INVALID) {
+                    release_lock(target, false);
+                }
             }
         }
         std::this_thread::yield();
     }
 
     // module updates are already occurred in release_lock because of deadlock
+    own.lock();
+    if (new_lock->queue == nullptr) {
+        // released while waiting, waiter owns the lock
+        allocator_t::destroy(new_lock);
+        return nullptr;
+    }
     return new_lock;
 }
 
-Status LockManager::release_lock(std::shared_ptr<Lock> lock, bool acquire) {
+Status LockManager::upgrade_lock(Lock* lock, LockMode mode) {
+    std::unique_lock<std::mutex> own(mtx);
+    HID hid = lock->get_hid();
+    auto iter = locks.find(hid);
+    CHECK_TRUE(iter != locks.end() && lock->queue == &iter->second.run);
+
+    LockStruct& module = iter->second;
+    lock->upgrade = mode;
+    if (upgradable(module, lock)) {
+        lock->mode = LockModes::supremum(lock->mode, mode);
+        lock->upgrade = LockMode::IDLE;
+        module.mode = LockModes::supremum(module.mode, lock->mode);
+        return Status::SUCCESS;
+    }
+
+    // keep the granted mode while waiting, no moment without isolation
+    ++module.upgrading;
+    lock->get_backref().state = TrxState::WAITING;
+    lock->wait();
+    own.unlock();
+
+    int selfcheck = 10;
+    while (lock->stop()) {
+        detect_and_release();
+        if (--selfcheck == 0) {
+            selfcheck = 10;
+            std::unique_lock<std::mutex> inner(mtx);
+            auto& run = locks[hid].run;
+            for (Lock* target : run) {
+                if (target != lock && lock->stop()
+                    && db->trx_state(target->get_xid()) == TrxState::INVALID
+                ) {
+                    release_lock(target, false);
+                    break;
+                }
+            }
+        }
+        std::this_thread::yield();
+    }
+
+    own.lock();
+    if (lock->queue == nullptr) {
+        // released while waiting, upgrader owns the lock
+        allocator_t::destroy(lock);
+        return Status::FAILURE;
+    }
+    return Status::SUCCESS;
+}
+
+Status LockManager::release_lock(Lock* lock, bool acquire) {
     std::unique_lock<std::mutex> own(mtx, std::defer_lock);
     if (acquire) {
         own.lock();
     }
 
-    HashableID hid = lock->get_hid().make_hashable();
-    auto iter = locks.find(hid);
+    auto iter = locks.find(lock->get_hid());
     CHECK_TRUE(iter != locks.end());
 
     LockStruct& module = iter->second;
-    auto found = std::find(module.run.begin(), module.run.end(), lock);
-    if (found != module.run.end()) {
-        module.run.erase(found);
+    if (lock->queue == &module.run) {
+        module.run.erase(lock);
+        if (lock->upgrade == LockMode::IDLE) {
+            allocator_t::destroy(lock);
+        } else {
+            // upgrader wakes up and returns the lock to the pool
+            --module.upgrading;
+            lock->upgrade = LockMode::IDLE;
+            lock->run();
+        }
     } else {
-        module.wait.remove(lock);
+        // waiter wakes up and returns the lock to the pool
+        module.wait.erase(lock);
         lock->run();
     }
 
-    Transaction& backref = lock->get_backref();
-
-    if (module.run.size() > 0) {
+    module.mode = running_mode(module);
+    if (module.run.empty() && module.wait.empty()) {
+        locks.erase(iter);
         return Status::SUCCESS;
     }
 
-    if (module.wait.size() == 0) {
-        locks.erase(iter);
+    grant_upgrades(module);
+    if (module.upgrading > 0) {
         return Status::SUCCESS;
     }
 
-    if (module.wait.front()->get_mode() == LockMode::SHARED) {
-        module.mode = LockMode::SHARED;
-        for (auto iter = module.wait.begin(); iter != module.wait.end();) {
-            lock = *iter;
-            if (lock->get_mode() != LockMode::SHARED) {
-                ++iter;
-                continue;
-            }
-
-            iter = module.wait.erase(iter);
-            module.run.push_front(lock);
-            lock->run();
+    // grant all waiting locks compatible with running ones
+    for (auto iter = module.wait.begin(); iter != module.wait.end();) {
+        lock = *iter;
+        if (!lockable(module, lock)) {
+            ++iter;
+            continue;
         }
-    } else {
-        module.mode = LockMode::EXCLUSIVE;
 
-        lock = module.wait.front();
-        module.wait.pop_front();
+        iter = module.wait.erase(lock);
+        module.mode = LockModes::supremum(module.mode, lock->get_mode());
         module.run.push_front(lock);
         lock->run();
     }
@@ -228,7 +513,7 @@ Status LockManager::detect_and_release() {
     CHECK_TRUE(found.size() > 0);
 
     for (trxid_t xid : found) {
-        CHECK_SUCCESS(db->abort_trx(xid));
+        CHECK_SUCCESS(db->abort_trx(xid, true));
     }
     return Status::SUCCESS;
 }
@@ -238,12 +523,73 @@ Status LockManager::set_database(Database& db) {
     return Status::SUCCESS;
 }
 
+Status LockManager::set_escalation(size_t records, size_t pages) {
+    records_per_page = records;
+    pages_per_table = pages;
+    return Status::SUCCESS;
+}
+
+size_t LockManager::record_escalation() const {
+    return records_per_page;
+}
+
+size_t LockManager::page_escalation() const {
+    return pages_per_table;
+}
+
 bool LockManager::lockable(
-    LockStruct const& module, std::shared_ptr<Lock> const& target
+    LockStruct const& module, Lock const* target
+) const {
+    LockMode mode = target->get_mode();
+    if (LockModes::compatible(module.mode, mode)) {
+        return true;
+    }
+    // lock conversion, only other transactions are considered
+    for (Lock const* lock : module.run) {
+        if (lock->get_xid() != target->get_xid()
+            && !LockModes::compatible(lock->get_mode(), mode)
+        ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LockManager::upgradable(
+    LockStruct const& module, Lock const* target
 ) const {
-    return module.mode == LockMode::IDLE
-        || (module.mode == LockMode::SHARED
-            && target->get_mode() == LockMode::SHARED);
+    for (Lock const* lock : module.run) {
+        if (lock->get_xid() != target->get_xid()
+            && !LockModes::compatible(lock->get_mode(), target->upgrade)
+        ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LockManager::grant_upgrades(LockStruct& module) {
+    if (module.upgrading == 0) {
+        return;
+    }
+    for (Lock* lock : module.run) {
+        if (lock->upgrade == LockMode::IDLE || !upgradable(module, lock)) {
+            continue;
+        }
+        lock->mode = LockModes::supremum(lock->mode, lock->upgrade);
+        lock->upgrade = LockMode::IDLE;
+        module.mode = LockModes::supremum(module.mode, lock->mode);
+        --module.upgrading;
+        lock->run();
+    }
+}
+
+LockMode LockManager::running_mode(LockStruct const& module) {
+    LockMode mode = LockMode::IDLE;
+    for (Lock const* lock : module.run) {
+        mode = LockModes::supremum(mode, lock->get_mode());
+    }
+    return mode;
 }
 
 int LockManager::DeadlockDetector::Node::refcount() const {
@@ -348,14 +694,37 @@ auto LockManager::DeadlockDetector::construct_graph(
 
     for (auto const& iter : locks) {
         auto const& module = iter.second;
-        for (auto const& wait_lock : module.wait) {
+        for (Lock const* wait_lock : module.wait) {
             trxid_t wait_xid = wait_lock->get_backref().get_id();
-            for (auto const& run_lock : module.run) {
+            for (Lock const* run_lock : module.run) {
                 trxid_t run_xid = run_lock->get_backref().get_id();
+                // lock conversion does not wait for itself
+                if (run_xid == wait_xid) {
+                    continue;
+                }
                 graph[run_xid].prev_id.insert(wait_xid);
                 graph[wait_xid].next_id.insert(run_xid);
             }
         }
+        if (module.upgrading == 0) {
+            continue;
+        }
+        // upgrader waits for the conflicting holders, including upgraders
+        for (Lock const* up_lock : module.run) {
+            if (up_lock->upgrade == LockMode::IDLE) {
+                continue;
+            }
+            trxid_t up_xid = up_lock->get_xid();
+            for (Lock const* run_lock : module.run) {
+                trxid_t run_xid = run_lock->get_xid();
+                if (run_xid == up_xid || LockModes::compatible(
+                        run_lock->get_mode(), up_lock->upgrade)) {
+                    continue;
+                }
+                graph[run_xid].prev_id.insert(up_xid);
+                graph[up_xid].next_id.insert(run_xid);
+            }
+        }
     }
 
     return graph;
@@ -1,11 +1,21 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
+#include <fstream>
+#include <set>
+#include <thread>
 
+#include "buffer_manager.hpp"
+#include "dbms.hpp"
+#include "fileio.hpp"
 #include "log_manager.hpp"
 
 /// WARNING: INVALID_TRXID should be 0.
 Log::Log()
     : lsn(0), prev_lsn(0), xid(0), type(LogType::INVALID)
-    , hid(), offset(-1), before(), after()
+    , hid(), offset(-1), before(), after(), undo_next(INVALID_LSN)
+    , delta_offset(0), delta_length(0), images()
 {
     // Do Nothing
 }
@@ -13,6 +23,7 @@ Log::Log()
 Log::Log(
     lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type
 ) : lsn(lsn), prev_lsn(prev_lsn), xid(xid), type(type), hid(), offset(-1)
+  , undo_next(INVALID_LSN), delta_offset(0), delta_length(0)
 {
     // Do Nothing
 }
@@ -21,21 +32,164 @@ Log::Log(
     lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
     HID hid, int offset, Record const& before, Record const& after
 ) : lsn(lsn), prev_lsn(prev_lsn), xid(xid), type(type),
-    hid(hid), offset(offset) {
+    hid(hid), offset(offset), undo_next(INVALID_LSN) {
     std::memcpy(&this->before, &before, sizeof(Record));
     std::memcpy(&this->after, &after, sizeof(Record));
+
+    // only the bytes between the first and the last difference are logged
+    int first = 0;
+    int last = sizeof(Record::value);
+    while (first < last && before.value[first] == after.value[first]) {
+        ++first;
+    }
+    while (last > first && before.value[last - 1] == after.value[last - 1]) {
+        --last;
+    }
+    delta_offset = first;
+    delta_length = last - first;
+}
+
+Log::Log(
+    lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+    HID hid, int offset, Record const& before, Record const& after,
+    lsn_t undo_next
+) : Log(lsn, prev_lsn, xid, type, hid, offset, before, after) {
+    this->undo_next = undo_next;
+}
+
+Log::Log(
+    lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+    HID hid, lsn_t undo_next
+) : Log(lsn, prev_lsn, xid, type) {
+    this->hid = hid;
+    this->undo_next = undo_next;
+}
+
+Log::Log(
+    lsn_t lsn, lsn_t prev_lsn, trxid_t xid, LogType type,
+    HID hid, std::shared_ptr<std::vector<uint8_t> const> images
+) : Log(lsn, prev_lsn, xid, type) {
+    this->hid = hid;
+    this->offset = static_cast<int>(images->size() / IMAGE_SIZE);
+    this->images = std::move(images);
 }
 
-LogManager::LogManager() : mtx(), last_lsn(0), log_map() {
+double RecoveryStats::redo_throughput() const {
+    return redo_time > 0 ? num_redo / redo_time : 0;
+}
+
+bool Log::undoable() const {
+    return type == LogType::UPDATE
+        || type == LogType::INSERT
+        || type == LogType::DELETE;
+}
+
+bool Log::compensation() const {
+    return type == LogType::CLR
+        || type == LogType::CLR_INSERT
+        || type == LogType::CLR_DELETE;
+}
+
+bool Log::logical() const {
+    return type == LogType::INSERT
+        || type == LogType::DELETE
+        || type == LogType::CLR_INSERT
+        || type == LogType::CLR_DELETE;
+}
+
+double GroupCommitStats::avg_group() const {
+    return num_groups > 0 ? static_cast<double>(num_commits) / num_groups : 0;
+}
+
+LogManager::LogManager()
+    : mtx(), last_lsn(0), drained_lsn(0), flushed_lsn(0)
+    , ring(new Slot[BUFFER_SIZE]()), shards(), fp(nullptr), filename()
+    , staging(), offsets(), file_end(0), archive(), archive_base(1), catalog()
+    , master_lsn(INVALID_LSN), ckpt_lsn(INVALID_LSN), checkpointer()
+    , ckpt_mtx(), ckpt_cv(), ckpt_running(false)
+    , group_mtx(), group_cv(), forming(), group_flushing(false)
+    , group_size(GROUP_SIZE), group_wait(0), group_stats()
+    , redo_workers(
+        std::max(1u, std::min(8u, std::thread::hardware_concurrency())))
+    , stats()
+{
     // Do Nothing
 }
 
+LogManager::~LogManager() {
+    stop_checkpointer();
+    if (fp != nullptr) {
+        flush_all();
+        fclose(fp);
+        fp = nullptr;
+    }
+}
+
+Status LogManager::open(std::string const& filename) {
+    std::unique_lock<std::mutex> own(mtx);
+    CHECK_TRUE(fp == nullptr && last_lsn == 0);
+    if (fexist(filename.c_str())) {
+        CHECK_NULL(fp = fopen(filename.c_str(), "r+"));
+    } else {
+        CHECK_NULL(fp = fopen(filename.c_str(), "w+"));
+    }
+    this->filename = filename;
+
+    // drop partially written logs
+    lsn_t num_logs = scan_logs();
+    CHECK_TRUE(fresize(fp, file_end));
+    last_lsn = drained_lsn = flushed_lsn = ckpt_lsn = num_logs;
+
+    std::ifstream stream(filename + ".catalog");
+    tableid_t tid;
+    std::string name;
+    while (stream >> tid && std::getline(stream >> std::ws, name)) {
+        catalog[tid] = name;
+    }
+
+    // master record is valid only if the checkpoint was written
+    std::ifstream master(filename + ".master");
+    if (master >> master_lsn && master_lsn > num_logs) {
+        master_lsn = INVALID_LSN;
+    }
+    return Status::SUCCESS;
+}
+
+bool LogManager::durable() const {
+    return fp != nullptr;
+}
+
 lsn_t LogManager::log_update(
     trxid_t xid, HID hid, int offset, Record const& before, Record const& after
 ) {
     return wrapper(xid, LogType::UPDATE, hid, offset, before, after);
 }
 
+lsn_t LogManager::log_insert(
+    trxid_t xid, HID hid, int offset, Record const& record
+) {
+    // images are compared with empty record, only value is logged
+    Record empty = Record();
+    empty.key = record.key;
+    return wrapper(xid, LogType::INSERT, hid, offset, empty, record);
+}
+
+lsn_t LogManager::log_delete(
+    trxid_t xid, HID hid, int offset, Record const& record
+) {
+    Record empty = Record();
+    empty.key = record.key;
+    return wrapper(xid, LogType::DELETE, hid, offset, record, empty);
+}
+
+lsn_t LogManager::log_clr(
+    trxid_t xid, HID hid, int offset,
+    Record const& before, Record const& after, lsn_t undo_next
+) {
+    return wrapper(
+        xid, LogType::CLR, hid, offset, before, after, undo_next);
+}
+
 lsn_t LogManager::log_abort(trxid_t xid) {
     return wrapper(xid, LogType::ABORT);
 }
@@ -48,20 +202,1044 @@ lsn_t LogManager::log_end(trxid_t xid) {
     return wrapper(xid, LogType::END);
 }
 
+Status LogManager::log_pages(
+    Database& dbms, tableid_t tid, std::vector<pagenum_t> const& pages
+) {
+    FileManager* file = dbms.tables.find_file(tid);
+    CHECK_NULL(file);
+    auto images = std::make_shared<std::vector<uint8_t>>(
+        pages.size() * Log::IMAGE_SIZE);
+    Status res = Status::SUCCESS;
+    for (size_t i = 0; i < pages.size() && res == Status::SUCCESS; ++i) {
+        uint8_t* entry = images->data() + i * Log::IMAGE_SIZE;
+        std::memcpy(entry, &pages[i], sizeof(pagenum_t));
+        Ubuffer buffer = dbms.buffers.buffering(*file, pages[i]);
+        res = buffer.buffer() == nullptr
+            ? Status::FAILURE
+            : buffer.read_void([&](Page const& page) {
+                std::memcpy(entry + sizeof(pagenum_t), &page, sizeof(Page));
+            });
+    }
+    if (res == Status::FAILURE) {
+        // partial structure could not be redone, nothing is logged
+        dbms.buffers.release_held(*file, pages, INVALID_LSN);
+        return Status::FAILURE;
+    }
+
+    // pages are stamped after the log is published,
+    // writing back the stamped page waits for the log
+    lsn_t lsn = get_lsn();
+    for (size_t i = 0; i < pages.size(); ++i) {
+        std::memcpy(
+            images->data() + i * Log::IMAGE_SIZE + sizeof(pagenum_t)
+                + offsetof(PageHeader, page_lsn),
+            &lsn, sizeof(lsn_t));
+    }
+    publish(lsn, INVALID_LSN, INVALID_TRXID,
+            LogType::PAGE, HID::table(tid), std::move(images));
+    return dbms.buffers.release_held(*file, pages, lsn);
+}
+
 std::list<Log> LogManager::get_logs(trxid_t xid) {
+    std::list<Log> logs;
+    lsn_t lsn = INVALID_LSN;
+    {
+        Shard& shard = shard_of(xid);
+        std::unique_lock<std::mutex> own(shard.mtx);
+        auto iter = shard.chains.find(xid);
+        if (iter == shard.chains.end()) {
+            return logs;
+        }
+        lsn = iter->second.last;
+    }
+
     std::unique_lock<std::mutex> own(mtx);
-    return std::move(log_map[xid]);
+    if (drain_until(own, lsn) != Status::SUCCESS) {
+        return logs;
+    }
+    while (lsn != INVALID_LSN) {
+        logs.emplace_back();
+        if (read_log(lsn, &logs.back()) != Status::SUCCESS) {
+            logs.pop_back();
+            break;
+        }
+        lsn = logs.back().prev_lsn;
+    }
+    return logs;
 }
 
 Status LogManager::remove_trxlog(trxid_t xid) {
-    std::unique_lock<std::mutex> lock(mtx);
-    return log_map.erase(xid) > 0
+    Shard& shard = shard_of(xid);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    return shard.chains.erase(xid) > 0
         ? Status::SUCCESS : Status::FAILURE;
 }
 
+Status LogManager::flush(lsn_t lsn) {
+    if (fp == nullptr || lsn <= flushed_lsn.load()) {
+        return Status::SUCCESS;
+    }
+    std::unique_lock<std::mutex> own(mtx);
+    if (lsn <= flushed_lsn) {
+        return Status::SUCCESS;
+    }
+    CHECK_SUCCESS(drain_until(own, lsn));
+    CHECK_TRUE(fpsync(fp));
+    flushed_lsn = drained_lsn.load();
+    return Status::SUCCESS;
+}
+
+Status LogManager::flush_all() {
+    if (fp == nullptr) {
+        return Status::SUCCESS;
+    }
+    return flush(last_lsn.load());
+}
+
+Status LogManager::commit(lsn_t lsn) {
+    if (fp == nullptr) {
+        return Status::SUCCESS;
+    }
+    std::unique_lock<std::mutex> own(group_mtx);
+    if (forming == nullptr) {
+        forming = std::make_shared<Group>(
+            Group{ INVALID_LSN, 0, false, Status::SUCCESS });
+    }
+    std::shared_ptr<Group> group = forming;
+    group->lsn = std::max(group->lsn, lsn);
+    bool leader = group->size++ == 0;
+
+    if (!leader) {
+        if (group->size >= group_size) {
+            group_cv.notify_all();
+        }
+        group_cv.wait(own, [&] { return group->done; });
+        return group->status;
+    }
+
+    // followers keep joining while the previous group is flushed
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::microseconds(group_wait);
+    group_cv.wait(own, [&] { return !group_flushing; });
+    group_cv.wait_until(own, deadline, [&] {
+        return group->size >= group_size;
+    });
+    forming = nullptr;
+    group_flushing = true;
+
+    own.unlock();
+    Status res = flush(group->lsn);
+    own.lock();
+
+    group_flushing = false;
+    group->done = true;
+    group->status = res;
+    ++group_stats.num_groups;
+    group_stats.num_commits += group->size;
+    group_stats.max_group = std::max(group_stats.max_group, group->size);
+    group_cv.notify_all();
+    return res;
+}
+
+Status LogManager::set_group_commit(size_t size, int wait) {
+    CHECK_TRUE(size > 0 && wait >= 0);
+    std::unique_lock<std::mutex> own(group_mtx);
+    group_size = size;
+    group_wait = wait;
+    return Status::SUCCESS;
+}
+
+GroupCommitStats LogManager::group_commit_stats() {
+    std::unique_lock<std::mutex> own(group_mtx);
+    return group_stats;
+}
+
+Status LogManager::register_table(
+    tableid_t tid, std::string const& filename
+) {
+    std::unique_lock<std::mutex> own(mtx);
+    if (fp == nullptr) {
+        return Status::SUCCESS;
+    }
+
+    auto iter = catalog.find(tid);
+    if (iter != catalog.end() && iter->second == filename) {
+        return Status::SUCCESS;
+    }
+    catalog[tid] = filename;
+
+    FILE* cfp = fopen((this->filename + ".catalog").c_str(), "a");
+    CHECK_NULL(cfp);
+    int res = fprintf(cfp, "%d %s\n", tid, filename.c_str()) > 0
+        && fpsync(cfp);
+    fclose(cfp);
+    CHECK_TRUE(res);
+    return Status::SUCCESS;
+}
+
+Status LogManager::rollback(Database& dbms, Log const& log) {
+    CHECK_TRUE(log.undoable());
+    return apply(dbms, log, true);
+}
+
+Status LogManager::rollback(Database& dbms, std::list<Log> const& logs) {
+    std::vector<Log const*> run;
+    for (Log const& log : logs) {
+        if (!log.undoable()) {
+            continue;
+        }
+        if (log.type == LogType::UPDATE) {
+            run.push_back(&log);
+            continue;
+        }
+        // structural change, updates after it are undone first
+        CHECK_SUCCESS(undo_updates(dbms, run));
+        run.clear();
+        CHECK_SUCCESS(rollback(dbms, log));
+    }
+    return undo_updates(dbms, run);
+}
+
+Status LogManager::recovery(Database& dbms) {
+    using clock = std::chrono::steady_clock;
+    auto begin = clock::now();
+    stats = RecoveryStats();
+
+    lsn_t start = INVALID_LSN;
+    std::vector<Log> logs;
+    std::map<tableid_t, std::string> tables;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        CHECK_TRUE(fp != nullptr);
+        start = master_lsn == INVALID_LSN ? 1 : master_lsn;
+        logs = read_logs(start);
+        tables = catalog;
+    }
+    for (auto const& pair : tables) {
+        dbms.open_table(pair.second);
+    }
+    // logs about the tables which do not exist anymore are ignored
+    auto exist = [&](Log const& log) {
+        return dbms.tables.find_file(log.hid.tid) != nullptr;
+    };
+    // logs before the checkpoint are read from the log file
+    auto fetch = [&](lsn_t lsn, Log* log) {
+        if (lsn >= start) {
+            CHECK_TRUE(lsn - start < logs.size());
+            *log = logs[lsn - start];
+            return Status::SUCCESS;
+        }
+        std::unique_lock<std::mutex> own(mtx);
+        return read_log(lsn, log);
+    };
+
+    // analysis, transactions which do not reach the end and dirty pages
+    std::map<trxid_t, lsn_t> losers;
+    std::set<trxid_t> winners;
+    std::set<trxid_t> ended;
+    std::map<HID, lsn_t> dirty;
+    for (Log const& log : logs) {
+        switch (log.type) {
+        case LogType::COMMIT:
+            losers.erase(log.xid);
+            winners.insert(log.xid);
+            break;
+        case LogType::END:
+            losers.erase(log.xid);
+            winners.erase(log.xid);
+            ended.insert(log.xid);
+            break;
+        case LogType::UPDATE:
+        case LogType::CLR:
+            dirty.emplace(HID::page(log.hid.tid, log.hid.pid), log.lsn);
+            losers[log.xid] = log.lsn;
+            break;
+        case LogType::INSERT:
+        case LogType::DELETE:
+        case LogType::CLR_INSERT:
+        case LogType::CLR_DELETE:
+        case LogType::ABORT:
+            losers[log.xid] = log.lsn;
+            break;
+        case LogType::CKPT_DPT: {
+            auto iter = dirty.find(log.hid);
+            if (iter == dirty.end() || iter->second > log.undo_next) {
+                dirty[log.hid] = log.undo_next;
+            }
+            break;
+        }
+        case LogType::CKPT_ATT: {
+            // transaction table is fuzzy, already finished trx may appear
+            Log last;
+            if (ended.count(log.xid) > 0 || winners.count(log.xid) > 0) {
+                break;
+            }
+            CHECK_SUCCESS(fetch(log.undo_next, &last));
+            if (last.type == LogType::COMMIT) {
+                winners.insert(log.xid);
+            } else if (last.type != LogType::END
+                && losers[log.xid] < log.undo_next
+            ) {
+                losers[log.xid] = log.undo_next;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // redo, repeating history from the oldest recLSN
+    lsn_t redo_lsn = start;
+    for (auto const& pair : dirty) {
+        redo_lsn = std::min(redo_lsn, pair.second);
+    }
+    if (redo_lsn < start) {
+        std::vector<Log> prefix;
+        {
+            std::unique_lock<std::mutex> own(mtx);
+            prefix = read_logs(redo_lsn);
+        }
+        prefix.resize(std::min<size_t>(prefix.size(), start - redo_lsn));
+        logs.insert(logs.begin(), prefix.begin(), prefix.end());
+        start = redo_lsn;
+    }
+    stats.num_logs = logs.size();
+
+    auto redo_begin = clock::now();
+    CHECK_SUCCESS(redo(dbms, logs, dirty));
+    stats.redo_time = std::chrono::duration<double>(
+        clock::now() - redo_begin).count();
+
+    // undo, rollback losers from the most recent log
+    std::set<lsn_t> to_undo;
+    for (auto const& pair : losers) {
+        to_undo.insert(pair.second);
+        // compensation logs continue the chain of the loser
+        Shard& shard = shard_of(pair.first);
+        std::unique_lock<std::mutex> own(shard.mtx);
+        shard.chains[pair.first] = Chain{ pair.second, pair.second };
+    }
+    while (!to_undo.empty()) {
+        lsn_t lsn = *to_undo.rbegin();
+        to_undo.erase(lsn);
+
+        Log log;
+        CHECK_SUCCESS(fetch(lsn, &log));
+        lsn_t next = log.prev_lsn;
+        if (log.undoable() && exist(log)) {
+            CHECK_SUCCESS(rollback(dbms, log));
+            ++stats.num_undo;
+        } else if (log.compensation()) {
+            next = log.undo_next;
+        }
+
+        if (next == INVALID_LSN) {
+            log_end(log.xid);
+            remove_trxlog(log.xid);
+        } else {
+            to_undo.insert(next);
+        }
+    }
+
+    for (trxid_t xid : winners) {
+        log_end(xid);
+        remove_trxlog(xid);
+    }
+    CHECK_SUCCESS(flush_all());
+    stats.total_time = std::chrono::duration<double>(
+        clock::now() - begin).count();
+    return Status::SUCCESS;
+}
+
+Status LogManager::set_redo_workers(size_t num) {
+    CHECK_TRUE(num > 0);
+    redo_workers = num;
+    return Status::SUCCESS;
+}
+
+RecoveryStats const& LogManager::recovery_stats() const {
+    return stats;
+}
+
+Status LogManager::checkpoint(Database& dbms) {
+    std::unique_lock<std::mutex> own(ckpt_mtx);
+    return write_checkpoint(dbms);
+}
+
+Status LogManager::undo_updates(
+    Database& dbms, std::vector<Log const*>& run
+) {
+    if (run.empty()) {
+        return Status::SUCCESS;
+    }
+    trxid_t xid = run.front()->xid;
+    lsn_t last_next = run.back()->prev_lsn;
+    // restart undo resumes from the most recent log which is not undone,
+    // logs below it could be undone twice, before images are idempotent
+    std::set<lsn_t> remaining;
+    for (Log const* log : run) {
+        remaining.insert(log->lsn);
+    }
+    auto undo_next = [&](Log const& log) {
+        remaining.erase(log.lsn);
+        return remaining.empty() ? last_next : *remaining.rbegin();
+    };
+
+    // same page in a row, the most recent log first for the same key
+    std::stable_sort(run.begin(), run.end(), [](Log const* a, Log const* b) {
+        return a->hid.tid != b->hid.tid
+            ? a->hid.tid < b->hid.tid
+            : a->before.key < b->before.key;
+    });
+
+    // compensate the logs at once, page is null if there is nothing to restore
+    auto compensate = [&](
+        size_t begin, size_t end, Page* page, pagenum_t leaf, int* offsets
+    ) {
+        lsn_t prev_lsn;
+        lsn_t lsn = reserve_chain(xid, end - begin, prev_lsn);
+        for (size_t i = begin; i < end; ++i, ++lsn) {
+            Log const& log = *run[i];
+            int offset = page == nullptr ? -1 : offsets[i - begin];
+            HID hid = log.hid;
+            if (offset >= 0) {
+                replay(*page, offset, log, true, lsn);
+                hid = HID(log.hid.tid, leaf, offset);
+            }
+            publish(lsn, prev_lsn, xid, LogType::CLR, hid,
+                    offset >= 0 ? offset : log.offset,
+                    log.after, log.before, undo_next(log));
+            prev_lsn = lsn;
+        }
+    };
+
+    std::vector<int> offsets;
+    size_t begin = 0;
+    while (begin < run.size()) {
+        tableid_t tid = run[begin]->hid.tid;
+        size_t end = begin;
+        Table const* table = dbms.tables.find(tid);
+        if (table != nullptr) {
+            table->bpt.write_leaf_page(
+                run[begin]->before.key, [&](Page& page, pagenum_t leaf) {
+                    // take the following keys while they are in the leaf
+                    offsets.clear();
+                    for (end = begin;
+                         end < run.size() && run[end]->hid.tid == tid;
+                         ++end
+                    ) {
+                        int offset = locate(page, *run[end]);
+                        if (offset < 0 && end > begin) {
+                            break;
+                        }
+                        offsets.push_back(offset);
+                    }
+                    compensate(begin, end, &page, leaf, offsets.data());
+                });
+        }
+        if (end == begin) {
+            // undo should be logged even if there is nothing to restore
+            end = begin + 1;
+            compensate(begin, end, nullptr, INVALID_PAGENUM, nullptr);
+        }
+        begin = end;
+    }
+    return Status::SUCCESS;
+}
+
+lsn_t LogManager::reserve_chain(trxid_t xid, size_t num, lsn_t& prev_lsn) {
+    Shard& shard = shard_of(xid);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    lsn_t lsn = last_lsn.fetch_add(num) + 1;
+    lsn_t last = lsn + num - 1;
+    auto iter = shard.chains.find(xid);
+    if (iter == shard.chains.end()) {
+        prev_lsn = INVALID_LSN;
+        shard.chains.emplace(xid, Chain{ lsn, last });
+    } else {
+        prev_lsn = iter->second.last;
+        iter->second.last = last;
+    }
+    return lsn;
+}
+
+Status LogManager::write_checkpoint(Database& dbms) {
+    CHECK_TRUE(fp != nullptr);
+    // nothing happened after the last checkpoint
+    if (last_lsn == ckpt_lsn) {
+        return Status::SUCCESS;
+    }
+
+    lsn_t begin = publish(get_lsn(), INVALID_LSN, INVALID_TRXID,
+                          LogType::BEGIN_CKPT);
+    // tables are collected after begin, updates before it are included
+    for (DirtyPage const& page : dbms.buffers.dirty_pages()) {
+        HID hid = HID::page(TableManager::convert(page.fileid), page.pagenum);
+        publish(get_lsn(), INVALID_LSN, INVALID_TRXID,
+                LogType::CKPT_DPT, hid, page.rec_lsn);
+    }
+    for (Shard& shard : shards) {
+        std::unique_lock<std::mutex> own(shard.mtx);
+        for (auto const& pair : shard.chains) {
+            publish(get_lsn(), INVALID_LSN, pair.first,
+                    LogType::CKPT_ATT, HID(), pair.second.last);
+        }
+    }
+    // pages written back before the dirty page table are out of it,
+    // they should be durable before the redo point passes their updates
+    CHECK_SUCCESS(dbms.buffers.sync_files());
+    lsn_t end = publish(get_lsn(), INVALID_LSN, INVALID_TRXID,
+                        LogType::END_CKPT, HID(), begin);
+
+    CHECK_SUCCESS(flush(end));
+    CHECK_SUCCESS(write_master(begin));
+    ckpt_lsn = end;
+    return Status::SUCCESS;
+}
+
+Status LogManager::start_checkpointer(Database& dbms, int interval) {
+    std::unique_lock<std::mutex> own(ckpt_mtx);
+    CHECK_TRUE(fp != nullptr && !ckpt_running && interval > 0);
+    ckpt_running = true;
+    checkpointer = std::thread([this, &dbms, interval] {
+        std::unique_lock<std::mutex> own(ckpt_mtx);
+        auto period = std::chrono::milliseconds(interval);
+        while (!ckpt_cv.wait_for(own, period, [&] { return !ckpt_running; })) {
+            // write back the oldest pages for advancing redo point
+            dbms.buffers.flush_dirty(FLUSH_BATCH);
+            write_checkpoint(dbms);
+        }
+    });
+    return Status::SUCCESS;
+}
+
+Status LogManager::stop_checkpointer() {
+    {
+        std::unique_lock<std::mutex> own(ckpt_mtx);
+        if (!ckpt_running) {
+            return Status::SUCCESS;
+        }
+        ckpt_running = false;
+    }
+    ckpt_cv.notify_all();
+    checkpointer.join();
+    return Status::SUCCESS;
+}
+
 lsn_t LogManager::get_lsn() {
-    if (++last_lsn == 0) {
-        ++last_lsn;
+    return last_lsn.fetch_add(1) + 1;
+}
+
+LogManager::Shard& LogManager::shard_of(trxid_t xid) {
+    return shards[static_cast<size_t>(xid) % NUM_SHARDS];
+}
+
+LogManager::Slot& LogManager::reserve(lsn_t lsn) {
+    // slot is reusable after the previous log in it is drained
+    while (lsn > drained_lsn.load(std::memory_order_acquire) + BUFFER_SIZE) {
+        std::unique_lock<std::mutex> own(mtx, std::try_to_lock);
+        if (own.owns_lock()) {
+            drain_buffer();
+        } else {
+            std::this_thread::yield();
+        }
     }
-    return last_lsn;
+    return ring[lsn % BUFFER_SIZE];
+}
+
+Status LogManager::drain_buffer() {
+    lsn_t start = drained_lsn.load() + 1;
+    lsn_t end = start;
+    size_t num_offsets = offsets.size();
+    staging.clear();
+    // stop at the log which is not published yet
+    for (;; ++end) {
+        Slot& slot = ring[end % BUFFER_SIZE];
+        if (slot.lsn.load(std::memory_order_acquire) != end) {
+            break;
+        }
+        if (fp != nullptr) {
+            size_t used = staging.size();
+            staging.resize(used + packed_size(slot.log));
+            pack(slot.log, staging.data() + used);
+            offsets.push_back(file_end + used);
+        } else {
+            archive.push_back(slot.log);
+        }
+    }
+    if (end == start) {
+        return Status::SUCCESS;
+    }
+
+    if (fp != nullptr) {
+        // logs are contiguous, write them at once
+        if (!fpwrite(staging.data(), staging.size(), file_end, fp)) {
+            offsets.resize(num_offsets);
+            return Status::FAILURE;
+        }
+        file_end += staging.size();
+    }
+    drained_lsn.store(end - 1, std::memory_order_release);
+
+    if (fp == nullptr && archive.size() > BUFFER_SIZE) {
+        trim_archive();
+    }
+    return Status::SUCCESS;
+}
+
+Status LogManager::drain_until(std::unique_lock<std::mutex>& own, lsn_t lsn) {
+    lsn = std::min(lsn, last_lsn.load());
+    while (drained_lsn < lsn) {
+        CHECK_SUCCESS(drain_buffer());
+        if (drained_lsn < lsn) {
+            // wait for the writers copying their logs
+            own.unlock();
+            std::this_thread::yield();
+            own.lock();
+        }
+    }
+    return Status::SUCCESS;
+}
+
+Status LogManager::read_log(lsn_t lsn, Log* log) {
+    CHECK_TRUE(lsn != INVALID_LSN && lsn <= drained_lsn);
+    if (fp != nullptr) {
+        long offset = offset_of(lsn);
+        std::vector<uint8_t> data(offset_of(lsn + 1) - offset);
+        CHECK_TRUE(fpread(data.data(), data.size(), offset, fp));
+        CHECK_TRUE(unpack(data.data(), data.size(), log) == data.size()
+            && log->lsn == lsn);
+        return Status::SUCCESS;
+    }
+    CHECK_TRUE(archive_base <= lsn);
+    *log = archive[lsn - archive_base];
+    return Status::SUCCESS;
+}
+
+void LogManager::trim_archive() {
+    // transactions which start after this point do not need archive
+    lsn_t oldest = last_lsn.load() + 1;
+    for (Shard& shard : shards) {
+        std::unique_lock<std::mutex> own(shard.mtx);
+        for (auto const& pair : shard.chains) {
+            oldest = std::min(oldest, pair.second.first);
+        }
+    }
+    while (!archive.empty() && archive_base < oldest) {
+        archive.pop_front();
+        ++archive_base;
+    }
+}
+
+std::vector<Log> LogManager::read_logs(lsn_t from) {
+    if (from == INVALID_LSN || offsets.size() < from) {
+        return std::vector<Log>();
+    }
+    long begin = offset_of(from);
+    std::vector<uint8_t> data(file_end - begin);
+    if (!fpread(data.data(), data.size(), begin, fp)) {
+        return std::vector<Log>();
+    }
+
+    std::vector<Log> logs(offsets.size() - (from - 1));
+    size_t pos = 0;
+    for (size_t i = 0; i < logs.size(); ++i) {
+        size_t used = unpack(data.data() + pos, data.size() - pos, &logs[i]);
+        if (used == 0 || logs[i].lsn != from + i) {
+            logs.resize(i);
+            break;
+        }
+        pos += used;
+    }
+    return logs;
+}
+
+lsn_t LogManager::scan_logs() {
+    offsets.clear();
+    file_end = 0;
+    std::vector<uint8_t> data(fsize(fp));
+    if (!fpread(data.data(), data.size(), 0, fp)) {
+        return 0;
+    }
+
+    // stop at the first broken log
+    Log log;
+    size_t used;
+    while ((used = unpack(
+                data.data() + file_end, data.size() - file_end, &log)) > 0
+        && log.lsn == offsets.size() + 1
+    ) {
+        offsets.push_back(file_end);
+        file_end += used;
+    }
+    return offsets.size();
+}
+
+size_t LogManager::packed_size(Log const& log) {
+    if (log.type == LogType::PAGE) {
+        return sizeof(PackedLog) + log.images->size();
+    }
+    bool record = log.undoable() || log.compensation();
+    return sizeof(PackedLog) + (record ? 2 * log.delta_length : 0);
+}
+
+size_t LogManager::pack(Log const& log, uint8_t* out) {
+    // checkpoint and transaction logs do not have record images
+    bool record = log.undoable() || log.compensation();
+    PackedLog packed;
+    packed.lsn = log.lsn;
+    packed.prev_lsn = log.prev_lsn;
+    packed.undo_next = log.undo_next;
+    packed.pid = log.hid.pid;
+    packed.rid = log.hid.rid;
+    packed.key = record ? log.before.key : 0;
+    packed.xid = log.xid;
+    packed.tid = log.hid.tid;
+    packed.offset = log.offset;
+    packed.type = static_cast<uint8_t>(log.type);
+    packed.delta_offset = record ? log.delta_offset : 0;
+    packed.delta_length = record ? log.delta_length : 0;
+    packed.reserved = 0;
+
+    size_t length = packed.delta_length;
+    std::memcpy(out, &packed, sizeof(PackedLog));
+    out += sizeof(PackedLog);
+    if (log.type == LogType::PAGE) {
+        std::memcpy(out, log.images->data(), log.images->size());
+        return sizeof(PackedLog) + log.images->size();
+    }
+    std::memcpy(out, log.before.value + packed.delta_offset, length);
+    std::memcpy(out + length, log.after.value + packed.delta_offset, length);
+    return sizeof(PackedLog) + 2 * length;
+}
+
+size_t LogManager::unpack(uint8_t const* data, size_t size, Log* log) {
+    PackedLog packed;
+    if (size < sizeof(PackedLog)) {
+        return 0;
+    }
+    std::memcpy(&packed, data, sizeof(PackedLog));
+    size_t length = packed.delta_length;
+    size_t total = sizeof(PackedLog) + 2 * length;
+    size_t num_images = 0;
+    if (static_cast<LogType>(packed.type) == LogType::PAGE) {
+        num_images = std::max(packed.offset, 0);
+        total += num_images * Log::IMAGE_SIZE;
+    }
+    if (packed.lsn == INVALID_LSN || size < total
+        || packed.delta_offset + length > sizeof(Record::value)
+    ) {
+        return 0;
+    }
+
+    // bytes out of the changed range are not logged, left zero
+    *log = Log();
+    log->lsn = packed.lsn;
+    log->prev_lsn = packed.prev_lsn;
+    log->xid = packed.xid;
+    log->type = static_cast<LogType>(packed.type);
+    log->hid = HID(packed.tid, packed.pid, packed.rid);
+    log->offset = packed.offset;
+    log->before.key = log->after.key = packed.key;
+    log->undo_next = packed.undo_next;
+    log->delta_offset = packed.delta_offset;
+    log->delta_length = packed.delta_length;
+
+    data += sizeof(PackedLog);
+    if (num_images > 0) {
+        log->images = std::make_shared<std::vector<uint8_t>>(
+            data, data + num_images * Log::IMAGE_SIZE);
+        return total;
+    }
+    std::memcpy(log->before.value + packed.delta_offset, data, length);
+    std::memcpy(log->after.value + packed.delta_offset, data + length, length);
+    return total;
+}
+
+long LogManager::offset_of(lsn_t lsn) const {
+    return static_cast<long>(
+        lsn - 1 < offsets.size() ? offsets[lsn - 1] : file_end);
+}
+
+Status LogManager::redo(
+    Database& dbms, std::vector<Log> const& logs,
+    std::map<HID, lsn_t> const& dirty
+) {
+    // logs which are not reflected on the flushed pages
+    auto redoable = [&](Log const& log) {
+        auto iter = dirty.find(HID::page(log.hid.tid, log.hid.pid));
+        return iter != dirty.end() && iter->second <= log.lsn;
+    };
+
+    CHECK_SUCCESS(redo_images(dbms, logs));
+
+    // records move on insert and delete, so the logical logs are barriers
+    // applied in lsn order, and the updates between them are replayed
+    // by page in parallel
+    std::vector<Log const*> updates;
+    for (Log const& log : logs) {
+        if (log.logical()) {
+            CHECK_SUCCESS(redo_pages(dbms, updates));
+            updates.clear();
+            CHECK_SUCCESS(apply(dbms, log, false));
+            ++stats.num_redo;
+        } else if ((log.type == LogType::UPDATE || log.type == LogType::CLR)
+            && redoable(log)
+        ) {
+            updates.push_back(&log);
+        }
+    }
+    return redo_pages(dbms, updates);
+}
+
+Status LogManager::redo_images(
+    Database& dbms, std::vector<Log> const& logs
+) {
+    // pages of a structure modification are logged at once, so the latest
+    // images make the consistent tree, and the records moved by them are
+    // out of the logical logs before
+    std::map<HID, std::pair<lsn_t, uint8_t const*>> latest;
+    for (Log const& log : logs) {
+        if (log.type != LogType::PAGE) {
+            continue;
+        }
+        for (int i = 0; i < log.offset; ++i) {
+            uint8_t const* entry = log.images->data() + i * Log::IMAGE_SIZE;
+            pagenum_t pagenum;
+            std::memcpy(&pagenum, entry, sizeof(pagenum_t));
+            latest[HID::page(log.hid.tid, pagenum)] =
+                std::make_pair(log.lsn, entry + sizeof(pagenum_t));
+        }
+    }
+
+    for (auto const& pair : latest) {
+        // logs about the tables which do not exist anymore are ignored
+        FileManager* file = dbms.tables.find_file(pair.first.tid);
+        if (file == nullptr) {
+            continue;
+        }
+        lsn_t lsn = pair.second.first;
+        bool created = false;
+        Ubuffer buffer = dbms.buffers.buffering(*file, pair.first.pid);
+        if (buffer.buffer() == nullptr) {
+            // page was not written to the file before crash
+            buffer = dbms.buffers.buffering(*file, pair.first.pid, true);
+            CHECK_NULL(buffer.buffer());
+            created = true;
+        }
+        CHECK_SUCCESS(buffer.write_void([&](Page& page) {
+            if (created || page.page_header().page_lsn < lsn) {
+                std::memcpy(&page, pair.second.second, sizeof(Page));
+            }
+        }));
+    }
+    return Status::SUCCESS;
+}
+
+Status LogManager::redo_pages(
+    Database& dbms, std::vector<Log const*> const& logs
+) {
+    // logs of the same page in lsn order
+    struct RedoPage {
+        HID hid;
+        FileManager* file;
+        std::vector<Log const*> logs;
+    };
+    std::vector<RedoPage> pages;
+    std::unordered_map<HID, size_t> index;
+    for (Log const* log : logs) {
+        HID hid = HID::page(log->hid.tid, log->hid.pid);
+        auto found = index.find(hid);
+        if (found == index.end()) {
+            // logs about the tables which do not exist anymore are ignored
+            FileManager* file = dbms.tables.find_file(hid.tid);
+            if (file == nullptr) {
+                continue;
+            }
+            found = index.emplace(hid, pages.size()).first;
+            pages.push_back(RedoPage{ hid, file, std::vector<Log const*>() });
+        }
+        pages[found->second].logs.push_back(log);
+        ++stats.num_redo;
+    }
+    if (pages.empty()) {
+        return Status::SUCCESS;
+    }
+
+    // partition by page, so per-page order is preserved
+    size_t num_workers = std::min(redo_workers, pages.size());
+    stats.num_workers = std::max(stats.num_workers, num_workers);
+    std::vector<std::vector<size_t>> partitions(num_workers);
+    for (size_t i = 0; i < pages.size(); ++i) {
+        partitions[pages[i].hid.hash() % num_workers].push_back(i);
+    }
+
+    // prefetch in the order which workers consume the pages
+    std::vector<size_t> order;
+    for (size_t round = 0; order.size() < pages.size(); ++round) {
+        for (auto const& partition : partitions) {
+            if (round < partition.size()) {
+                order.push_back(partition[round]);
+            }
+        }
+    }
+    size_t window = std::max(1, dbms.buffers.get_capacity() / 2);
+    std::atomic<size_t> done(0);
+    std::atomic<bool> failed(false);
+    std::thread prefetcher([&] {
+        for (size_t i = 0; i < order.size() && !failed; ++i) {
+            // do not evict the pages which are not replayed yet
+            while (i >= done + window && !failed) {
+                std::this_thread::yield();
+            }
+            RedoPage const& page = pages[order[i]];
+            dbms.buffers.prefetch(*page.file, page.hid.pid);
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (auto const& partition : partitions) {
+        workers.emplace_back([&] {
+            for (size_t idx : partition) {
+                RedoPage const& page = pages[idx];
+                Ubuffer buffer =
+                    dbms.buffers.buffering(*page.file, page.hid.pid);
+                // page was not allocated before crash
+                if (buffer.buffer() != nullptr
+                    && buffer.write_void([&](Page& frame) {
+                        for (Log const* log : page.logs) {
+                            replay(frame, locate(frame, *log),
+                                   *log, false, log->lsn);
+                        }
+                    }) == Status::FAILURE
+                ) {
+                    failed = true;
+                }
+                ++done;
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    prefetcher.join();
+    return failed ? Status::FAILURE : Status::SUCCESS;
+}
+
+int LogManager::locate(Page const& page, Log const& log) {
+    PageHeader const& header = page.page_header();
+    if (!header.is_leaf) {
+        return -1;
+    }
+    int num_key = header.number_of_keys;
+    Record const* records = page.records();
+    if (log.offset >= 0 && log.offset < num_key
+        && records[log.offset].key == log.before.key
+    ) {
+        return log.offset;
+    }
+    for (int i = 0; i < num_key; ++i) {
+        if (records[i].key == log.before.key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void LogManager::replay(
+    Page& page, int offset, Log const& log, bool undo, lsn_t lsn
+) {
+    Record const& image = undo ? log.before : log.after;
+    PageHeader& header = page.page_header();
+    // skip if already applied or the record was moved
+    if (header.page_lsn >= lsn
+        || !header.is_leaf
+        || offset < 0
+        || offset >= static_cast<int>(header.number_of_keys)
+        || page.records()[offset].key != image.key
+    ) {
+        return;
+    }
+    std::memcpy(
+        page.records()[offset].value + log.delta_offset,
+        image.value + log.delta_offset, log.delta_length);
+    header.page_lsn = lsn;
+}
+
+Status LogManager::apply(Database& dbms, Log const& log, bool undo) {
+    LogType clr = LogType::CLR;
+    if (log.type == LogType::INSERT) {
+        clr = LogType::CLR_DELETE;
+    } else if (log.type == LogType::DELETE) {
+        clr = LogType::CLR_INSERT;
+    }
+    bool compensated = false;
+    auto compensate = [&](HID hid, int offset) {
+        compensated = true;
+        return wrapper(log.xid, clr, hid, offset,
+                       log.after, log.before, log.prev_lsn);
+    };
+    BPTree::logger_t logger;
+    if (undo) {
+        logger = [&](HID hid, int offset, Record const&) {
+            return compensate(hid, offset);
+        };
+    } else {
+        // leaf is stamped as if the log is written again
+        logger = [&](HID, int, Record const&) {
+            return log.lsn;
+        };
+    }
+
+    // records could be moved after the log was written, find them by key
+    Table const* table = dbms.tables.find(log.hid.tid);
+    if (table != nullptr) {
+        BPTree const& tree = table->bpt;
+        Record const& image = undo ? log.before : log.after;
+        // leaf already reflects the log, records could be moved there
+        // by the structure modification redone with the page images
+        if (!undo && log.logical() && tree.leaf_lsn(image.key) >= log.lsn) {
+            return Status::SUCCESS;
+        }
+        switch (undo ? clr : log.type) {
+        case LogType::UPDATE:
+        case LogType::CLR:
+            tree.write_leaf(image.key, [&](Page& page, HID hid, int offset) {
+                replay(page, offset, log, undo,
+                       undo ? compensate(hid, offset) : log.lsn);
+            });
+            break;
+        case LogType::INSERT:
+        case LogType::CLR_INSERT:
+            // already exists if applied
+            tree.insert_record(image, logger);
+            break;
+        case LogType::DELETE:
+        case LogType::CLR_DELETE:
+            tree.remove_record(image.key, logger);
+            break;
+        default:
+            return Status::FAILURE;
+        }
+    }
+
+    // undo should be logged even if there is nothing to restore
+    if (undo && !compensated) {
+        compensate(log.hid, log.offset);
+    }
+    return Status::SUCCESS;
+}
+
+Status LogManager::write_master(lsn_t lsn) {
+    // replace master record atomically
+    std::string temp = filename + ".master.tmp";
+    FILE* mfp = fopen(temp.c_str(), "w");
+    CHECK_NULL(mfp);
+    int res = fprintf(mfp, "%zu\n", lsn) > 0 && fpsync(mfp);
+    fclose(mfp);
+    CHECK_TRUE(res);
+    CHECK_TRUE(std::rename(temp.c_str(), (filename + ".master").c_str()) == 0);
+    master_lsn = lsn;
+    return Status::SUCCESS;
 }
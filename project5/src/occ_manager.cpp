@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "dbms.hpp"
+#include "occ_manager.hpp"
+
+OccManager::OccManager()
+    : dbms(nullptr), mtx(), active()
+    , words(std::make_unique<std::atomic<uint64_t>[]>(NUM_WORDS))
+    , num_commits(0), num_conflicts(0)
+{
+    for (size_t i = 0; i < NUM_WORDS; ++i) {
+        words[i] = 0;
+    }
+}
+
+Status OccManager::set_database(Database& db) {
+    dbms = &db;
+    return Status::SUCCESS;
+}
+
+Status OccManager::begin(trxid_t xid, bool read_only) {
+    std::unique_lock<std::mutex> own(mtx);
+    Context& context = active[xid];
+    context = Context();
+    context.read_only = read_only;
+    return Status::SUCCESS;
+}
+
+Status OccManager::find(
+    trxid_t xid, tableid_t tid, prikey_t key, Record* record
+) {
+    Context* context = context_of(xid);
+    CHECK_NULL(context);
+
+    recid_t id(tid, key);
+    auto iter = context->writes.find(id);
+    if (iter == context->writes.end()) {
+        return stable_read(*context, id, record);
+    }
+    if (iter->second.op == Op::DELETE) {
+        return Status::FAILURE;
+    }
+    if (record != nullptr) {
+        std::memcpy(record, &iter->second.record, sizeof(Record));
+    }
+    return Status::SUCCESS;
+}
+
+Status OccManager::insert(
+    trxid_t xid, tableid_t tid, prikey_t key,
+    uint8_t const* value, int value_size
+) {
+    Context* context = context_of(xid);
+    CHECK_NULL(context);
+    CHECK_TRUE(!context->read_only);
+    CHECK_NULL((*dbms)[tid]);
+
+    Record record = Record();
+    CHECK_SUCCESS(BPTree::write_record(record, key, value, value_size));
+
+    recid_t id(tid, key);
+    auto iter = context->writes.find(id);
+    if (iter != context->writes.end()) {
+        // reinsert deleted record
+        CHECK_TRUE(iter->second.op == Op::DELETE);
+        iter->second = Write{ Op::UPDATE, record };
+        return Status::SUCCESS;
+    }
+
+    CHECK_TRUE(stable_read(*context, id, nullptr) == Status::FAILURE);
+    context->writes.emplace(id, Write{ Op::INSERT, record });
+    return Status::SUCCESS;
+}
+
+Status OccManager::remove(trxid_t xid, tableid_t tid, prikey_t key) {
+    Context* context = context_of(xid);
+    CHECK_NULL(context);
+    CHECK_TRUE(!context->read_only);
+
+    recid_t id(tid, key);
+    auto iter = context->writes.find(id);
+    if (iter != context->writes.end()) {
+        CHECK_TRUE(iter->second.op != Op::DELETE);
+        if (iter->second.op == Op::INSERT) {
+            // absence is still validated by the read set
+            context->writes.erase(iter);
+        } else {
+            iter->second.op = Op::DELETE;
+        }
+        return Status::SUCCESS;
+    }
+
+    Record record;
+    CHECK_SUCCESS(stable_read(*context, id, &record));
+    context->writes.emplace(id, Write{ Op::DELETE, record });
+    return Status::SUCCESS;
+}
+
+Status OccManager::update(
+    trxid_t xid, tableid_t tid, prikey_t key, Record const& record
+) {
+    Context* context = context_of(xid);
+    CHECK_NULL(context);
+    CHECK_TRUE(!context->read_only);
+
+    recid_t id(tid, key);
+    auto iter = context->writes.find(id);
+    if (iter != context->writes.end()) {
+        CHECK_TRUE(iter->second.op != Op::DELETE);
+    } else {
+        CHECK_SUCCESS(stable_read(*context, id, nullptr));
+        iter = context->writes.emplace(id, Write{ Op::UPDATE, record }).first;
+    }
+    std::memcpy(&iter->second.record, &record, sizeof(Record));
+    iter->second.record.key = key;
+    return Status::SUCCESS;
+}
+
+Status OccManager::commit(trxid_t xid) {
+    Context context;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        auto iter = active.find(xid);
+        if (iter == active.end()) {
+            return Status::SUCCESS;
+        }
+        context = std::move(iter->second);
+        active.erase(iter);
+    }
+
+    // phase 1. lock the words of the write set in address order, free from
+    // deadlock, colliding records are locked once
+    std::vector<std::atomic<uint64_t>*> locked;
+    for (auto const& pair : context.writes) {
+        locked.push_back(&word_of(pair.first));
+    }
+    std::sort(locked.begin(), locked.end());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+    for (std::atomic<uint64_t>* word : locked) {
+        uint64_t value = word->load();
+        while ((value & LOCKED)
+            || !word->compare_exchange_weak(value, value | LOCKED)
+        ) {
+            std::this_thread::yield();
+            value = word->load();
+        }
+    }
+
+    // phase 2. validate the read set
+    bool valid = true;
+    for (auto const& pair : context.reads) {
+        std::atomic<uint64_t>* word = &word_of(pair.first);
+        uint64_t value = word->load();
+        bool own = std::binary_search(locked.begin(), locked.end(), word);
+        if ((value & ~LOCKED) != pair.second
+            || ((value & LOCKED) && !own)
+        ) {
+            valid = false;
+            break;
+        }
+    }
+
+    // phase 3. install the writes
+    Status res = Status::SUCCESS;
+    if (valid) {
+        for (auto const& pair : context.writes) {
+            if (install(xid, pair.first, pair.second) == Status::FAILURE) {
+                // restore installed writes before they become visible
+                dbms->trxs.abort_trx(xid, *dbms);
+                res = Status::FAILURE;
+                break;
+            }
+        }
+    } else {
+        ++num_conflicts;
+        res = Status::FAILURE;
+    }
+
+    // new version for the written records, readers can detect the change
+    uint64_t step = valid ? 2 : 0;
+    for (std::atomic<uint64_t>* word : locked) {
+        word->store((word->load() & ~LOCKED) + step);
+    }
+    if (res == Status::SUCCESS) {
+        ++num_commits;
+    }
+    return res;
+}
+
+Status OccManager::abort(trxid_t xid) {
+    std::unique_lock<std::mutex> own(mtx);
+    active.erase(xid);
+    return Status::SUCCESS;
+}
+
+OccStats OccManager::stats() const {
+    return OccStats{ num_commits.load(), num_conflicts.load() };
+}
+
+OccManager::Context* OccManager::context_of(trxid_t xid) {
+    std::unique_lock<std::mutex> own(mtx);
+    auto iter = active.find(xid);
+    if (iter == active.end()) {
+        return nullptr;
+    }
+    return &iter->second;
+}
+
+std::atomic<uint64_t>& OccManager::word_of(recid_t const& id) {
+    // mix the high bits down, sequential keys spread over the words
+    uint64_t hash = RecordHash{}(id) * 0x9E3779B97F4A7C15ull;
+    return words[(hash >> 32) & (NUM_WORDS - 1)];
+}
+
+Status OccManager::stable_read(
+    Context& context, recid_t const& id, Record* record
+) {
+    std::atomic<uint64_t>& word = word_of(id);
+    Record temp;
+    Status res;
+    while (true) {
+        uint64_t version = word.load();
+        if (version & LOCKED) {
+            std::this_thread::yield();
+            continue;
+        }
+        res = dbms->find(id.first, id.second, &temp);
+        if (word.load() == version) {
+            context.reads.emplace(id, version);
+            break;
+        }
+    }
+
+    if (res == Status::SUCCESS && record != nullptr) {
+        std::memcpy(record, &temp, sizeof(Record));
+    }
+    return res;
+}
+
+Status OccManager::install(
+    trxid_t xid, recid_t const& id, Write const& write
+) {
+    Table const* table = dbms->tables.find(id.first);
+    CHECK_NULL(table);
+    BPTree const& tree = table->bpt;
+    switch (write.op) {
+    case Op::UPDATE:
+        return tree.write_leaf(id.second, [&](Page& page, HID hid, int offset) {
+            Record& rec = page.records()[offset];
+            page.page_header().page_lsn = dbms->logs.log_update(
+                xid, hid, offset, rec, write.record);
+            std::memcpy(
+                rec.value, write.record.value,
+                sizeof(Record) - sizeof(prikey_t));
+        });
+    case Op::INSERT:
+        return tree.insert_record(
+            write.record, [&](HID hid, int offset, Record const& rec) {
+                return dbms->logs.log_insert(xid, hid, offset, rec);
+            });
+    case Op::DELETE:
+        return tree.remove_record(
+            id.second, [&](HID hid, int offset, Record const& rec) {
+                return dbms->logs.log_delete(xid, hid, offset, rec);
+            });
+    }
+    return Status::FAILURE;
+}
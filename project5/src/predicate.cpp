@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstring>
+
+#include "predicate.hpp"
+
+Predicate::Predicate() : terms() {
+    // Do Nothing
+}
+
+Status Predicate::bytes(
+    size_t offset, std::string const& operand, CompareOp op
+) {
+    CHECK_TRUE(offset <= sizeof(Record::value));
+    CHECK_TRUE(operand.size() <= sizeof(Record::value) - offset);
+
+    Term term;
+    term.kind = Kind::BYTES;
+    term.op = op;
+    term.offset = offset;
+    term.length = operand.size();
+    term.integer = 0;
+    std::memcpy(term.bytes, operand.data(), operand.size());
+    terms.push_back(term);
+    return Status::SUCCESS;
+}
+
+Status Predicate::prefix(std::string const& prefix) {
+    return bytes(0, prefix, CompareOp::EQ);
+}
+
+Status Predicate::integer(
+    size_t offset, CompareOp op, int64_t operand, size_t width
+) {
+    CHECK_TRUE(width == 1 || width == 2 || width == 4 || width == 8);
+    CHECK_TRUE(offset <= sizeof(Record::value) - width);
+
+    Term term;
+    term.kind = Kind::INTEGER;
+    term.op = op;
+    term.offset = offset;
+    term.length = width;
+    term.integer = operand;
+    terms.push_back(term);
+    return Status::SUCCESS;
+}
+
+bool Predicate::match(Record const& record) const {
+    uint8_t sel = 0;
+    for (Term const& term : terms) {
+        if (select(term, &record, &sel, 1) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Predicate::filter(
+    Record const* records, size_t num, std::vector<Record>& out
+) const {
+    if (terms.empty()) {
+        out.insert(out.end(), records, records + num);
+        return num;
+    }
+
+    size_t matched = 0;
+    uint8_t sel[BLOCK_SIZE];
+    for (size_t base = 0; base < num; base += BLOCK_SIZE) {
+        Record const* block = records + base;
+        size_t count = std::min(BLOCK_SIZE, num - base);
+        for (size_t i = 0; i < count; ++i) {
+            sel[i] = static_cast<uint8_t>(i);
+        }
+        for (size_t i = 0; i < terms.size() && count > 0; ++i) {
+            count = select(terms[i], block, sel, count);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(block[sel[i]]);
+        }
+        matched += count;
+    }
+    return matched;
+}
+
+size_t Predicate::select(
+    Term const& term, Record const* records, uint8_t* sel, size_t num
+) {
+    // branch-free narrowing, index is written and kept only if matched
+    size_t out = 0;
+    if (term.kind == Kind::BYTES) {
+        for (size_t i = 0; i < num; ++i) {
+            uint8_t const* value = records[sel[i]].value + term.offset;
+            int cmp = std::memcmp(value, term.bytes, term.length);
+            sel[out] = sel[i];
+            out += compare(cmp, term.op);
+        }
+        return out;
+    }
+
+    for (size_t i = 0; i < num; ++i) {
+        int64_t field = read_integer(term, records[sel[i]].value);
+        int cmp = (field > term.integer) - (field < term.integer);
+        sel[out] = sel[i];
+        out += compare(cmp, term.op);
+    }
+    return out;
+}
+
+int64_t Predicate::read_integer(Term const& term, uint8_t const* value) {
+    value += term.offset;
+    switch (term.length) {
+    case 1: {
+        int8_t field;
+        std::memcpy(&field, value, sizeof(field));
+        return field;
+    }
+    case 2: {
+        int16_t field;
+        std::memcpy(&field, value, sizeof(field));
+        return field;
+    }
+    case 4: {
+        int32_t field;
+        std::memcpy(&field, value, sizeof(field));
+        return field;
+    }
+    default: {
+        int64_t field;
+        std::memcpy(&field, value, sizeof(field));
+        return field;
+    }
+    }
+}
+
+bool Predicate::compare(int cmp, CompareOp op) {
+    switch (op) {
+    case CompareOp::EQ:
+        return cmp == 0;
+    case CompareOp::NE:
+        return cmp != 0;
+    case CompareOp::LT:
+        return cmp < 0;
+    case CompareOp::LE:
+        return cmp <= 0;
+    case CompareOp::GT:
+        return cmp > 0;
+    case CompareOp::GE:
+        return cmp >= 0;
+    }
+    return false;
+}
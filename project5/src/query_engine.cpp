@@ -0,0 +1,1972 @@
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+#include "query_engine.hpp"
+
+namespace {
+
+using Subplans = std::vector<std::unique_ptr<SubPlan>>;
+
+constexpr prikey_t MIN_KEY = std::numeric_limits<prikey_t>::min();
+constexpr prikey_t MAX_KEY = std::numeric_limits<prikey_t>::max();
+
+/// Expression bound to the column positions of the input rows.
+struct BoundExpr {
+    /// Kind of the bound expression.
+    enum class Kind {
+        COLUMN = 0, CONST = 1, NOT = 2, AND = 3, OR = 4, COMPARE = 5,
+        LIKE = 6, IN_LIST = 7, IN_PLAN = 8, SCALAR = 9,
+    };
+
+    Kind kind = Kind::CONST;            /// kind of the expression.
+    size_t index = 0;                   /// column index.
+    Value value;                        /// constant.
+    CompareOp op = CompareOp::EQ;       /// comparison operator.
+    bool negated = false;               /// not like, not in.
+    std::vector<BoundExpr> args;        /// operands.
+    SubPlan const* plan = nullptr;      /// subquery, owned by the operator.
+};
+
+Value boolean(bool value) {
+    return Value::of(static_cast<int64_t>(value));
+}
+
+bool truthy(Value const& value) {
+    return value.is_number() && value.as_real() != 0;
+}
+
+bool satisfies(int cmp, CompareOp op) {
+    switch (op) {
+    case CompareOp::EQ:
+        return cmp == 0;
+    case CompareOp::NE:
+        return cmp != 0;
+    case CompareOp::LT:
+        return cmp < 0;
+    case CompareOp::LE:
+        return cmp <= 0;
+    case CompareOp::GT:
+        return cmp > 0;
+    case CompareOp::GE:
+        return cmp >= 0;
+    }
+    return false;
+}
+
+CompareOp flip(CompareOp op) {
+    switch (op) {
+    case CompareOp::LT:
+        return CompareOp::GT;
+    case CompareOp::LE:
+        return CompareOp::GE;
+    case CompareOp::GT:
+        return CompareOp::LT;
+    case CompareOp::GE:
+        return CompareOp::LE;
+    default:
+        return op;
+    }
+}
+
+CompareOp negate(CompareOp op) {
+    switch (op) {
+    case CompareOp::EQ:
+        return CompareOp::NE;
+    case CompareOp::NE:
+        return CompareOp::EQ;
+    case CompareOp::LT:
+        return CompareOp::GE;
+    case CompareOp::LE:
+        return CompareOp::GT;
+    case CompareOp::GT:
+        return CompareOp::LE;
+    case CompareOp::GE:
+        return CompareOp::LT;
+    }
+    return op;
+}
+
+/// Match with the pattern, `%` for any sequence and `_` for a character.
+bool like_match(std::string const& str, std::string const& pattern) {
+    size_t s = 0;
+    size_t p = 0;
+    size_t star = std::string::npos;
+    size_t mark = 0;
+    while (s < str.size()) {
+        if (p < pattern.size() && pattern[p] == '%') {
+            star = p++;
+            mark = s;
+        } else if (p < pattern.size()
+            && (pattern[p] == '_' || pattern[p] == str[s])
+        ) {
+            ++s;
+            ++p;
+        } else if (star != std::string::npos) {
+            // backtrack, the last `%` takes one more character
+            p = star + 1;
+            s = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+Value eval(BoundExpr const& expr, Row const& row) {
+    switch (expr.kind) {
+    case BoundExpr::Kind::COLUMN:
+        return row[expr.index];
+    case BoundExpr::Kind::CONST:
+        return expr.value;
+    case BoundExpr::Kind::NOT: {
+        Value value = eval(expr.args[0], row);
+        return value.is_null() ? value : boolean(!truthy(value));
+    }
+    case BoundExpr::Kind::AND:
+    case BoundExpr::Kind::OR: {
+        // three-valued logic, null if undecided by the other side
+        bool decisive = expr.kind == BoundExpr::Kind::OR;
+        Value lhs = eval(expr.args[0], row);
+        if (!lhs.is_null() && truthy(lhs) == decisive) {
+            return boolean(decisive);
+        }
+        Value rhs = eval(expr.args[1], row);
+        if (!rhs.is_null() && truthy(rhs) == decisive) {
+            return boolean(decisive);
+        }
+        if (lhs.is_null() || rhs.is_null()) {
+            return Value();
+        }
+        return boolean(!decisive);
+    }
+    case BoundExpr::Kind::COMPARE: {
+        Value lhs = eval(expr.args[0], row);
+        Value rhs = eval(expr.args[1], row);
+        if (lhs.is_null() || rhs.is_null()) {
+            return Value();
+        }
+        return boolean(satisfies(lhs.compare(rhs), expr.op));
+    }
+    case BoundExpr::Kind::LIKE: {
+        Value lhs = eval(expr.args[0], row);
+        if (lhs.is_null()) {
+            return lhs;
+        }
+        bool matched = like_match(lhs.to_string(), expr.args[1].value.str);
+        return boolean(matched != expr.negated);
+    }
+    case BoundExpr::Kind::IN_LIST: {
+        Value lhs = eval(expr.args[0], row);
+        if (lhs.is_null()) {
+            return lhs;
+        }
+        bool found = false;
+        for (size_t i = 1; i < expr.args.size() && !found; ++i) {
+            found = eval(expr.args[i], row) == lhs;
+        }
+        return boolean(found != expr.negated);
+    }
+    case BoundExpr::Kind::IN_PLAN: {
+        Value lhs = eval(expr.args[0], row);
+        if (lhs.is_null()) {
+            return lhs;
+        }
+        bool found = expr.plan->values.count(lhs) > 0;
+        return boolean(found != expr.negated);
+    }
+    case BoundExpr::Kind::SCALAR:
+        return expr.plan->value;
+    }
+    return Value();
+}
+
+/// Append the columns of the record to the row.
+void decode(Schema const& schema, Record const& record, Row& row) {
+    for (size_t i = 0; i < schema.columns.size(); ++i) {
+        row.push_back(schema.decode(i, record));
+    }
+}
+
+std::string field_text(Field const& field) {
+    return field.table.empty() ? field.name : field.table + "." + field.name;
+}
+
+std::string join_text(std::vector<std::string> const& texts) {
+    std::string joined;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        joined += (i > 0 ? " and " : "") + texts[i];
+    }
+    return joined;
+}
+
+std::vector<Field> concat(
+    std::vector<Field> const& left, std::vector<Field> const& right
+) {
+    std::vector<Field> fields = left;
+    fields.insert(fields.end(), right.begin(), right.end());
+    return fields;
+}
+
+/// Leaf scan of the key range, predicate is evaluated in the leaf.
+class ScanOperator : public Operator {
+public:
+    ScanOperator(
+        std::vector<Field> fields, Table const* table, Schema const* schema,
+        prikey_t start, prikey_t end, Predicate predicate, bool filtered,
+        std::string detail
+    ) : Operator(std::move(fields)), table(table), schema(schema),
+        start(start), end(end), predicate(std::move(predicate)),
+        filtered(filtered), detail(std::move(detail)), iter(nullptr), pos(0)
+    {
+        // Do Nothing
+    }
+
+    std::string describe() const override {
+        return "Scan " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        iter = std::make_unique<BPTreeBatchIterator>(table->batches(
+            start, end, filtered ? &predicate : nullptr));
+        pos = 0;
+        return Status::SUCCESS;
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        while (iter->valid()) {
+            std::vector<Record> const& batch = iter->batch();
+            if (pos < batch.size()) {
+                row.clear();
+                decode(*schema, batch[pos++], row);
+                valid = true;
+                return Status::SUCCESS;
+            }
+            CHECK_SUCCESS(iter->next());
+            pos = 0;
+        }
+        valid = false;
+        return Status::SUCCESS;
+    }
+
+private:
+    Table const* table;
+    Schema const* schema;
+    prikey_t start;
+    prikey_t end;
+    Predicate predicate;
+    bool filtered;
+    std::string detail;
+    std::unique_ptr<BPTreeBatchIterator> iter;
+    size_t pos;
+};
+
+/// Rows satisfying the condition.
+class FilterOperator : public Operator {
+public:
+    FilterOperator(
+        std::unique_ptr<Operator> child, BoundExpr cond, Subplans subplans,
+        std::string detail
+    ) : Operator(child->fields()), cond(std::move(cond)),
+        detail(std::move(detail))
+    {
+        children.push_back(std::move(child));
+        subqueries = std::move(subplans);
+    }
+
+    std::string describe() const override {
+        return "Filter: " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        do {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+        } while (valid && !truthy(eval(cond, row)));
+        return Status::SUCCESS;
+    }
+
+private:
+    BoundExpr cond;
+    std::string detail;
+};
+
+/// Derived table, columns are qualified by its alias.
+class SubqueryOperator : public Operator {
+public:
+    SubqueryOperator(
+        std::unique_ptr<Operator> child, std::vector<Field> fields,
+        std::string alias
+    ) : Operator(std::move(fields)), alias(std::move(alias)) {
+        children.push_back(std::move(child));
+    }
+
+    std::string describe() const override {
+        return "Subquery " + alias;
+    }
+
+protected:
+    Status open_rows() override {
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        return children[0]->next(row, valid);
+    }
+
+private:
+    std::string alias;
+};
+
+/// Hash join, right input is built and left input probes in order.
+class HashJoinOperator : public Operator {
+public:
+    HashJoinOperator(
+        std::unique_ptr<Operator> left, std::unique_ptr<Operator> right,
+        std::vector<size_t> left_keys, std::vector<size_t> right_keys,
+        std::string detail
+    ) : Operator(concat(left->fields(), right->fields())),
+        left_keys(std::move(left_keys)), right_keys(std::move(right_keys)),
+        detail(std::move(detail)), table(), probe(), matches(nullptr), pos(0)
+    {
+        children.push_back(std::move(left));
+        children.push_back(std::move(right));
+    }
+
+    std::string describe() const override {
+        return detail.empty() ? "CrossJoin" : "HashJoin: " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        CHECK_SUCCESS(children[0]->open());
+        CHECK_SUCCESS(children[1]->open());
+
+        table.clear();
+        Row row;
+        Row key;
+        bool valid = true;
+        while (true) {
+            CHECK_SUCCESS(children[1]->next(row, valid));
+            if (!valid) {
+                break;
+            }
+            if (extract(row, right_keys, key)) {
+                table[key].push_back(std::move(row));
+            }
+        }
+        matches = nullptr;
+        return Status::SUCCESS;
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        Row key;
+        while (true) {
+            if (matches != nullptr && pos < matches->size()) {
+                Row const& match = (*matches)[pos++];
+                row = probe;
+                row.insert(row.end(), match.begin(), match.end());
+                valid = true;
+                return Status::SUCCESS;
+            }
+
+            CHECK_SUCCESS(children[0]->next(probe, valid));
+            if (!valid) {
+                return Status::SUCCESS;
+            }
+            matches = nullptr;
+            pos = 0;
+            if (extract(probe, left_keys, key)) {
+                auto iter = table.find(key);
+                if (iter != table.end()) {
+                    matches = &iter->second;
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<size_t> left_keys;
+    std::vector<size_t> right_keys;
+    std::string detail;
+    std::unordered_map<Row, std::vector<Row>, RowHash> table;
+    Row probe;
+    std::vector<Row> const* matches;
+    size_t pos;
+
+    /// Extract the join key, null never matches.
+    static bool extract(
+        Row const& row, std::vector<size_t> const& keys, Row& key
+    ) {
+        key.clear();
+        for (size_t idx : keys) {
+            if (row[idx].is_null()) {
+                return false;
+            }
+            key.push_back(row[idx]);
+        }
+        return true;
+    }
+};
+
+/// Index nested-loop join, keys of the left rows are probed on the right
+/// tree in sorted batches.
+class IndexJoinOperator : public Operator {
+public:
+    IndexJoinOperator(
+        std::unique_ptr<Operator> left, std::vector<Field> right_fields,
+        Table const* table, Schema const* schema, size_t left_key,
+        Predicate predicate, bool filtered, BoundExpr const* residual,
+        Subplans subplans, std::string detail
+    ) : Operator(concat(left->fields(), right_fields)), table(table),
+        schema(schema), left_key(left_key), predicate(std::move(predicate)),
+        filtered(filtered), has_residual(residual != nullptr), residual(),
+        detail(std::move(detail)), outer(), inner(), keys(), records(),
+        pos(0), exhausted(false)
+    {
+        if (residual != nullptr) {
+            this->residual = *residual;
+        }
+        children.push_back(std::move(left));
+        subqueries = std::move(subplans);
+    }
+
+    std::string describe() const override {
+        return "IndexJoin " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        outer.clear();
+        inner.clear();
+        pos = 0;
+        exhausted = false;
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        while (true) {
+            while (pos < outer.size()) {
+                Row const& left = outer[pos++];
+                Value const& key = left[left_key];
+                if (key.type != Value::Type::INT) {
+                    continue;
+                }
+                auto iter = inner.find(key.integer);
+                if (iter == inner.end()) {
+                    continue;
+                }
+                row = left;
+                row.insert(row.end(), iter->second.begin(), iter->second.end());
+                valid = true;
+                return Status::SUCCESS;
+            }
+            if (exhausted) {
+                valid = false;
+                return Status::SUCCESS;
+            }
+            CHECK_SUCCESS(fill());
+        }
+    }
+
+private:
+    Table const* table;
+    Schema const* schema;
+    size_t left_key;
+    Predicate predicate;
+    bool filtered;
+    bool has_residual;
+    BoundExpr residual;
+    std::string detail;
+    std::vector<Row> outer;
+    std::unordered_map<prikey_t, Row> inner;
+    std::vector<prikey_t> keys;
+    std::vector<Record> records;
+    size_t pos;
+    bool exhausted;
+
+    /// Read the next batch of the left rows and probe their keys.
+    Status fill() {
+        outer.clear();
+        inner.clear();
+        keys.clear();
+        pos = 0;
+
+        Row row;
+        bool valid = true;
+        while (outer.size() < JoinOper::NESTED_LOOP_BATCH) {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+            if (!valid) {
+                exhausted = true;
+                break;
+            }
+            if (row[left_key].type == Value::Type::INT) {
+                keys.push_back(row[left_key].integer);
+            }
+            outer.push_back(std::move(row));
+        }
+        if (keys.empty()) {
+            return Status::SUCCESS;
+        }
+
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        records.clear();
+        CHECK_SUCCESS(table->find_batch(keys, records));
+        for (Record const& record : records) {
+            if (filtered && !predicate.match(record)) {
+                continue;
+            }
+            Row right;
+            decode(*schema, record, right);
+            if (has_residual && !truthy(eval(residual, right))) {
+                continue;
+            }
+            inner.emplace(record.key, std::move(right));
+        }
+        return Status::SUCCESS;
+    }
+};
+
+/// Primary key join of two tables through the database.
+class PkJoinOperator : public Operator {
+public:
+    PkJoinOperator(
+        std::vector<Field> fields, Database& dbms,
+        Schema const* schema1, Schema const* schema2, std::string detail
+    ) : Operator(std::move(fields)), dbms(&dbms), schema1(schema1),
+        schema2(schema2), detail(std::move(detail)), joined(), pos(0)
+    {
+        // Do Nothing
+    }
+
+    std::string describe() const override {
+        return "PkJoin: " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        joined.clear();
+        pos = 0;
+        return dbms->prikey_join(
+            schema1->id, schema2->id,
+            [&](Record const& rec1, Record const& rec2) {
+                Row row;
+                decode(*schema1, rec1, row);
+                decode(*schema2, rec2, row);
+                joined.push_back(std::move(row));
+                return Status::SUCCESS;
+            });
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        valid = pos < joined.size();
+        if (valid) {
+            row = std::move(joined[pos++]);
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    Database* dbms;
+    Schema const* schema1;
+    Schema const* schema2;
+    std::string detail;
+    std::vector<Row> joined;
+    size_t pos;
+};
+
+/// Aggregate function.
+enum class AggFunc { COUNT = 0, SUM = 1, AVG = 2, MIN = 3, MAX = 4, ANY = 5 };
+
+/// Aggregate of the bound argument.
+struct AggSpec {
+    AggFunc func;       /// function.
+    BoundExpr arg;      /// argument, constant for count(*).
+};
+
+/// Running state of the aggregate.
+struct AggState {
+    size_t count = 0;       /// the number of non-null values.
+    bool real = false;      /// whether real number is summed.
+    int64_t isum = 0;       /// sum of the integers.
+    bool overflow = false;  /// whether the sum of the integers is overflowed.
+    double rsum = 0;        /// sum of the reals.
+    Value min;              /// minimum value.
+    Value max;              /// maximum value.
+    Value any;              /// first value.
+};
+
+/// Hash aggregation, groups are returned in the order of appearance.
+class AggregateOperator : public Operator {
+public:
+    AggregateOperator(
+        std::unique_ptr<Operator> child, std::vector<Field> fields,
+        std::vector<size_t> groups, std::vector<AggSpec> specs,
+        Subplans subplans, std::string detail
+    ) : Operator(std::move(fields)), groups(std::move(groups)),
+        specs(std::move(specs)), detail(std::move(detail)), results(), pos(0)
+    {
+        children.push_back(std::move(child));
+        subqueries = std::move(subplans);
+    }
+
+    std::string describe() const override {
+        return "Aggregate: " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        CHECK_SUCCESS(children[0]->open());
+
+        std::unordered_map<Row, size_t, RowHash> index;
+        std::vector<std::pair<Row, std::vector<AggState>>> states;
+        if (groups.empty()) {
+            // single row even if the input is empty
+            index.emplace(Row(), 0);
+            states.emplace_back(Row(), std::vector<AggState>(specs.size()));
+        }
+
+        Row row;
+        Row key;
+        bool valid = true;
+        while (true) {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+            if (!valid) {
+                break;
+            }
+            key.clear();
+            for (size_t idx : groups) {
+                key.push_back(row[idx]);
+            }
+            auto iter = index.find(key);
+            if (iter == index.end()) {
+                iter = index.emplace(key, states.size()).first;
+                states.emplace_back(key, std::vector<AggState>(specs.size()));
+            }
+            std::vector<AggState>& aggs = states[iter->second].second;
+            for (size_t i = 0; i < specs.size(); ++i) {
+                add(aggs[i], eval(specs[i].arg, row));
+            }
+        }
+
+        results.clear();
+        pos = 0;
+        for (auto& group : states) {
+            Row result = std::move(group.first);
+            for (size_t i = 0; i < specs.size(); ++i) {
+                // overflowed integer sum fails instead of wrapping around
+                CHECK_TRUE(!group.second[i].overflow
+                    || (specs[i].func != AggFunc::SUM
+                        && specs[i].func != AggFunc::AVG));
+                result.push_back(finish(specs[i].func, group.second[i]));
+            }
+            results.push_back(std::move(result));
+        }
+        return Status::SUCCESS;
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        valid = pos < results.size();
+        if (valid) {
+            row = std::move(results[pos++]);
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    std::vector<size_t> groups;
+    std::vector<AggSpec> specs;
+    std::string detail;
+    std::vector<Row> results;
+    size_t pos;
+
+    static void add(AggState& state, Value const& value) {
+        if (value.is_null()) {
+            return;
+        }
+        if (state.count++ == 0) {
+            state.any = value;
+            state.min = value;
+            state.max = value;
+        } else if (value.compare(state.min) < 0) {
+            state.min = value;
+        } else if (value.compare(state.max) > 0) {
+            state.max = value;
+        }
+        if (value.type == Value::Type::INT) {
+            state.overflow |= __builtin_add_overflow(
+                state.isum, value.integer, &state.isum);
+        } else if (value.type == Value::Type::REAL) {
+            state.real = true;
+            state.rsum += value.real;
+        }
+    }
+
+    static Value finish(AggFunc func, AggState const& state) {
+        if (func == AggFunc::COUNT) {
+            return Value::of(static_cast<int64_t>(state.count));
+        }
+        if (state.count == 0) {
+            return Value();
+        }
+        double sum = static_cast<double>(state.isum) + state.rsum;
+        switch (func) {
+        case AggFunc::SUM:
+            return state.real ? Value::of(sum) : Value::of(state.isum);
+        case AggFunc::AVG:
+            return Value::of(sum / state.count);
+        case AggFunc::MIN:
+            return state.min;
+        case AggFunc::MAX:
+            return state.max;
+        default:
+            return state.any;
+        }
+    }
+};
+
+/// Computed columns of the input rows.
+class ProjectOperator : public Operator {
+public:
+    ProjectOperator(
+        std::unique_ptr<Operator> child, std::vector<Field> fields,
+        std::vector<BoundExpr> exprs, Subplans subplans
+    ) : Operator(std::move(fields)), exprs(std::move(exprs)), input() {
+        children.push_back(std::move(child));
+        subqueries = std::move(subplans);
+    }
+
+    std::string describe() const override {
+        std::string text = "Project: ";
+        for (size_t i = 0; i < output.size(); ++i) {
+            text += (i > 0 ? ", " : "") + field_text(output[i]);
+        }
+        return text;
+    }
+
+protected:
+    Status open_rows() override {
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        CHECK_SUCCESS(children[0]->next(input, valid));
+        if (valid) {
+            row.clear();
+            for (BoundExpr const& expr : exprs) {
+                row.push_back(eval(expr, input));
+            }
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    std::vector<BoundExpr> exprs;
+    Row input;
+};
+
+/// Stable sort of all input rows.
+class SortOperator : public Operator {
+public:
+    SortOperator(
+        std::unique_ptr<Operator> child,
+        std::vector<std::pair<size_t, bool>> keys, std::string detail
+    ) : Operator(child->fields()), keys(std::move(keys)),
+        detail(std::move(detail)), sorted(), pos(0)
+    {
+        children.push_back(std::move(child));
+    }
+
+    std::string describe() const override {
+        return "Sort: " + detail;
+    }
+
+protected:
+    Status open_rows() override {
+        CHECK_SUCCESS(children[0]->open());
+        sorted.clear();
+        pos = 0;
+
+        Row row;
+        bool valid = true;
+        while (true) {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+            if (!valid) {
+                break;
+            }
+            sorted.push_back(std::move(row));
+        }
+        std::stable_sort(
+            sorted.begin(), sorted.end(), [&](Row const& lhs, Row const& rhs) {
+                for (auto const& key : keys) {
+                    int cmp = lhs[key.first].compare(rhs[key.first]);
+                    if (cmp != 0) {
+                        return key.second ? cmp > 0 : cmp < 0;
+                    }
+                }
+                return false;
+            });
+        return Status::SUCCESS;
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        valid = pos < sorted.size();
+        if (valid) {
+            row = std::move(sorted[pos++]);
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    std::vector<std::pair<size_t, bool>> keys;
+    std::string detail;
+    std::vector<Row> sorted;
+    size_t pos;
+};
+
+/// First row of each distinct prefix of the columns.
+class DistinctOperator : public Operator {
+public:
+    DistinctOperator(std::unique_ptr<Operator> child, size_t width) :
+        Operator(child->fields()), width(width), seen()
+    {
+        children.push_back(std::move(child));
+    }
+
+    std::string describe() const override {
+        return "Distinct";
+    }
+
+protected:
+    Status open_rows() override {
+        seen.clear();
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        while (true) {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+            if (!valid
+                || seen.emplace(row.begin(), row.begin() + width).second
+            ) {
+                return Status::SUCCESS;
+            }
+        }
+    }
+
+private:
+    size_t width;
+    std::unordered_set<Row, RowHash> seen;
+};
+
+/// Leading rows of the input, input is not read after the limit.
+class LimitOperator : public Operator {
+public:
+    LimitOperator(std::unique_ptr<Operator> child, size_t limit) :
+        Operator(child->fields()), limit(limit), count(0)
+    {
+        children.push_back(std::move(child));
+    }
+
+    std::string describe() const override {
+        return "Limit " + std::to_string(limit);
+    }
+
+protected:
+    Status open_rows() override {
+        count = 0;
+        return children[0]->open();
+    }
+
+    Status next_row(Row& row, bool& valid) override {
+        valid = false;
+        if (count < limit) {
+            CHECK_SUCCESS(children[0]->next(row, valid));
+            count += valid;
+        }
+        return Status::SUCCESS;
+    }
+
+private:
+    size_t limit;
+    size_t count;
+};
+
+/// Table in the from clause with the conjuncts only on itself.
+struct Source {
+    std::string qualifier;                  /// alias or table name.
+    Schema const* schema = nullptr;         /// nullptr if derived.
+    Table const* table = nullptr;           /// nullptr if derived.
+    std::unique_ptr<Operator> derived;      /// plan of the derived table.
+    std::vector<Field> fields;              /// columns.
+    prikey_t start = MIN_KEY;               /// pushed down lower bound.
+    prikey_t end = MAX_KEY;                 /// pushed down upper bound.
+    Predicate predicate;                    /// pushed down predicate.
+    bool filtered = false;                  /// whether predicate has terms.
+    std::vector<std::string> ranges;        /// texts of the key conjuncts.
+    std::vector<std::string> terms;         /// texts of the leaf conjuncts.
+    std::vector<Expr const*> filters;       /// remaining conjuncts.
+
+    /// Whether the base table is read without any condition.
+    bool bare() const {
+        return schema != nullptr && ranges.empty() && !filtered
+            && filters.empty();
+    }
+};
+
+/// Planner of the select statement.
+class Planner {
+public:
+    Planner(Database& dbms, Catalog const& catalog, std::string& message) :
+        dbms(dbms), catalog(catalog), message(message), owned()
+    {
+        // Do Nothing
+    }
+
+    /// Plan the select, output columns are the select list.
+    Status plan(Select const& select, std::unique_ptr<Operator>& root) {
+        std::unique_ptr<Operator> current;
+        CHECK_SUCCESS(plan_from(select, current));
+
+        // select list, `*` is expanded to the columns of the input
+        std::vector<Expr const*> items;
+        std::vector<Field> names;
+        for (SelectItem const& item : select.items) {
+            if (item.expr->kind == Expr::Kind::STAR) {
+                for (Field const& field : current->fields()) {
+                    auto column = std::make_unique<Expr>(Expr::Kind::COLUMN);
+                    column->table = field.table;
+                    column->name = field.name;
+                    items.push_back(column.get());
+                    names.push_back(field);
+                    owned.push_back(std::move(column));
+                }
+                continue;
+            }
+            Expr const& expr = *item.expr;
+            items.push_back(&expr);
+            if (!item.alias.empty()) {
+                names.push_back(Field { "", item.alias });
+            } else if (expr.kind == Expr::Kind::COLUMN) {
+                names.push_back(Field { expr.table, expr.name });
+            } else {
+                names.push_back(Field { "", expr.to_string() });
+            }
+        }
+
+        // order by refers to the select list by name or by expression
+        std::vector<int> refs;
+        for (OrderItem const& item : select.order_by) {
+            Expr const& expr = *item.expr;
+            int ref = -1;
+            for (size_t i = 0; i < items.size() && ref < 0; ++i) {
+                bool named = expr.kind == Expr::Kind::COLUMN
+                    && expr.table.empty() && names[i].name == expr.name;
+                if (named || expr.to_string() == items[i]->to_string()) {
+                    ref = static_cast<int>(i);
+                }
+            }
+            refs.push_back(ref);
+        }
+
+        std::vector<Expr const*> exprs = items;
+        for (size_t i = 0; i < refs.size(); ++i) {
+            if (refs[i] < 0) {
+                exprs.push_back(select.order_by[i].expr.get());
+            }
+        }
+        CHECK_SUCCESS(plan_aggregate(select, exprs, current));
+
+        // visible columns and the hidden sort keys
+        Subplans subplans;
+        std::vector<BoundExpr> bound;
+        std::vector<Field> fields = names;
+        std::vector<std::pair<size_t, bool>> keys;
+        std::vector<std::string> key_texts;
+        for (Expr const* item : items) {
+            bound.emplace_back();
+            CHECK_SUCCESS(
+                bind(*item, current->fields(), subplans, bound.back()));
+        }
+        for (size_t i = 0; i < refs.size(); ++i) {
+            OrderItem const& item = select.order_by[i];
+            size_t idx = static_cast<size_t>(refs[i]);
+            if (refs[i] < 0) {
+                idx = bound.size();
+                bound.emplace_back();
+                CHECK_SUCCESS(
+                    bind(*item.expr, current->fields(), subplans, bound.back()));
+                fields.push_back(Field { "", item.expr->to_string() });
+            }
+            keys.emplace_back(idx, item.desc);
+            key_texts.push_back(
+                item.expr->to_string() + (item.desc ? " desc" : ""));
+        }
+        size_t visible = items.size();
+        bool hidden = bound.size() > visible;
+        current = std::make_unique<ProjectOperator>(
+            std::move(current), std::move(fields), std::move(bound),
+            std::move(subplans));
+
+        if (select.distinct && !hidden) {
+            current = std::make_unique<DistinctOperator>(
+                std::move(current), visible);
+        }
+        if (!keys.empty()) {
+            std::string detail;
+            for (size_t i = 0; i < key_texts.size(); ++i) {
+                detail += (i > 0 ? ", " : "") + key_texts[i];
+            }
+            current = std::make_unique<SortOperator>(
+                std::move(current), std::move(keys), detail);
+        }
+        // distinct keeps the first row in the order of the hidden keys
+        if (select.distinct && hidden) {
+            current = std::make_unique<DistinctOperator>(
+                std::move(current), visible);
+        }
+        if (select.limit >= 0) {
+            current = std::make_unique<LimitOperator>(
+                std::move(current), static_cast<size_t>(select.limit));
+        }
+        if (hidden) {
+            std::vector<BoundExpr> columns(visible);
+            for (size_t i = 0; i < visible; ++i) {
+                columns[i].kind = BoundExpr::Kind::COLUMN;
+                columns[i].index = i;
+            }
+            current = std::make_unique<ProjectOperator>(
+                std::move(current), names, std::move(columns), Subplans());
+        }
+        root = std::move(current);
+        return Status::SUCCESS;
+    }
+
+private:
+    Database& dbms;
+    Catalog const& catalog;
+    std::string& message;
+    std::vector<ExprPtr> owned;     /// expressions made by the planner.
+
+    Status fail(std::string const& what) {
+        message = what;
+        return Status::FAILURE;
+    }
+
+    /// Plan the from clause and the where clause.
+    Status plan_from(Select const& select, std::unique_ptr<Operator>& root) {
+        std::vector<Source> sources;
+        std::vector<Field> all;
+        std::vector<size_t> owners;
+        for (TableRef const& ref : select.from) {
+            CHECK_SUCCESS(add_source(ref, sources));
+            for (Field const& field : sources.back().fields) {
+                all.push_back(field);
+                owners.push_back(sources.size() - 1);
+            }
+        }
+
+        // conjuncts on a single table are pushed down to the table
+        std::vector<Expr const*> conds;
+        if (select.where != nullptr) {
+            conjuncts(*select.where, conds);
+        }
+        std::vector<Expr const*> multi;
+        std::vector<std::set<size_t>> multi_refs;
+        for (Expr const* cond : conds) {
+            std::set<size_t> refs;
+            CHECK_SUCCESS(collect(*cond, all, owners, refs));
+            if (refs.size() == 1) {
+                Source& source = sources[*refs.begin()];
+                if (source.schema == nullptr || !push_down(*cond, source)) {
+                    source.filters.push_back(cond);
+                }
+                continue;
+            }
+            multi.push_back(cond);
+            multi_refs.push_back(std::move(refs));
+        }
+
+        std::vector<bool> joined(sources.size(), false);
+        std::vector<bool> used(multi.size(), false);
+        std::unique_ptr<Operator> current;
+        CHECK_SUCCESS(source_operator(sources[0], current));
+        joined[0] = true;
+        bool bare = sources[0].bare();
+        CHECK_SUCCESS(apply_ready(multi, multi_refs, joined, used, current));
+        bare &= std::all_of(used.begin(), used.end(), [](bool u) { return !u; });
+
+        for (size_t step = 1; step < sources.size(); ++step) {
+            // prefer the table connected by an equi-join in from order
+            size_t next = sources.size();
+            for (size_t j = 0; j < sources.size() && next == sources.size(); ++j) {
+                if (joined[j]) {
+                    continue;
+                }
+                for (size_t k = 0; k < multi.size(); ++k) {
+                    size_t lhs;
+                    size_t rhs;
+                    if (!used[k]
+                        && equi(*multi[k], all, owners, lhs, rhs)
+                        && ((joined[owners[lhs]] && owners[rhs] == j)
+                            || (joined[owners[rhs]] && owners[lhs] == j))
+                    ) {
+                        next = j;
+                        break;
+                    }
+                }
+            }
+            if (next == sources.size()) {
+                next = std::find(joined.begin(), joined.end(), false)
+                    - joined.begin();
+            }
+
+            // equi-join keys between the joined tables and the next
+            std::vector<size_t> conds_k;
+            std::vector<Expr const*> left_cols;
+            std::vector<Expr const*> right_cols;
+            for (size_t k = 0; k < multi.size(); ++k) {
+                size_t lhs;
+                size_t rhs;
+                if (used[k] || !equi(*multi[k], all, owners, lhs, rhs)) {
+                    continue;
+                }
+                Expr const* lcol = multi[k]->args[0].get();
+                Expr const* rcol = multi[k]->args[1].get();
+                if (owners[lhs] == next && joined[owners[rhs]]) {
+                    std::swap(lhs, rhs);
+                    std::swap(lcol, rcol);
+                }
+                if (joined[owners[lhs]] && owners[rhs] == next) {
+                    conds_k.push_back(k);
+                    left_cols.push_back(lcol);
+                    right_cols.push_back(rcol);
+                }
+            }
+
+            Source& source = sources[next];
+            int key_match = -1;
+            bool pk_match = false;
+            for (size_t i = 0; i < right_cols.size(); ++i) {
+                if (!is_key(*right_cols[i], source)) {
+                    continue;
+                }
+                key_match = static_cast<int>(i);
+                pk_match = step == 1 && bare && source.bare()
+                    && is_key(*left_cols[i], sources[0]);
+                if (pk_match) {
+                    break;
+                }
+            }
+
+            if (pk_match) {
+                used[conds_k[key_match]] = true;
+                current = std::make_unique<PkJoinOperator>(
+                    concat(current->fields(), source.fields), dbms,
+                    sources[0].schema, source.schema,
+                    multi[conds_k[key_match]]->to_string());
+            } else if (key_match >= 0 && source.schema != nullptr
+                && source.ranges.empty()
+            ) {
+                used[conds_k[key_match]] = true;
+                CHECK_SUCCESS(index_join(
+                    source, *left_cols[key_match],
+                    multi[conds_k[key_match]]->to_string(), current));
+            } else {
+                std::unique_ptr<Operator> right;
+                CHECK_SUCCESS(source_operator(source, right));
+                std::vector<size_t> left_keys;
+                std::vector<size_t> right_keys;
+                std::vector<std::string> texts;
+                for (size_t i = 0; i < conds_k.size(); ++i) {
+                    size_t lidx;
+                    size_t ridx;
+                    CHECK_SUCCESS(
+                        resolve(*left_cols[i], current->fields(), lidx));
+                    CHECK_SUCCESS(
+                        resolve(*right_cols[i], right->fields(), ridx));
+                    left_keys.push_back(lidx);
+                    right_keys.push_back(ridx);
+                    texts.push_back(multi[conds_k[i]]->to_string());
+                    used[conds_k[i]] = true;
+                }
+                current = std::make_unique<HashJoinOperator>(
+                    std::move(current), std::move(right),
+                    std::move(left_keys), std::move(right_keys),
+                    join_text(texts));
+            }
+            joined[next] = true;
+            CHECK_SUCCESS(
+                apply_ready(multi, multi_refs, joined, used, current));
+        }
+        root = std::move(current);
+        return Status::SUCCESS;
+    }
+
+    /// Plan the grouping and the aggregates of the expressions.
+    Status plan_aggregate(
+        Select const& select, std::vector<Expr const*> const& exprs,
+        std::unique_ptr<Operator>& current
+    ) {
+        std::vector<Expr const*> aggs;
+        for (Expr const* expr : exprs) {
+            aggregates(*expr, aggs);
+        }
+        if (select.group_by.empty() && aggs.empty()) {
+            return Status::SUCCESS;
+        }
+
+        std::vector<Field> const& input = current->fields();
+        std::vector<Field> fields;
+        std::vector<size_t> groups;
+        std::vector<std::string> texts;
+        for (ExprPtr const& expr : select.group_by) {
+            if (expr->kind != Expr::Kind::COLUMN) {
+                return fail("group by expects column: " + expr->to_string());
+            }
+            size_t idx;
+            CHECK_SUCCESS(resolve(*expr, input, idx));
+            groups.push_back(idx);
+            fields.push_back(input[idx]);
+        }
+
+        Subplans subplans;
+        std::vector<AggSpec> specs;
+        for (Expr const* agg : aggs) {
+            AggSpec spec { AggFunc::COUNT, BoundExpr() };
+            static char const* names[] = { "count", "sum", "avg", "min", "max" };
+            for (size_t i = 0; i < 5; ++i) {
+                if (agg->name == names[i]) {
+                    spec.func = static_cast<AggFunc>(i);
+                }
+            }
+            Expr const& arg = *agg->args[0];
+            if (arg.kind == Expr::Kind::STAR) {
+                spec.arg.value = Value::of(static_cast<int64_t>(1));
+            } else {
+                CHECK_SUCCESS(bind(arg, input, subplans, spec.arg));
+            }
+            specs.push_back(std::move(spec));
+            fields.push_back(Field { "", agg->to_string() });
+            texts.push_back(agg->to_string());
+        }
+
+        // columns neither grouped nor aggregated take any value of the group
+        std::vector<Expr const*> columns;
+        for (Expr const* expr : exprs) {
+            bare_columns(*expr, columns);
+        }
+        for (Expr const* column : columns) {
+            size_t idx;
+            CHECK_SUCCESS(resolve(*column, input, idx));
+            bool found = std::find(groups.begin(), groups.end(), idx)
+                != groups.end();
+            for (AggSpec const& spec : specs) {
+                found |= spec.func == AggFunc::ANY && spec.arg.index == idx;
+            }
+            if (!found) {
+                AggSpec spec { AggFunc::ANY, BoundExpr() };
+                spec.arg.kind = BoundExpr::Kind::COLUMN;
+                spec.arg.index = idx;
+                specs.push_back(std::move(spec));
+                fields.push_back(input[idx]);
+            }
+        }
+
+        std::string detail = join_list(texts);
+        if (!select.group_by.empty()) {
+            std::vector<std::string> keys;
+            for (ExprPtr const& expr : select.group_by) {
+                keys.push_back(expr->to_string());
+            }
+            detail += (detail.empty() ? "group by " : " group by ")
+                + join_list(keys);
+        }
+        current = std::make_unique<AggregateOperator>(
+            std::move(current), std::move(fields), std::move(groups),
+            std::move(specs), std::move(subplans), detail);
+        return Status::SUCCESS;
+    }
+
+    /// Add the table of the from clause.
+    Status add_source(TableRef const& ref, std::vector<Source>& sources) {
+        Source source;
+        if (ref.query != nullptr) {
+            std::unique_ptr<Operator> derived;
+            Planner nested(dbms, catalog, message);
+            CHECK_SUCCESS(nested.plan(*ref.query, derived));
+            source.qualifier = ref.alias;
+            for (Field const& field : derived->fields()) {
+                source.fields.push_back(Field { ref.alias, field.name });
+            }
+            source.derived = std::make_unique<SubqueryOperator>(
+                std::move(derived), source.fields, ref.alias);
+        } else {
+            source.schema = catalog.find(ref.name);
+            if (source.schema == nullptr) {
+                return fail("unknown table " + ref.name);
+            }
+            source.table = dbms[source.schema->id];
+            if (source.table == nullptr) {
+                return fail("table is not opened: " + ref.name);
+            }
+            source.qualifier = ref.alias.empty() ? source.schema->name : ref.alias;
+            for (Column const& column : source.schema->columns) {
+                source.fields.push_back(Field { source.qualifier, column.name });
+            }
+        }
+
+        for (Source const& other : sources) {
+            if (other.qualifier == source.qualifier) {
+                return fail("duplicate table " + source.qualifier);
+            }
+        }
+        sources.push_back(std::move(source));
+        return Status::SUCCESS;
+    }
+
+    /// Operator reading the table with its own conjuncts.
+    Status source_operator(Source& source, std::unique_ptr<Operator>& op) {
+        if (source.schema == nullptr) {
+            op = std::move(source.derived);
+        } else {
+            op = std::make_unique<ScanOperator>(
+                source.fields, source.table, source.schema, source.start,
+                source.end, source.predicate, source.filtered,
+                scan_detail(source));
+        }
+        return apply_filter(source.filters, op);
+    }
+
+    /// Index join probing the table with the key of the left column.
+    Status index_join(
+        Source& source, Expr const& left_col, std::string const& cond,
+        std::unique_ptr<Operator>& current
+    ) {
+        size_t left_key;
+        CHECK_SUCCESS(resolve(left_col, current->fields(), left_key));
+
+        Subplans subplans;
+        BoundExpr residual;
+        std::vector<std::string> texts = source.terms;
+        if (!source.filters.empty()) {
+            CHECK_SUCCESS(
+                bind_all(source.filters, source.fields, subplans, residual));
+            for (Expr const* filter : source.filters) {
+                texts.push_back(filter->to_string());
+            }
+        }
+
+        std::string detail = scan_name(source) + ": " + cond;
+        if (!texts.empty()) {
+            detail += " filter: " + join_text(texts);
+        }
+        current = std::make_unique<IndexJoinOperator>(
+            std::move(current), source.fields, source.table, source.schema,
+            left_key, source.predicate, source.filtered,
+            source.filters.empty() ? nullptr : &residual,
+            std::move(subplans), detail);
+        return Status::SUCCESS;
+    }
+
+    /// Filter the conjuncts whose tables are all joined.
+    Status apply_ready(
+        std::vector<Expr const*> const& multi,
+        std::vector<std::set<size_t>> const& refs,
+        std::vector<bool> const& joined, std::vector<bool>& used,
+        std::unique_ptr<Operator>& current
+    ) {
+        std::vector<Expr const*> ready;
+        for (size_t k = 0; k < multi.size(); ++k) {
+            bool all = std::all_of(
+                refs[k].begin(), refs[k].end(),
+                [&](size_t idx) { return joined[idx]; });
+            if (!used[k] && all) {
+                used[k] = true;
+                ready.push_back(multi[k]);
+            }
+        }
+        return apply_filter(ready, current);
+    }
+
+    /// Wrap the operator with the filter of the conjuncts.
+    Status apply_filter(
+        std::vector<Expr const*> const& conds, std::unique_ptr<Operator>& op
+    ) {
+        if (conds.empty()) {
+            return Status::SUCCESS;
+        }
+        Subplans subplans;
+        BoundExpr cond;
+        CHECK_SUCCESS(bind_all(conds, op->fields(), subplans, cond));
+
+        std::vector<std::string> texts;
+        for (Expr const* expr : conds) {
+            texts.push_back(expr->to_string());
+        }
+        op = std::make_unique<FilterOperator>(
+            std::move(op), std::move(cond), std::move(subplans),
+            join_text(texts));
+        return Status::SUCCESS;
+    }
+
+    /// Bind the conjunction of the expressions.
+    Status bind_all(
+        std::vector<Expr const*> const& conds,
+        std::vector<Field> const& fields, Subplans& subplans, BoundExpr& out
+    ) {
+        CHECK_SUCCESS(bind(*conds[0], fields, subplans, out));
+        for (size_t i = 1; i < conds.size(); ++i) {
+            BoundExpr conj;
+            conj.kind = BoundExpr::Kind::AND;
+            conj.args.push_back(std::move(out));
+            conj.args.emplace_back();
+            CHECK_SUCCESS(bind(*conds[i], fields, subplans, conj.args.back()));
+            out = std::move(conj);
+        }
+        return Status::SUCCESS;
+    }
+
+    /// Bind the expression to the columns.
+    Status bind(
+        Expr const& expr, std::vector<Field> const& fields,
+        Subplans& subplans, BoundExpr& out
+    ) {
+        switch (expr.kind) {
+        case Expr::Kind::COLUMN:
+            out.kind = BoundExpr::Kind::COLUMN;
+            return resolve(expr, fields, out.index);
+        case Expr::Kind::LITERAL:
+            out.kind = BoundExpr::Kind::CONST;
+            out.value = expr.value;
+            return Status::SUCCESS;
+        case Expr::Kind::STAR:
+            return fail("unexpected *");
+        case Expr::Kind::NOT:
+        case Expr::Kind::AND:
+        case Expr::Kind::OR:
+        case Expr::Kind::COMPARE:
+        case Expr::Kind::LIKE:
+            out.kind = expr.kind == Expr::Kind::NOT ? BoundExpr::Kind::NOT
+                : expr.kind == Expr::Kind::AND ? BoundExpr::Kind::AND
+                : expr.kind == Expr::Kind::OR ? BoundExpr::Kind::OR
+                : expr.kind == Expr::Kind::COMPARE
+                    ? BoundExpr::Kind::COMPARE
+                    : BoundExpr::Kind::LIKE;
+            out.op = expr.op;
+            out.negated = expr.negated;
+            return bind_args(expr, fields, subplans, out);
+        case Expr::Kind::IN:
+            out.negated = expr.negated;
+            if (expr.query == nullptr) {
+                out.kind = BoundExpr::Kind::IN_LIST;
+                return bind_args(expr, fields, subplans, out);
+            }
+            out.kind = BoundExpr::Kind::IN_PLAN;
+            CHECK_SUCCESS(bind_args(expr, fields, subplans, out));
+            return subquery(*expr.query, false, subplans, out.plan);
+        case Expr::Kind::SUBQUERY:
+            out.kind = BoundExpr::Kind::SCALAR;
+            return subquery(*expr.query, true, subplans, out.plan);
+        case Expr::Kind::AGGREGATE: {
+            // aggregates are the columns of the aggregate operator
+            std::string text = expr.to_string();
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (fields[i].table.empty() && fields[i].name == text) {
+                    out.kind = BoundExpr::Kind::COLUMN;
+                    out.index = i;
+                    return Status::SUCCESS;
+                }
+            }
+            return fail("aggregate is not allowed here: " + text);
+        }
+        }
+        return fail("unknown expression");
+    }
+
+    Status bind_args(
+        Expr const& expr, std::vector<Field> const& fields,
+        Subplans& subplans, BoundExpr& out
+    ) {
+        for (ExprPtr const& arg : expr.args) {
+            out.args.emplace_back();
+            CHECK_SUCCESS(bind(*arg, fields, subplans, out.args.back()));
+        }
+        return Status::SUCCESS;
+    }
+
+    /// Plan the uncorrelated subquery owned by the binding operator.
+    Status subquery(
+        Select const& select, bool scalar, Subplans& subplans,
+        SubPlan const*& plan
+    ) {
+        auto subplan = std::make_unique<SubPlan>();
+        subplan->scalar = scalar;
+        subplan->done = false;
+        subplan->message = &message;
+
+        Planner nested(dbms, catalog, message);
+        CHECK_SUCCESS(nested.plan(select, subplan->root));
+        if (subplan->root->fields().size() != 1) {
+            return fail("subquery must return one column");
+        }
+        plan = subplan.get();
+        subplans.push_back(std::move(subplan));
+        return Status::SUCCESS;
+    }
+
+    /// Find the column, unqualified name should be unique.
+    Status resolve(
+        Expr const& column, std::vector<Field> const& fields, size_t& index
+    ) {
+        size_t found = fields.size();
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].name == column.name
+                && (column.table.empty() || fields[i].table == column.table)
+            ) {
+                if (found != fields.size()) {
+                    return fail("ambiguous column " + column.to_string());
+                }
+                found = i;
+            }
+        }
+        if (found == fields.size()) {
+            return fail("unknown column " + column.to_string());
+        }
+        index = found;
+        return Status::SUCCESS;
+    }
+
+    /// Collect the tables referenced by the expression.
+    Status collect(
+        Expr const& expr, std::vector<Field> const& all,
+        std::vector<size_t> const& owners, std::set<size_t>& refs
+    ) {
+        if (expr.kind == Expr::Kind::COLUMN) {
+            size_t idx;
+            CHECK_SUCCESS(resolve(expr, all, idx));
+            refs.insert(owners[idx]);
+        }
+        for (ExprPtr const& arg : expr.args) {
+            CHECK_SUCCESS(collect(*arg, all, owners, refs));
+        }
+        return Status::SUCCESS;
+    }
+
+    /// Whether the expression is equality of the columns of two tables.
+    bool equi(
+        Expr const& expr, std::vector<Field> const& all,
+        std::vector<size_t> const& owners, size_t& lhs, size_t& rhs
+    ) {
+        if (expr.kind != Expr::Kind::COMPARE || expr.op != CompareOp::EQ
+            || expr.args[0]->kind != Expr::Kind::COLUMN
+            || expr.args[1]->kind != Expr::Kind::COLUMN
+        ) {
+            return false;
+        }
+        std::string saved = message;
+        bool found = resolve(*expr.args[0], all, lhs) == Status::SUCCESS
+            && resolve(*expr.args[1], all, rhs) == Status::SUCCESS;
+        message = saved;
+        return found && owners[lhs] != owners[rhs];
+    }
+
+    /// Whether the column is the primary key of the base table.
+    static bool is_key(Expr const& column, Source const& source) {
+        if (source.schema == nullptr
+            || (!column.table.empty() && column.table != source.qualifier)
+        ) {
+            return false;
+        }
+        int idx = source.schema->find(column.name);
+        return idx >= 0 && source.schema->columns[idx].key;
+    }
+
+    /// Push the conjunct down to the key range or the leaf predicate.
+    /// \return bool, false if it should be filtered after the scan.
+    static bool push_down(Expr const& cond, Source& source) {
+        Expr const* expr = &cond;
+        bool negated = false;
+        if (expr->kind == Expr::Kind::NOT) {
+            expr = expr->args[0].get();
+            negated = true;
+        }
+
+        if (expr->kind == Expr::Kind::LIKE) {
+            Column const* column = column_of(*expr->args[0], source);
+            if (column == nullptr || column->type != ColumnType::CHAR) {
+                return false;
+            }
+            bool pushed = push_like(
+                *column, expr->args[1]->value.str,
+                negated != expr->negated, source.predicate);
+            return record_term(pushed, cond, source);
+        }
+
+        if (expr->kind != Expr::Kind::COMPARE) {
+            return false;
+        }
+        CompareOp op = negated ? negate(expr->op) : expr->op;
+        Expr const* lhs = expr->args[0].get();
+        Expr const* rhs = expr->args[1].get();
+        if (lhs->kind == Expr::Kind::LITERAL) {
+            std::swap(lhs, rhs);
+            op = flip(op);
+        }
+        Column const* column = column_of(*lhs, source);
+        if (column == nullptr || rhs->kind != Expr::Kind::LITERAL) {
+            return false;
+        }
+
+        Value const& value = rhs->value;
+        if (column->key) {
+            if (value.type != Value::Type::INT || op == CompareOp::NE) {
+                return false;
+            }
+            narrow(op, value.integer, source.start, source.end);
+            source.ranges.push_back(cond.to_string());
+            return true;
+        }
+        if (column->type == ColumnType::INT) {
+            return record_term(
+                value.type == Value::Type::INT
+                    && source.predicate.integer(
+                        column->offset, op, value.integer) == Status::SUCCESS,
+                cond, source);
+        }
+        // null padded operand compares in the string order
+        if (value.type != Value::Type::STR || value.str.size() > column->size) {
+            return false;
+        }
+        std::string padded = value.str;
+        padded.resize(column->size, '\0');
+        return record_term(
+            source.predicate.bytes(column->offset, padded, op)
+                == Status::SUCCESS,
+            cond, source);
+    }
+
+    /// Compile like pattern of the prefix or the exact match.
+    static bool push_like(
+        Column const& column, std::string const& pattern, bool negated,
+        Predicate& predicate
+    ) {
+        size_t wildcard = pattern.find_first_of("%_");
+        std::string operand = pattern.substr(0, wildcard);
+        // longer operand never matches, but should not be truncated
+        if (operand.size() > column.size) {
+            return false;
+        }
+        if (wildcard == std::string::npos) {
+            operand.resize(column.size, '\0');
+        } else if (wildcard != pattern.size() - 1 || pattern.back() != '%') {
+            return false;
+        }
+        CompareOp op = negated ? CompareOp::NE : CompareOp::EQ;
+        return predicate.bytes(column.offset, operand, op) == Status::SUCCESS;
+    }
+
+    static bool record_term(bool pushed, Expr const& cond, Source& source) {
+        if (pushed) {
+            source.filtered = true;
+            source.terms.push_back(cond.to_string());
+        }
+        return pushed;
+    }
+
+    /// Narrow the key range with the comparison.
+    static void narrow(
+        CompareOp op, prikey_t value, prikey_t& start, prikey_t& end
+    ) {
+        switch (op) {
+        case CompareOp::EQ:
+            start = std::max(start, value);
+            end = std::min(end, value);
+            break;
+        case CompareOp::LT:
+            if (value == MIN_KEY) {
+                start = MAX_KEY;
+                end = MIN_KEY;
+            } else {
+                end = std::min(end, value - 1);
+            }
+            break;
+        case CompareOp::LE:
+            end = std::min(end, value);
+            break;
+        case CompareOp::GT:
+            if (value == MAX_KEY) {
+                start = MAX_KEY;
+                end = MIN_KEY;
+            } else {
+                start = std::max(start, value + 1);
+            }
+            break;
+        case CompareOp::GE:
+            start = std::max(start, value);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// Get the column of the base table, nullptr if not a column.
+    static Column const* column_of(Expr const& expr, Source const& source) {
+        if (expr.kind != Expr::Kind::COLUMN
+            || (!expr.table.empty() && expr.table != source.qualifier)
+        ) {
+            return nullptr;
+        }
+        int idx = source.schema->find(expr.name);
+        return idx < 0 ? nullptr : &source.schema->columns[idx];
+    }
+
+    static std::string scan_name(Source const& source) {
+        std::string name = source.schema->name;
+        if (source.qualifier != name) {
+            name += " " + source.qualifier;
+        }
+        return name;
+    }
+
+    static std::string scan_detail(Source const& source) {
+        std::string detail = scan_name(source);
+        if (!source.ranges.empty()) {
+            detail += " key: " + join_text(source.ranges);
+        }
+        if (!source.terms.empty()) {
+            detail += " filter: " + join_text(source.terms);
+        }
+        return detail;
+    }
+
+    static std::string join_list(std::vector<std::string> const& texts) {
+        std::string joined;
+        for (size_t i = 0; i < texts.size(); ++i) {
+            joined += (i > 0 ? ", " : "") + texts[i];
+        }
+        return joined;
+    }
+
+    /// Split the conjunction.
+    static void conjuncts(Expr const& expr, std::vector<Expr const*>& out) {
+        if (expr.kind == Expr::Kind::AND) {
+            conjuncts(*expr.args[0], out);
+            conjuncts(*expr.args[1], out);
+        } else {
+            out.push_back(&expr);
+        }
+    }
+
+    /// Collect the distinct aggregates outside of the subqueries.
+    static void aggregates(Expr const& expr, std::vector<Expr const*>& out) {
+        if (expr.kind == Expr::Kind::AGGREGATE) {
+            std::string text = expr.to_string();
+            for (Expr const* agg : out) {
+                if (agg->to_string() == text) {
+                    return;
+                }
+            }
+            out.push_back(&expr);
+            return;
+        }
+        for (ExprPtr const& arg : expr.args) {
+            aggregates(*arg, out);
+        }
+    }
+
+    /// Collect the columns outside of the aggregates and the subqueries.
+    static void bare_columns(Expr const& expr, std::vector<Expr const*>& out) {
+        if (expr.kind == Expr::Kind::COLUMN) {
+            out.push_back(&expr);
+        }
+        if (expr.kind == Expr::Kind::AGGREGATE) {
+            return;
+        }
+        for (ExprPtr const& arg : expr.args) {
+            bare_columns(*arg, out);
+        }
+    }
+};
+
+void explain_into(
+    Operator const& op, bool analyze, size_t depth, std::string& out
+) {
+    std::string indent(depth * 2, ' ');
+    out += indent + (depth > 0 ? "-> " : "") + op.describe();
+    if (analyze) {
+        char stats[64];
+        std::snprintf(
+            stats, sizeof(stats), " (rows=%zu, time=%.3fms)",
+            op.rows(), op.elapsed());
+        out += stats;
+    }
+    out += '\n';
+    for (auto const& subplan : op.subplans()) {
+        out += indent + "  " + (subplan->scalar ? "SubPlan scalar" : "SubPlan in")
+            + '\n';
+        explain_into(*subplan->root, analyze, depth + 2, out);
+    }
+    for (auto const& child : op.inputs()) {
+        explain_into(*child, analyze, depth + 1, out);
+    }
+}
+
+}
+
+Operator::Operator(std::vector<Field> fields) :
+    output(std::move(fields)), children(), subqueries(), num_rows(0),
+    time(std::chrono::steady_clock::duration::zero())
+{
+    // Do Nothing
+}
+
+Operator::~Operator() {
+    // Do Nothing
+}
+
+Status Operator::open() {
+    auto begin = std::chrono::steady_clock::now();
+    Status status = Status::SUCCESS;
+    for (auto& subplan : subqueries) {
+        status = subplan->run();
+        if (status != Status::SUCCESS) {
+            break;
+        }
+    }
+    if (status == Status::SUCCESS) {
+        status = open_rows();
+    }
+    time += std::chrono::steady_clock::now() - begin;
+    return status;
+}
+
+Status Operator::next(Row& row, bool& valid) {
+    auto begin = std::chrono::steady_clock::now();
+    Status status = next_row(row, valid);
+    time += std::chrono::steady_clock::now() - begin;
+    num_rows += status == Status::SUCCESS && valid;
+    return status;
+}
+
+std::vector<Field> const& Operator::fields() const {
+    return output;
+}
+
+std::vector<std::unique_ptr<Operator>> const& Operator::inputs() const {
+    return children;
+}
+
+std::vector<std::unique_ptr<SubPlan>> const& Operator::subplans() const {
+    return subqueries;
+}
+
+size_t Operator::rows() const {
+    return num_rows;
+}
+
+double Operator::elapsed() const {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+Status SubPlan::run() {
+    if (done) {
+        return Status::SUCCESS;
+    }
+    CHECK_SUCCESS(root->open());
+
+    Row row;
+    bool valid = true;
+    size_t count = 0;
+    while (true) {
+        CHECK_SUCCESS(root->next(row, valid));
+        if (!valid) {
+            break;
+        }
+        if (!scalar) {
+            values.insert(row[0]);
+        } else if (count++ > 0) {
+            *message = "subquery returns more than one row";
+            return Status::FAILURE;
+        } else {
+            value = row[0];
+        }
+    }
+    done = true;
+    return Status::SUCCESS;
+}
+
+QueryEngine::QueryEngine(Database& dbms, Catalog const& catalog) :
+    dbms(&dbms), catalog(&catalog), message()
+{
+    // Do Nothing
+}
+
+Status QueryEngine::execute(std::string const& sql, QueryResult& result) {
+    message.clear();
+    result.columns.clear();
+    result.rows.clear();
+    result.plan.clear();
+
+    SqlParser parser(sql);
+    Statement stmt;
+    if (parser.parse(stmt) != Status::SUCCESS) {
+        message = parser.error();
+        return Status::FAILURE;
+    }
+
+    std::unique_ptr<Operator> root;
+    Planner planner(*dbms, *catalog, message);
+    CHECK_SUCCESS(planner.plan(*stmt.select, root));
+    for (Field const& field : root->fields()) {
+        result.columns.push_back(field.name);
+    }
+    if (stmt.explain && !stmt.analyze) {
+        result.plan = explain(*root, false);
+        return Status::SUCCESS;
+    }
+
+    Status status = root->open();
+    Row row;
+    bool valid = status == Status::SUCCESS;
+    while (valid) {
+        status = root->next(row, valid);
+        if (status != Status::SUCCESS) {
+            break;
+        }
+        if (valid) {
+            result.rows.push_back(std::move(row));
+        }
+    }
+    if (status != Status::SUCCESS) {
+        if (message.empty()) {
+            message = "execution failed";
+        }
+        return Status::FAILURE;
+    }
+    if (stmt.analyze) {
+        result.plan = explain(*root, true);
+    }
+    return Status::SUCCESS;
+}
+
+std::string const& QueryEngine::error() const {
+    return message;
+}
+
+std::string QueryEngine::explain(Operator const& root, bool analyze) {
+    std::string out;
+    explain_into(root, analyze, 0, out);
+    return out;
+}
@@ -0,0 +1,307 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "result_sink.hpp"
+
+namespace {
+// two digits per lookup, index is twice of the value
+char const DIGITS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+}
+
+ResultBuffer::ResultBuffer(SinkFormat format, size_t capacity)
+    : fmt(format), buffer(new char[capacity]), capacity(capacity), used(0)
+{
+    // Do Nothing
+}
+
+void ResultBuffer::append(Record const& record) {
+    char* out = put(reserve(MAX_RECORD_SIZE), record);
+    if (fmt == SinkFormat::CSV) {
+        *out++ = '\n';
+    }
+    used = out - buffer.get();
+}
+
+void ResultBuffer::append(Record const& rec1, Record const& rec2) {
+    char* out = put(reserve(2 * MAX_RECORD_SIZE), rec1);
+    if (fmt == SinkFormat::CSV) {
+        *out++ = ',';
+    }
+    out = put(out, rec2);
+    if (fmt == SinkFormat::CSV) {
+        *out++ = '\n';
+    }
+    used = out - buffer.get();
+}
+
+void ResultBuffer::append(std::vector<Record const*> const& row) {
+    char* out = reserve(row.size() * MAX_RECORD_SIZE);
+    for (size_t i = 0; i < row.size(); ++i) {
+        if (i > 0 && fmt == SinkFormat::CSV) {
+            *out++ = ',';
+        }
+        out = put(out, *row[i]);
+    }
+    if (fmt == SinkFormat::CSV) {
+        *out++ = '\n';
+    }
+    used = out - buffer.get();
+}
+
+bool ResultBuffer::full() const {
+    return used + 2 * MAX_RECORD_SIZE > capacity;
+}
+
+char const* ResultBuffer::data() const {
+    return buffer.get();
+}
+
+size_t ResultBuffer::size() const {
+    return used;
+}
+
+void ResultBuffer::clear() {
+    used = 0;
+}
+
+SinkFormat ResultBuffer::format() const {
+    return fmt;
+}
+
+size_t ResultBuffer::format_int(char* out, int64_t value) {
+    // magnitude in unsigned, minimum of int64_t is not negatable
+    uint64_t rest = value < 0
+        ? 0 - static_cast<uint64_t>(value)
+        : static_cast<uint64_t>(value);
+
+    char tmp[20];
+    char* ptr = tmp + sizeof(tmp);
+    while (rest >= 100) {
+        size_t idx = (rest % 100) * 2;
+        rest /= 100;
+        *--ptr = DIGITS[idx + 1];
+        *--ptr = DIGITS[idx];
+    }
+    if (rest >= 10) {
+        size_t idx = rest * 2;
+        *--ptr = DIGITS[idx + 1];
+        *--ptr = DIGITS[idx];
+    } else {
+        *--ptr = static_cast<char>('0' + rest);
+    }
+
+    size_t len = tmp + sizeof(tmp) - ptr;
+    size_t sign = 0;
+    if (value < 0) {
+        out[sign++] = '-';
+    }
+    std::memcpy(out + sign, ptr, len);
+    return sign + len;
+}
+
+char* ResultBuffer::reserve(size_t size) {
+    if (used + size > capacity) {
+        size_t grown = std::max(capacity * 2, used + size);
+        std::unique_ptr<char[]> next(new char[grown]);
+        std::memcpy(next.get(), buffer.get(), used);
+        buffer = std::move(next);
+        capacity = grown;
+    }
+    return buffer.get() + used;
+}
+
+char* ResultBuffer::put(char* out, Record const& record) const {
+    if (fmt == SinkFormat::BINARY) {
+        std::memcpy(out, &record, sizeof(Record));
+        return out + sizeof(Record);
+    }
+
+    out += format_int(out, record.key);
+    *out++ = ',';
+    // value is null terminated string, or full length
+    char const* value = reinterpret_cast<char const*>(record.value);
+    size_t len = strnlen(value, sizeof(record.value));
+    std::memcpy(out, value, len);
+    return out + len;
+}
+
+ResultSink::ResultSink(SinkFormat format, size_t capacity)
+    : fd(-1), buffer(format, capacity)
+{
+    // Do Nothing
+}
+
+ResultSink::~ResultSink() {
+    close();
+}
+
+Status ResultSink::open(std::string const& filename) {
+    CHECK_TRUE(fd == -1);
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK_TRUE(fd != -1);
+    buffer.clear();
+    return Status::SUCCESS;
+}
+
+Status ResultSink::write(Record const& record) {
+    buffer.append(record);
+    if (buffer.full()) {
+        return flush();
+    }
+    return Status::SUCCESS;
+}
+
+Status ResultSink::write(Record const& rec1, Record const& rec2) {
+    buffer.append(rec1, rec2);
+    if (buffer.full()) {
+        return flush();
+    }
+    return Status::SUCCESS;
+}
+
+Status ResultSink::write(std::vector<Record const*> const& row) {
+    buffer.append(row);
+    if (buffer.full()) {
+        return flush();
+    }
+    return Status::SUCCESS;
+}
+
+Status ResultSink::write(std::vector<ResultBuffer> const& buffers) {
+    std::vector<ResultBuffer const*> others;
+    for (ResultBuffer const& other : buffers) {
+        CHECK_TRUE(other.format() == buffer.format());
+        others.push_back(&other);
+    }
+    return write_all(others);
+}
+
+Status ResultSink::write(ResultBuffer const& other) {
+    CHECK_TRUE(other.format() == buffer.format());
+    return write_all({ &other });
+}
+
+Status ResultSink::flush() {
+    return write_all({});
+}
+
+Status ResultSink::close() {
+    if (fd == -1) {
+        return Status::SUCCESS;
+    }
+    Status res = flush();
+    if (::close(fd) != 0) {
+        res = Status::FAILURE;
+    }
+    fd = -1;
+    return res;
+}
+
+SinkFormat ResultSink::format() const {
+    return buffer.format();
+}
+
+Status ResultSink::write_all(
+    std::vector<ResultBuffer const*> const& buffers
+) {
+    CHECK_TRUE(fd != -1);
+    std::vector<iovec> iov;
+    if (buffer.size() > 0) {
+        iov.push_back(iovec {
+            const_cast<char*>(buffer.data()), buffer.size() });
+    }
+    for (ResultBuffer const* other : buffers) {
+        if (other->size() > 0) {
+            iov.push_back(iovec {
+                const_cast<char*>(other->data()), other->size() });
+        }
+    }
+    buffer.clear();
+
+    // partial write is resumed from the unwritten bytes
+    size_t idx = 0;
+    while (idx < iov.size()) {
+        int num = static_cast<int>(std::min<size_t>(iov.size() - idx, IOV_MAX));
+        ssize_t written = ::writev(fd, &iov[idx], num);
+        if (written < 0) {
+            CHECK_TRUE(errno == EINTR);
+            continue;
+        }
+        size_t rest = static_cast<size_t>(written);
+        while (idx < iov.size() && rest >= iov[idx].iov_len) {
+            rest -= iov[idx++].iov_len;
+        }
+        if (rest > 0) {
+            iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + rest;
+            iov[idx].iov_len -= rest;
+        }
+    }
+    return Status::SUCCESS;
+}
+
+RangeWriter::RangeWriter(ResultSink& sink, size_t num_ranges, size_t capacity)
+    : sink(&sink), buffers(), mtx(), cond(), turn(0), failed(false)
+{
+    for (size_t i = 0; i < num_ranges; ++i) {
+        buffers.emplace_back(sink.format(), capacity);
+    }
+}
+
+Status RangeWriter::write(
+    size_t range, Record const& rec1, Record const& rec2
+) {
+    CHECK_TRUE(!failed);
+    ResultBuffer& buffer = buffers[range];
+    if (turn != range) {
+        buffer.append(rec1, rec2);
+        if (!buffer.full()) {
+            return Status::SUCCESS;
+        }
+        return drain(range);
+    }
+
+    // rows buffered before the turn come first
+    if (buffer.size() > 0) {
+        CHECK_SUCCESS(drain(range));
+    }
+    return sink->write(rec1, rec2);
+}
+
+Status RangeWriter::finish(size_t range, Status res) {
+    if (res == Status::SUCCESS) {
+        res = drain(range);
+    }
+
+    std::unique_lock<std::mutex> own(mtx);
+    if (res == Status::SUCCESS) {
+        ++turn;
+    } else {
+        failed = true;
+    }
+    cond.notify_all();
+    return res;
+}
+
+Status RangeWriter::drain(size_t range) {
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        cond.wait(own, [&] { return failed || turn == range; });
+    }
+    CHECK_TRUE(!failed);
+
+    // only the range in its turn writes to the sink
+    Status res = sink->write(buffers[range]);
+    buffers[range].clear();
+    return res;
+}
@@ -0,0 +1,552 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "sql_parser.hpp"
+
+namespace {
+
+char const* KEYWORDS[] = {
+    "select", "distinct", "from", "where", "group", "by", "order", "asc",
+    "desc", "limit", "and", "or", "not", "like", "in", "as", "explain",
+    "analyze",
+};
+
+char const* AGGREGATES[] = { "count", "sum", "avg", "min", "max" };
+
+char const* compare_symbol(CompareOp op) {
+    switch (op) {
+    case CompareOp::EQ:
+        return "=";
+    case CompareOp::NE:
+        return "!=";
+    case CompareOp::LT:
+        return "<";
+    case CompareOp::LE:
+        return "<=";
+    case CompareOp::GT:
+        return ">";
+    case CompareOp::GE:
+        return ">=";
+    }
+    return "?";
+}
+
+std::string quote(std::string const& str) {
+    std::string quoted = "'";
+    for (char c : str) {
+        quoted += c;
+        if (c == '\'') {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+}
+
+Expr::Expr(Kind kind) :
+    kind(kind), op(CompareOp::EQ), table(), name(), value(), args(),
+    query(nullptr), negated(false)
+{
+    // Do Nothing
+}
+
+std::string Expr::to_string() const {
+    switch (kind) {
+    case Kind::COLUMN:
+        return table.empty() ? name : table + "." + name;
+    case Kind::LITERAL:
+        return value.type == Value::Type::STR
+            ? quote(value.str)
+            : value.to_string();
+    case Kind::STAR:
+        return "*";
+    case Kind::NOT:
+        return "not " + args[0]->to_string();
+    case Kind::AND:
+    case Kind::OR:
+        return "(" + args[0]->to_string()
+            + (kind == Kind::AND ? " and " : " or ")
+            + args[1]->to_string() + ")";
+    case Kind::COMPARE:
+        return args[0]->to_string() + " " + compare_symbol(op) + " "
+            + args[1]->to_string();
+    case Kind::LIKE:
+        return args[0]->to_string() + (negated ? " not like " : " like ")
+            + args[1]->to_string();
+    case Kind::IN: {
+        std::string text = args[0]->to_string()
+            + (negated ? " not in (" : " in (");
+        if (query != nullptr) {
+            return text + query->to_string() + ")";
+        }
+        for (size_t i = 1; i < args.size(); ++i) {
+            text += (i > 1 ? ", " : "") + args[i]->to_string();
+        }
+        return text + ")";
+    }
+    case Kind::SUBQUERY:
+        return "(" + query->to_string() + ")";
+    case Kind::AGGREGATE:
+        return name + "(" + args[0]->to_string() + ")";
+    }
+    return "";
+}
+
+Select::Select() :
+    distinct(false), items(), from(), where(nullptr), group_by(),
+    order_by(), limit(-1)
+{
+    // Do Nothing
+}
+
+std::string Select::to_string() const {
+    std::string text = distinct ? "select distinct " : "select ";
+    for (size_t i = 0; i < items.size(); ++i) {
+        text += (i > 0 ? ", " : "") + items[i].expr->to_string();
+        if (!items[i].alias.empty()) {
+            text += " as " + items[i].alias;
+        }
+    }
+
+    text += " from ";
+    for (size_t i = 0; i < from.size(); ++i) {
+        TableRef const& ref = from[i];
+        text += i > 0 ? ", " : "";
+        text += ref.query != nullptr
+            ? "(" + ref.query->to_string() + ")"
+            : ref.name;
+        if (!ref.alias.empty()) {
+            text += " " + ref.alias;
+        }
+    }
+
+    if (where != nullptr) {
+        text += " where " + where->to_string();
+    }
+    for (size_t i = 0; i < group_by.size(); ++i) {
+        text += (i > 0 ? ", " : " group by ") + group_by[i]->to_string();
+    }
+    for (size_t i = 0; i < order_by.size(); ++i) {
+        text += (i > 0 ? ", " : " order by ") + order_by[i].expr->to_string();
+        if (order_by[i].desc) {
+            text += " desc";
+        }
+    }
+    if (limit >= 0) {
+        text += " limit " + std::to_string(limit);
+    }
+    return text;
+}
+
+SqlParser::SqlParser(std::string const& sql) :
+    sql(sql), tokens(), cursor(0), message()
+{
+    // Do Nothing
+}
+
+Status SqlParser::parse(Statement& stmt) {
+    tokens.clear();
+    cursor = 0;
+    message.clear();
+    CHECK_SUCCESS(tokenize());
+
+    stmt.explain = accept("explain");
+    stmt.analyze = stmt.explain && accept("analyze");
+    stmt.select = std::make_unique<Select>();
+    CHECK_SUCCESS(parse_select(*stmt.select));
+
+    accept(";");
+    if (peek().kind != Token::Kind::END) {
+        return fail("unexpected token");
+    }
+    return Status::SUCCESS;
+}
+
+std::string const& SqlParser::error() const {
+    return message;
+}
+
+Status SqlParser::tokenize() {
+    size_t pos = 0;
+    while (pos < sql.size()) {
+        unsigned char c = sql[pos];
+        if (std::isspace(c)) {
+            ++pos;
+            continue;
+        }
+        // comment to the end of line
+        if (sql.compare(pos, 2, "--") == 0) {
+            while (pos < sql.size() && sql[pos] != '\n') {
+                ++pos;
+            }
+            continue;
+        }
+
+        Token token { Token::Kind::SYMBOL, "", pos };
+        if (std::isalpha(c) || c == '_') {
+            token.kind = Token::Kind::IDENT;
+            while (pos < sql.size()
+                && (std::isalnum(static_cast<unsigned char>(sql[pos]))
+                    || sql[pos] == '_')
+            ) {
+                token.text += static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(sql[pos++])));
+            }
+        } else if (std::isdigit(c)) {
+            token.kind = Token::Kind::NUMBER;
+            bool dot = false;
+            while (pos < sql.size()
+                && (std::isdigit(static_cast<unsigned char>(sql[pos]))
+                    || (sql[pos] == '.' && !dot))
+            ) {
+                dot |= sql[pos] == '.';
+                token.text += sql[pos++];
+            }
+        } else if (c == '\'') {
+            token.kind = Token::Kind::STRING;
+            for (++pos; ; ++pos) {
+                if (pos >= sql.size()) {
+                    cursor = tokens.size();
+                    tokens.push_back(token);
+                    return fail("unterminated string");
+                }
+                if (sql[pos] == '\'') {
+                    // quote is escaped by doubling
+                    if (pos + 1 < sql.size() && sql[pos + 1] == '\'') {
+                        token.text += sql[++pos];
+                        continue;
+                    }
+                    ++pos;
+                    break;
+                }
+                token.text += sql[pos];
+            }
+        } else if (sql.compare(pos, 2, "!=") == 0
+            || sql.compare(pos, 2, "<>") == 0
+            || sql.compare(pos, 2, "<=") == 0
+            || sql.compare(pos, 2, ">=") == 0
+        ) {
+            token.text = sql.substr(pos, 2);
+            pos += 2;
+        } else if (std::strchr(",.()*=<>;-", c) != nullptr) {
+            token.text = std::string(1, static_cast<char>(c));
+            ++pos;
+        } else {
+            cursor = tokens.size();
+            tokens.push_back(token);
+            return fail("invalid character");
+        }
+        tokens.push_back(std::move(token));
+    }
+    tokens.push_back(Token { Token::Kind::END, "", sql.size() });
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_select(Select& select) {
+    CHECK_SUCCESS(expect("select"));
+    select.distinct = accept("distinct");
+    do {
+        SelectItem item;
+        if (accept("*")) {
+            item.expr = std::make_unique<Expr>(Expr::Kind::STAR);
+        } else {
+            CHECK_SUCCESS(parse_or(item.expr));
+            CHECK_SUCCESS(parse_alias(item.alias));
+        }
+        select.items.push_back(std::move(item));
+    } while (accept(","));
+
+    CHECK_SUCCESS(expect("from"));
+    do {
+        TableRef ref;
+        CHECK_SUCCESS(parse_table(ref));
+        select.from.push_back(std::move(ref));
+    } while (accept(","));
+
+    if (accept("where")) {
+        CHECK_SUCCESS(parse_or(select.where));
+    }
+    if (accept("group")) {
+        CHECK_SUCCESS(expect("by"));
+        do {
+            ExprPtr expr;
+            CHECK_SUCCESS(parse_or(expr));
+            select.group_by.push_back(std::move(expr));
+        } while (accept(","));
+    }
+    if (accept("order")) {
+        CHECK_SUCCESS(expect("by"));
+        do {
+            OrderItem item { nullptr, false };
+            CHECK_SUCCESS(parse_or(item.expr));
+            if (accept("desc")) {
+                item.desc = true;
+            } else {
+                accept("asc");
+            }
+            select.order_by.push_back(std::move(item));
+        } while (accept(","));
+    }
+    if (accept("limit")) {
+        Token const& token = peek();
+        if (token.kind != Token::Kind::NUMBER
+            || token.text.find('.') != std::string::npos
+        ) {
+            return fail("expected integer limit");
+        }
+        select.limit = std::strtoll(token.text.c_str(), nullptr, 10);
+        ++cursor;
+    }
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_table(TableRef& ref) {
+    if (accept("(")) {
+        ref.query = std::make_unique<Select>();
+        CHECK_SUCCESS(parse_select(*ref.query));
+        CHECK_SUCCESS(expect(")"));
+        CHECK_SUCCESS(parse_alias(ref.alias));
+        if (ref.alias.empty()) {
+            return fail("derived table needs alias");
+        }
+        return Status::SUCCESS;
+    }
+
+    Token const& token = peek();
+    if (token.kind != Token::Kind::IDENT || is_keyword(token.text)) {
+        return fail("expected table name");
+    }
+    ref.name = token.text;
+    ++cursor;
+    return parse_alias(ref.alias);
+}
+
+Status SqlParser::parse_or(ExprPtr& expr) {
+    CHECK_SUCCESS(parse_and(expr));
+    while (accept("or")) {
+        auto node = std::make_unique<Expr>(Expr::Kind::OR);
+        node->args.push_back(std::move(expr));
+        node->args.emplace_back();
+        CHECK_SUCCESS(parse_and(node->args.back()));
+        expr = std::move(node);
+    }
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_and(ExprPtr& expr) {
+    CHECK_SUCCESS(parse_not(expr));
+    while (accept("and")) {
+        auto node = std::make_unique<Expr>(Expr::Kind::AND);
+        node->args.push_back(std::move(expr));
+        node->args.emplace_back();
+        CHECK_SUCCESS(parse_not(node->args.back()));
+        expr = std::move(node);
+    }
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_not(ExprPtr& expr) {
+    if (!accept("not")) {
+        return parse_predicate(expr);
+    }
+    expr = std::make_unique<Expr>(Expr::Kind::NOT);
+    expr->args.emplace_back();
+    return parse_not(expr->args.back());
+}
+
+Status SqlParser::parse_predicate(ExprPtr& expr) {
+    CHECK_SUCCESS(parse_primary(expr));
+
+    static char const* symbols[] = { "=", "!=", "<>", "<", "<=", ">", ">=" };
+    static CompareOp const ops[] = {
+        CompareOp::EQ, CompareOp::NE, CompareOp::NE, CompareOp::LT,
+        CompareOp::LE, CompareOp::GT, CompareOp::GE,
+    };
+    if (peek().kind == Token::Kind::SYMBOL) {
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+            if (accept(symbols[i])) {
+                auto node = std::make_unique<Expr>(Expr::Kind::COMPARE);
+                node->op = ops[i];
+                node->args.push_back(std::move(expr));
+                node->args.emplace_back();
+                CHECK_SUCCESS(parse_primary(node->args.back()));
+                expr = std::move(node);
+                return Status::SUCCESS;
+            }
+        }
+    }
+
+    bool negated = accept("not");
+    if (accept("like")) {
+        if (peek().kind != Token::Kind::STRING) {
+            return fail("expected pattern string");
+        }
+        auto pattern = std::make_unique<Expr>(Expr::Kind::LITERAL);
+        pattern->value = Value::of(peek().text);
+        ++cursor;
+
+        auto node = std::make_unique<Expr>(Expr::Kind::LIKE);
+        node->negated = negated;
+        node->args.push_back(std::move(expr));
+        node->args.push_back(std::move(pattern));
+        expr = std::move(node);
+        return Status::SUCCESS;
+    }
+    if (accept("in")) {
+        auto node = std::make_unique<Expr>(Expr::Kind::IN);
+        node->negated = negated;
+        node->args.push_back(std::move(expr));
+        CHECK_SUCCESS(expect("("));
+        if (is("select")) {
+            node->query = std::make_unique<Select>();
+            CHECK_SUCCESS(parse_select(*node->query));
+        } else {
+            do {
+                node->args.emplace_back();
+                CHECK_SUCCESS(parse_or(node->args.back()));
+            } while (accept(","));
+        }
+        CHECK_SUCCESS(expect(")"));
+        expr = std::move(node);
+        return Status::SUCCESS;
+    }
+    if (negated) {
+        return fail("expected like or in");
+    }
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_primary(ExprPtr& expr) {
+    Token const& token = peek();
+    bool minus = token.kind == Token::Kind::SYMBOL && token.text == "-"
+        && tokens[cursor + 1].kind == Token::Kind::NUMBER;
+    if (minus || token.kind == Token::Kind::NUMBER) {
+        cursor += minus;
+        std::string text = (minus ? "-" : "") + peek().text;
+        ++cursor;
+
+        expr = std::make_unique<Expr>(Expr::Kind::LITERAL);
+        errno = 0;
+        if (text.find('.') != std::string::npos) {
+            expr->value = Value::of(std::strtod(text.c_str(), nullptr));
+        } else {
+            expr->value = Value::of(
+                static_cast<int64_t>(std::strtoll(text.c_str(), nullptr, 10)));
+        }
+        if (errno == ERANGE) {
+            --cursor;
+            return fail("number out of range");
+        }
+        return Status::SUCCESS;
+    }
+
+    if (token.kind == Token::Kind::STRING) {
+        expr = std::make_unique<Expr>(Expr::Kind::LITERAL);
+        expr->value = Value::of(token.text);
+        ++cursor;
+        return Status::SUCCESS;
+    }
+
+    if (accept("(")) {
+        if (is("select")) {
+            expr = std::make_unique<Expr>(Expr::Kind::SUBQUERY);
+            expr->query = std::make_unique<Select>();
+            CHECK_SUCCESS(parse_select(*expr->query));
+        } else {
+            CHECK_SUCCESS(parse_or(expr));
+        }
+        return expect(")");
+    }
+
+    if (token.kind != Token::Kind::IDENT || is_keyword(token.text)) {
+        return fail("expected expression");
+    }
+    std::string name = token.text;
+    ++cursor;
+
+    for (char const* func : AGGREGATES) {
+        if (name == func && accept("(")) {
+            expr = std::make_unique<Expr>(Expr::Kind::AGGREGATE);
+            expr->name = name;
+            if (name == "count" && accept("*")) {
+                expr->args.push_back(std::make_unique<Expr>(Expr::Kind::STAR));
+            } else {
+                expr->args.emplace_back();
+                CHECK_SUCCESS(parse_or(expr->args.back()));
+            }
+            return expect(")");
+        }
+    }
+
+    expr = std::make_unique<Expr>(Expr::Kind::COLUMN);
+    if (accept(".")) {
+        Token const& column = peek();
+        if (column.kind != Token::Kind::IDENT) {
+            return fail("expected column name");
+        }
+        expr->table = name;
+        name = column.text;
+        ++cursor;
+    }
+    expr->name = name;
+    return Status::SUCCESS;
+}
+
+Status SqlParser::parse_alias(std::string& alias) {
+    alias.clear();
+    bool as = accept("as");
+    Token const& token = peek();
+    if (token.kind == Token::Kind::IDENT && !is_keyword(token.text)) {
+        alias = token.text;
+        ++cursor;
+        return Status::SUCCESS;
+    }
+    return as ? fail("expected alias") : Status::SUCCESS;
+}
+
+SqlParser::Token const& SqlParser::peek() const {
+    return tokens[cursor];
+}
+
+bool SqlParser::is(char const* text) const {
+    Token const& token = peek();
+    return (token.kind == Token::Kind::IDENT
+            || token.kind == Token::Kind::SYMBOL)
+        && token.text == text;
+}
+
+bool SqlParser::accept(char const* text) {
+    if (is(text)) {
+        ++cursor;
+        return true;
+    }
+    return false;
+}
+
+Status SqlParser::expect(char const* text) {
+    if (accept(text)) {
+        return Status::SUCCESS;
+    }
+    return fail(std::string("expected ") + text);
+}
+
+Status SqlParser::fail(std::string const& what) {
+    Token const& token = peek();
+    message = what + " at " + std::to_string(token.pos);
+    if (token.kind != Token::Kind::END) {
+        message += " near '" + sql.substr(token.pos, 16) + "'";
+    }
+    return Status::FAILURE;
+}
+
+bool SqlParser::is_keyword(std::string const& ident) {
+    for (char const* keyword : KEYWORDS) {
+        if (ident == keyword) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -33,22 +33,30 @@ Status Table::find(prikey_t key, Record* record, trxid_t xid) const {
     return bpt.find(key, record, xid);
 }
 
-std::vector<Record> Table::find_range(prikey_t start, prikey_t end) const {
-    return bpt.find_range(start, end);
+Status Table::find_batch(
+    std::vector<prikey_t> const& keys, std::vector<Record>& records
+) const {
+    return bpt.find_batch(keys, records);
+}
+
+std::vector<Record> Table::find_range(
+    prikey_t start, prikey_t end, Predicate const* filter
+) const {
+    return bpt.find_range(start, end, filter);
 }
 
 Status Table::insert(
-    prikey_t key, uint8_t const* value, int value_size
+    prikey_t key, uint8_t const* value, int value_size, trxid_t xid
 ) const {
-    return bpt.insert(key, value, value_size);
+    return bpt.insert(key, value, value_size, xid);
 }
 
 Status Table::update(prikey_t key, Record const& rec, trxid_t xid) const {
     return bpt.update(key, rec, xid);
 }
 
-Status Table::remove(prikey_t key) const {
-    return bpt.remove(key);
+Status Table::remove(prikey_t key, trxid_t xid) const {
+    return bpt.remove(key, xid);
 }
 
 Status Table::destroy_tree() const {
@@ -63,6 +71,20 @@ Table::RecordIterator Table::end() const {
     return bpt.end();
 }
 
+pagenum_t Table::num_pages() const {
+    return bpt.num_pages();
+}
+
+std::vector<prikey_t> Table::separators(size_t num) const {
+    return bpt.separators(num);
+}
+
+BPTreeBatchIterator Table::batches(
+    prikey_t start, prikey_t end, Predicate const* filter
+) const {
+    return bpt.batches(start, end, filter);
+}
+
 fileid_t Table::fileid() const {
     return file.get_id();
 }
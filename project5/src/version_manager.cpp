@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstring>
+
+#include "version_manager.hpp"
+
+VersionManager::VersionManager()
+    : mtx(), clock(0), active(), garbage(), shards()
+    , num_versions(0), num_collected(0)
+{
+    // Do Nothing
+}
+
+timestamp_t VersionManager::begin(trxid_t xid) {
+    std::unique_lock<std::mutex> own(mtx);
+    Context& context = active[xid];
+    context.snapshot = clock;
+    context.stamp = std::make_shared<std::atomic<timestamp_t>>(UNCOMMITTED);
+    context.writes.clear();
+    return context.snapshot;
+}
+
+Status VersionManager::commit(trxid_t xid) {
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        auto iter = active.find(xid);
+        if (iter == active.end()) {
+            return Status::SUCCESS;
+        }
+        // stamp under the snapshot mutex, so later snapshots see it all
+        timestamp_t stamp = ++clock;
+        iter->second.stamp->store(stamp);
+        if (!iter->second.writes.empty()) {
+            garbage.push_back(
+                Committed{ stamp, std::move(iter->second.writes) });
+        }
+        active.erase(iter);
+    }
+    collect();
+    return Status::SUCCESS;
+}
+
+Status VersionManager::abort(trxid_t xid) {
+    std::vector<chainid_t> writes;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        auto iter = active.find(xid);
+        if (iter == active.end()) {
+            return Status::SUCCESS;
+        }
+        writes = std::move(iter->second.writes);
+        active.erase(iter);
+    }
+
+    for (chainid_t const& id : writes) {
+        Shard& shard = shard_of(id);
+        std::unique_lock<std::mutex> own(shard.mtx);
+        auto iter = shard.chains.find(id);
+        if (iter == shard.chains.end()) {
+            continue;
+        }
+        // other writers may push their versions after the rollback
+        std::unique_ptr<Version>* link = &iter->second;
+        while (*link != nullptr && (*link)->writer != xid) {
+            link = &(*link)->older;
+        }
+        if (*link != nullptr) {
+            std::unique_ptr<Version> aborted = std::move(*link);
+            *link = std::move(aborted->older);
+            --num_versions;
+        }
+        if (iter->second == nullptr) {
+            shard.chains.erase(iter);
+        }
+    }
+    collect();
+    return Status::SUCCESS;
+}
+
+bool VersionManager::conflict(trxid_t xid, tableid_t tid, prikey_t key) {
+    timestamp_t snapshot;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        auto iter = active.find(xid);
+        if (iter == active.end()) {
+            return false;
+        }
+        snapshot = iter->second.snapshot;
+    }
+
+    chainid_t id(tid, key);
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    auto iter = shard.chains.find(id);
+    if (iter == shard.chains.end()) {
+        return false;
+    }
+    // uncommitted versions of the others are aborted ones under the lock
+    for (Version const* version = iter->second.get();
+        version != nullptr && version->writer != xid;
+        version = version->older.get()
+    ) {
+        timestamp_t stamp = version->stamp->load();
+        if (stamp != UNCOMMITTED) {
+            return stamp > snapshot;
+        }
+    }
+    return false;
+}
+
+Status VersionManager::record(
+    trxid_t xid, tableid_t tid, prikey_t key,
+    bool exists, Record const& image
+) {
+    chainid_t id(tid, key);
+    std::shared_ptr<std::atomic<timestamp_t>> stamp;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        auto iter = active.find(xid);
+        if (iter == active.end()) {
+            // transaction without snapshot, nothing to keep
+            return Status::SUCCESS;
+        }
+        stamp = iter->second.stamp;
+    }
+
+    Shard& shard = shard_of(id);
+    {
+        std::unique_lock<std::mutex> own(shard.mtx);
+        std::unique_ptr<Version>& newest = shard.chains[id];
+        if (newest != nullptr && newest->writer == xid) {
+            // committed image is already kept by the first write
+            return Status::SUCCESS;
+        }
+
+        std::unique_ptr<Version> version = std::make_unique<Version>();
+        version->writer = xid;
+        version->stamp = std::move(stamp);
+        version->exists = exists;
+        std::memcpy(&version->image, &image, sizeof(Record));
+        version->older = std::move(newest);
+        newest = std::move(version);
+        ++num_versions;
+    }
+
+    std::unique_lock<std::mutex> own(mtx);
+    auto iter = active.find(xid);
+    if (iter != active.end()) {
+        iter->second.writes.push_back(id);
+    }
+    return Status::SUCCESS;
+}
+
+Status VersionManager::read(
+    trxid_t xid, tableid_t tid, prikey_t key,
+    bool exists, Record* record
+) {
+    timestamp_t snapshot = snapshot_of(xid);
+
+    chainid_t id(tid, key);
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    auto iter = shard.chains.find(id);
+    if (iter == shard.chains.end()) {
+        return exists ? Status::SUCCESS : Status::FAILURE;
+    }
+
+    // rewind the writes which are invisible to the snapshot
+    Version const* visible = nullptr;
+    for (Version const* version = iter->second.get();
+        version != nullptr;
+        version = version->older.get()
+    ) {
+        timestamp_t stamp = version->stamp->load();
+        if (version->writer == xid
+            || (stamp != UNCOMMITTED && stamp <= snapshot)
+        ) {
+            break;
+        }
+        visible = version;
+    }
+
+    if (visible == nullptr) {
+        return exists ? Status::SUCCESS : Status::FAILURE;
+    }
+    if (!visible->exists) {
+        return Status::FAILURE;
+    }
+    if (record != nullptr) {
+        std::memcpy(record, &visible->image, sizeof(Record));
+    }
+    return Status::SUCCESS;
+}
+
+size_t VersionManager::collect() {
+    timestamp_t bound;
+    std::vector<Committed> targets;
+    {
+        std::unique_lock<std::mutex> own(mtx);
+        bound = oldest();
+        while (!garbage.empty() && garbage.front().stamp <= bound) {
+            targets.push_back(std::move(garbage.front()));
+            garbage.pop_front();
+        }
+    }
+
+    size_t collected = 0;
+    for (Committed const& committed : targets) {
+        for (chainid_t const& id : committed.writes) {
+            collected += prune(id, bound);
+        }
+    }
+    num_versions -= collected;
+    num_collected += collected;
+    return collected;
+}
+
+VersionStats VersionManager::stats() {
+    std::unique_lock<std::mutex> own(mtx);
+    return VersionStats{
+        num_versions.load(), num_collected.load(), oldest() };
+}
+
+VersionManager::Shard& VersionManager::shard_of(chainid_t const& id) {
+    return shards[ChainHash{}(id) % NUM_SHARDS];
+}
+
+timestamp_t VersionManager::snapshot_of(trxid_t xid) {
+    std::unique_lock<std::mutex> own(mtx);
+    auto iter = active.find(xid);
+    if (iter == active.end()) {
+        return clock;
+    }
+    return iter->second.snapshot;
+}
+
+timestamp_t VersionManager::oldest() const {
+    timestamp_t retn = clock;
+    for (auto const& pair : active) {
+        retn = std::min(retn, pair.second.snapshot);
+    }
+    return retn;
+}
+
+size_t VersionManager::prune(chainid_t const& id, timestamp_t oldest) {
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    auto iter = shard.chains.find(id);
+    if (iter == shard.chains.end()) {
+        return 0;
+    }
+
+    // every snapshot sees the write, so its prior image is unreachable
+    std::unique_ptr<Version>* link = &iter->second;
+    while (*link != nullptr) {
+        timestamp_t stamp = (*link)->stamp->load();
+        if (stamp != UNCOMMITTED && stamp <= oldest) {
+            break;
+        }
+        link = &(*link)->older;
+    }
+
+    size_t num = 0;
+    std::unique_ptr<Version> dropped = std::move(*link);
+    while (dropped != nullptr) {
+        dropped = std::move(dropped->older);
+        ++num;
+    }
+    if (iter->second == nullptr) {
+        shard.chains.erase(iter);
+    }
+    return num;
+}
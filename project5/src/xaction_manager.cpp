@@ -6,38 +6,41 @@
 #include "xaction_manager.hpp"
 
 Transaction::Transaction()
-    : id(INVALID_TRXID), state(TrxState::IDLE)
-    , wait(nullptr), locks(), mtx(nullptr)
+    : id(INVALID_TRXID), read_only(false), state(TrxState::IDLE)
+    , wait(nullptr), locks(), children(), mtx(nullptr)
 {
     // Do Nothing
 }
 
-Transaction::Transaction(trxid_t id)
-    : id(id), state(TrxState::RUNNING), wait(nullptr)
-    , locks(), mtx(std::make_unique<std::mutex>())
+Transaction::Transaction(trxid_t id, bool read_only)
+    : id(id), read_only(read_only), state(TrxState::RUNNING), wait(nullptr)
+    , locks(), children(), mtx(std::make_unique<std::mutex>())
 {
     // Do Nothing
 }
 
 Transaction::Transaction(Transaction&& trx) noexcept
-    : id(trx.id), state(trx.state.load()), wait(std::move(trx.wait))
-    , locks(std::move(trx.locks)), mtx(std::move(trx.mtx))
+    : id(trx.id), read_only(trx.read_only), state(trx.state.load()), wait(trx.wait)
+    , locks(std::move(trx.locks)), children(std::move(trx.children))
+    , mtx(std::move(trx.mtx))
 {
     trx.state = TrxState::IDLE;
     trx.id = INVALID_TRXID;
-    trx.state = TrxState::IDLE;
+    trx.wait = nullptr;
 }
 
 Transaction& Transaction::operator=(Transaction&& trx) noexcept {
     id = trx.id;
+    read_only = trx.read_only;
     state = trx.state.load();
-    wait = std::move(trx.wait);
+    wait = trx.wait;
     locks = std::move(trx.locks);
+    children = std::move(trx.children);
     mtx = std::move(trx.mtx);
 
     trx.state = TrxState::IDLE;
     trx.id = INVALID_TRXID;
-    trx.state = TrxState::IDLE;
+    trx.wait = nullptr;
     return *this;
 }
 
@@ -45,52 +48,59 @@ Status Transaction::end_trx(LockManager& manager) {
     return release_locks(manager);
 }
 
-Status Transaction::abort_trx(Database& dbms) {
+Status Transaction::abort_trx(Database& dbms, bool locked) {
     std::unique_lock<std::mutex> own(*mtx);
+    CHECK_TRUE(state != TrxState::ABORTED);
     state = TrxState::ABORTED;
-    std::list<Log> logs = dbms.logs.get_logs(id);
-    for (Log const& log : logs) {
-        FileManager* file = dbms.tables.find_file(log.hid.tid);
-        CHECK_NULL(file);
-        dbms.buffers.buffering(*file, log.hid.pid).write_void(
-            [&](Page& page) {
-                std::memcpy(&page.records()[log.offset], &log.before, sizeof(Record));
-            });
+    if (read_only) {
+        // nothing to undo, no log is written
+        own.unlock();
+        return release_locks(dbms.locks, locked);
     }
 
+    std::list<Log> logs = dbms.logs.get_logs(id);
+    dbms.logs.log_abort(id);
+    CHECK_SUCCESS(dbms.logs.rollback(dbms, logs));
+    dbms.logs.log_end(id);
+
     own.unlock();
-    return release_locks(dbms.locks);
+    return release_locks(dbms.locks, locked);
 }
 
 Status Transaction::require_lock(
     LockManager& manager, HID hid, LockMode mode
 ) {
     CHECK_TRUE(state == TrxState::RUNNING);
-    std::unique_lock<std::mutex> own(*mtx);
-    if (locks.find(hid) != locks.end()) {
-        std::shared_ptr<Lock> lock = locks.at(hid);
-        if (static_cast<int>(mode) > static_cast<int>(lock->get_mode())) {
-            own.unlock();
-            return elevate_lock(manager, std::move(lock), mode);
-        }
-
+    // read-only transaction reads from the snapshot without locks
+    CHECK_TRUE(!read_only);
+    if (covered(hid, mode)) {
         return Status::SUCCESS;
     }
 
-    own.unlock();
-    auto lock = manager.require_lock(this, hid, mode);
+    // intention locks from the coarsest granularity
+    LockMode intention = LockModes::intention(mode);
+    if (hid.level() == LockLevel::RECORD) {
+        CHECK_SUCCESS(acquire_lock(manager, HID::table(hid.tid), intention));
+        CHECK_SUCCESS(acquire_lock(manager, hid.parent(), intention));
+    } else if (hid.level() == LockLevel::PAGE) {
+        CHECK_SUCCESS(acquire_lock(manager, hid.parent(), intention));
+    }
 
-    if (state == TrxState::RUNNING) {
-        own.lock();
-        locks[hid] = std::move(lock);
+    // ancestor could be elevated to the covering mode
+    if (covered(hid, mode)) {
         return Status::SUCCESS;
     }
-    return Status::FAILURE;
+    CHECK_SUCCESS(acquire_lock(manager, hid, mode));
+
+    if (hid.level() == LockLevel::RECORD) {
+        CHECK_SUCCESS(escalate_lock(manager, hid.parent()));
+    }
+    return escalate_lock(manager, HID::table(hid.tid));
 }
 
-Status Transaction::release_locks(LockManager& manager) {
+Status Transaction::release_locks(LockManager& manager, bool locked) {
     std::unique_lock<std::mutex> own(*mtx);
-    bool acquire = state != TrxState::ABORTED;
+    bool acquire = !locked;
     if (wait != nullptr) {
         CHECK_SUCCESS(manager.release_lock(wait, acquire));
     }
@@ -98,6 +108,7 @@ Status Transaction::release_locks(LockManager& manager) {
         CHECK_SUCCESS(manager.release_lock(pair.second, acquire));
     }
     locks.clear();
+    children.clear();
     return Status::SUCCESS;
 }
 
@@ -109,73 +120,185 @@ TrxState Transaction::get_state() const {
     return state;
 }
 
-std::shared_ptr<Lock> Transaction::get_wait() const {
+bool Transaction::is_read_only() const {
+    return read_only;
+}
+
+Lock* Transaction::get_wait() const {
     return wait;
 }
 
-std::map<HID, std::shared_ptr<Lock>> const& Transaction::get_locks() const {
+auto Transaction::get_locks() const -> lockmap_t const& {
     return locks;
 }
 
+bool Transaction::covered(HID hid, LockMode mode) const {
+    std::unique_lock<std::mutex> own(*mtx);
+    for (; hid.level() != LockLevel::INVALID; hid = hid.parent()) {
+        auto iter = locks.find(hid);
+        if (iter != locks.end()
+            && LockModes::covers(iter->second->get_mode(), mode)
+        ) {
+            return true;
+        }
+        // ancestors should cover the lock in non-intention mode
+        mode = LockModes::escalated(mode);
+    }
+    return false;
+}
+
+Status Transaction::acquire_lock(
+    LockManager& manager, HID hid, LockMode mode
+) {
+    std::unique_lock<std::mutex> own(*mtx);
+    auto iter = locks.find(hid);
+    if (iter != locks.end()) {
+        Lock* lock = iter->second;
+        LockMode held = lock->get_mode();
+        if (LockModes::covers(held, mode)) {
+            return Status::SUCCESS;
+        }
+
+        own.unlock();
+        return elevate_lock(manager, lock, LockModes::supremum(held, mode));
+    }
+
+    own.unlock();
+    Lock* lock = manager.require_lock(this, hid, mode);
+
+    if (lock != nullptr && state == TrxState::RUNNING) {
+        own.lock();
+        locks[hid] = lock;
+        if (hid.level() == LockLevel::RECORD
+            || hid.level() == LockLevel::PAGE
+        ) {
+            Children& child = children[hid.parent()];
+            child.num++;
+            child.mode = LockModes::supremum(
+                child.mode, LockModes::escalated(mode));
+        }
+        return Status::SUCCESS;
+    }
+    return Status::FAILURE;
+}
+
 Status Transaction::elevate_lock(
-    LockManager& manager, std::shared_ptr<Lock> lock, LockMode mode
+    LockManager& manager, Lock* lock, LockMode mode
 ) {
+    // upgrade in place, the weaker mode is held until it is granted
     HID hid = lock->get_hid();
-    CHECK_SUCCESS(manager.release_lock(lock));
-    auto new_lock = manager.require_lock(this, hid, mode);
+    CHECK_SUCCESS(manager.upgrade_lock(lock, mode));
+    CHECK_TRUE(state == TrxState::RUNNING);
+
+    std::unique_lock<std::mutex> own(*mtx);
+    auto iter = children.find(hid.parent());
+    if (iter != children.end()) {
+        iter->second.mode = LockModes::supremum(
+            iter->second.mode, LockModes::escalated(mode));
+    }
+    return Status::SUCCESS;
+}
+
+Status Transaction::escalate_lock(LockManager& manager, HID parent) {
+    std::unique_lock<std::mutex> own(*mtx);
+    auto iter = children.find(parent);
+    if (iter == children.end()) {
+        return Status::SUCCESS;
+    }
+
+    size_t threshold = parent.level() == LockLevel::PAGE
+        ? manager.record_escalation()
+        : manager.page_escalation();
+    if (threshold == 0 || iter->second.num < threshold) {
+        return Status::SUCCESS;
+    }
+
+    LockMode mode = iter->second.mode;
+    own.unlock();
+
+    if (parent.level() == LockLevel::PAGE) {
+        CHECK_SUCCESS(acquire_lock(
+            manager, parent.parent(), LockModes::intention(mode)));
+    }
+    CHECK_SUCCESS(acquire_lock(manager, parent, mode));
 
-    if (state == TrxState::RUNNING) {
-        std::unique_lock<std::mutex> own(*mtx);
-        locks[hid] = new_lock;
+    // release all locks in lower granularity, they are covered by parent
+    std::vector<Lock*> released;
+    own.lock();
+    HID start = parent.level() == LockLevel::PAGE
+        ? HID(parent.tid, parent.pid, 0)
+        : HID(parent.tid, INVALID_PAGENUM, 0);
+    for (auto lock = locks.lower_bound(start); lock != locks.end();) {
+        HID const& hid = lock->first;
+        if (hid.tid != parent.tid
+            || (parent.level() == LockLevel::PAGE && hid.pid != parent.pid)
+        ) {
+            break;
+        }
+        if (hid == parent) {
+            ++lock;
+            continue;
+        }
+        children.erase(hid);
+        released.push_back(lock->second);
+        lock = locks.erase(lock);
+    }
+    children.erase(parent);
+    own.unlock();
+
+    for (Lock* lock : released) {
+        CHECK_SUCCESS(manager.release_lock(lock));
     }
     return Status::SUCCESS;
 }
 
 TransactionManager::TransactionManager(LockManager& lockmng)
-    : mtx(), lock_manager(&lockmng), last_id(0), trxs()
+    : lock_manager(&lockmng), last_id(0), shards()
 {
     // Do Nothing
 }
 
-trxid_t TransactionManager::new_trx() {
-    std::unique_lock<std::mutex> lock(mtx);
-
+trxid_t TransactionManager::new_trx(bool read_only) {
     trxid_t id = ++last_id;
-    if (last_id < 0) {
-        last_id = 1;
+    while (id <= 0) {
+        // wrap around, restart from the first ID
+        trxid_t wrapped = id;
+        last_id.compare_exchange_strong(wrapped, 0);
+        id = ++last_id;
     }
 
-    if (trxs.find(id) != trxs.end()) {
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    if (shard.trxs.find(id) != shard.trxs.end()) {
         return INVALID_TRXID;
     }
 
-    trxs.emplace(id, Transaction(id));
+    shard.trxs.emplace(id, std::make_shared<Transaction>(id, read_only));
     return id;
 }
 
 Status TransactionManager::end_trx(trxid_t id) {
-    std::unique_lock<std::mutex> own(mtx);
-    auto iter = trxs.find(id);
-    CHECK_TRUE(iter != trxs.end());
-    Transaction& trx = iter->second;
-
-    own.unlock();
-    CHECK_SUCCESS(trx.end_trx(*lock_manager));
+    std::shared_ptr<Transaction> trx = find_trx(id);
+    CHECK_NULL(trx);
+    CHECK_SUCCESS(trx->end_trx(*lock_manager));
 
-    own.lock();
-    trxs.erase(id);
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    shard.trxs.erase(id);
     return Status::SUCCESS;
 }
 
-Status TransactionManager::abort_trx(trxid_t id, Database& dbms) {
-    std::unique_lock<std::mutex> own(mtx);
-    auto iter = trxs.find(id);
-    CHECK_TRUE(iter != trxs.end());
-
-    Transaction& trx = iter->second;
-    CHECK_SUCCESS(trx.abort_trx(dbms));
-
-    trxs.erase(id);
+Status TransactionManager::abort_trx(
+    trxid_t id, Database& dbms, bool locked
+) {
+    // roll back outside the shard, the state admits only the first abort
+    std::shared_ptr<Transaction> trx = find_trx(id);
+    CHECK_NULL(trx);
+    CHECK_SUCCESS(trx->abort_trx(dbms, locked));
+
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    shard.trxs.erase(id);
     return Status::SUCCESS;
 }
 
@@ -190,9 +313,23 @@ Status TransactionManager::require_lock(
 Status TransactionManager::release_locks(trxid_t id) {
     return use_trx<Status>(
         id, Status::FAILURE,
-        &Transaction::release_locks, *lock_manager);
+        &Transaction::release_locks, *lock_manager, false);
 }
 
 TrxState TransactionManager::trx_state(trxid_t id) {
     return use_trx<TrxState>(id, TrxState::INVALID, &Transaction::get_state);
+}
+
+bool TransactionManager::read_only(trxid_t id) {
+    return use_trx<bool>(id, false, &Transaction::is_read_only);
+}
+
+std::shared_ptr<Transaction> TransactionManager::find_trx(trxid_t id) {
+    Shard& shard = shard_of(id);
+    std::unique_lock<std::mutex> own(shard.mtx);
+    auto iter = shard.trxs.find(id);
+    if (iter == shard.trxs.end()) {
+        return nullptr;
+    }
+    return iter->second;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aggregate.hpp"
+#include "dbms.hpp"
+#include "test.hpp"
+
+struct AggregateTest {
+    TEST_METHOD(aggregate)
+    TEST_METHOD(distinct)
+    TEST_METHOD(group_by)
+};
+
+using group_map_t = std::unordered_map<prikey_t, Aggregate>;
+
+size_t aggregate_workers[] = { 1, 4 };
+
+static tableid_t prepare(Database& dbms, int num_keys) {
+    tableid_t tid = dbms.open_table("testfile");
+    char value[16];
+    for (int i = 0; i < num_keys; ++i) {
+        int len = std::snprintf(value, sizeof(value), "%d", i % 37 - 5);
+        dbms.insert(tid, i, reinterpret_cast<uint8_t*>(value), len + 1);
+    }
+    return tid;
+}
+
+static prikey_t key_of(Record const& record) {
+    return record.key;
+}
+
+TEST_SUITE(AggregateTest::aggregate, {
+    {
+        Database dbms(1000);
+        tableid_t tid = prepare(dbms, 5000);
+        Table const* table = dbms[tid];
+
+        for (size_t workers : aggregate_workers) {
+            Aggregate result;
+            TEST_SUCCESS(dbms.aggregate(
+                tid, AggregateOper::value_as_int, result, workers));
+            TEST(result.count == 5000);
+            TEST(result.min == -5);
+            TEST(result.max == 31);
+
+            aggval_t sum = 0;
+            for (int i = 0; i < 5000; ++i) {
+                sum += i % 37 - 5;
+            }
+            TEST(result.sum == sum);
+            TEST(result.avg() == static_cast<double>(sum) / 5000);
+
+            // key range crossing the ranges of the workers
+            TEST_SUCCESS(AggregateOper::aggregate(
+                table, key_of, result, workers, 1000, 3999));
+            TEST(result.count == 3000);
+            TEST(result.min == 1000);
+            TEST(result.max == 3999);
+            TEST(result.sum == (1000 + 3999) * 3000 / 2);
+
+            TEST_SUCCESS(AggregateOper::aggregate(
+                table, key_of, result, workers, 6000, 7000));
+            TEST(result.count == 0);
+            TEST(result.avg() == 0);
+        }
+
+        // failure of the worker is reported
+        TEST(AggregateOper::parallel_scan(
+            table, 4, 0, 4999, [](size_t, Record const& rec) {
+                return rec.key == 4321 ? Status::FAILURE : Status::SUCCESS;
+            }) == Status::FAILURE);
+        TEST(AggregateOper::parallel_scan(
+            table, 0, 0, 4999, [](size_t, Record const&) {
+                return Status::SUCCESS;
+            }) == Status::FAILURE);
+
+        // overflow of the sum is reported instead of wrapped
+        constexpr aggval_t LARGE = std::numeric_limits<aggval_t>::max() / 2;
+        Aggregate partial;
+        partial.add(LARGE);
+        partial.add(LARGE);
+        TEST(!partial.overflow);
+        Aggregate merged;
+        merged.merge(partial);
+        merged.merge(partial);
+        TEST(merged.overflow);
+        Aggregate negative;
+        negative.add(std::numeric_limits<aggval_t>::min());
+        negative.add(-1);
+        TEST(negative.overflow);
+
+        Aggregate result;
+        TEST(AggregateOper::aggregate(
+            table, [](Record const&) { return LARGE; }, result, 4)
+                == Status::FAILURE);
+        TEST(result.overflow);
+        TEST(result.count == 5000);
+
+        Record record;
+        std::snprintf(reinterpret_cast<char*>(record.value),
+            sizeof(record.value), "%s", "-123456789012345678901234567890");
+        TEST(AggregateOper::value_as_int(record)
+            == std::numeric_limits<aggval_t>::min());
+        std::snprintf(reinterpret_cast<char*>(record.value),
+            sizeof(record.value), "%s", "9223372036854775807");
+        TEST(AggregateOper::value_as_int(record)
+            == std::numeric_limits<aggval_t>::max());
+    }
+    remove("testfile");
+})
+
+TEST_SUITE(AggregateTest::distinct, {
+    {
+        Database dbms(1000);
+        tableid_t tid = prepare(dbms, 3000);
+
+        for (size_t workers : aggregate_workers) {
+            std::vector<aggval_t> values;
+            TEST_SUCCESS(dbms.distinct(
+                tid, AggregateOper::value_as_int, values, workers));
+            TEST(values.size() == 37);
+            for (size_t i = 0; i < values.size(); ++i) {
+                TEST(values[i] == static_cast<aggval_t>(i) - 5);
+            }
+
+            std::vector<std::string> strings;
+            TEST_SUCCESS(dbms.distinct(
+                tid, [](Record const& rec) {
+                    return std::string(
+                        reinterpret_cast<char const*>(rec.value));
+                }, strings, workers));
+            TEST(strings.size() == 37);
+            TEST(strings.front() == "-1");
+            TEST(strings.back() == "9");
+        }
+    }
+    remove("testfile");
+})
+
+TEST_SUITE(AggregateTest::group_by, {
+    {
+        Database dbms(1000);
+        tableid_t tid = prepare(dbms, 4000);
+
+        for (size_t workers : aggregate_workers) {
+            group_map_t groups;
+            TEST_SUCCESS(dbms.group_by(
+                tid, [](Record const& rec) { return rec.key % 10; },
+                key_of, groups, workers));
+            TEST(groups.size() == 10);
+            for (auto const& pair : groups) {
+                prikey_t group = pair.first;
+                Aggregate const& aggr = pair.second;
+                TEST(aggr.count == 400);
+                TEST(aggr.min == group);
+                TEST(aggr.max == 3990 + group);
+                TEST(aggr.sum == (group + 3990 + group) * 400 / 2);
+            }
+        }
+    }
+    remove("testfile");
+})
+
+int aggregate_test() {
+    return AggregateTest::aggregate_test()
+        && AggregateTest::distinct_test()
+        && AggregateTest::group_by_test();
+}
@@ -16,6 +16,8 @@ struct BPTreeIteratorTest {
     TEST_NAME(cmp_operator);
     TEST_NAME(deref_operator);
     TEST_NAME(integrate);
+    TEST_NAME(batch);
+    TEST_NAME(seek);
 };
 
 TEST_SUITE(BPTreeIteratorTest::ctor, {
@@ -319,6 +321,114 @@ TEST_SUITE(BPTreeIteratorTest::integrate, {
     remove("testfile");
 })
 
+TEST_SUITE(BPTreeIteratorTest::batch, {
+    BufferManager manager(100);
+    FileManager file("testfile");
+
+    uint8_t tmp[5];
+    BPTree tree(&file, &manager);
+    tree.test_config(4, 5, true);
+
+    std::vector<int> values;
+    for (int i = 0; i < 100; ++i) {
+        values.push_back(2 * i);
+    }
+
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    while (!values.empty()) {
+        int idx = gen() % values.size();
+        tree.insert(values[idx], tmp, 5);
+        values.erase(values.begin() + idx);
+    }
+
+    // one batch per leaf
+    int key = 0;
+    int num_batch = 0;
+    for (BPTreeBatchIterator iter = tree.batches(); iter.valid(); iter.next()) {
+        TEST(!iter.batch().empty());
+        TEST(iter.batch().size() <= 4);
+        for (Record const& rec : iter.batch()) {
+            TEST(rec.key == key);
+            key += 2;
+        }
+        ++num_batch;
+    }
+    TEST(key == 200);
+    TEST(num_batch >= 25 && num_batch < 100);
+
+    BPTreeBatchIterator iter = tree.batches(11, 50);
+    TEST(iter.valid() && iter.batch().front().key == 12);
+    int num_key = 0;
+    for (; iter.valid(); iter.next()) {
+        num_key += iter.batch().size();
+        TEST(iter.batch().back().key <= 50);
+    }
+    TEST(num_key == 20);
+    TEST(!tree.batches(50, 11).valid());
+    TEST(!tree.batches(199, 300).valid());
+
+    // start key is greater than all keys of its leaf
+    for (int start = -1; start < 200; start += 2) {
+        std::vector<Record> records = tree.find_range(start, start + 10);
+        size_t expected = start + 10 < 200 ? 5 : (199 - start) / 2;
+        TEST(records.size() == expected);
+        for (size_t i = 0; i < records.size(); ++i) {
+            TEST(records[i].key == start + 1 + 2 * static_cast<int>(i));
+        }
+    }
+
+    manager.shutdown();
+    file.~FileManager();
+    remove("testfile");
+})
+
+TEST_SUITE(BPTreeIteratorTest::seek, {
+    BufferManager manager(100);
+    FileManager file("testfile");
+
+    uint8_t tmp[5];
+    BPTree tree(&file, &manager);
+    tree.test_config(4, 5, true);
+    for (int i = 0; i < 200; ++i) {
+        tree.insert(2 * i, tmp, 5);
+    }
+
+    BPTreeIterator iter = tree.begin();
+    // in the leaf, the next leaf and far away
+    TEST((*iter.seek(5)).key() == 6);
+    TEST((*iter.seek(7)).key() == 8);
+    TEST((*iter.seek(15)).key() == 16);
+    TEST((*iter.seek(251)).key() == 252);
+    TEST((*iter.seek(50)).key() == 252);
+    ++iter;
+    TEST((*iter).key() == 254);
+    TEST((*iter.seek(398)).key() == 398);
+    TEST(iter.seek(399) == tree.end());
+
+    BPTreeBatchIterator batch = tree.batches();
+    TEST_SUCCESS(batch.seek(11));
+    TEST(batch.valid() && batch.batch().front().key == 12);
+    TEST_SUCCESS(batch.seek(13));
+    TEST(batch.valid() && batch.batch().front().key == 14);
+    TEST_SUCCESS(batch.seek(301));
+    TEST(batch.valid() && batch.batch().front().key == 302);
+    TEST_SUCCESS(batch.seek(9));
+    TEST(batch.batch().front().key == 302);
+    TEST_SUCCESS(batch.seek(399));
+    TEST(!batch.valid());
+    TEST_SUCCESS(batch.seek(400));
+    TEST(!batch.valid());
+
+    BPTreeBatchIterator bounded = tree.batches(0, 100);
+    TEST_SUCCESS(bounded.seek(101));
+    TEST(!bounded.valid());
+
+    manager.shutdown();
+    file.~FileManager();
+    remove("testfile");
+})
+
 int bptree_iter_test() {
     return BPTreeIteratorTest::ctor_test()
         && BPTreeIteratorTest::copy_ctor_test()
@@ -330,5 +440,7 @@ int bptree_iter_test() {
         && BPTreeIteratorTest::inc_operator_test()
         && BPTreeIteratorTest::cmp_operator_test()
         && BPTreeIteratorTest::deref_operator_test()
-        && BPTreeIteratorTest::integrate_test();
+        && BPTreeIteratorTest::integrate_test()
+        && BPTreeIteratorTest::batch_test()
+        && BPTreeIteratorTest::seek_test();
 }
\ No newline at end of file
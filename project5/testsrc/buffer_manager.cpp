@@ -47,6 +47,8 @@ struct BufferManagerTest {
     static int release_test();
     static int find_test();
     static int concurrency_test();
+    static int dirty_pages_test();
+    static int flush_dirty_test();
 };
 
 TEST_SUITE(UbufferTest::constructor, {
@@ -431,11 +433,22 @@ TEST_SUITE(BufferManagerTest::release_file, {
     TEST(1 == manager.load(file2, FILE_HEADER_PAGENUM));
     TEST(2 == manager.load(file2, 1, true));
 
+    // written pages of the released file are synchronized
+    TEST_SUCCESS(manager.buffering(file2, 1).write_void([](Page&) {}));
     TEST_SUCCESS(manager.release_file(file2.get_id()));
     TEST(manager.num_buffer == 1);
     TEST(manager.buffers[0]->file == &file1);
     TEST(manager.buffers[1]->file == nullptr);
     TEST(manager.buffers[2]->file == nullptr);
+    TEST(manager.written.empty());
+
+    // evicted page waits for the next synchronization
+    TEST_SUCCESS(manager.buffering(file1, FILE_HEADER_PAGENUM).write_void(
+        [](Page&) {}));
+    TEST_SUCCESS(manager.release_block(0));
+    TEST(manager.written.count(&file1) == 1);
+    TEST_SUCCESS(manager.sync_files());
+    TEST(manager.written.empty());
 
     TEST_SUCCESS(manager.shutdown());
     file1.~FileManager();
@@ -584,6 +597,82 @@ TEST_SUITE(BufferManagerTest::free_page, {
     remove("testfile");
 })
 
+TEST_SUITE(BufferManagerTest::dirty_pages, {
+    BufferManager manager(5);
+    FileManager file("testfile");
+
+    pagenum_t pagenum[3];
+    for (int i = 0; i < 3; ++i) {
+        pagenum[i] = file.page_create();
+        TEST(pagenum[i] != INVALID_PAGENUM);
+    }
+
+    // unlogged modification does not have recLSN
+    TEST_SUCCESS(manager.buffering(file, pagenum[0]).write_void([](Page&) {}));
+    TEST(manager.dirty_pages().size() == 0);
+
+    for (int i = 1; i < 3; ++i) {
+        TEST_SUCCESS(manager.buffering(file, pagenum[i]).write_void(
+            [&](Page& page) { page.page_header().page_lsn = i * 10; }));
+    }
+    // recLSN is kept until the page is written
+    TEST_SUCCESS(manager.buffering(file, pagenum[1]).write_void(
+        [](Page& page) { page.page_header().page_lsn = 30; }));
+
+    std::vector<DirtyPage> pages = manager.dirty_pages();
+    TEST(pages.size() == 2);
+    for (DirtyPage const& page : pages) {
+        TEST(page.fileid == file.get_id());
+        TEST(page.pagenum == pagenum[1] || page.pagenum == pagenum[2]);
+        TEST(page.rec_lsn == (page.pagenum == pagenum[1] ? 10 : 20));
+    }
+    // all pins are returned
+    for (int i = 0; i < manager.num_buffer; ++i) {
+        TEST(manager.buffers[i]->pin == 0);
+    }
+
+    TEST_SUCCESS(manager.shutdown());
+    file.~FileManager();
+    remove("testfile");
+})
+
+TEST_SUITE(BufferManagerTest::flush_dirty, {
+    BufferManager manager(5);
+    FileManager file("testfile");
+
+    pagenum_t pagenum[3];
+    for (int i = 0; i < 3; ++i) {
+        pagenum[i] = file.page_create();
+        TEST(pagenum[i] != INVALID_PAGENUM);
+        // younger page first
+        TEST_SUCCESS(manager.buffering(file, pagenum[i]).write_void(
+            [&](Page& page) { page.page_header().page_lsn = 30 - i * 10; }));
+    }
+
+    // the oldest page is written first
+    TEST_SUCCESS(manager.flush_dirty(1));
+    std::vector<DirtyPage> pages = manager.dirty_pages();
+    TEST(pages.size() == 2);
+    for (DirtyPage const& page : pages) {
+        TEST(page.pagenum != pagenum[2]);
+    }
+
+    Page page;
+    TEST_SUCCESS(file.page_read(pagenum[2], page));
+    TEST(page.page_header().page_lsn == 10);
+    TEST(manager.written.count(&file) == 1);
+    TEST_SUCCESS(manager.sync_files());
+    TEST(manager.written.empty());
+
+    TEST_SUCCESS(manager.flush_dirty(5));
+    TEST(manager.dirty_pages().size() == 0);
+    TEST(!manager.buffers[manager.find(file.get_id(), pagenum[0])]->is_dirty);
+
+    TEST_SUCCESS(manager.shutdown());
+    file.~FileManager();
+    remove("testfile");
+})
+
 TEST_SUITE(BufferManagerTest::concurrency, {
     /// TODO: Impl.
 })
@@ -618,6 +707,8 @@ int buffer_manager_test() {
         && BufferManagerTest::release_test()
         && BufferManagerTest::find_test()
         && BufferManagerTest::buffering_test()
+        && BufferManagerTest::dirty_pages_test()
+        && BufferManagerTest::flush_dirty_test()
         && BufferManagerTest::new_page_test()
         && BufferManagerTest::free_page_test()
         && BufferManagerTest::concurrency_test();
@@ -0,0 +1,147 @@
+#include <cstring>
+
+#include "catalog.hpp"
+#include "test.hpp"
+
+struct CatalogTest {
+    TEST_METHOD(value)
+    TEST_METHOD(define)
+    TEST_METHOD(encode)
+};
+
+using column_list_t = std::vector<Column>;
+
+static Value integer(int64_t value) {
+    return Value::of(value);
+}
+
+static Status define_two(Catalog& catalog, Column first, Column second) {
+    return catalog.define("t1", 1, column_list_t { first, second });
+}
+
+static Row pikachu() {
+    return Row {
+        integer(25), Value::of(std::string("Pikachu")),
+        Value::of(std::string("Electric")), integer(-7),
+    };
+}
+
+static column_list_t pokemon_columns() {
+    return column_list_t {
+        Column::integer("ID", true),
+        Column::chars("Name", 32),
+        Column::chars("type", 16),
+        Column::integer("level"),
+    };
+}
+
+TEST_SUITE(CatalogTest::value, {
+    Value null;
+    Value one = integer(1);
+    Value real = Value::of(1.5);
+    Value str = Value::of(std::string("a"));
+
+    TEST(null.is_null());
+    TEST(one.is_number() && real.is_number() && !str.is_number());
+    TEST(null.compare(one) < 0);
+    TEST(one.compare(real) < 0);
+    TEST(real.compare(str) < 0);
+    TEST(str.compare(Value::of(std::string("b"))) < 0);
+    TEST(integer(-3).compare(integer(2)) < 0);
+
+    // integral reals are same with the integers
+    TEST(integer(2) == Value::of(2.0));
+    TEST(integer(2).hash() == Value::of(2.0).hash());
+    TEST(integer(2) != Value::of(2.5));
+
+    TEST(one.to_string() == "1");
+    TEST(real.to_string() == "1.5000");
+    TEST(str.to_string() == "a");
+    TEST(str.to_string(true) == "'a'");
+    TEST(null.to_string() == "null");
+
+    RowHash hasher;
+    Row row1(2, str);
+    Row row2(2, str);
+    row1[0] = integer(1);
+    row2[0] = Value::of(1.0);
+    TEST(row1 == row2);
+    TEST(hasher(row1) == hasher(row2));
+})
+
+TEST_SUITE(CatalogTest::define, {
+    Catalog catalog;
+    TEST_SUCCESS(catalog.define("Pokemon", 3, pokemon_columns()));
+
+    Schema const* schema = catalog.find("POKEMON");
+    TEST(schema != nullptr);
+    TEST(schema->name == "pokemon");
+    TEST(schema->id == 3);
+    TEST(schema->find("name") == 1);
+    TEST(schema->find("Name") == -1);
+    TEST(schema->find("none") == -1);
+    TEST(schema->columns[0].key);
+    TEST(schema->columns[1].offset == 0);
+    TEST(schema->columns[2].offset == 32);
+    TEST(schema->columns[3].offset == 48);
+    TEST(catalog.find("trainer") == nullptr);
+
+    // duplicate table
+    TEST(catalog.define("pokemon", 4, pokemon_columns()) == Status::FAILURE);
+
+    // key should be single integer column
+    TEST(define_two(catalog, Column::integer("a"), Column::chars("b", 8))
+        == Status::FAILURE);
+    TEST(define_two(
+        catalog, Column::integer("a", true), Column::integer("b", true))
+            == Status::FAILURE);
+
+    Column key = Column::chars("a", 8);
+    key.key = true;
+    TEST(define_two(catalog, key, Column::integer("b")) == Status::FAILURE);
+
+    // duplicate column and too wide value
+    TEST(define_two(
+        catalog, Column::integer("a", true), Column::chars("A", 8))
+            == Status::FAILURE);
+    TEST(define_two(
+        catalog, Column::integer("a", true), Column::chars("b", 121))
+            == Status::FAILURE);
+    TEST_SUCCESS(define_two(
+        catalog, Column::integer("a", true), Column::chars("b", 120)));
+})
+
+TEST_SUITE(CatalogTest::encode, {
+    Catalog catalog;
+    TEST_SUCCESS(catalog.define("pokemon", 3, pokemon_columns()));
+    Schema const* schema = catalog.find("pokemon");
+
+    Row values = pikachu();
+    Record record;
+    TEST_SUCCESS(schema->encode(values, record));
+    TEST(record.key == 25);
+    TEST(std::strcmp(reinterpret_cast<char*>(record.value), "Pikachu") == 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        TEST(schema->decode(i, record) == values[i]);
+    }
+
+    // full width string without null terminator
+    values[2] = Value::of(std::string(16, 'x'));
+    TEST_SUCCESS(schema->encode(values, record));
+    TEST(schema->decode(2, record).str == std::string(16, 'x'));
+
+    values[2] = Value::of(std::string(17, 'x'));
+    TEST(schema->encode(values, record) == Status::FAILURE);
+
+    values[2] = integer(1);
+    TEST(schema->encode(values, record) == Status::FAILURE);
+
+    values.pop_back();
+    TEST(schema->encode(values, record) == Status::FAILURE);
+})
+
+int catalog_test() {
+    return CatalogTest::value_test()
+        && CatalogTest::define_test()
+        && CatalogTest::encode_test();
+}
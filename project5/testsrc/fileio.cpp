@@ -78,10 +78,24 @@ TEST_SUITE(fpread, {
     remove("testfile");
 })
 
+TEST_SUITE(fpsync, {
+    FILE* fp = fopen("testfile", "w+");
+    fwrite("asdf", 1, 4, fp);
+    TEST(fpsync(fp));
+
+    FILE* fp2 = fopen("testfile", "r");
+    TEST(fsize(fp2) == 4);
+
+    fclose(fp2);
+    fclose(fp);
+    remove("testfile");
+})
+
 int fileio_test() {
     return fexist_test()
         && fsize_test()
         && fresize_test()
         && fpwrite_test()
-        && fpread_test();
+        && fpread_test()
+        && fpsync_test();
 }
\ No newline at end of file
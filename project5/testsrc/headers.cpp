@@ -1,3 +1,4 @@
+#include "headers.hpp"
 #include "test.hpp"
 
 TEST_SUITE(size, {
@@ -9,7 +10,20 @@ TEST_SUITE(size, {
 })
 
 TEST_SUITE(page_init, {
-    // TODO: Impl test
+    Page page{};
+    PageHeader& stale = page.page_header();
+    stale.number_of_keys = 7;
+    stale.parent_page_number = 3;
+    stale.special_page_number = 5;
+    stale.page_lsn = 9;
+    TEST_SUCCESS(page.init(true));
+
+    PageHeader const& header = page.page_header();
+    TEST(header.is_leaf == 1);
+    TEST(header.number_of_keys == 0);
+    TEST(header.parent_page_number == INVALID_PAGENUM);
+    TEST(header.special_page_number == INVALID_PAGENUM);
+    TEST(header.page_lsn == INVALID_LSN);
 })
 
 TEST_SUITE(page_release_abstraction, {
@@ -1,6 +1,10 @@
 #include "dbms.hpp"
 #include "join.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 int arr1[] = { 1, 2, 3, 5, 7 };
 int arr2[] = { 1, 4, 5, 6, 7 };
 
@@ -61,6 +65,329 @@ TEST_SUITE(set_merge, {
     remove("testfile2");
 })
 
+using keypair_t = std::pair<prikey_t, prikey_t>;
+
+size_t budgets[] = { JoinOper::HASH_JOIN_BUDGET, 4096 };
+
+TEST_SUITE(hash_join, {
+    auto dbms = std::make_unique<Database>(1000);
+
+    tableid_t tid1 = dbms->open_table("testfile1");
+    tableid_t tid2 = dbms->open_table("testfile2");
+
+    // join on the first integer of the value, left is larger
+    constexpr int num_left = 3000;
+    constexpr int num_right = 500;
+    int value[2];
+    for (int i = 0; i < num_left; ++i) {
+        value[0] = i % 700;
+        value[1] = i;
+        dbms->insert(
+            tid1, i, reinterpret_cast<uint8_t*>(value), sizeof(value));
+    }
+    for (int i = 0; i < num_right; ++i) {
+        value[0] = i * 2;
+        value[1] = -i;
+        dbms->insert(
+            tid2, i, reinterpret_cast<uint8_t*>(value), sizeof(value));
+    }
+
+    auto field = [](Record const& rec) -> JoinOper::joinkey_t {
+        int num;
+        std::memcpy(&num, rec.value, sizeof(int));
+        return num;
+    };
+
+    // expected pairs of the primary keys
+    std::vector<keypair_t> expected;
+    for (int i = 0; i < num_left; ++i) {
+        for (int j = 0; j < num_right; ++j) {
+            if (i % 700 == j * 2) {
+                expected.emplace_back(i, j);
+            }
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    for (size_t budget : budgets) {
+        std::vector<keypair_t> found;
+        TEST_SUCCESS(JoinOper::hash_join(
+            (*dbms)[tid1], (*dbms)[tid2], field, field,
+            [&](Record const& rec1, Record const& rec2) {
+                found.emplace_back(rec1.key, rec2.key);
+                return Status::SUCCESS;
+            },
+            budget));
+        std::sort(found.begin(), found.end());
+        TEST(found == expected);
+    }
+
+    // callback failure stops the join
+    int calls = 0;
+    TEST(JoinOper::hash_join(
+        (*dbms)[tid1], (*dbms)[tid2], field, field,
+        [&](Record const&, Record const&) {
+            ++calls;
+            return Status::FAILURE;
+        }) == Status::FAILURE);
+    TEST(calls == 1);
+
+    dbms.reset();
+    remove("testfile1");
+    remove("testfile2");
+})
+
+size_t num_workers[] = { 1, 4, 7 };
+
+TEST_SUITE(parallel_merge, {
+    auto dbms = std::make_unique<Database>(1000);
+
+    tableid_t tid1 = dbms->open_table("testfile1");
+    tableid_t tid2 = dbms->open_table("testfile2");
+
+    constexpr int num_insert =
+        BPTree::DEFAULT_LEAF_ORDER * BPTree::DEFAULT_INTERNAL_ORDER;
+    uint8_t arr[5];
+    for (int i = 0; i < num_insert; ++i) {
+        dbms->insert(tid1, i * 2, arr, 5);
+        dbms->insert(tid2, i * 3 - 100, arr, 5);
+    }
+    Table const* table1 = (*dbms)[tid1];
+    Table const* table2 = (*dbms)[tid2];
+    TEST(table1->separators(4).size() >= 4);
+
+    std::vector<prikey_t> expected;
+    JoinOper::set_merge(table1, table2,
+        [&](Record const& rec1, Record const&) {
+            expected.push_back(rec1.key);
+            return Status::SUCCESS;
+        });
+
+    for (size_t workers : num_workers) {
+        std::vector<std::vector<prikey_t>> sinks(workers);
+        TEST_SUCCESS(dbms->parallel_join(tid1, tid2, workers,
+            [&](size_t worker, Record const& rec1, Record const& rec2) {
+                if (rec1.key != rec2.key) {
+                    return Status::FAILURE;
+                }
+                sinks[worker].push_back(rec1.key);
+                return Status::SUCCESS;
+            }));
+
+        // ordered after concatenation
+        std::vector<prikey_t> found;
+        for (auto const& sink : sinks) {
+            found.insert(found.end(), sink.begin(), sink.end());
+        }
+        TEST(found == expected);
+    }
+
+    // cursor over the range crossing the leaves
+    JoinOper::LeafCursor cursor(table1, 101, 999);
+    std::vector<prikey_t> keys;
+    for (; cursor.valid(); cursor.next()) {
+        keys.push_back(cursor.record().key);
+    }
+    TEST(keys.size() == 449);
+    TEST(keys.front() == 102);
+    TEST(keys.back() == 998);
+
+    dbms.reset();
+    remove("testfile1");
+    remove("testfile2");
+})
+
+size_t batch_sizes[] = { 1, 7, JoinOper::NESTED_LOOP_BATCH };
+prikey_t missing_keys[] = { -5, -3, 1, 3, 1000001 };
+
+TEST_SUITE(nested_loop, {
+    auto dbms = std::make_unique<Database>(1000);
+
+    tableid_t small = dbms->open_table("testfile1");
+    tableid_t large = dbms->open_table("testfile2");
+
+    constexpr int num_insert =
+        BPTree::DEFAULT_LEAF_ORDER * BPTree::DEFAULT_INTERNAL_ORDER;
+    for (int i = 0; i < num_insert; ++i) {
+        dbms->insert(large, i * 2, reinterpret_cast<uint8_t const*>("L"), 2);
+    }
+    // sparse keys, a half of them are absent in the large table
+    for (int i = 0; i < 60; ++i) {
+        dbms->insert(
+            small, i * 97 - 30, reinterpret_cast<uint8_t const*>("S"), 2);
+    }
+    Table const* table1 = (*dbms)[small];
+    Table const* table2 = (*dbms)[large];
+
+    std::vector<prikey_t> expected;
+    JoinOper::set_merge(table1, table2,
+        [&](Record const& rec1, Record const&) {
+            expected.push_back(rec1.key);
+            return Status::SUCCESS;
+        });
+    TEST(expected.size() > 20 && expected.size() < 40);
+
+    for (size_t batch_size : batch_sizes) {
+        std::vector<prikey_t> found;
+        TEST_SUCCESS(JoinOper::nested_loop(table1, table2,
+            [&](Record const& outer, Record const& inner) {
+                if (outer.key != inner.key || outer.value[0] != 'S') {
+                    return Status::FAILURE;
+                }
+                found.push_back(outer.key);
+                return Status::SUCCESS;
+            }, batch_size));
+        TEST(found == expected);
+    }
+
+    // nested loop is cheaper only if one side is much smaller
+    pagenum_t pages1 = table1->num_pages();
+    pagenum_t pages2 = table2->num_pages();
+    TEST(JoinOper::nested_loop_cost(pages1, pages2)
+        < JoinOper::merge_cost(pages1, pages2));
+    TEST(JoinOper::nested_loop_cost(pages2, pages2)
+        > JoinOper::merge_cost(pages2, pages2));
+    TEST(JoinOper::choose_join(pages1, pages2)
+        == JoinOper::PrikeyJoin::PROBE_RIGHT);
+    TEST(JoinOper::choose_join(pages2, pages1)
+        == JoinOper::PrikeyJoin::PROBE_LEFT);
+    TEST(JoinOper::choose_join(pages2, pages2)
+        == JoinOper::PrikeyJoin::MERGE);
+
+    // left record first regardless of the outer side
+    std::vector<prikey_t> found;
+    TEST_SUCCESS(dbms->prikey_join(large, small,
+        [&](Record const& rec1, Record const& rec2) {
+            if (rec1.value[0] != 'L' || rec2.value[0] != 'S') {
+                return Status::FAILURE;
+            }
+            found.push_back(rec1.key);
+            return Status::SUCCESS;
+        }));
+    TEST(found == expected);
+
+    found.clear();
+    TEST_SUCCESS(dbms->prikey_join(small, large,
+        [&](Record const& rec1, Record const& rec2) {
+            if (rec1.value[0] != 'S' || rec2.value[0] != 'L') {
+                return Status::FAILURE;
+            }
+            found.push_back(rec1.key);
+            return Status::SUCCESS;
+        }));
+    TEST(found == expected);
+
+    // parallel join runs the cheaper nested loop on the first worker
+    found.clear();
+    size_t num_done = 0;
+    TEST_SUCCESS(dbms->parallel_join(large, small, 4,
+        [&](size_t worker, Record const& rec1, Record const& rec2) {
+            if (worker != 0 || rec1.value[0] != 'L' || rec2.value[0] != 'S') {
+                return Status::FAILURE;
+            }
+            found.push_back(rec1.key);
+            return Status::SUCCESS;
+        },
+        [&](size_t, Status res) {
+            ++num_done;
+            return res;
+        }));
+    TEST(found == expected);
+    TEST(num_done == 1);
+
+    // missing keys only
+    std::vector<prikey_t> keys(
+        std::begin(missing_keys), std::end(missing_keys));
+    std::vector<Record> records;
+    TEST_SUCCESS(table2->find_batch(keys, records));
+    TEST(records.empty());
+
+    dbms.reset();
+    remove("testfile1");
+    remove("testfile2");
+})
+
+int leapfrog_steps[] = { 2, 3, 5, 1009 };
+
+TEST_SUITE(leapfrog, {
+    auto dbms = std::make_unique<Database>(1000);
+
+    constexpr int max_key = 20000;
+    std::vector<tableid_t> ids;
+    for (int i = 0; i < 4; ++i) {
+        std::string name = "testfile" + std::to_string(i + 1);
+        ids.push_back(dbms->open_table(name));
+        uint8_t value = static_cast<uint8_t>(i);
+        for (int key = 0; key <= max_key; key += leapfrog_steps[i]) {
+            dbms->insert(ids.back(), key, &value, 1);
+        }
+    }
+
+    // cursor seeks in the leaf, across the leaves and past the end
+    JoinOper::LeafCursor cursor((*dbms)[ids[0]], 0, max_key);
+    TEST_SUCCESS(cursor.seek(7));
+    TEST(cursor.valid() && cursor.record().key == 8);
+    TEST_SUCCESS(cursor.seek(5));
+    TEST(cursor.record().key == 8);
+    TEST_SUCCESS(cursor.seek(12345));
+    TEST(cursor.valid() && cursor.record().key == 12346);
+    TEST_SUCCESS(cursor.seek(max_key + 1));
+    TEST(!cursor.valid());
+
+    // sparse table is the driver, dense tables are sought
+    std::vector<prikey_t> found;
+    TEST_SUCCESS(dbms->multi_join(ids,
+        [&](std::vector<Record const*> const& row) {
+            if (row.size() != 4) {
+                return Status::FAILURE;
+            }
+            for (size_t i = 0; i < row.size(); ++i) {
+                if (row[i]->key != row[0]->key || row[i]->value[0] != i) {
+                    return Status::FAILURE;
+                }
+            }
+            found.push_back(row[0]->key);
+            return Status::SUCCESS;
+        }));
+
+    std::vector<prikey_t> expected;
+    for (int key = 0; key <= max_key; key += 2 * 3 * 5 * 1009) {
+        expected.push_back(key);
+    }
+    TEST(found == expected);
+
+    // two-way is same with merge join
+    std::vector<tableid_t> pair(ids.begin(), ids.begin() + 2);
+    found.clear();
+    TEST_SUCCESS(dbms->multi_join(pair,
+        [&](std::vector<Record const*> const& row) {
+            found.push_back(row[0]->key);
+            return Status::SUCCESS;
+        }));
+    expected.clear();
+    TEST_SUCCESS(dbms->prikey_join(ids[0], ids[1],
+        [&](Record const& rec1, Record const&) {
+            expected.push_back(rec1.key);
+            return Status::SUCCESS;
+        }));
+    TEST(found == expected);
+    TEST(found.size() == max_key / 6 + 1);
+
+    TEST(dbms->multi_join(std::vector<tableid_t>(),
+        [&](std::vector<Record const*> const&) {
+            return Status::SUCCESS;
+        }) == Status::FAILURE);
+
+    dbms.reset();
+    for (int i = 0; i < 4; ++i) {
+        remove(("testfile" + std::to_string(i + 1)).c_str());
+    }
+})
+
 int join_test() {
-    return set_merge_test();
+    return set_merge_test()
+        && hash_join_test()
+        && parallel_merge_test()
+        && nested_loop_test()
+        && leapfrog_test();
 }
\ No newline at end of file
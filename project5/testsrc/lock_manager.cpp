@@ -3,6 +3,7 @@
 #include "xaction_manager.hpp"
 #include "test.hpp"
 
+#include <atomic>
 #include <future>
 #include <memory>
 #include <thread>
@@ -11,14 +12,17 @@ struct HierarchicalTest {
     TEST_METHOD(constructor);
     TEST_METHOD(make_hashable);
     TEST_METHOD(comparison);
+    TEST_METHOD(level);
 };
 
 struct LockTest {
+    TEST_METHOD(modes);
     TEST_METHOD(constructor);
     TEST_METHOD(move_constructor);
     TEST_METHOD(move_assignment);
     TEST_METHOD(getter);
     TEST_METHOD(run);
+    TEST_METHOD(queue);
 };
 
 struct LockManagerTest {
@@ -35,12 +39,20 @@ struct LockManagerTest {
     TEST_METHOD(deadlock_choose_abort);
     TEST_METHOD(deadlock_construct_graph);
     TEST_METHOD(lockable);
+    TEST_METHOD(escalation);
+    TEST_METHOD(upgrade_lock);
     TEST_METHOD(integrate);
 
     struct GraphInfo {
+        std::list<Lock> owned;
         LockManager::locktable_t locktable;
         std::unique_ptr<Transaction[]> trxs;
         LockManager::DeadlockDetector::graph_t graph;
+
+        Lock* make_lock(HID hid, LockMode mode, Transaction* trx) {
+            owned.emplace_back(hid, mode, trx);
+            return &owned.back();
+        }
     };
 
     static std::unique_ptr<GraphInfo> sample_dag();
@@ -82,6 +94,51 @@ TEST_SUITE(HierarchicalTest::comparison, {
     TEST(!(HID(10, 10, 10) == HID(10, 10, 20)));
 })
 
+TEST_SUITE(HierarchicalTest::level, {
+    TEST(HID().level() == LockLevel::INVALID);
+    TEST(HID(1, 2, 3).level() == LockLevel::RECORD);
+    TEST(HID::page(1, 2).level() == LockLevel::PAGE);
+    TEST(HID::table(1).level() == LockLevel::TABLE);
+
+    TEST(HID(1, 2, 3).parent() == HID::page(1, 2));
+    TEST(HID::page(1, 2).parent() == HID::table(1));
+    TEST(HID::table(1).parent() == HID());
+
+    TEST(HID::table(1) < HID(1, 2, 3));
+    TEST(HID(1, 2, 3) < HID::page(1, 2));
+})
+
+TEST_SUITE(LockTest::modes, {
+    LockMode IS = LockMode::INTENTION_SHARED;
+    LockMode IX = LockMode::INTENTION_EXCLUSIVE;
+    LockMode S = LockMode::SHARED;
+    LockMode X = LockMode::EXCLUSIVE;
+
+    TEST(LockModes::compatible(IS, IX));
+    TEST(LockModes::compatible(IS, S));
+    TEST(!LockModes::compatible(IS, X));
+    TEST(LockModes::compatible(IX, IX));
+    TEST(!LockModes::compatible(IX, S));
+    TEST(!LockModes::compatible(S, IX));
+    TEST(LockModes::compatible(S, S));
+    TEST(!LockModes::compatible(X, IS));
+    TEST(LockModes::compatible(LockMode::IDLE, X));
+
+    TEST(LockModes::covers(X, IX));
+    TEST(LockModes::covers(S, IS));
+    TEST(!LockModes::covers(S, IX));
+    TEST(!LockModes::covers(IX, S));
+
+    TEST(LockModes::supremum(IS, IX) == IX);
+    TEST(LockModes::supremum(S, IX) == X);
+    TEST(LockModes::supremum(LockMode::IDLE, S) == S);
+
+    TEST(LockModes::intention(S) == IS);
+    TEST(LockModes::intention(X) == IX);
+    TEST(LockModes::escalated(IS) == S);
+    TEST(LockModes::escalated(IX) == X);
+})
+
 TEST_SUITE(LockTest::constructor, {
     Lock lock;
     TEST(lock.get_hid() == HID());
@@ -146,6 +203,45 @@ TEST_SUITE(LockTest::run, {
     TEST(!lock.stop());
 })
 
+TEST_SUITE(LockTest::queue, {
+    Transaction trx(10);
+    Lock locks[3];
+    for (size_t i = 0; i < 3; ++i) {
+        locks[i] = Lock(HID(1, 2, i), LockMode::SHARED, &trx);
+    }
+
+    LockQueue queue;
+    TEST(queue.empty());
+    TEST(queue.front() == nullptr);
+    TEST(queue.begin() == queue.end());
+
+    queue.push_back(&locks[1]);
+    queue.push_front(&locks[0]);
+    queue.push_back(&locks[2]);
+    TEST(queue.size() == 3);
+    TEST(queue.front() == &locks[0]);
+    TEST(queue.back() == &locks[2]);
+    TEST(locks[1].queue == &queue);
+
+    int idx = 0;
+    for (Lock* lock : queue) {
+        TEST(lock == &locks[idx++]);
+    }
+    TEST(idx == 3);
+
+    auto iter = queue.erase(&locks[1]);
+    TEST(*iter == &locks[2]);
+    TEST(locks[1].queue == nullptr);
+    TEST(locks[0].next == &locks[2]);
+    TEST(locks[2].prev == &locks[0]);
+
+    TEST(queue.erase(&locks[2]) == queue.end());
+    TEST(queue.back() == &locks[0]);
+    queue.erase(&locks[0]);
+    TEST(queue.empty());
+    TEST(queue.front() == nullptr && queue.back() == nullptr);
+})
+
 TEST_SUITE(LockManagerTest::require_lock, {
     // case 0. single shared
     {
@@ -161,7 +257,7 @@ TEST_SUITE(LockManagerTest::require_lock, {
         TEST(&lock->get_backref() == &trx);
         TEST(!lock->stop());
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::SHARED);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 1);
@@ -182,7 +278,7 @@ TEST_SUITE(LockManagerTest::require_lock, {
         TEST(&lock->get_backref() == &trx);
         TEST(!lock->stop());
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::EXCLUSIVE);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 1);
@@ -210,7 +306,7 @@ TEST_SUITE(LockManagerTest::require_lock, {
         TEST(&lock2->get_backref() == &trx2);
         TEST(!lock2->stop());
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::SHARED);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 2);
@@ -228,7 +324,7 @@ TEST_SUITE(LockManagerTest::release_lock, {
         auto lock = manager.require_lock(&trx, HID(1, 2, 3), LockMode::EXCLUSIVE);
         TEST_SUCCESS(manager.release_lock(lock));
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::IDLE);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 0);
@@ -243,7 +339,7 @@ TEST_SUITE(LockManagerTest::release_lock, {
         auto lock2 = manager.require_lock(&trx2, HID(1, 2, 3), LockMode::SHARED);
         TEST_SUCCESS(manager.release_lock(lock));
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::SHARED);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 1);
@@ -265,7 +361,7 @@ TEST_SUITE(LockManagerTest::release_lock, {
         TEST_SUCCESS(manager.release_lock(lock));
         auto lock2 = fut.get();
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::EXCLUSIVE);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 1);
@@ -299,12 +395,12 @@ TEST_SUITE(LockManagerTest::release_lock, {
         auto lock3 = fut2.get();
         auto lock4 = fut3.get();
 
-        auto& module = manager.locks[HID(1, 2, 3).make_hashable()];
+        auto& module = manager.locks[HID(1, 2, 3)];
         TEST(module.mode == LockMode::SHARED);
         TEST(module.wait.size() == 0);
         TEST(module.run.size() == 2);
-        TEST(std::set<std::shared_ptr<Lock>>(module.run.begin(), module.run.end())
-            == std::set<std::shared_ptr<Lock>>({ lock3, lock4 }));
+        TEST(std::set<Lock*>(module.run.begin(), module.run.end())
+            == std::set<Lock*>({ lock3, lock4 }));
 
         TEST_SUCCESS(manager.release_lock(lock3));
 
@@ -340,8 +436,8 @@ TEST_SUITE(LockManagerTest::deadlock, {
 
     TEST((res == Status::SUCCESS && res2 == Status::FAILURE)
         || (res == Status::FAILURE && res2 == Status::SUCCESS));
-    TEST((res == Status::SUCCESS && dbms.trxs.trxs.find(xid2) == dbms.trxs.trxs.end())
-        || (res == Status::FAILURE && dbms.trxs.trxs.find(xid) == dbms.trxs.trxs.end()));
+    TEST((res == Status::SUCCESS && dbms.trxs.find_trx(xid2) == nullptr)
+        || (res == Status::FAILURE && dbms.trxs.find_trx(xid) == nullptr));
 
     // case 1. shared -> exclusive
     /// TODO: Impl
@@ -490,17 +586,18 @@ TEST_SUITE(LockManagerTest::lockable, {
     module.mode = LockMode::IDLE;
 
     HID hid(10, 20, 30);
-    auto lock = std::make_shared<Lock>(hid, LockMode::SHARED, nullptr);
-    TEST(manager.lockable(module, lock));
+    Transaction trx(10);
+    Lock lock(hid, LockMode::SHARED, &trx);
+    TEST(manager.lockable(module, &lock));
 
     module.mode = LockMode::SHARED;
-    TEST(manager.lockable(module, lock));
+    TEST(manager.lockable(module, &lock));
 
-    lock->mode = LockMode::EXCLUSIVE;
-    TEST(!manager.lockable(module, lock));
+    lock.mode = LockMode::EXCLUSIVE;
+    TEST(!manager.lockable(module, &lock));
 
     module.mode = LockMode::EXCLUSIVE;
-    TEST(!manager.lockable(module, lock));
+    TEST(!manager.lockable(module, &lock));
 })
 
 std::unique_ptr<LockManagerTest::GraphInfo> LockManagerTest::sample_dag() {
@@ -514,25 +611,25 @@ std::unique_ptr<LockManagerTest::GraphInfo> LockManagerTest::sample_dag() {
         trxs[i] = Transaction(i);
     }
 
-    auto& module01 = locktable[HID(0, 1, 2).make_hashable()];
+    auto& module01 = locktable[HID(0, 1, 2)];
     module01.mode = LockMode::EXCLUSIVE;
-    module01.run.push_back(std::make_shared<Lock>(HID(0, 1, 2), LockMode::EXCLUSIVE, &trxs[1]));
-    module01.wait.push_back(std::make_shared<Lock>(HID(0, 1, 2), LockMode::EXCLUSIVE, &trxs[0]));
+    module01.run.push_back(graph_info->make_lock(HID(0, 1, 2), LockMode::EXCLUSIVE, &trxs[1]));
+    module01.wait.push_back(graph_info->make_lock(HID(0, 1, 2), LockMode::EXCLUSIVE, &trxs[0]));
     trxs[0].wait = module01.wait.back();
 
-    auto& module11 = locktable[HID(0, 2, 2).make_hashable()];
+    auto& module11 = locktable[HID(0, 2, 2)];
     module11.mode = LockMode::EXCLUSIVE;
-    module11.run.push_back(std::make_shared<Lock>(HID(0, 2, 2), LockMode::EXCLUSIVE, &trxs[3]));
-    module11.wait.push_back(std::make_shared<Lock>(HID(0, 2, 2), LockMode::SHARED, &trxs[1]));
+    module11.run.push_back(graph_info->make_lock(HID(0, 2, 2), LockMode::EXCLUSIVE, &trxs[3]));
+    module11.wait.push_back(graph_info->make_lock(HID(0, 2, 2), LockMode::SHARED, &trxs[1]));
     trxs[1].wait = module11.wait.back();
-    module11.wait.push_back(std::make_shared<Lock>(HID(0, 2, 2), LockMode::SHARED, &trxs[2]));
+    module11.wait.push_back(graph_info->make_lock(HID(0, 2, 2), LockMode::SHARED, &trxs[2]));
     trxs[2].wait = module11.wait.back();
 
-    auto& module21 = locktable[HID(1, 3, 2).make_hashable()];
+    auto& module21 = locktable[HID(1, 3, 2)];
     module21.mode = LockMode::SHARED;
-    module21.run.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::SHARED, &trxs[4]));
-    module21.run.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::SHARED, &trxs[5]));
-    module21.wait.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::EXCLUSIVE, &trxs[3]));
+    module21.run.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::SHARED, &trxs[4]));
+    module21.run.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::SHARED, &trxs[5]));
+    module21.wait.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::EXCLUSIVE, &trxs[3]));
     trxs[3].wait = module21.wait.back();
     
     graph_info->graph = LockManager::DeadlockDetector::construct_graph(locktable);
@@ -550,44 +647,173 @@ std::unique_ptr<LockManagerTest::GraphInfo> LockManagerTest::sample_graph() {
         trxs[i] = Transaction(i);
     }
 
-    LockManager::LockStruct& module12 = locktable[HID(1, 2, 3).make_hashable()];
+    LockManager::LockStruct& module12 = locktable[HID(1, 2, 3)];
     module12.mode = LockMode::EXCLUSIVE;
-    module12.run.push_back(std::make_shared<Lock>(HID(1, 2, 3), LockMode::EXCLUSIVE, &trxs[1]));
-    module12.wait.push_back(std::make_shared<Lock>(HID(1, 2, 3), LockMode::EXCLUSIVE, &trxs[3]));
+    module12.run.push_back(graph_info->make_lock(HID(1, 2, 3), LockMode::EXCLUSIVE, &trxs[1]));
+    module12.wait.push_back(graph_info->make_lock(HID(1, 2, 3), LockMode::EXCLUSIVE, &trxs[3]));
     trxs[3].wait = module12.wait.back();
 
-    LockManager::LockStruct& module32 = locktable[HID(1, 3, 2).make_hashable()];
+    LockManager::LockStruct& module32 = locktable[HID(1, 3, 2)];
     module32.mode = LockMode::SHARED;
-    module32.run.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::SHARED, &trxs[3]));
-    module32.run.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::SHARED, &trxs[6]));
-    module32.wait.push_back(std::make_shared<Lock>(HID(1, 3, 2), LockMode::EXCLUSIVE, &trxs[2]));
+    module32.run.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::SHARED, &trxs[3]));
+    module32.run.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::SHARED, &trxs[6]));
+    module32.wait.push_back(graph_info->make_lock(HID(1, 3, 2), LockMode::EXCLUSIVE, &trxs[2]));
     trxs[2].wait = module32.wait.back();
 
-    LockManager::LockStruct& module22 = locktable[HID(1, 2, 2).make_hashable()];
+    LockManager::LockStruct& module22 = locktable[HID(1, 2, 2)];
     module22.mode = LockMode::SHARED;
-    module22.run.push_back(std::make_shared<Lock>(HID(1, 2, 2), LockMode::SHARED, &trxs[2]));
-    module22.run.push_back(std::make_shared<Lock>(HID(1, 2, 2), LockMode::SHARED, &trxs[5]));
-    module22.wait.push_back(std::make_shared<Lock>(HID(1, 2, 2), LockMode::EXCLUSIVE, &trxs[1]));
+    module22.run.push_back(graph_info->make_lock(HID(1, 2, 2), LockMode::SHARED, &trxs[2]));
+    module22.run.push_back(graph_info->make_lock(HID(1, 2, 2), LockMode::SHARED, &trxs[5]));
+    module22.wait.push_back(graph_info->make_lock(HID(1, 2, 2), LockMode::EXCLUSIVE, &trxs[1]));
     trxs[1].wait = module22.wait.back();
-    module22.wait.push_back(std::make_shared<Lock>(HID(1, 2, 2), LockMode::EXCLUSIVE, &trxs[4]));
+    module22.wait.push_back(graph_info->make_lock(HID(1, 2, 2), LockMode::EXCLUSIVE, &trxs[4]));
     trxs[4].wait = module22.wait.back();
 
-    LockManager::LockStruct& module42 = locktable[HID(1, 4, 2).make_hashable()];
+    LockManager::LockStruct& module42 = locktable[HID(1, 4, 2)];
     module42.mode = LockMode::EXCLUSIVE;
-    module42.run.push_back(std::make_shared<Lock>(HID(1, 4, 2), LockMode::EXCLUSIVE, &trxs[4]));
-    module42.wait.push_back(std::make_shared<Lock>(HID(1, 4, 2), LockMode::EXCLUSIVE, &trxs[5]));
+    module42.run.push_back(graph_info->make_lock(HID(1, 4, 2), LockMode::EXCLUSIVE, &trxs[4]));
+    module42.wait.push_back(graph_info->make_lock(HID(1, 4, 2), LockMode::EXCLUSIVE, &trxs[5]));
     trxs[5].wait = module42.wait.back();
 
-    LockManager::LockStruct& module52 = locktable[HID(1, 5, 2).make_hashable()];
+    LockManager::LockStruct& module52 = locktable[HID(1, 5, 2)];
     module52.mode = LockMode::EXCLUSIVE;
-    module52.run.push_back(std::make_shared<Lock>(HID(1, 5, 2), LockMode::EXCLUSIVE, &trxs[6]));
-    module52.wait.push_back(std::make_shared<Lock>(HID(1, 5, 2), LockMode::EXCLUSIVE, &trxs[0]));
+    module52.run.push_back(graph_info->make_lock(HID(1, 5, 2), LockMode::EXCLUSIVE, &trxs[6]));
+    module52.wait.push_back(graph_info->make_lock(HID(1, 5, 2), LockMode::EXCLUSIVE, &trxs[0]));
     trxs[0].wait = module52.wait.back();
 
     graph_info->graph = LockManager::DeadlockDetector::construct_graph(locktable);
     return std::move(graph_info);
 }
 
+TEST_SUITE(LockManagerTest::escalation, {
+    Database dbms(4, false);
+    TEST_SUCCESS(dbms.set_escalation(4, 2));
+
+    trxid_t xid = dbms.begin_trx();
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, HID(1, 2, i), LockMode::SHARED));
+    }
+
+    Transaction& trx = *dbms.trxs.find_trx(xid);
+    TEST(trx.locks.size() == 5);
+    TEST(trx.locks.at(HID::table(1))->get_mode() == LockMode::INTENTION_SHARED);
+    TEST(trx.locks.at(HID::page(1, 2))->get_mode() == LockMode::INTENTION_SHARED);
+
+    // case 0. record to page
+    TEST_SUCCESS(dbms.trxs.require_lock(xid, HID(1, 2, 3), LockMode::EXCLUSIVE));
+    TEST(trx.locks.size() == 2);
+    TEST(trx.locks.at(HID::table(1))->get_mode() == LockMode::INTENTION_EXCLUSIVE);
+    TEST(trx.locks.at(HID::page(1, 2))->get_mode() == LockMode::EXCLUSIVE);
+    TEST(dbms.locks.locks.size() == 2);
+
+    // covered by page lock
+    TEST_SUCCESS(dbms.trxs.require_lock(xid, HID(1, 2, 10), LockMode::EXCLUSIVE));
+    TEST(trx.locks.size() == 2);
+
+    // case 1. page to table
+    TEST_SUCCESS(dbms.trxs.require_lock(xid, HID(1, 3, 0), LockMode::SHARED));
+    TEST(trx.locks.size() == 1);
+    TEST(trx.locks.at(HID::table(1))->get_mode() == LockMode::EXCLUSIVE);
+    TEST(dbms.locks.locks.size() == 1);
+
+    TEST_SUCCESS(dbms.end_trx(xid));
+    TEST(dbms.locks.locks.size() == 0);
+
+    // case 2. disabled
+    TEST_SUCCESS(dbms.set_escalation(0, 0));
+    xid = dbms.begin_trx();
+    for (size_t i = 0; i < 10; ++i) {
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, HID(1, 2, i), LockMode::SHARED));
+    }
+    TEST(dbms.trxs.find_trx(xid)->locks.size() == 12);
+    TEST_SUCCESS(dbms.end_trx(xid));
+})
+
+TEST_SUITE(LockManagerTest::upgrade_lock, {
+    HID hid(1, 2, 3);
+    {
+        // case 0. upgrade in place
+        Database dbms(4, false);
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, hid, LockMode::SHARED));
+        Lock* lock = dbms.trxs.find_trx(xid)->locks.at(hid);
+
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, hid, LockMode::EXCLUSIVE));
+        TEST(dbms.trxs.find_trx(xid)->locks.at(hid) == lock);
+        TEST(lock->get_mode() == LockMode::EXCLUSIVE);
+        TEST(dbms.locks.locks.at(hid).run.size() == 1);
+        TEST(dbms.locks.locks.at(hid).mode == LockMode::EXCLUSIVE);
+        TEST_SUCCESS(dbms.end_trx(xid));
+    }
+    {
+        // case 1. upgrader has priority over the waiting request
+        Database dbms(4, false);
+        trxid_t xid = dbms.begin_trx();
+        trxid_t xid2 = dbms.begin_trx();
+        trxid_t xid3 = dbms.begin_trx();
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, hid, LockMode::SHARED));
+        TEST_SUCCESS(dbms.trxs.require_lock(xid2, hid, LockMode::SHARED));
+
+        std::atomic<int> order(0);
+        int upgraded = 0;
+        int reader = 0;
+        std::thread upgrader([&] {
+            if (dbms.trxs.require_lock(xid, hid, LockMode::EXCLUSIVE)
+                    == Status::SUCCESS) {
+                upgraded = ++order;
+                dbms.end_trx(xid);
+            }
+        });
+        while (dbms.trx_state(xid) != TrxState::WAITING) {
+            std::this_thread::yield();
+        }
+
+        // compatible with the holders, but waits behind the upgrader
+        std::thread waiter([&] {
+            if (dbms.trxs.require_lock(xid3, hid, LockMode::SHARED)
+                    == Status::SUCCESS) {
+                reader = ++order;
+                dbms.end_trx(xid3);
+            }
+        });
+        while (dbms.trx_state(xid3) != TrxState::WAITING) {
+            std::this_thread::yield();
+        }
+        TEST(order == 0);
+
+        TEST_SUCCESS(dbms.end_trx(xid2));
+        upgrader.join();
+        waiter.join();
+        TEST(upgraded == 1);
+        TEST(reader == 2);
+        TEST(dbms.locks.locks.size() == 0);
+    }
+    {
+        // case 2. conversion deadlock
+        Database dbms(4, false);
+        trxid_t xid = dbms.begin_trx();
+        trxid_t xid2 = dbms.begin_trx();
+        TEST_SUCCESS(dbms.trxs.require_lock(xid, hid, LockMode::SHARED));
+        TEST_SUCCESS(dbms.trxs.require_lock(xid2, hid, LockMode::SHARED));
+
+        Status res;
+        std::thread thread([&] {
+            res = dbms.trxs.require_lock(xid, hid, LockMode::EXCLUSIVE);
+        });
+        Status res2 = dbms.trxs.require_lock(xid2, hid, LockMode::EXCLUSIVE);
+        thread.join();
+
+        TEST((res == Status::SUCCESS && res2 == Status::FAILURE)
+            || (res == Status::FAILURE && res2 == Status::SUCCESS));
+        trxid_t winner = res == Status::SUCCESS ? xid : xid2;
+        TEST(dbms.trx_state(winner) == TrxState::RUNNING);
+        TEST(dbms.trxs.find_trx(winner)->locks.at(hid)->get_mode()
+            == LockMode::EXCLUSIVE);
+        TEST_SUCCESS(dbms.end_trx(winner));
+        TEST(dbms.locks.locks.size() == 0);
+    }
+})
+
 TEST_SUITE(LockManagerTest::integrate, {
     /// TODO: impl.
 })
@@ -596,11 +822,14 @@ int lock_manager_test() {
     return HierarchicalTest::constructor_test()
         && HierarchicalTest::make_hashable_test()
         && HierarchicalTest::comparison_test()
+        && HierarchicalTest::level_test()
+        && LockTest::modes_test()
         && LockTest::constructor_test()
         && LockTest::move_constructor_test()
         && LockTest::move_assignment_test()
         && LockTest::getter_test()
         && LockTest::run_test()
+        && LockTest::queue_test()
         && LockManagerTest::require_lock_test()
         // && LockManagerTest::release_lock_test()
         && LockManagerTest::detect_and_release_test()
@@ -617,5 +846,7 @@ int lock_manager_test() {
         && LockManagerTest::deadlock_choose_abort_test()
         && LockManagerTest::deadlock_construct_graph_test()
         // && LockManagerTest::lockable_test()
+        && LockManagerTest::escalation_test()
+        && LockManagerTest::upgrade_lock_test()
         && LockManagerTest::integrate_test();
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
+#include "dbms.hpp"
+#include "fileio.hpp"
 #include "log_manager.hpp"
 #include "test.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
 struct LogManagerTest {
     TEST_METHOD(constructor)
     TEST_METHOD(get_lsn)
@@ -10,6 +19,20 @@ struct LogManagerTest {
     TEST_METHOD(log_commit)
     TEST_METHOD(log_end)
     TEST_METHOD(remove_trxlog)
+    TEST_METHOD(log_clr)
+    TEST_METHOD(ring_buffer)
+    TEST_METHOD(flush)
+    TEST_METHOD(register_table)
+    TEST_METHOD(recovery)
+    TEST_METHOD(checkpoint)
+    TEST_METHOD(checkpointer)
+    TEST_METHOD(parallel_redo)
+    TEST_METHOD(packed_log)
+    TEST_METHOD(group_commit)
+    TEST_METHOD(insert_delete)
+    TEST_METHOD(read_only)
+    TEST_METHOD(abort_batch)
+    TEST_METHOD(structure)
 };
 
 TEST_SUITE(log_constructor, {
@@ -29,11 +52,11 @@ TEST_SUITE(log_constructor, {
     TEST(log2.hid == HID());
     TEST(log2.offset == -1);
 
-    Record before;
+    Record before = Record();
     before.key = 300;
     before.value[0] = 'a';
 
-    Record after;
+    Record after = Record();
     after.key = 400;
     after.value[0] = 'b';
 
@@ -48,26 +71,54 @@ TEST_SUITE(log_constructor, {
     TEST(log3.before.value[0] == 'a');
     TEST(log3.after.key == 400);
     TEST(log3.after.value[0] == 'b');
+    TEST(log3.delta_offset == 0);
+    TEST(log3.delta_length == 1);
+
+    after.value[0] = 'a';
+    after.value[10] = 'c';
+    after.value[20] = 'd';
+    Log log4(5, 4, 3, LogType::UPDATE, HID(1, 10, 20), 100, before, after);
+    TEST(log4.delta_offset == 10);
+    TEST(log4.delta_length == 11);
+
+    Log log5(6, 5, 3, LogType::UPDATE, HID(1, 10, 20), 100, before, before);
+    TEST(log5.delta_length == 0);
 })
 
 TEST_SUITE(LogManagerTest::constructor, {
     LogManager logmng;
     TEST(logmng.last_lsn == 0);
-    TEST(logmng.log_map.size() == 0);
+    TEST(logmng.drained_lsn == 0);
+    TEST(logmng.get_logs(10).size() == 0);
 })
 
 TEST_SUITE(LogManagerTest::get_lsn, {
     LogManager logmng;
     TEST(1 == logmng.get_lsn());
-
-    logmng.last_lsn = static_cast<size_t>(-1);
-    TEST(1 == logmng.get_lsn());
+    TEST(2 == logmng.get_lsn());
+    TEST(logmng.last_lsn == 2);
 })
 
 TEST_SUITE(LogManagerTest::get_logs, {
     LogManager logmng;
-    logmng.log_map[10].emplace_back();
-    // TEST(&logmng.get_logs(10) == &logmng.log_map[10]);
+    logmng.log_commit(10);
+    logmng.log_commit(20);
+    logmng.log_end(10);
+
+    // logs are drained from ring buffer on demand
+    TEST(logmng.drained_lsn == 0);
+    std::list<Log> logs = logmng.get_logs(10);
+    TEST(logmng.drained_lsn == 3);
+    TEST(logs.size() == 2);
+    TEST(logs.front().lsn == 3);
+    TEST(logs.front().prev_lsn == 1);
+    TEST(logs.back().lsn == 1);
+    TEST(logs.back().type == LogType::COMMIT);
+
+    logs = logmng.get_logs(20);
+    TEST(logs.size() == 1);
+    TEST(logs.front().lsn == 2);
+    TEST(logs.front().prev_lsn == INVALID_LSN);
 })
 
 TEST_SUITE(LogManagerTest::log_update, {
@@ -82,71 +133,996 @@ TEST_SUITE(LogManagerTest::log_update, {
     LogManager logmng;
     lsn_t lsn = logmng.log_update(10, HID(1, 20, 30), 40, before, after);
     TEST(lsn == 1);
-    TEST(logmng.log_map[10].size() == 1);
-    TEST(logmng.log_map[10].front().lsn == 1);
-    TEST(logmng.log_map[10].front().prev_lsn == 0);
-    TEST(logmng.log_map[10].front().xid == 10);
-    TEST(logmng.log_map[10].front().type == LogType::UPDATE);
-    TEST(logmng.log_map[10].front().hid == HID(1, 20, 30));
-    TEST(logmng.log_map[10].front().offset == 40);
-    TEST(logmng.log_map[10].front().before.key == 300);
-    TEST(logmng.log_map[10].front().before.value[0] == 'a');
-    TEST(logmng.log_map[10].front().after.key == 400);
-    TEST(logmng.log_map[10].front().after.value[0] == 'b');
+    TEST(logmng.get_logs(10).size() == 1);
+    TEST(logmng.get_logs(10).front().lsn == 1);
+    TEST(logmng.get_logs(10).front().prev_lsn == 0);
+    TEST(logmng.get_logs(10).front().xid == 10);
+    TEST(logmng.get_logs(10).front().type == LogType::UPDATE);
+    TEST(logmng.get_logs(10).front().hid == HID(1, 20, 30));
+    TEST(logmng.get_logs(10).front().offset == 40);
+    TEST(logmng.get_logs(10).front().before.key == 300);
+    TEST(logmng.get_logs(10).front().before.value[0] == 'a');
+    TEST(logmng.get_logs(10).front().after.key == 400);
+    TEST(logmng.get_logs(10).front().after.value[0] == 'b');
 
     lsn = logmng.log_update(10, HID(1, 60, 70), 80, before, after);
     TEST(lsn == 2);
-    TEST(logmng.log_map[10].size() == 2);
-    TEST(logmng.log_map[10].front().lsn == 2);
-    TEST(logmng.log_map[10].front().prev_lsn == 1);
+    TEST(logmng.get_logs(10).size() == 2);
+    TEST(logmng.get_logs(10).front().lsn == 2);
+    TEST(logmng.get_logs(10).front().prev_lsn == 1);
 
     lsn = logmng.log_update(10, HID(1, 90, 100), 110, before, after);
     TEST(lsn == 3);
-    TEST(logmng.log_map[10].size() == 3);
-    TEST(logmng.log_map[10].front().lsn == 3);
-    TEST(logmng.log_map[10].front().prev_lsn == 2);
+    TEST(logmng.get_logs(10).size() == 3);
+    TEST(logmng.get_logs(10).front().lsn == 3);
+    TEST(logmng.get_logs(10).front().prev_lsn == 2);
 })
 
 TEST_SUITE(LogManagerTest::log_abort, {
     LogManager logmng;
     lsn_t lsn = logmng.log_abort(10);
     TEST(lsn == 1);
-    TEST(logmng.log_map[10].size() == 1);
-    TEST(logmng.log_map[10].front().lsn == 1);
-    TEST(logmng.log_map[10].front().prev_lsn == 0);
-    TEST(logmng.log_map[10].front().xid == 10);
-    TEST(logmng.log_map[10].front().type == LogType::ABORT);
+    TEST(logmng.get_logs(10).size() == 1);
+    TEST(logmng.get_logs(10).front().lsn == 1);
+    TEST(logmng.get_logs(10).front().prev_lsn == 0);
+    TEST(logmng.get_logs(10).front().xid == 10);
+    TEST(logmng.get_logs(10).front().type == LogType::ABORT);
 })
 
 TEST_SUITE(LogManagerTest::log_commit, {
     LogManager logmng;
     lsn_t lsn = logmng.log_commit(10);
     TEST(lsn == 1);
-    TEST(logmng.log_map[10].size() == 1);
-    TEST(logmng.log_map[10].front().lsn == 1);
-    TEST(logmng.log_map[10].front().prev_lsn == 0);
-    TEST(logmng.log_map[10].front().xid == 10);
-    TEST(logmng.log_map[10].front().type == LogType::COMMIT);
+    TEST(logmng.get_logs(10).size() == 1);
+    TEST(logmng.get_logs(10).front().lsn == 1);
+    TEST(logmng.get_logs(10).front().prev_lsn == 0);
+    TEST(logmng.get_logs(10).front().xid == 10);
+    TEST(logmng.get_logs(10).front().type == LogType::COMMIT);
 })
 
 TEST_SUITE(LogManagerTest::log_end, {
     LogManager logmng;
     lsn_t lsn = logmng.log_end(10);
     TEST(lsn == 1);
-    TEST(logmng.log_map[10].size() == 1);
-    TEST(logmng.log_map[10].front().lsn == 1);
-    TEST(logmng.log_map[10].front().prev_lsn == 0);
-    TEST(logmng.log_map[10].front().xid == 10);
-    TEST(logmng.log_map[10].front().type == LogType::END);
+    TEST(logmng.get_logs(10).size() == 1);
+    TEST(logmng.get_logs(10).front().lsn == 1);
+    TEST(logmng.get_logs(10).front().prev_lsn == 0);
+    TEST(logmng.get_logs(10).front().xid == 10);
+    TEST(logmng.get_logs(10).front().type == LogType::END);
 })
 
 TEST_SUITE(LogManagerTest::remove_trxlog, {
     LogManager logmng;
-    logmng.log_map[10].emplace_back();
-    TEST(logmng.log_map[10].size() == 1);
+    logmng.log_end(10);
+    TEST(logmng.get_logs(10).size() == 1);
     TEST_SUCCESS(logmng.remove_trxlog(10));
     TEST(logmng.remove_trxlog(10) == Status::FAILURE);
-    TEST(logmng.log_map.find(10) == logmng.log_map.end());
+    TEST(logmng.get_logs(10).size() == 0);
+})
+
+TEST_SUITE(LogManagerTest::log_clr, {
+    Record before;
+    before.key = 300;
+    Record after;
+    after.key = 300;
+
+    LogManager logmng;
+    logmng.log_update(10, HID(1, 20, 30), 30, before, after);
+    lsn_t lsn = logmng.log_clr(10, HID(1, 20, 30), 30, after, before, 0);
+    TEST(lsn == 2);
+    TEST(logmng.get_logs(10).front().type == LogType::CLR);
+    TEST(logmng.get_logs(10).front().prev_lsn == 1);
+    TEST(logmng.get_logs(10).front().undo_next == 0);
+})
+
+TEST_SUITE(LogManagerTest::ring_buffer, {
+    constexpr int num_threads = 4;
+    constexpr int num_logs = LogManager::BUFFER_SIZE;
+    Record record;
+    record.key = 10;
+
+    for (int durable = 0; durable < 2; ++durable) {
+        LogManager logmng;
+        if (durable) {
+            TEST_SUCCESS(logmng.open("testlog"));
+        }
+
+        // concurrent writers wrap around the ring buffer
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&, i] {
+                for (int j = 0; j < num_logs; ++j) {
+                    logmng.log_update(
+                        i + 1, HID(1, 2, j), j % 31, record, record);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        TEST(logmng.last_lsn == num_threads * num_logs);
+
+        for (int i = 0; i < num_threads; ++i) {
+            std::list<Log> logs = logmng.get_logs(i + 1);
+            TEST(logs.size() == num_logs);
+
+            // chain is in reverse chronological order
+            int j = num_logs;
+            lsn_t lsn = logs.front().lsn + 1;
+            for (Log const& log : logs) {
+                TEST(log.xid == static_cast<trxid_t>(i + 1));
+                TEST(log.hid == HID(1, 2, --j));
+                TEST(log.lsn < lsn);
+                lsn = log.lsn;
+            }
+            TEST_SUCCESS(logmng.remove_trxlog(i + 1));
+        }
+
+        if (durable) {
+            TEST_SUCCESS(logmng.flush_all());
+            std::vector<Log> logs = logmng.read_logs();
+            TEST(logs.size() == num_threads * num_logs);
+        } else {
+            // logs of the finished transactions are discarded
+            logmng.log_end(100);
+            logmng.get_logs(100);
+            TEST(logmng.archive.size() <= LogManager::BUFFER_SIZE + 1);
+        }
+    }
+    remove("testlog");
+})
+
+TEST_SUITE(LogManagerTest::flush, {
+    Record record;
+    record.key = 10;
+    {
+        LogManager logmng;
+        TEST(!logmng.durable());
+        logmng.log_update(10, HID(1, 2, 3), 3, record, record);
+        TEST_SUCCESS(logmng.flush(1));
+        TEST(logmng.flushed_lsn == 0);
+        // log file should be opened before writing logs
+        TEST(logmng.open("testlog") == Status::FAILURE);
+    }
+    {
+        LogManager logmng;
+        TEST_SUCCESS(logmng.open("testlog"));
+        TEST(logmng.durable());
+        TEST(logmng.last_lsn == 0);
+
+        logmng.log_update(10, HID(1, 2, 3), 3, record, record);
+        logmng.log_update(20, HID(1, 2, 4), 4, record, record);
+        logmng.log_commit(10);
+        TEST(logmng.drained_lsn == 0);
+
+        TEST_SUCCESS(logmng.flush(2));
+        TEST(logmng.drained_lsn == 3);
+        TEST(logmng.flushed_lsn == 3);
+        // records are not changed, only headers are written
+        TEST(fsize(logmng.fp) == 3 * sizeof(LogManager::PackedLog));
+
+        // already durable
+        logmng.log_end(10);
+        TEST_SUCCESS(logmng.flush(3));
+        TEST(logmng.drained_lsn == 3);
+
+        // logs are read back from the log file
+        std::list<Log> logs = logmng.get_logs(10);
+        TEST(logs.size() == 3);
+        TEST(logs.front().type == LogType::END);
+        TEST(logs.back().type == LogType::UPDATE);
+    }
+    {
+        LogManager logmng;
+        TEST_SUCCESS(logmng.open("testlog"));
+        TEST(logmng.last_lsn == 4);
+
+        std::vector<Log> logs = logmng.read_logs();
+        TEST(logs.size() == 4);
+        TEST(logs[0].type == LogType::UPDATE);
+        TEST(logs[1].xid == 20);
+        TEST(logs[1].hid == HID(1, 2, 4));
+        TEST(logs[2].type == LogType::COMMIT);
+        TEST(logs[2].prev_lsn == 1);
+        TEST(logs[3].type == LogType::END);
+
+        TEST(logmng.log_abort(30) == 5);
+    }
+    remove("testlog");
+})
+
+TEST_SUITE(LogManagerTest::register_table, {
+    {
+        LogManager logmng;
+        TEST_SUCCESS(logmng.register_table(1, "testdb"));
+        TEST(logmng.catalog.size() == 0);
+
+        TEST_SUCCESS(logmng.open("testlog"));
+        TEST_SUCCESS(logmng.register_table(1, "testdb"));
+        TEST_SUCCESS(logmng.register_table(2, "dir/testdb2"));
+        TEST_SUCCESS(logmng.register_table(1, "testdb"));
+    }
+    {
+        LogManager logmng;
+        TEST_SUCCESS(logmng.open("testlog"));
+        TEST(logmng.catalog.size() == 2);
+        TEST(logmng.catalog[1] == "testdb");
+        TEST(logmng.catalog[2] == "dir/testdb2");
+    }
+    remove("testlog");
+    remove("testlog.catalog");
+})
+
+TEST_SUITE(LogManagerTest::recovery, {
+    auto make_record = [](prikey_t key, char const* value) {
+        Record record;
+        record.key = key;
+        std::strcpy(reinterpret_cast<char*>(record.value), value);
+        return record;
+    };
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        dbms.find(tid, key, &record);
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+
+    {
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 10; ++i) {
+            dbms.insert(tid, i, reinterpret_cast<uint8_t const*>("init"), 5);
+        }
+    }
+
+    {
+        // simulate crash, destructor is never called
+        Database* dbms = new Database(4, false, "testlog", 0);
+        TEST(reinterpret_cast<uintptr_t>(dbms) % alignof(Database) == 0);
+        tableid_t tid = dbms->open_table("testdb");
+
+        // uncommitted, but stolen
+        trxid_t xid = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 2, make_record(2, "loser"), xid));
+        TEST_SUCCESS(dbms->buffers.release_file((*dbms)[tid]->fileid()));
+
+        // committed, but not written
+        trxid_t xid2 = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 1, make_record(1, "winner"), xid2));
+        TEST_SUCCESS(dbms->end_trx(xid2));
+
+        // aborted before crash
+        trxid_t xid3 = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 3, make_record(3, "aborted"), xid3));
+        TEST_SUCCESS(dbms->abort_trx(xid3));
+        TEST_SUCCESS(dbms->logs.flush_all());
+
+        TEST(value_of(*dbms, tid, 1) == "winner");
+        TEST(value_of(*dbms, tid, 2) == "loser");
+        TEST(value_of(*dbms, tid, 3) == "init");
+    }
+
+    {
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        TEST(value_of(dbms, tid, 1) == "winner");
+        TEST(value_of(dbms, tid, 2) == "init");
+        TEST(value_of(dbms, tid, 3) == "init");
+        TEST(value_of(dbms, tid, 4) == "init");
+
+        // all transactions are finished
+        std::vector<Log> logs = dbms.logs.read_logs();
+        TEST(logs.back().type == LogType::END);
+        TEST(logs[logs.size() - 2].type == LogType::CLR);
+        TEST(logs[logs.size() - 2].undo_next == INVALID_LSN);
+    }
+
+    {
+        // idempotent
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        TEST(value_of(dbms, tid, 1) == "winner");
+        TEST(value_of(dbms, tid, 2) == "init");
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::checkpoint, {
+    auto make_record = [](prikey_t key, char const* value) {
+        Record record;
+        record.key = key;
+        std::strcpy(reinterpret_cast<char*>(record.value), value);
+        return record;
+    };
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        dbms.find(tid, key, &record);
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+
+    {
+        Database dbms(4, false, "testlog", 0);
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 10; ++i) {
+            dbms.insert(tid, i, reinterpret_cast<uint8_t const*>("init"), 5);
+        }
+        // nothing to checkpoint
+        TEST(dbms.logs.last_lsn == 0);
+        TEST_SUCCESS(dbms.checkpoint());
+    }
+
+    {
+        // simulate crash, destructor is never called
+        Database* dbms = new Database(4, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+
+        // active at checkpoint, committed after it
+        trxid_t xid = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 1, make_record(1, "winner"), xid));
+        // active at checkpoint, never committed
+        trxid_t xid2 = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 2, make_record(2, "loser"), xid2));
+
+        std::vector<DirtyPage> pages = dbms->buffers.dirty_pages();
+        TEST(pages.size() == 1);
+        TEST(pages[0].rec_lsn == 1);
+
+        TEST_SUCCESS(dbms->checkpoint());
+        lsn_t master = dbms->logs.master_lsn;
+        TEST(master == 3);
+        TEST(fexist("testlog.master"));
+
+        std::vector<Log> logs = dbms->logs.read_logs(master);
+        TEST(logs.size() == 5);
+        TEST(logs[0].type == LogType::BEGIN_CKPT);
+        TEST(logs[1].type == LogType::CKPT_DPT);
+        TEST(logs[1].undo_next == 1);
+        TEST(logs[2].type == LogType::CKPT_ATT);
+        TEST(logs[3].type == LogType::CKPT_ATT);
+        TEST(logs[4].type == LogType::END_CKPT);
+        TEST(logs[4].undo_next == master);
+
+        // started after checkpoint, never committed
+        trxid_t xid3 = dbms->begin_trx();
+        TEST_SUCCESS(dbms->update(tid, 3, make_record(3, "loser"), xid3));
+        TEST_SUCCESS(dbms->end_trx(xid));
+        TEST_SUCCESS(dbms->logs.flush_all());
+    }
+
+    {
+        // redo starts before checkpoint, from the recLSN of the page
+        Database dbms(4, false, "testlog", 0);
+        tableid_t tid = dbms.open_table("testdb");
+        TEST(value_of(dbms, tid, 1) == "winner");
+        TEST(value_of(dbms, tid, 2) == "init");
+        TEST(value_of(dbms, tid, 3) == "init");
+        TEST(value_of(dbms, tid, 4) == "init");
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::checkpointer, {
+    {
+        Database dbms(4, false, "testlog", 5);
+        tableid_t tid = dbms.open_table("testdb");
+        dbms.insert(tid, 1, reinterpret_cast<uint8_t const*>("init"), 5);
+
+        Record record;
+        record.key = 1;
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 1, record, xid));
+        TEST_SUCCESS(dbms.end_trx(xid));
+
+        // dirty page is written back in background
+        for (int i = 0; i < 200 && dbms.logs.master_lsn == INVALID_LSN; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        TEST(dbms.logs.master_lsn != INVALID_LSN);
+        for (int i = 0; i < 200 && dbms.buffers.dirty_pages().size() > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        TEST(dbms.buffers.dirty_pages().size() == 0);
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::parallel_redo, {
+    constexpr int num_keys = 2000;
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        dbms.find(tid, key, &record);
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+
+    {
+        Database dbms(16, false, "testlog", 0);
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < num_keys; ++i) {
+            dbms.insert(tid, i, reinterpret_cast<uint8_t const*>("init"), 5);
+        }
+    }
+
+    {
+        // simulate crash, committed updates are not written to the pages
+        Database* dbms = new Database(1000, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+        Record record;
+        std::strcpy(reinterpret_cast<char*>(record.value), "redo");
+        for (int round = 0; round < 2; ++round) {
+            trxid_t xid = dbms->begin_trx();
+            for (int i = 0; i < num_keys; ++i) {
+                TEST_SUCCESS(dbms->update(tid, i, record, xid));
+            }
+            TEST_SUCCESS(dbms->end_trx(xid));
+        }
+    }
+
+    for (size_t workers : { 4, 1 }) {
+        // small buffer pool, prefetched pages are evicted and reloaded
+        Database dbms(8);
+        TEST_SUCCESS(dbms.logs.open("testlog"));
+        TEST_SUCCESS(dbms.logs.set_redo_workers(workers));
+        TEST_SUCCESS(dbms.logs.recovery(dbms));
+
+        RecoveryStats const& stats = dbms.recovery_stats();
+        if (workers == 4) {
+            TEST(stats.num_redo == 2 * num_keys);
+            TEST(stats.num_workers == 4);
+            TEST(stats.num_undo == 0);
+            TEST(stats.redo_throughput() > 0);
+        }
+
+        tableid_t tid = dbms.open_table("testdb");
+        int redone = 0;
+        for (int i = 0; i < num_keys; ++i) {
+            redone += value_of(dbms, tid, i) == "redo";
+        }
+        TEST(redone == num_keys);
+    }
+
+    {
+        // inserts and deletes are the barriers between the updates
+        Database* dbms = new Database(1000, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+        Record record;
+        std::strcpy(reinterpret_cast<char*>(record.value), "mixed");
+        trxid_t xid = dbms->begin_trx();
+        for (int i = 0; i < num_keys; ++i) {
+            TEST_SUCCESS(dbms->update(tid, i, record, xid));
+            if (i % 100 == 0) {
+                TEST_SUCCESS(dbms->insert(tid, num_keys + i,
+                    reinterpret_cast<uint8_t const*>("new"), 4, xid));
+                TEST_SUCCESS(dbms->remove(tid, i, xid));
+            }
+        }
+        TEST_SUCCESS(dbms->end_trx(xid));
+    }
+
+    {
+        Database dbms(8);
+        TEST_SUCCESS(dbms.logs.open("testlog"));
+        TEST_SUCCESS(dbms.logs.set_redo_workers(4));
+        TEST_SUCCESS(dbms.logs.recovery(dbms));
+
+        RecoveryStats const& stats = dbms.recovery_stats();
+        // history of the previous crash is repeated again
+        TEST(stats.num_redo == 3 * num_keys + 2 * (num_keys / 100));
+        TEST(stats.num_workers == 4);
+        TEST(stats.num_undo == 0);
+
+        tableid_t tid = dbms.open_table("testdb");
+        int redone = 0;
+        for (int i = 0; i < num_keys; ++i) {
+            if (i % 100 != 0) {
+                redone += value_of(dbms, tid, i) == "mixed";
+            } else {
+                redone += dbms.find(tid, i, nullptr) == Status::FAILURE
+                    && value_of(dbms, tid, num_keys + i) == "new";
+            }
+        }
+        TEST(redone == num_keys);
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::packed_log, {
+    Record before;
+    before.key = 30;
+    std::memset(before.value, 'a', sizeof(before.value));
+    Record after = before;
+    std::memcpy(after.value + 40, "bcd", 3);
+
+    uint8_t data[LogManager::MAX_PACKED];
+    Log log(3, 2, 10, LogType::CLR, HID(1, 2, 4), 4, before, after, 1);
+    size_t size = LogManager::pack(log, data);
+    TEST(size == sizeof(LogManager::PackedLog) + 6);
+
+    Log unpacked;
+    TEST(LogManager::unpack(data, size - 1, &unpacked) == 0);
+    TEST(LogManager::unpack(data, size, &unpacked) == size);
+    TEST(unpacked.lsn == 3);
+    TEST(unpacked.prev_lsn == 2);
+    TEST(unpacked.xid == 10);
+    TEST(unpacked.type == LogType::CLR);
+    TEST(unpacked.hid == HID(1, 2, 4));
+    TEST(unpacked.offset == 4);
+    TEST(unpacked.undo_next == 1);
+    TEST(unpacked.before.key == 30);
+    TEST(unpacked.after.key == 30);
+    TEST(unpacked.delta_offset == 40);
+    TEST(unpacked.delta_length == 3);
+    TEST(std::memcmp(unpacked.before.value + 40, "aaa", 3) == 0);
+    TEST(std::memcmp(unpacked.after.value + 40, "bcd", 3) == 0);
+
+    // changed bytes are written back on replay
+    Page page;
+    TEST_SUCCESS(page.init(true));
+    page.page_header().number_of_keys = 5;
+    std::memcpy(&page.records()[4], &before, sizeof(Record));
+    LogManager::replay(page, 4, unpacked, false, unpacked.lsn);
+    TEST(std::memcmp(&page.records()[4], &after, sizeof(Record)) == 0);
+    TEST(page.page_header().page_lsn == 3);
+
+    LogManager::replay(page, 4, unpacked, true, 4);
+    TEST(std::memcmp(&page.records()[4], &before, sizeof(Record)) == 0);
+    TEST(page.page_header().page_lsn == 4);
+
+    // already applied
+    LogManager::replay(page, 4, unpacked, false, 4);
+    TEST(std::memcmp(&page.records()[4], &before, sizeof(Record)) == 0);
+})
+
+TEST_SUITE(LogManagerTest::group_commit, {
+    {
+        // memory only, nothing to wait
+        LogManager logmng;
+        TEST_SUCCESS(logmng.commit(logmng.log_commit(10)));
+        TEST(logmng.group_commit_stats().num_groups == 0);
+        TEST(logmng.set_group_commit(0, 0) == Status::FAILURE);
+        TEST(logmng.set_group_commit(4, -1) == Status::FAILURE);
+    }
+    {
+        LogManager logmng;
+        TEST_SUCCESS(logmng.open("testlog"));
+        // leader waits until the group is full
+        TEST_SUCCESS(logmng.set_group_commit(4, 10000000));
+
+        std::atomic<int> committed(0);
+        std::vector<std::thread> threads;
+        for (int i = 1; i <= 4; ++i) {
+            threads.emplace_back([&, i] {
+                lsn_t lsn = logmng.log_commit(i);
+                if (logmng.commit(lsn) == Status::SUCCESS
+                    && logmng.flushed_lsn >= lsn
+                ) {
+                    ++committed;
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        TEST(committed == 4);
+
+        GroupCommitStats stats = logmng.group_commit_stats();
+        TEST(stats.num_groups == 1);
+        TEST(stats.num_commits == 4);
+        TEST(stats.max_group == 4);
+        TEST(stats.avg_group() == 4);
+    }
+    {
+        Database dbms(4, false, "testlog", 0);
+        TEST_SUCCESS(dbms.set_group_commit(1, 0));
+        for (int i = 0; i < 3; ++i) {
+            TEST_SUCCESS(dbms.end_trx(dbms.begin_trx()));
+        }
+        GroupCommitStats stats = dbms.group_commit_stats();
+        TEST(stats.num_groups == 3);
+        TEST(stats.num_commits == 3);
+        TEST(stats.max_group == 1);
+    }
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+})
+
+TEST_SUITE(LogManagerTest::insert_delete, {
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        if (dbms.find(tid, key, &record) == Status::FAILURE) {
+            return std::string("none");
+        }
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+    auto as_value = [](char const* value) {
+        return reinterpret_cast<uint8_t const*>(value);
+    };
+
+    {
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 10; i += 2) {
+            dbms.insert(tid, i, as_value("init"), 5);
+        }
+
+        // abort restores both of inserted and deleted records
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.insert(tid, 5, as_value("new"), 4, xid));
+        TEST_SUCCESS(dbms.remove(tid, 4, xid));
+        TEST(dbms.insert(tid, 5, as_value("dup"), 4, xid) == Status::FAILURE);
+        TEST(value_of(dbms, tid, 5) == "new");
+        TEST(value_of(dbms, tid, 4) == "none");
+        TEST_SUCCESS(dbms.abort_trx(xid));
+        TEST(value_of(dbms, tid, 5) == "none");
+        TEST(value_of(dbms, tid, 4) == "init");
+        TEST_SUCCESS(dbms.logs.flush_all());
+
+        std::vector<Log> logs = dbms.logs.read_logs();
+        TEST(logs[logs.size() - 3].type == LogType::CLR_INSERT);
+        TEST(logs[logs.size() - 2].type == LogType::CLR_DELETE);
+
+        // snapshot reader takes no lock
+        Record record;
+        trxid_t reader = dbms.begin_trx();
+        TEST(dbms.find(tid, 7, &record, reader) == Status::FAILURE);
+        trxid_t deleter = dbms.begin_trx();
+        TEST_SUCCESS(dbms.remove(tid, 6, deleter));
+
+        // deleter locks the next key, insertion into the gap waits
+        std::atomic<bool> inserted(false);
+        std::thread writer([&] {
+            trxid_t xid = dbms.begin_trx();
+            if (dbms.insert(tid, 7, as_value("new"), 4, xid)
+                    == Status::SUCCESS) {
+                inserted = true;
+                dbms.end_trx(xid);
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        TEST(!inserted);
+        TEST_SUCCESS(dbms.end_trx(deleter));
+
+        writer.join();
+        TEST(inserted);
+        TEST(value_of(dbms, tid, 6) == "none");
+        TEST(dbms.find(tid, 7, &record, reader) == Status::FAILURE);
+        TEST_SUCCESS(dbms.find(tid, 6, &record, reader));
+        TEST(std::strcmp(reinterpret_cast<char*>(record.value), "init") == 0);
+        TEST_SUCCESS(dbms.end_trx(reader));
+        TEST(value_of(dbms, tid, 7) == "new");
+
+        // first updater wins, stale writer is aborted
+        trxid_t stale = dbms.begin_trx();
+        trxid_t fresh = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 2, record, fresh));
+        TEST_SUCCESS(dbms.end_trx(fresh));
+        TEST(dbms.update(tid, 2, record, stale) == Status::FAILURE);
+        TEST(dbms.trx_state(stale) == TrxState::INVALID);
+        TEST(dbms.version_stats().num_versions == 0);
+    }
+
+    {
+        // simulate crash, destructor is never called
+        Database* dbms = new Database(4, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+
+        trxid_t xid = dbms->begin_trx();
+        TEST_SUCCESS(dbms->insert(tid, 11, as_value("loser"), 6, xid));
+        TEST_SUCCESS(dbms->remove(tid, 0, xid));
+        TEST_SUCCESS(dbms->buffers.release_file((*dbms)[tid]->fileid()));
+        TEST_SUCCESS(dbms->logs.flush_all());
+    }
+
+    {
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        TEST(value_of(dbms, tid, 11) == "none");
+        TEST(value_of(dbms, tid, 0) == "init");
+        TEST(value_of(dbms, tid, 7) == "new");
+        TEST(value_of(dbms, tid, 4) == "init");
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::read_only, {
+    auto make_record = [](prikey_t key, char const* value) {
+        Record record;
+        record.key = key;
+        std::strcpy(reinterpret_cast<char*>(record.value), value);
+        return record;
+    };
+    auto value_of = [](
+        Database& dbms, tableid_t tid, prikey_t key, trxid_t xid
+    ) {
+        Record record;
+        if (dbms.find(tid, key, &record, xid) == Status::FAILURE) {
+            return std::string("none");
+        }
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+    auto as_value = [](char const* value) {
+        return reinterpret_cast<uint8_t const*>(value);
+    };
+
+    {
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 10; ++i) {
+            dbms.insert(tid, i, as_value("init"), 5);
+        }
+
+        // reads from the snapshot, writes are refused
+        trxid_t reader = dbms.begin_trx(true);
+        TEST(value_of(dbms, tid, 1, reader) == "init");
+        TEST(dbms.update(tid, 1, make_record(1, "ro"), reader)
+            == Status::FAILURE);
+        TEST(dbms.insert(tid, 20, as_value("ro"), 3, reader)
+            == Status::FAILURE);
+        TEST(dbms.remove(tid, 2, reader) == Status::FAILURE);
+        TEST(dbms.trx_state(reader) == TrxState::RUNNING);
+
+        // writer is never blocked by the reader
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 1, make_record(1, "new"), xid));
+        TEST_SUCCESS(dbms.remove(tid, 3, xid));
+        TEST_SUCCESS(dbms.end_trx(xid));
+        TEST(value_of(dbms, tid, 1, reader) == "init");
+        TEST(value_of(dbms, tid, 3, reader) == "init");
+
+        // no log is written by the read-only transaction
+        lsn_t last = dbms.logs.last_lsn;
+        TEST_SUCCESS(dbms.end_trx(reader));
+        TEST(dbms.trx_state(reader) == TrxState::INVALID);
+        reader = dbms.begin_trx(true);
+        TEST(value_of(dbms, tid, 1, reader) == "new");
+        TEST_SUCCESS(dbms.abort_trx(reader));
+        TEST(dbms.logs.last_lsn == last);
+        TEST(dbms.version_stats().num_versions == 0);
+
+        // aborted bytes are never visible, even during the rollback
+        std::atomic<bool> running(true);
+        std::atomic<int> num_dirty(0);
+        std::thread aborter([&] {
+            for (int i = 0; i < 200; ++i) {
+                trxid_t xid = dbms.begin_trx();
+                dbms.update(tid, 6, make_record(6, "dirty"), xid);
+                dbms.abort_trx(xid);
+            }
+            running = false;
+        });
+        while (running) {
+            trxid_t xid = dbms.begin_trx(true);
+            if (value_of(dbms, tid, 6, xid) != "init") {
+                ++num_dirty;
+            }
+            dbms.end_trx(xid);
+        }
+        aborter.join();
+        TEST(num_dirty == 0);
+
+        // optimistic mode validates the reads only
+        dbms.set_concurrency(Concurrency::OPTIMISTIC);
+        reader = dbms.begin_trx(true);
+        TEST(value_of(dbms, tid, 4, reader) == "init");
+        TEST(dbms.update(tid, 4, make_record(4, "ro"), reader)
+            == Status::FAILURE);
+        TEST_SUCCESS(dbms.end_trx(reader));
+
+        reader = dbms.begin_trx(true);
+        TEST(value_of(dbms, tid, 5, reader) == "init");
+        xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 5, make_record(5, "new"), xid));
+        TEST_SUCCESS(dbms.end_trx(xid));
+        last = dbms.logs.last_lsn;
+        TEST(dbms.end_trx(reader) == Status::FAILURE);
+        TEST(dbms.trx_state(reader) == TrxState::INVALID);
+        TEST(dbms.logs.last_lsn == last);
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::abort_batch, {
+    constexpr int num_keys = 200;
+    auto make_record = [](prikey_t key, char const* value) {
+        Record record;
+        record.key = key;
+        std::strcpy(reinterpret_cast<char*>(record.value), value);
+        return record;
+    };
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        if (dbms.find(tid, key, &record) == Status::FAILURE) {
+            return std::string("none");
+        }
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+    auto as_value = [](char const* value) {
+        return reinterpret_cast<uint8_t const*>(value);
+    };
+
+    {
+        Database dbms(16, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < num_keys; ++i) {
+            dbms.insert(tid, i, as_value("init"), 5);
+        }
+    }
+
+    {
+        // simulate crash after abort, destructor is never called
+        Database* dbms = new Database(4, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+        lsn_t start = dbms->logs.last_lsn;
+
+        // updates over the pages in scattered order
+        trxid_t xid = dbms->begin_trx();
+        for (int i = 0; i < num_keys - 1; ++i) {
+            prikey_t key = (i * 37) % num_keys;
+            TEST_SUCCESS(dbms->update(tid, key, make_record(key, "upd"), xid));
+        }
+        TEST_SUCCESS(dbms->update(tid, 5, make_record(5, "upd2"), xid));
+        // updates around the structural changes
+        TEST_SUCCESS(dbms->insert(tid, 1000, as_value("new"), 4, xid));
+        TEST_SUCCESS(dbms->update(tid, 1000, make_record(1000, "new2"), xid));
+        TEST_SUCCESS(dbms->update(tid, 7, make_record(7, "upd2"), xid));
+        prikey_t last_key = ((num_keys - 1) * 37) % num_keys;
+        TEST_SUCCESS(dbms->remove(tid, last_key, xid));
+        TEST_SUCCESS(dbms->update(tid, 8, make_record(8, "upd2"), xid));
+        TEST_SUCCESS(dbms->abort_trx(xid));
+
+        for (int i = 0; i < num_keys; ++i) {
+            TEST(value_of(*dbms, tid, i) == "init");
+        }
+        TEST(value_of(*dbms, tid, 1000) == "none");
+
+        // every undoable log is compensated once, chain ends at the first
+        TEST_SUCCESS(dbms->logs.flush_all());
+        std::vector<Log> logs = dbms->logs.read_logs(start + 1);
+        size_t num_undoable = 0;
+        size_t num_clr = 0;
+        Log const* last = nullptr;
+        for (Log const& log : logs) {
+            if (log.undoable()) {
+                ++num_undoable;
+            } else if (log.compensation()) {
+                ++num_clr;
+                last = &log;
+            }
+        }
+        TEST(num_undoable == num_keys + 5);
+        TEST(num_clr == num_undoable);
+        TEST(last != nullptr && last->undo_next == INVALID_LSN);
+    }
+
+    {
+        // redo replays the compensation logs
+        Database dbms(4, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < num_keys; ++i) {
+            TEST(value_of(dbms, tid, i) == "init");
+        }
+        TEST(value_of(dbms, tid, 1000) == "none");
+        TEST(dbms.recovery_stats().num_undo == 0);
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
+})
+
+TEST_SUITE(LogManagerTest::structure, {
+    auto value_of = [](Database& dbms, tableid_t tid, prikey_t key) {
+        Record record;
+        if (dbms.find(tid, key, &record) == Status::FAILURE) {
+            return std::string("none");
+        }
+        return std::string(reinterpret_cast<char*>(record.value));
+    };
+    auto as_value = [](char const* value) {
+        return reinterpret_cast<uint8_t const*>(value);
+    };
+
+    {
+        // page images are packed after the header
+        auto images = std::make_shared<std::vector<uint8_t>>(
+            2 * Log::IMAGE_SIZE, 7);
+        Log log(5, INVALID_LSN, INVALID_TRXID,
+                LogType::PAGE, HID::table(1), images);
+        TEST(log.offset == 2);
+        std::vector<uint8_t> data(LogManager::packed_size(log));
+        TEST(data.size() == sizeof(LogManager::PackedLog) + images->size());
+        TEST(LogManager::pack(log, data.data()) == data.size());
+
+        Log unpacked;
+        TEST(LogManager::unpack(data.data(), data.size() - 1, &unpacked) == 0);
+        TEST(LogManager::unpack(data.data(), data.size(), &unpacked)
+            == data.size());
+        TEST(unpacked.type == LogType::PAGE);
+        TEST(unpacked.offset == 2);
+        TEST(*unpacked.images == *images);
+    }
+
+    {
+        Database dbms(16, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 100; ++i) {
+            dbms.insert(tid, i, as_value("init"), 5);
+        }
+    }
+
+    {
+        // simulate crash, destructor is never called
+        Database* dbms = new Database(16, false, "testlog", 0);
+        tableid_t tid = dbms->open_table("testdb");
+        // redo starts after the records written before
+        TEST_SUCCESS(dbms->buffers.flush_dirty(100));
+        TEST_SUCCESS(dbms->checkpoint());
+        lsn_t start = dbms->logs.last_lsn;
+
+        // leaves split, old records move to the new leaves
+        trxid_t xid = dbms->begin_trx();
+        for (int i = 100; i < 200; ++i) {
+            TEST_SUCCESS(dbms->insert(tid, i, as_value("new"), 4, xid));
+        }
+        TEST_SUCCESS(dbms->end_trx(xid));
+
+        // split leaf is written back, but the new leaf is not
+        TEST_SUCCESS(dbms->buffers.flush_dirty(1));
+        TEST_SUCCESS(dbms->logs.flush_all());
+
+        size_t num_pages = 0;
+        for (Log const& log : dbms->logs.read_logs(start + 1)) {
+            if (log.type == LogType::PAGE) {
+                TEST(log.xid == INVALID_TRXID && log.offset > 1);
+                ++num_pages;
+            }
+        }
+        TEST(num_pages > 0);
+    }
+
+    {
+        Database dbms(16, false, "testlog");
+        tableid_t tid = dbms.open_table("testdb");
+        for (int i = 0; i < 100; ++i) {
+            TEST(value_of(dbms, tid, i) == "init");
+        }
+        for (int i = 100; i < 200; ++i) {
+            TEST(value_of(dbms, tid, i) == "new");
+        }
+        std::vector<Record> records = dbms.find_range(tid, 0, 1000);
+        TEST(records.size() == 200);
+        for (size_t i = 0; i < records.size(); ++i) {
+            TEST(records[i].key == static_cast<prikey_t>(i));
+        }
+    }
+
+    remove("testlog");
+    remove("testlog.catalog");
+    remove("testlog.master");
+    remove("testdb");
 })
 
 int log_manager_test() {
@@ -158,5 +1134,19 @@ int log_manager_test() {
         && LogManagerTest::log_abort_test()
         && LogManagerTest::log_commit_test()
         && LogManagerTest::log_end_test()
-        && LogManagerTest::remove_trxlog_test();
+        && LogManagerTest::remove_trxlog_test()
+        && LogManagerTest::log_clr_test()
+        && LogManagerTest::ring_buffer_test()
+        && LogManagerTest::flush_test()
+        && LogManagerTest::register_table_test()
+        && LogManagerTest::recovery_test()
+        && LogManagerTest::checkpoint_test()
+        && LogManagerTest::checkpointer_test()
+        && LogManagerTest::parallel_redo_test()
+        && LogManagerTest::packed_log_test()
+        && LogManagerTest::group_commit_test()
+        && LogManagerTest::insert_delete_test()
+        && LogManagerTest::read_only_test()
+        && LogManagerTest::abort_batch_test()
+        && LogManagerTest::structure_test();
 }
@@ -0,0 +1,206 @@
+#include "dbms.hpp"
+#include "occ_manager.hpp"
+#include "test.hpp"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+struct OccManagerTest {
+    TEST_METHOD(read_write)
+    TEST_METHOD(validate)
+    TEST_METHOD(abort)
+    TEST_METHOD(concurrency)
+};
+
+static Record make_record(prikey_t key, char const* value) {
+    Record record = Record();
+    record.key = key;
+    std::strcpy(reinterpret_cast<char*>(record.value), value);
+    return record;
+}
+
+static std::string value_of(
+    Database& dbms, tableid_t tid, prikey_t key, trxid_t xid = INVALID_TRXID
+) {
+    Record record;
+    if (dbms.find(tid, key, &record, xid) == Status::FAILURE) {
+        return "none";
+    }
+    return std::string(reinterpret_cast<char*>(record.value));
+}
+
+static tableid_t prepare(Database& dbms) {
+    tableid_t tid = dbms.open_table("testdb");
+    for (int i = 0; i < 10; ++i) {
+        dbms.insert(tid, i, reinterpret_cast<uint8_t const*>("init"), 5);
+    }
+    dbms.set_concurrency(Concurrency::OPTIMISTIC);
+    return tid;
+}
+
+TEST_SUITE(OccManagerTest::read_write, {
+    {
+        Database dbms(4);
+        tableid_t tid = prepare(dbms);
+
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 1, make_record(1, "new"), xid));
+        TEST_SUCCESS(dbms.insert(
+            tid, 20, reinterpret_cast<uint8_t const*>("ins"), 4, xid));
+        TEST_SUCCESS(dbms.remove(tid, 2, xid));
+        TEST(dbms.insert(
+            tid, 3, reinterpret_cast<uint8_t const*>("dup"), 4, xid)
+                == Status::FAILURE);
+        TEST(dbms.update(tid, 30, make_record(30, "none"), xid)
+            == Status::FAILURE);
+
+        // own writes are visible, but not installed until commit
+        TEST(value_of(dbms, tid, 1, xid) == "new");
+        TEST(value_of(dbms, tid, 20, xid) == "ins");
+        TEST(value_of(dbms, tid, 2, xid) == "none");
+        TEST(value_of(dbms, tid, 1) == "init");
+        TEST(value_of(dbms, tid, 20) == "none");
+        TEST(value_of(dbms, tid, 2) == "init");
+
+        TEST_SUCCESS(dbms.end_trx(xid));
+        TEST(value_of(dbms, tid, 1) == "new");
+        TEST(value_of(dbms, tid, 20) == "ins");
+        TEST(value_of(dbms, tid, 2) == "none");
+        TEST(dbms.occ_stats().num_commits == 1);
+
+        // insert after delete in the same transaction
+        xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.remove(tid, 3, xid));
+        TEST_SUCCESS(dbms.insert(
+            tid, 3, reinterpret_cast<uint8_t const*>("re"), 3, xid));
+        TEST_SUCCESS(dbms.insert(
+            tid, 21, reinterpret_cast<uint8_t const*>("tmp"), 4, xid));
+        TEST_SUCCESS(dbms.remove(tid, 21, xid));
+        TEST_SUCCESS(dbms.end_trx(xid));
+        TEST(value_of(dbms, tid, 3) == "re");
+        TEST(value_of(dbms, tid, 21) == "none");
+    }
+    remove("testdb");
+})
+
+TEST_SUITE(OccManagerTest::validate, {
+    {
+        Database dbms(4);
+        tableid_t tid = prepare(dbms);
+
+        // read record is overwritten before commit
+        trxid_t xid = dbms.begin_trx();
+        TEST(value_of(dbms, tid, 1, xid) == "init");
+        trxid_t xid2 = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 1, make_record(1, "other"), xid2));
+        TEST_SUCCESS(dbms.end_trx(xid2));
+
+        TEST_SUCCESS(dbms.update(tid, 5, make_record(5, "stale"), xid));
+        TEST(dbms.end_trx(xid) == Status::FAILURE);
+        TEST(dbms.trx_state(xid) == TrxState::INVALID);
+        TEST(value_of(dbms, tid, 5) == "init");
+
+        // absent key is inserted before commit
+        xid = dbms.begin_trx();
+        TEST(value_of(dbms, tid, 30, xid) == "none");
+        xid2 = dbms.begin_trx();
+        TEST_SUCCESS(dbms.insert(
+            tid, 30, reinterpret_cast<uint8_t const*>("ins"), 4, xid2));
+        TEST_SUCCESS(dbms.end_trx(xid2));
+        TEST_SUCCESS(dbms.update(tid, 6, make_record(6, "stale"), xid));
+        TEST(dbms.end_trx(xid) == Status::FAILURE);
+        TEST(value_of(dbms, tid, 6) == "init");
+
+        // disjoint transactions are both committed
+        xid = dbms.begin_trx();
+        xid2 = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 7, make_record(7, "a"), xid));
+        TEST_SUCCESS(dbms.update(tid, 8, make_record(8, "b"), xid2));
+        TEST_SUCCESS(dbms.end_trx(xid2));
+        TEST_SUCCESS(dbms.end_trx(xid));
+
+        // records sharing the version word are locked once
+        OccManager words;
+        prikey_t alias = 10;
+        while (&words.word_of({ tid, alias }) != &words.word_of({ tid, 9 })) {
+            ++alias;
+        }
+        xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 9, make_record(9, "c"), xid));
+        TEST_SUCCESS(dbms.insert(
+            tid, alias, reinterpret_cast<uint8_t const*>("alias"), 6, xid));
+        TEST_SUCCESS(dbms.end_trx(xid));
+        TEST(value_of(dbms, tid, 9) == "c");
+        TEST(value_of(dbms, tid, alias) == "alias");
+
+        OccStats stats = dbms.occ_stats();
+        TEST(stats.num_commits == 5);
+        TEST(stats.num_conflicts == 2);
+    }
+    remove("testdb");
+})
+
+TEST_SUITE(OccManagerTest::abort, {
+    {
+        Database dbms(4);
+        tableid_t tid = prepare(dbms);
+
+        trxid_t xid = dbms.begin_trx();
+        TEST_SUCCESS(dbms.update(tid, 1, make_record(1, "new"), xid));
+        TEST_SUCCESS(dbms.remove(tid, 2, xid));
+        TEST_SUCCESS(dbms.abort_trx(xid));
+        TEST(dbms.find(tid, 1, nullptr, xid) == Status::FAILURE);
+        TEST(value_of(dbms, tid, 1) == "init");
+        TEST(value_of(dbms, tid, 2) == "init");
+    }
+    remove("testdb");
+})
+
+TEST_SUITE(OccManagerTest::concurrency, {
+    constexpr int NUM_THREAD = 4;
+    constexpr int NUM_INCR = 200;
+    {
+        Database dbms(16);
+        tableid_t tid = prepare(dbms);
+
+        Record zero = Record();
+        zero.key = 0;
+        dbms.update(tid, 0, zero);
+
+        // read-modify-write counter, retried on conflict
+        std::vector<std::thread> threads;
+        for (int i = 0; i < NUM_THREAD; ++i) {
+            threads.emplace_back([&] {
+                for (int j = 0; j < NUM_INCR; ++j) {
+                    while (true) {
+                        trxid_t xid = dbms.begin_trx();
+                        Record record;
+                        dbms.find(tid, 0, &record, xid);
+                        ++*reinterpret_cast<int*>(record.value);
+                        dbms.update(tid, 0, record, xid);
+                        if (dbms.end_trx(xid) == Status::SUCCESS) {
+                            break;
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        Record record;
+        TEST_SUCCESS(dbms.find(tid, 0, &record));
+        TEST(*reinterpret_cast<int*>(record.value) == NUM_THREAD * NUM_INCR);
+        TEST(dbms.occ_stats().num_commits == NUM_THREAD * NUM_INCR);
+    }
+    remove("testdb");
+})
+
+int occ_manager_test() {
+    return OccManagerTest::read_write_test()
+        && OccManagerTest::validate_test()
+        && OccManagerTest::abort_test()
+        && OccManagerTest::concurrency_test();
+}
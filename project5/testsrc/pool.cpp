@@ -0,0 +1,69 @@
+#include "pool.hpp"
+#include "test.hpp"
+
+#include <map>
+#include <set>
+#include <thread>
+
+using pool_t = BlockPool<24, 8>;
+
+TEST_SUITE(block_pool, {
+    std::set<void*> blocks;
+    for (size_t i = 0; i < 3 * pool_t::BATCH; ++i) {
+        blocks.insert(pool_t::allocate());
+    }
+    TEST(blocks.size() == 3 * pool_t::BATCH);
+
+    void* last = *blocks.begin();
+    for (void* block : blocks) {
+        pool_t::deallocate(block);
+        last = block;
+    }
+    // most recently freed block is reused first
+    TEST(pool_t::allocate() == last);
+    pool_t::deallocate(last);
+
+    // blocks freed by other thread are reusable
+    void* block = pool_t::allocate();
+    std::thread([&] { pool_t::deallocate(block); }).join();
+
+    std::set<void*> reused;
+    for (size_t i = 0; i < 4 * pool_t::BATCH; ++i) {
+        reused.insert(pool_t::allocate());
+    }
+    TEST(reused.find(block) != reused.end());
+    for (void* ptr : reused) {
+        pool_t::deallocate(ptr);
+    }
+})
+
+struct Data {
+    int value;
+    Data(int value) : value(value) {}
+};
+
+using pool_map_t = std::map<
+    int, int, std::less<int>, PoolAllocator<std::pair<int const, int>>>;
+
+TEST_SUITE(pool_allocator, {
+    Data* data = PoolAllocator<Data>::create(10);
+    TEST(data->value == 10);
+    PoolAllocator<Data>::destroy(data);
+    TEST(PoolAllocator<Data>::create(20) == data);
+    PoolAllocator<Data>::destroy(data);
+
+    pool_map_t map;
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i * 2;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        TEST(map[i] == i * 2);
+    }
+    map.clear();
+    TEST(map.size() == 0);
+})
+
+int pool_test() {
+    return block_pool_test()
+        && pool_allocator_test();
+}
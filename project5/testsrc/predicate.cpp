@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "dbms.hpp"
+#include "predicate.hpp"
+#include "test.hpp"
+
+struct PredicateTest {
+    TEST_METHOD(bytes)
+    TEST_METHOD(integer)
+    TEST_METHOD(scan)
+};
+
+static Record make_record(prikey_t key, char const* value, int32_t field) {
+    Record record = Record();
+    record.key = key;
+    std::strcpy(reinterpret_cast<char*>(record.value), value);
+    std::memcpy(record.value + 64, &field, sizeof(field));
+    return record;
+}
+
+Record fruits[] = {
+    make_record(1, "apple", 0),
+    make_record(2, "apricot", 0),
+    make_record(3, "banana", 0),
+};
+
+TEST_SUITE(PredicateTest::bytes, {
+    Record const* records = fruits;
+
+    Predicate pred;
+    std::vector<Record> out;
+    TEST(pred.filter(records, 3, out) == 3);
+
+    TEST_SUCCESS(pred.prefix("ap"));
+    out.clear();
+    TEST(pred.filter(records, 3, out) == 2);
+    TEST(out[0].key == 1 && out[1].key == 2);
+    TEST(pred.match(records[1]));
+    TEST(!pred.match(records[2]));
+
+    Predicate range;
+    TEST_SUCCESS(range.bytes(1, "pr", CompareOp::GE));
+    TEST(!range.match(records[0]));
+    TEST(range.match(records[1]));
+    TEST(!range.match(records[2]));
+    TEST_SUCCESS(range.bytes(0, "b", CompareOp::LT));
+    TEST(range.match(records[1]));
+
+    // out of the value
+    TEST(pred.bytes(120, "a") == Status::FAILURE);
+    TEST(pred.bytes(100, std::string(21, 'a')) == Status::FAILURE);
+    TEST_SUCCESS(pred.bytes(120, ""));
+})
+
+TEST_SUITE(PredicateTest::integer, {
+    std::vector<Record> records;
+    for (int i = 0; i < 200; ++i) {
+        records.push_back(make_record(i, "v", i % 50 - 25));
+    }
+
+    Predicate pred;
+    TEST_SUCCESS(pred.integer(64, CompareOp::LT, 0, 4));
+    std::vector<Record> out;
+    // larger than a block
+    TEST(pred.filter(records.data(), records.size(), out) == 100);
+    for (Record const& rec : out) {
+        TEST(rec.key % 50 < 25);
+    }
+
+    TEST_SUCCESS(pred.integer(64, CompareOp::NE, -10, 4));
+    TEST_SUCCESS(pred.integer(64, CompareOp::GE, -12, 1));
+    out.clear();
+    TEST(pred.filter(records.data(), records.size(), out) == 44);
+
+    Predicate eq;
+    TEST_SUCCESS(eq.integer(64, CompareOp::EQ, 7, 4));
+    TEST(eq.match(records[32]));
+    TEST(!eq.match(records[33]));
+
+    TEST(eq.integer(0, CompareOp::EQ, 0, 3) == Status::FAILURE);
+    TEST(eq.integer(113, CompareOp::EQ, 0, 8) == Status::FAILURE);
+    TEST_SUCCESS(eq.integer(112, CompareOp::EQ, 0, 8));
+})
+
+TEST_SUITE(PredicateTest::scan, {
+    {
+        Database dbms(1000);
+        tableid_t tid = dbms.open_table("testfile");
+        for (int i = 0; i < 3000; ++i) {
+            Record rec = make_record(i, i % 3 == 0 ? "fizz" : "buzz", i);
+            dbms.insert(tid, i, rec.value, sizeof(rec.value));
+        }
+
+        Predicate pred;
+        TEST_SUCCESS(pred.prefix("fi"));
+        TEST_SUCCESS(pred.integer(64, CompareOp::LT, 1500, 4));
+        std::vector<Record> found = dbms.find_range(tid, 100, 2999, &pred);
+        TEST(found.size() == 466);
+        for (size_t i = 0; i < found.size(); ++i) {
+            TEST(found[i].key == 102 + 3 * static_cast<prikey_t>(i));
+        }
+
+        // leaves without any match are skipped by the batches
+        Predicate none;
+        TEST_SUCCESS(none.integer(64, CompareOp::GT, 2990, 4));
+        auto iter = dbms[tid]->batches(0, 2999, &none);
+        TEST(iter.valid() && iter.batch().front().key == 2991);
+        TEST_SUCCESS(iter.next());
+        TEST(!iter.valid() || iter.batch().front().key > 2991);
+        TEST(dbms.find_range(tid, 0, 2999, &none).size() == 9);
+    }
+    remove("testfile");
+})
+
+int predicate_test() {
+    return PredicateTest::bytes_test()
+        && PredicateTest::integer_test()
+        && PredicateTest::scan_test();
+}
@@ -0,0 +1,541 @@
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "dbms.hpp"
+#include "query_engine.hpp"
+#include "test.hpp"
+
+struct QueryEngineTest {
+    TEST_METHOD(scan)
+    TEST_METHOD(aggregate)
+    TEST_METHOD(join)
+    TEST_METHOD(subquery)
+    TEST_METHOD(explain)
+};
+
+struct PokemonRow {
+    int64_t id;
+    char const* name;
+    char const* type;
+};
+
+struct TrainerRow {
+    int64_t id;
+    char const* name;
+    char const* hometown;
+};
+
+struct CatchedRow {
+    int64_t id;
+    int64_t owner_id;
+    int64_t pid;
+    int64_t level;
+    char const* nickname;
+};
+
+PokemonRow pokemons[] = {
+    { 1, "Bulbasaur", "Grass" }, { 2, "Ivysaur", "Grass" },
+    { 3, "Venusaur", "Grass" }, { 4, "Charmander", "Fire" },
+    { 5, "Charmeleon", "Fire" }, { 6, "Charizard", "Fire" },
+    { 7, "Squirtle", "Water" }, { 8, "Wartortle", "Water" },
+    { 9, "Blastoise", "Water" }, { 10, "Pikachu", "Electric" },
+    { 11, "Raichu", "Electric" }, { 12, "Oddish", "Grass" },
+    { 25, "Eevee", "Normal" },
+};
+
+TrainerRow trainers[] = {
+    { 1, "Red", "Pallet Town" }, { 2, "Blue", "Pallet Town" },
+    { 3, "Misty", "Cerulean City" }, { 4, "Brock", "Pewter City" },
+    { 5, "Yellow", "Viridian City" }, { 6, "Ash", "Pallet Town" },
+};
+
+CatchedRow catched[] = {
+    { 1, 1, 6, 50, "Zard" }, { 2, 1, 10, 30, "Sparky" },
+    { 3, 2, 9, 45, "Blasty" }, { 4, 3, 7, 20, "Squirt" },
+    { 5, 3, 8, 35, "Ace" }, { 6, 4, 25, 15, "Rocky" },
+    { 7, 5, 10, 50, "Chu" }, { 8, 6, 1, 10, "Bulby" },
+    { 9, 6, 4, 12, "Amber" },
+};
+
+int64_t evolutions[][2] = {
+    { 1, 2 }, { 2, 3 }, { 4, 5 }, { 5, 6 }, { 7, 8 }, { 8, 9 }, { 10, 11 },
+};
+
+int64_t gyms[] = { 3, 4 };
+
+char const* grass_names[] = { "Bulbasaur", "Ivysaur", "Oddish", "Venusaur" };
+char const* trainer_names[] = { "Ash", "Blue", "Brock", "Red" };
+char const* all_types[] = { "Electric", "Fire", "Grass", "Normal", "Water" };
+char const* c_names[] = { "Charizard", "Charmander", "Charmeleon" };
+char const* not_b_towns[] = {
+    "Cerulean City", "Pallet Town", "Viridian City",
+};
+char const* desc_types[] = { "Water", "Fire", "Grass" };
+char const* in_list_names[] = { "Bulbasaur", "Eevee" };
+char const* max_nicknames[] = { "Chu", "Zard" };
+char const* top_owners[] = { "1", "3" };
+char const* max_levels[] = { "50", "50", "35", "15" };
+char const* a_trainers[] = { "Ash", "Misty" };
+char const* a_nicknames[] = { "Amber", "Ace" };
+char const* leader_names[] = { "Misty", "Brock" };
+char const* leader_sums[] = { "55", "15" };
+char const* uncaught[] = {
+    "Charmeleon", "Ivysaur", "Oddish", "Raichu", "Venusaur",
+};
+char const* top_avg[] = { "Yellow" };
+char const* double_evolvable[] = { "Pikachu" };
+
+using column_list_t = std::vector<Column>;
+
+static Row make_row(Value first, Value second, Value third) {
+    return Row { first, second, third };
+}
+
+static Status insert(Database& dbms, Schema const& schema, Row const& row) {
+    Record record;
+    CHECK_SUCCESS(schema.encode(row, record));
+    return dbms.insert(
+        schema.id, record.key, record.value, sizeof(record.value));
+}
+
+static Value str(char const* value) {
+    return Value::of(std::string(value));
+}
+
+static Status prepare(Database& dbms, Catalog& catalog) {
+    CHECK_SUCCESS(catalog.define(
+        "Pokemon", dbms.open_table("testfile1"), column_list_t {
+            Column::integer("id", true),
+            Column::chars("name", 32),
+            Column::chars("type", 16),
+        }));
+    CHECK_SUCCESS(catalog.define(
+        "Trainer", dbms.open_table("testfile2"), column_list_t {
+            Column::integer("id", true),
+            Column::chars("name", 32),
+            Column::chars("hometown", 32),
+        }));
+    CHECK_SUCCESS(catalog.define(
+        "CatchedPokemon", dbms.open_table("testfile3"), column_list_t {
+            Column::integer("id", true),
+            Column::integer("owner_id"),
+            Column::integer("pid"),
+            Column::integer("level"),
+            Column::chars("nickname", 32),
+        }));
+    CHECK_SUCCESS(catalog.define(
+        "Evolution", dbms.open_table("testfile4"), column_list_t {
+            Column::integer("before_id", true),
+            Column::integer("after_id"),
+        }));
+    CHECK_SUCCESS(catalog.define(
+        "Gym", dbms.open_table("testfile5"), column_list_t {
+            Column::integer("leader_id", true),
+            Column::chars("city", 32),
+        }));
+
+    for (PokemonRow const& row : pokemons) {
+        CHECK_SUCCESS(insert(dbms, *catalog.find("pokemon"), make_row(
+            Value::of(row.id), str(row.name), str(row.type))));
+    }
+    for (TrainerRow const& row : trainers) {
+        CHECK_SUCCESS(insert(dbms, *catalog.find("trainer"), make_row(
+            Value::of(row.id), str(row.name), str(row.hometown))));
+    }
+    for (CatchedRow const& row : catched) {
+        Row values = make_row(
+            Value::of(row.id), Value::of(row.owner_id), Value::of(row.pid));
+        values.push_back(Value::of(row.level));
+        values.push_back(str(row.nickname));
+        CHECK_SUCCESS(insert(dbms, *catalog.find("catchedpokemon"), values));
+    }
+    for (auto const& row : evolutions) {
+        Row values = make_row(Value::of(row[0]), Value::of(row[1]), Value());
+        values.pop_back();
+        CHECK_SUCCESS(insert(dbms, *catalog.find("evolution"), values));
+    }
+    for (int64_t leader : gyms) {
+        Row values = make_row(Value::of(leader), str("Gym"), Value());
+        values.pop_back();
+        CHECK_SUCCESS(insert(dbms, *catalog.find("gym"), values));
+    }
+    return Status::SUCCESS;
+}
+
+static void cleanup() {
+    char filename[16];
+    for (int i = 1; i <= 7; ++i) {
+        std::snprintf(filename, sizeof(filename), "testfile%d", i);
+        remove(filename);
+    }
+}
+
+/// Execute the query and print the error if failed.
+static bool run(QueryEngine& engine, char const* sql, QueryResult& result) {
+    if (engine.execute(sql, result) != Status::SUCCESS) {
+        printf("query failed: %s\n", engine.error().c_str());
+        return false;
+    }
+    return true;
+}
+
+/// Whether the column of the result is same with the expected.
+template <size_t N>
+static bool column_is(
+    QueryResult const& result, size_t col, char const* const (&expected)[N]
+) {
+    if (result.rows.size() != N) {
+        return false;
+    }
+    for (size_t i = 0; i < N; ++i) {
+        if (result.rows[i][col].to_string() != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool contains(std::string const& text, char const* part) {
+    return text.find(part) != std::string::npos;
+}
+
+TEST_SUITE(QueryEngineTest::scan, {
+    {
+        Database dbms(1000);
+        Catalog catalog;
+        TEST_SUCCESS(prepare(dbms, catalog));
+        QueryEngine engine(dbms, catalog);
+        QueryResult result;
+
+        TEST(run(engine,
+            "select name from Pokemon where type = 'Grass' order by name",
+            result));
+        TEST(result.columns.size() == 1 && result.columns[0] == "name");
+        TEST(column_is(result, 0, grass_names));
+
+        TEST(run(engine,
+            "select name from Trainer "
+            "where hometown = 'Pallet Town' or hometown = 'Pewter City' "
+            "order by name", result));
+        TEST(column_is(result, 0, trainer_names));
+
+        TEST(run(engine,
+            "select distinct type from Pokemon order by type", result));
+        TEST(column_is(result, 0, all_types));
+
+        TEST(run(engine,
+            "select name from Pokemon where name like 'C%' order by name",
+            result));
+        TEST(column_is(result, 0, c_names));
+
+        TEST(run(engine,
+            "select distinct hometown from Trainer "
+            "where not name like 'B%' order by hometown", result));
+        TEST(column_is(result, 0, not_b_towns));
+
+        // distinct in the order of the column not in the select list
+        TEST(run(engine,
+            "select distinct type from Pokemon where id < 10 "
+            "order by id desc", result));
+        TEST(column_is(result, 0, desc_types));
+
+        TEST(run(engine,
+            "select name from Pokemon where id in (1, 25) order by name",
+            result));
+        TEST(column_is(result, 0, in_list_names));
+
+        // general pattern is matched after the scan
+        TEST(run(engine,
+            "select name from Pokemon where name like '_ika%u' "
+            "and 5 <= id", result));
+        TEST(result.rows.size() == 1);
+        TEST(result.rows[0][0].str == "Pikachu");
+
+        TEST(run(engine,
+            "select * from Trainer where id >= 6 or name = 'Red'", result));
+        TEST(result.columns.size() == 3);
+        TEST(result.rows.size() == 2);
+        TEST(result.rows[0][0].integer == 1);
+        TEST(result.rows[1][2].str == "Pallet Town");
+
+        // pattern longer than the column is not truncated in the leaf
+        TEST_SUCCESS(catalog.define(
+            "Code", dbms.open_table("testfile6"), column_list_t {
+                Column::integer("id", true),
+                Column::chars("c", 4),
+            }));
+        Row code = make_row(
+            Value::of(static_cast<int64_t>(1)), str("abcd"), Value());
+        code.pop_back();
+        TEST_SUCCESS(insert(dbms, *catalog.find("code"), code));
+        TEST(run(engine, "select id from Code where c like 'abcdef'", result));
+        TEST(result.rows.empty());
+        TEST(run(engine, "select id from Code where c like 'abcd'", result));
+        TEST(result.rows.size() == 1);
+
+        TEST(engine.execute("select name from Nothing", result)
+            == Status::FAILURE);
+        TEST(engine.error() == "unknown table nothing");
+        TEST(engine.execute("select none from Pokemon", result)
+            == Status::FAILURE);
+        TEST(engine.error() == "unknown column none");
+        TEST(engine.execute("select name from", result) == Status::FAILURE);
+        TEST(!engine.error().empty());
+    }
+    cleanup();
+})
+
+TEST_SUITE(QueryEngineTest::aggregate, {
+    {
+        Database dbms(1000);
+        Catalog catalog;
+        TEST_SUCCESS(prepare(dbms, catalog));
+        QueryEngine engine(dbms, catalog);
+        QueryResult result;
+
+        TEST(run(engine, "select avg(level) from CatchedPokemon", result));
+        TEST(result.columns[0] == "avg(level)");
+        TEST(result.rows.size() == 1);
+        TEST(result.rows[0][0].type == Value::Type::REAL);
+        TEST(result.rows[0][0].real == 267.0 / 9);
+
+        TEST(run(engine,
+            "select count(*), sum(level), min(nickname), max(level) "
+            "from CatchedPokemon where level > 100", result));
+        TEST(result.rows.size() == 1);
+        TEST(result.rows[0][0].integer == 0);
+        TEST(result.rows[0][1].is_null());
+        TEST(result.rows[0][2].is_null());
+
+        TEST(run(engine,
+            "select count(*) from Pokemon where type != 'Fire'", result));
+        TEST(result.rows[0][0].integer == 10);
+
+        TEST(run(engine,
+            "select owner_id, count(*) as cnt from CatchedPokemon "
+            "group by owner_id order by cnt desc, owner_id limit 2", result));
+        TEST(result.columns[1] == "cnt");
+        TEST(column_is(result, 0, top_owners));
+        TEST(result.rows[1][1].integer == 2);
+
+        TEST(run(engine,
+            "select max(c.level) as max_level from CatchedPokemon c, "
+            "Trainer t where c.owner_id = t.id group by t.hometown "
+            "order by max_level desc", result));
+        TEST(column_is(result, 0, max_levels));
+
+        TEST(engine.execute(
+            "select name from Pokemon where max(id) > 3", result)
+                == Status::FAILURE);
+
+        // integer sum out of the range fails instead of wrapping around
+        TEST_SUCCESS(catalog.define(
+            "Big", dbms.open_table("testfile7"), column_list_t {
+                Column::integer("id", true),
+                Column::integer("amount"),
+            }));
+        for (int64_t id = 1; id <= 2; ++id) {
+            Row big = make_row(Value::of(id), Value::of(
+                std::numeric_limits<int64_t>::max() - id), Value());
+            big.pop_back();
+            TEST_SUCCESS(insert(dbms, *catalog.find("big"), big));
+        }
+        TEST(run(engine, "select max(amount) from Big", result));
+        TEST(engine.execute("select sum(amount) from Big", result)
+            == Status::FAILURE);
+        TEST(engine.execute("select avg(amount) from Big", result)
+            == Status::FAILURE);
+        TEST(run(engine, "select sum(amount) from Big where id = 1", result));
+        TEST(result.rows[0][0].integer
+            == std::numeric_limits<int64_t>::max() - 1);
+    }
+    cleanup();
+})
+
+TEST_SUITE(QueryEngineTest::join, {
+    {
+        Database dbms(1000);
+        Catalog catalog;
+        TEST_SUCCESS(prepare(dbms, catalog));
+        QueryEngine engine(dbms, catalog);
+        QueryResult result;
+
+        TEST(run(engine,
+            "select t.name, c.nickname from Trainer t, CatchedPokemon c "
+            "where t.id = c.owner_id and c.nickname like 'A%' "
+            "order by t.name", result));
+        TEST(column_is(result, 0, a_trainers));
+        TEST(column_is(result, 1, a_nicknames));
+
+        TEST(run(engine,
+            "select t.name, p.name from Trainer t, CatchedPokemon c, "
+            "Pokemon p where t.id = c.owner_id and c.pid = p.id "
+            "order by t.name, p.name", result));
+        TEST(result.rows.size() == 9);
+        TEST(result.rows[0][0].str == "Ash");
+        TEST(result.rows[0][1].str == "Bulbasaur");
+        TEST(result.rows[8][0].str == "Yellow");
+        TEST(result.rows[8][1].str == "Pikachu");
+
+        // primary key join of the unfiltered tables
+        TEST(run(engine,
+            "select p.name, e.after_id from Pokemon p, Evolution e "
+            "where p.id = e.before_id order by p.name", result));
+        TEST(result.rows.size() == 7);
+        TEST(result.rows[0][0].str == "Bulbasaur");
+        TEST(result.rows[0][1].integer == 2);
+
+        TEST(run(engine,
+            "select t.name, sum(c.level) as sum_level "
+            "from CatchedPokemon c, Trainer t "
+            "where c.owner_id = t.id and c.owner_id in "
+            "(select leader_id from Gym) "
+            "group by c.owner_id order by sum_level desc", result));
+        TEST(column_is(result, 0, leader_names));
+        TEST(column_is(result, 1, leader_sums));
+
+        // cross join
+        TEST(run(engine,
+            "select count(*) from Trainer t, Gym g where t.id > 4", result));
+        TEST(result.rows[0][0].integer == 4);
+
+        TEST(engine.execute(
+            "select name from Trainer t, Pokemon p", result)
+                == Status::FAILURE);
+        TEST(engine.error() == "ambiguous column name");
+    }
+    cleanup();
+})
+
+TEST_SUITE(QueryEngineTest::subquery, {
+    {
+        Database dbms(1000);
+        Catalog catalog;
+        TEST_SUCCESS(prepare(dbms, catalog));
+        QueryEngine engine(dbms, catalog);
+        QueryResult result;
+
+        TEST(run(engine,
+            "select nickname from CatchedPokemon "
+            "where level = (select max(level) from CatchedPokemon) "
+            "order by nickname", result));
+        TEST(column_is(result, 0, max_nicknames));
+
+        TEST(run(engine,
+            "select max(level) from CatchedPokemon where owner_id in "
+            "(select id from Trainer where name = 'Yellow')", result));
+        TEST(result.rows[0][0].integer == 50);
+
+        TEST(run(engine,
+            "select name from Pokemon where id not in "
+            "(select distinct pid from CatchedPokemon) order by name",
+            result));
+        TEST(column_is(result, 0, uncaught));
+
+        TEST(run(engine,
+            "select name from Trainer where id in ("
+            "  select c.owner_id from ("
+            "    select owner_id, avg(level) as avg_level"
+            "    from CatchedPokemon group by owner_id) c"
+            "  where c.avg_level = (select max(tmp.avg_level) from ("
+            "    select avg(level) as avg_level from CatchedPokemon"
+            "    group by owner_id) as tmp))"
+            "order by name", result));
+        TEST(column_is(result, 0, top_avg));
+
+        TEST(run(engine,
+            "select p.name from Evolution e, Pokemon p "
+            "where e.before_id = p.id "
+            "and e.before_id not in (select after_id from Evolution) "
+            "and e.after_id not in (select before_id from Evolution) "
+            "order by p.name", result));
+        TEST(column_is(result, 0, double_evolvable));
+
+        TEST(run(engine,
+            "select name, (select count(*) from Gym) as gyms from Trainer "
+            "where id = 1", result));
+        TEST(result.rows.size() == 1);
+        TEST(result.rows[0][1].integer == 2);
+
+        // correlated subquery is not supported
+        TEST(engine.execute(
+            "select e.before_id, "
+            "(select name from Pokemon where id = e.before_id) as first "
+            "from Evolution e", result) == Status::FAILURE);
+        TEST(engine.error() == "unknown column e.before_id");
+
+        TEST(engine.execute(
+            "select name from Pokemon where id = (select id from Trainer)",
+            result) == Status::FAILURE);
+        TEST(engine.error() == "subquery returns more than one row");
+        TEST(engine.execute(
+            "select name from Pokemon where id in (select * from Trainer)",
+            result) == Status::FAILURE);
+        TEST(engine.error() == "subquery must return one column");
+    }
+    cleanup();
+})
+
+TEST_SUITE(QueryEngineTest::explain, {
+    {
+        Database dbms(1000);
+        Catalog catalog;
+        TEST_SUCCESS(prepare(dbms, catalog));
+        QueryEngine engine(dbms, catalog);
+        QueryResult result;
+
+        // conjuncts are pushed down to the key range and the leaf
+        TEST(run(engine,
+            "explain select name from Pokemon "
+            "where id < 10 and type = 'Grass' and name like 'B%' "
+            "and name like '%a%'", result));
+        TEST(result.rows.empty());
+        TEST(contains(result.plan,
+            "Scan pokemon key: id < 10 "
+            "filter: type = 'Grass' and name like 'B%'"));
+        TEST(contains(result.plan, "Filter: name like '%a%'"));
+        TEST(!contains(result.plan, "rows="));
+
+        TEST(run(engine,
+            "explain select p.name, e.after_id from Pokemon p, Evolution e "
+            "where p.id = e.before_id", result));
+        TEST(contains(result.plan, "PkJoin: p.id = e.before_id"));
+
+        TEST(run(engine,
+            "explain select t.name, p.name from Trainer t, CatchedPokemon c, "
+            "Pokemon p where t.id = c.owner_id and c.pid = p.id "
+            "and p.type = 'Water'", result));
+        TEST(contains(result.plan, "HashJoin: t.id = c.owner_id"));
+        TEST(contains(result.plan,
+            "IndexJoin pokemon p: c.pid = p.id filter: p.type = 'Water'"));
+
+        // subquery is planned but not evaluated without analyze
+        TEST(run(engine,
+            "explain select name from Pokemon where id in "
+            "(select pid from CatchedPokemon where level >= 30)", result));
+        TEST(contains(result.plan, "SubPlan in"));
+        TEST(contains(result.plan,
+            "Scan catchedpokemon filter: level >= 30"));
+
+        TEST(run(engine,
+            "explain analyze select name from Pokemon where id in "
+            "(select pid from CatchedPokemon where level >= 30) "
+            "order by name", result));
+        TEST(result.rows.size() == 4);
+        TEST(contains(result.plan, "Sort: name (rows=4, time="));
+        TEST(contains(result.plan,
+            "Scan catchedpokemon filter: level >= 30 (rows=5, time="));
+        TEST(contains(result.plan, "Scan pokemon (rows=13, time="));
+    }
+    cleanup();
+})
+
+int query_engine_test() {
+    return QueryEngineTest::scan_test()
+        && QueryEngineTest::aggregate_test()
+        && QueryEngineTest::join_test()
+        && QueryEngineTest::subquery_test()
+        && QueryEngineTest::explain_test();
+}
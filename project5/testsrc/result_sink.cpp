@@ -0,0 +1,208 @@
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "result_sink.hpp"
+#include "test.hpp"
+
+struct ResultSinkTest {
+    TEST_METHOD(format_int)
+    TEST_METHOD(csv)
+    TEST_METHOD(binary)
+    TEST_METHOD(gather)
+    TEST_METHOD(ranges)
+};
+
+int64_t int_samples[] = {
+    0, 1, -1, 9, 10, -10, 99, 100, 12345, -987654321,
+    std::numeric_limits<int64_t>::max(),
+    std::numeric_limits<int64_t>::min(),
+};
+
+static Record make_record(prikey_t key, char const* value) {
+    Record record = Record();
+    record.key = key;
+    std::strcpy(reinterpret_cast<char*>(record.value), value);
+    return record;
+}
+
+static std::string read_file(char const* filename) {
+    std::string content;
+    FILE* fp = fopen(filename, "rb");
+    if (fp == nullptr) {
+        return content;
+    }
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        content.append(buf, len);
+    }
+    fclose(fp);
+    return content;
+}
+
+TEST_SUITE(ResultSinkTest::format_int, {
+    char buf[32];
+    for (int64_t value : int_samples) {
+        size_t len = ResultBuffer::format_int(buf, value);
+        TEST(std::string(buf, len) == std::to_string(value));
+    }
+})
+
+TEST_SUITE(ResultSinkTest::csv, {
+    {
+        // small buffer, flushed many times
+        ResultSink sink(SinkFormat::CSV, 512);
+        TEST_SUCCESS(sink.open("testfile"));
+
+        std::string expected;
+        for (int i = -50; i < 50; ++i) {
+            std::string value = "v" + std::to_string(i * 7);
+            Record rec1 = make_record(i, value.c_str());
+            Record rec2 = make_record(i * 1000, "right");
+            TEST_SUCCESS(sink.write(rec1, rec2));
+            TEST(sink.buffer.size() <= 512);
+            expected += std::to_string(i) + "," + value + ","
+                + std::to_string(i * 1000) + ",right\n";
+        }
+        TEST_SUCCESS(sink.write(make_record(7, "single")));
+        expected += "7,single\n";
+
+        // value without null terminator is written in full length
+        Record full = Record();
+        full.key = 1;
+        std::memset(full.value, 'a', sizeof(full.value));
+        TEST_SUCCESS(sink.write(full));
+        expected += "1," + std::string(sizeof(full.value), 'a') + "\n";
+
+        TEST_SUCCESS(sink.close());
+        TEST(read_file("testfile") == expected);
+    }
+    remove("testfile");
+})
+
+TEST_SUITE(ResultSinkTest::binary, {
+    {
+        ResultSink sink(SinkFormat::BINARY, 1024);
+        TEST_SUCCESS(sink.open("testfile"));
+        for (int i = 0; i < 20; ++i) {
+            TEST_SUCCESS(sink.write(
+                make_record(i, "left"), make_record(-i, "right")));
+        }
+        TEST_SUCCESS(sink.close());
+
+        std::string content = read_file("testfile");
+        TEST(content.size() == 40 * sizeof(Record));
+        Record const* records =
+            reinterpret_cast<Record const*>(content.data());
+        for (int i = 0; i < 20; ++i) {
+            TEST(records[2 * i].key == i);
+            TEST(records[2 * i + 1].key == -i);
+            TEST(std::strcmp(
+                reinterpret_cast<char const*>(records[2 * i + 1].value),
+                "right") == 0);
+        }
+    }
+    remove("testfile");
+})
+
+TEST_SUITE(ResultSinkTest::gather, {
+    {
+        ResultSink sink;
+        TEST_SUCCESS(sink.open("testfile"));
+        TEST_SUCCESS(sink.write(make_record(0, "head")));
+
+        // buffers grow beyond the initial capacity
+        std::vector<ResultBuffer> buffers;
+        std::string expected = "0,head\n";
+        for (int i = 0; i < 4; ++i) {
+            buffers.emplace_back(SinkFormat::CSV, 16);
+            for (int j = 0; j < 10 * i; ++j) {
+                buffers.back().append(make_record(i, "a"), make_record(j, "b"));
+                expected += std::to_string(i) + ",a,"
+                    + std::to_string(j) + ",b\n";
+            }
+        }
+        TEST_SUCCESS(sink.write(buffers));
+        TEST(sink.buffer.size() == 0);
+
+        buffers.clear();
+        buffers.emplace_back(SinkFormat::BINARY);
+        TEST(sink.write(buffers) == Status::FAILURE);
+
+        TEST_SUCCESS(sink.close());
+        TEST(read_file("testfile") == expected);
+    }
+    remove("testfile");
+})
+
+constexpr size_t NUM_RANGES = 4;
+
+/// Write the rows of the range and finish it.
+static Status write_range(RangeWriter& writer, size_t range, int num_rows) {
+    Status res = Status::SUCCESS;
+    for (int i = 0; i < num_rows && res == Status::SUCCESS; ++i) {
+        res = writer.write(range, make_record(range, "a"), make_record(i, "b"));
+    }
+    return writer.finish(range, res);
+}
+
+TEST_SUITE(ResultSinkTest::ranges, {
+    {
+        ResultSink sink;
+        TEST_SUCCESS(sink.open("testfile"));
+
+        // small buffers, later ranges wait for their turn
+        RangeWriter writer(sink, NUM_RANGES, 512);
+        std::vector<Status> results(NUM_RANGES, Status::FAILURE);
+        std::vector<std::thread> workers;
+        for (size_t i = NUM_RANGES; i-- > 0;) {
+            workers.emplace_back([&, i] {
+                results[i] = write_range(writer, i, 100);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        std::string expected;
+        for (size_t i = 0; i < NUM_RANGES; ++i) {
+            TEST(results[i] == Status::SUCCESS);
+            for (int j = 0; j < 100; ++j) {
+                expected += std::to_string(i) + ",a,"
+                    + std::to_string(j) + ",b\n";
+            }
+        }
+        TEST_SUCCESS(sink.close());
+        TEST(read_file("testfile") == expected);
+    }
+
+    {
+        // failed range stops the waiting ones
+        ResultSink sink;
+        TEST_SUCCESS(sink.open("testfile"));
+        RangeWriter writer(sink, 2, 512);
+        Status later = Status::SUCCESS;
+        std::thread worker([&] {
+            later = write_range(writer, 1, 100);
+        });
+        TEST_SUCCESS(writer.write(0, make_record(0, "a"), make_record(0, "b")));
+        TEST(writer.finish(0, Status::FAILURE) == Status::FAILURE);
+        worker.join();
+        TEST(later == Status::FAILURE);
+        TEST(writer.write(1, make_record(1, "a"), make_record(1, "b"))
+            == Status::FAILURE);
+    }
+    remove("testfile");
+})
+
+int result_sink_test() {
+    return ResultSinkTest::format_int_test()
+        && ResultSinkTest::csv_test()
+        && ResultSinkTest::binary_test()
+        && ResultSinkTest::gather_test()
+        && ResultSinkTest::ranges_test();
+}
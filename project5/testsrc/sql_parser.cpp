@@ -0,0 +1,160 @@
+#include <string>
+
+#include "sql_parser.hpp"
+#include "test.hpp"
+
+struct SqlParserTest {
+    TEST_METHOD(tokenize)
+    TEST_METHOD(select)
+    TEST_METHOD(subquery)
+    TEST_METHOD(error)
+};
+
+char const* token_texts[] = {
+    "select", "name", ",", "-", "3", ",", "1.25", "from", "t",
+    "where", "a", "<>", "O'Neil", "and", "b", ">=", "2", ";", "",
+};
+
+char const* invalid_sqls[] = {
+    "",
+    "select",
+    "select a",
+    "select a from",
+    "select a from t where",
+    "select a from t where a like b",
+    "select a from t where a not = 1",
+    "select a from t limit x",
+    "select a from t order name",
+    "select a from (select b from u)",
+    "select a from t as",
+    "select a from t where a = 'open",
+    "select a from t where a = #",
+    "select a from t t2 t3",
+    "select count( from t",
+};
+
+static std::string canonical(std::string const& sql) {
+    SqlParser parser(sql);
+    Statement stmt;
+    if (parser.parse(stmt) != Status::SUCCESS) {
+        return "error: " + parser.error();
+    }
+    return stmt.select->to_string();
+}
+
+TEST_SUITE(SqlParserTest::tokenize, {
+    SqlParser parser(
+        "SELECT Name, -3, 1.25 FROM t -- comment\n"
+        "WHERE a <> 'O''Neil' AND b>=2;");
+    TEST_SUCCESS(parser.tokenize());
+
+    size_t num_tokens = sizeof(token_texts) / sizeof(token_texts[0]);
+    TEST(parser.tokens.size() == num_tokens);
+    for (size_t i = 0; i < parser.tokens.size(); ++i) {
+        TEST(parser.tokens[i].text == token_texts[i]);
+    }
+    TEST(parser.tokens[12].kind == SqlParser::Token::Kind::STRING);
+    TEST(parser.tokens[6].kind == SqlParser::Token::Kind::NUMBER);
+    TEST(parser.tokens.back().kind == SqlParser::Token::Kind::END);
+})
+
+TEST_SUITE(SqlParserTest::select, {
+    SqlParser parser(
+        "select distinct T.Name as n, count(*) cnt from Trainer T, City "
+        "where not t.name like 'M%' and (a = 1 or b != 'x') "
+        "group by t.name order by cnt desc, n limit 3");
+    Statement stmt;
+    TEST_SUCCESS(parser.parse(stmt));
+    TEST(!stmt.explain && !stmt.analyze);
+
+    Select const& select = *stmt.select;
+    TEST(select.distinct);
+    TEST(select.items.size() == 2);
+    TEST(select.items[0].alias == "n");
+    TEST(select.items[0].expr->kind == Expr::Kind::COLUMN);
+    TEST(select.items[0].expr->table == "t");
+    TEST(select.items[1].alias == "cnt");
+    TEST(select.items[1].expr->kind == Expr::Kind::AGGREGATE);
+    TEST(select.items[1].expr->args[0]->kind == Expr::Kind::STAR);
+    TEST(select.from.size() == 2);
+    TEST(select.from[0].name == "trainer" && select.from[0].alias == "t");
+    TEST(select.from[1].name == "city" && select.from[1].alias.empty());
+    TEST(select.where->kind == Expr::Kind::AND);
+    TEST(select.where->args[0]->kind == Expr::Kind::NOT);
+    TEST(select.group_by.size() == 1);
+    TEST(select.order_by.size() == 2);
+    TEST(select.order_by[0].desc && !select.order_by[1].desc);
+    TEST(select.limit == 3);
+
+    TEST(select.to_string() ==
+        "select distinct t.name as n, count(*) as cnt from trainer t, city "
+        "where (not t.name like 'M%' and (a = 1 or b != 'x')) "
+        "group by t.name order by cnt desc, n limit 3");
+
+    // explain, precedence of and over or, literals
+    SqlParser explain("explain analyze select * from t;");
+    TEST_SUCCESS(explain.parse(stmt));
+    TEST(stmt.explain && stmt.analyze);
+    TEST(stmt.select->items[0].expr->kind == Expr::Kind::STAR);
+
+    TEST(canonical("select a from t where a = 1 or b = 2 and c = 3")
+        == "select a from t where (a = 1 or (b = 2 and c = 3))");
+    TEST(canonical("select a from t where a in (1, -2, 'it''s')")
+        == "select a from t where a in (1, -2, 'it''s')");
+    TEST(canonical("select a from t where x not like 'a_%' and y >= 0.5")
+        == "select a from t where (x not like 'a_%' and y >= 0.5000)");
+})
+
+TEST_SUITE(SqlParserTest::subquery, {
+    SqlParser parser(
+        "select name from Trainer where id in ("
+        "  select c.owner_id from ("
+        "    select owner_id, avg(level) as avg_level from CatchedPokemon"
+        "    group by owner_id) c"
+        "  where c.avg_level = (select max(tmp.avg_level) from ("
+        "    select avg(level) as avg_level from CatchedPokemon"
+        "    group by owner_id) as tmp))"
+        "order by name");
+    Statement stmt;
+    TEST_SUCCESS(parser.parse(stmt));
+
+    Expr const& in = *stmt.select->where;
+    TEST(in.kind == Expr::Kind::IN);
+    TEST(!in.negated);
+    TEST(in.query != nullptr);
+
+    Select const& inner = *in.query;
+    TEST(inner.from.size() == 1);
+    TEST(inner.from[0].alias == "c");
+    TEST(inner.from[0].query != nullptr);
+    TEST(inner.from[0].query->group_by.size() == 1);
+
+    Expr const& cmp = *inner.where;
+    TEST(cmp.kind == Expr::Kind::COMPARE);
+    TEST(cmp.args[1]->kind == Expr::Kind::SUBQUERY);
+    TEST(cmp.args[1]->query->from[0].alias == "tmp");
+
+    TEST(canonical("select a from t where b not in (select c from u)")
+        == "select a from t where b not in (select c from u)");
+})
+
+TEST_SUITE(SqlParserTest::error, {
+    for (char const* sql : invalid_sqls) {
+        SqlParser parser(sql);
+        Statement stmt;
+        TEST(parser.parse(stmt) == Status::FAILURE);
+        TEST(!parser.error().empty());
+    }
+
+    SqlParser parser("select a from t where a = #");
+    Statement stmt;
+    TEST(parser.parse(stmt) == Status::FAILURE);
+    TEST(parser.error() == "invalid character at 26 near '#'");
+})
+
+int sql_parser_test() {
+    return SqlParserTest::tokenize_test()
+        && SqlParserTest::select_test()
+        && SqlParserTest::subquery_test()
+        && SqlParserTest::error_test();
+}
@@ -11,9 +11,18 @@ TEST_SUITE(unit, {
     TEST(table_manager_test());
     TEST(join_test());
     TEST(hashable_test());
+    TEST(pool_test());
     TEST(lock_manager_test());
     TEST(log_manager_test());
     TEST(xaction_manager_test());
+    TEST(version_manager_test());
+    TEST(occ_manager_test());
+    TEST(result_sink_test());
+    TEST(aggregate_test());
+    TEST(predicate_test());
+    TEST(catalog_test());
+    TEST(sql_parser_test());
+    TEST(query_engine_test());
 })
 
 int main() {
@@ -37,8 +37,17 @@ int bptree_iter_test();
 int table_manager_test();
 int join_test();
 int hashable_test();
+int pool_test();
 int lock_manager_test();
 int log_manager_test();
 int xaction_manager_test();
+int version_manager_test();
+int occ_manager_test();
+int result_sink_test();
+int aggregate_test();
+int predicate_test();
+int catalog_test();
+int sql_parser_test();
+int query_engine_test();
 // int dbms_test();
 // int dbapi_test();
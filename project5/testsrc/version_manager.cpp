@@ -0,0 +1,166 @@
+#include "version_manager.hpp"
+#include "test.hpp"
+
+#include <cstring>
+
+struct VersionManagerTest {
+    TEST_METHOD(begin)
+    TEST_METHOD(read)
+    TEST_METHOD(abort)
+    TEST_METHOD(conflict)
+    TEST_METHOD(collect)
+};
+
+static Record make_record(prikey_t key, char const* value) {
+    Record record;
+    record.key = key;
+    std::strcpy(reinterpret_cast<char*>(record.value), value);
+    return record;
+}
+
+static bool value_is(Record const& record, char const* value) {
+    return std::strcmp(
+        reinterpret_cast<char const*>(record.value), value) == 0;
+}
+
+TEST_SUITE(VersionManagerTest::begin, {
+    VersionManager versions;
+    TEST(versions.begin(1) == 0);
+    TEST_SUCCESS(versions.commit(1));
+    TEST(versions.begin(2) == 1);
+    TEST(versions.begin(3) == 1);
+    TEST(versions.stats().oldest == 1);
+
+    TEST_SUCCESS(versions.commit(3));
+    TEST(versions.stats().oldest == 1);
+    TEST_SUCCESS(versions.abort(2));
+    TEST(versions.stats().oldest == 2);
+
+    // unknown transaction is ignored
+    TEST_SUCCESS(versions.commit(10));
+    TEST_SUCCESS(versions.abort(10));
+})
+
+TEST_SUITE(VersionManagerTest::read, {
+    VersionManager versions;
+    Record page = make_record(1, "old");
+
+    versions.begin(1);
+    versions.begin(2);
+    TEST_SUCCESS(versions.record(1, 0, 1, true, page));
+    TEST_SUCCESS(versions.record(1, 0, 1, true, make_record(1, "mid")));
+    TEST(versions.stats().num_versions == 1);
+    page = make_record(1, "new");
+
+    // own write is visible, others read the committed image
+    Record record = page;
+    TEST_SUCCESS(versions.read(1, 0, 1, true, &record));
+    TEST(value_is(record, "new"));
+    record = page;
+    TEST_SUCCESS(versions.read(2, 0, 1, true, &record));
+    TEST(value_is(record, "old"));
+
+    // commit after the snapshot is invisible
+    TEST_SUCCESS(versions.commit(1));
+    record = page;
+    TEST_SUCCESS(versions.read(2, 0, 1, true, &record));
+    TEST(value_is(record, "old"));
+
+    versions.begin(3);
+    record = page;
+    TEST_SUCCESS(versions.read(3, 0, 1, true, &record));
+    TEST(value_is(record, "new"));
+
+    // uncommitted insert and delete
+    versions.begin(4);
+    TEST_SUCCESS(versions.record(4, 0, 2, false, make_record(2, "")));
+    TEST_SUCCESS(versions.record(4, 0, 3, true, make_record(3, "del")));
+    TEST(versions.read(3, 0, 2, true, &record) == Status::FAILURE);
+    TEST_SUCCESS(versions.read(3, 0, 3, false, &record));
+    TEST(value_is(record, "del"));
+    TEST_SUCCESS(versions.read(4, 0, 2, true, &record));
+    TEST(versions.read(4, 0, 3, false, &record) == Status::FAILURE);
+
+    // no version, page is the answer
+    TEST_SUCCESS(versions.read(3, 1, 1, true, nullptr));
+    TEST(versions.read(3, 1, 1, false, nullptr) == Status::FAILURE);
+})
+
+TEST_SUITE(VersionManagerTest::abort, {
+    VersionManager versions;
+    versions.begin(1);
+    TEST_SUCCESS(versions.record(1, 0, 1, true, make_record(1, "old")));
+    TEST(versions.stats().num_versions == 1);
+    TEST_SUCCESS(versions.abort(1));
+    TEST(versions.stats().num_versions == 0);
+
+    // aborted version in the middle of the chain
+    versions.begin(2);
+    versions.begin(3);
+    versions.begin(4);
+    TEST_SUCCESS(versions.record(2, 0, 1, true, make_record(1, "old")));
+    TEST_SUCCESS(versions.record(3, 0, 1, true, make_record(1, "old")));
+    TEST_SUCCESS(versions.abort(2));
+    TEST(versions.stats().num_versions == 1);
+
+    Record record = make_record(1, "new");
+    TEST_SUCCESS(versions.read(4, 0, 1, true, &record));
+    TEST(value_is(record, "old"));
+})
+
+TEST_SUITE(VersionManagerTest::conflict, {
+    VersionManager versions;
+    versions.begin(1);
+    versions.begin(2);
+    TEST(!versions.conflict(1, 0, 1));
+    TEST_SUCCESS(versions.record(2, 0, 1, true, make_record(1, "old")));
+    TEST(!versions.conflict(2, 0, 1));
+    TEST_SUCCESS(versions.commit(2));
+
+    // first updater wins
+    TEST(versions.conflict(1, 0, 1));
+    TEST(!versions.conflict(1, 0, 2));
+    versions.begin(3);
+    TEST(!versions.conflict(3, 0, 1));
+
+    // aborted writer is not a conflict
+    versions.begin(4);
+    TEST_SUCCESS(versions.record(4, 0, 2, true, make_record(2, "old")));
+    TEST(!versions.conflict(3, 0, 2));
+})
+
+TEST_SUITE(VersionManagerTest::collect, {
+    VersionManager versions;
+    versions.begin(1);
+    versions.begin(2);
+    TEST_SUCCESS(versions.record(2, 0, 1, true, make_record(1, "v0")));
+    TEST_SUCCESS(versions.commit(2));
+
+    // snapshot 1 still needs the image
+    TEST(versions.stats().num_versions == 1);
+    TEST(versions.collect() == 0);
+
+    versions.begin(3);
+    TEST_SUCCESS(versions.record(3, 0, 1, true, make_record(1, "v1")));
+    TEST_SUCCESS(versions.commit(3));
+    TEST(versions.stats().num_versions == 2);
+
+    Record record = make_record(1, "v2");
+    TEST_SUCCESS(versions.read(1, 0, 1, true, &record));
+    TEST(value_is(record, "v0"));
+
+    // oldest snapshot advances, both versions are unreachable
+    TEST_SUCCESS(versions.commit(1));
+    VersionStats stats = versions.stats();
+    TEST(stats.num_versions == 0);
+    TEST(stats.num_collected == 2);
+    TEST(stats.oldest == 3);
+})
+
+int version_manager_test() {
+    return VersionManagerTest::begin_test()
+        && VersionManagerTest::read_test()
+        && VersionManagerTest::abort_test()
+        && VersionManagerTest::conflict_test()
+        && VersionManagerTest::collect_test();
+}
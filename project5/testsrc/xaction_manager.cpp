@@ -1,4 +1,11 @@
+#include "dbms.hpp"
 #include "test.hpp"
+#include "xaction_manager.hpp"
+
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 struct TransactionTest {
 TEST_METHOD(constructor);
@@ -63,15 +70,84 @@ TEST_SUITE(TransactionManagerTest::constructor, {
 })
 
 TEST_SUITE(TransactionManagerTest::new_trx, {
-
+    LockManager locks;
+    TransactionManager trxs(locks);
+    TEST(trxs.new_trx() == 1);
+    TEST(trxs.new_trx() == 2);
+
+    // IDs are unique across the threads
+    std::mutex mtx;
+    std::set<trxid_t> ids;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            std::vector<trxid_t> local;
+            for (int j = 0; j < 1000; ++j) {
+                local.push_back(trxs.new_trx());
+            }
+            std::unique_lock<std::mutex> own(mtx);
+            ids.insert(local.begin(), local.end());
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    TEST(ids.size() == 4000);
+    TEST(ids.find(INVALID_TRXID) == ids.end());
+
+    // wrap around to the first ID
+    TEST_SUCCESS(trxs.end_trx(1));
+    trxs.last_id = std::numeric_limits<trxid_t>::max();
+    TEST(trxs.new_trx() == 1);
 })
 
 TEST_SUITE(TransactionManagerTest::end_trx, {
-
+    LockManager locks;
+    TransactionManager trxs(locks);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; ++j) {
+                trxid_t xid = trxs.new_trx();
+                if (trxs.end_trx(xid) != Status::SUCCESS) {
+                    return;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    TEST(trxs.last_id == 4000);
+    for (auto const& shard : trxs.shards) {
+        TEST(shard.trxs.empty());
+    }
+    TEST(trxs.end_trx(1) == Status::FAILURE);
 })
 
 TEST_SUITE(TransactionManagerTest::abort_trx, {
-
+    Database dbms(4);
+    TransactionManager& trxs = dbms.trxs;
+    trxid_t xid = trxs.new_trx();
+    trxid_t other = trxs.new_trx();
+    TEST_SUCCESS(trxs.abort_trx(xid, dbms));
+    TEST(trxs.trx_state(xid) == TrxState::INVALID);
+    TEST(trxs.abort_trx(xid, dbms) == Status::FAILURE);
+    TEST(trxs.trx_state(other) == TrxState::RUNNING);
+
+    // rollback is claimed once, entry is kept until the rollback ends
+    std::shared_ptr<Transaction> trx = trxs.find_trx(other);
+    TEST(trx != nullptr);
+    TEST_SUCCESS(trx->abort_trx(dbms));
+    TEST(trxs.abort_trx(other, dbms) == Status::FAILURE);
+    TEST(trxs.trx_state(other) == TrxState::ABORTED);
+
+    // found transaction outlives its entry
+    trxid_t third = trxs.new_trx();
+    std::shared_ptr<Transaction> held = trxs.find_trx(third);
+    TEST_SUCCESS(trxs.abort_trx(third, dbms));
+    TEST(trxs.find_trx(third) == nullptr);
+    TEST(held->get_state() == TrxState::ABORTED);
 })
 
 TEST_SUITE(TransactionManagerTest::require_lock, {
@@ -83,7 +159,13 @@ TEST_SUITE(TransactionManagerTest::release_locks, {
 })
 
 TEST_SUITE(TransactionManagerTest::trx_state, {
-
+    LockManager locks;
+    TransactionManager trxs(locks);
+    trxid_t xid = trxs.new_trx();
+    TEST(trxs.trx_state(xid) == TrxState::RUNNING);
+    TEST(trxs.trx_state(xid + 1) == TrxState::INVALID);
+    TEST_SUCCESS(trxs.end_trx(xid));
+    TEST(trxs.trx_state(xid) == TrxState::INVALID);
 })
 
 int xaction_manager_test() {